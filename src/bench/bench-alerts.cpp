@@ -0,0 +1,171 @@
+/**
+ * @file
+ *
+ * Measures the cost of checking price alerts against a stream of quotes,
+ * with the alerts indexed by threshold, against checking every alert on the
+ * symbol quoted.
+ */
+
+/*
+The MIT License (MIT)
+
+Copyright (c) 2015 David Bradshaw
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <random>
+#include <chrono>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <stocklib/alertbook.h>
+
+#include "bench.h"
+
+using std::cout;
+using std::endl;
+
+namespace
+{
+    typedef std::chrono::steady_clock clock;
+
+    double elapsed_ns(clock::time_point start)
+    {
+	return std::chrono::duration<double,std::nano>(clock::now()-start).count();
+    }
+
+    /** An alert, as a scan checks it */
+    struct rule
+    {
+	int64_t threshold;
+	sl_alert_direction_t direction;
+    };
+}
+
+/**
+ * Options: -r <alerts> (default 1000000), -s <symbols> (default 1000), -q
+ * <quotes> (default 1000000). Alerts repeat, so none are used up, and their
+ * thresholds lie within 20% of where each symbol starts; quotes move each
+ * symbol by up to 0.1% at a time.
+ */
+int bench_alerts(int argc, char* argv[])
+{
+    std::size_t rules = 1000000;
+    std::size_t symbols = 1000;
+    std::size_t quotes = 1000000;
+    int opt;
+    while ( (opt = getopt(argc,argv,"r:s:q:")) != -1 )
+	switch (opt)
+	{
+	case 'r':
+	    rules = atol(optarg);
+	    break;
+	case 's':
+	    symbols = atol(optarg);
+	    break;
+	case 'q':
+	    quotes = atol(optarg);
+	    break;
+	}
+
+    if ( !rules || !symbols || !quotes )
+    {
+	std::cerr << "Alerts, symbols and quotes must be positive" << endl;
+	return 1;
+    }
+
+    std::mt19937 random(42);
+    std::uniform_int_distribution<sl_symbol_t> pick(1,symbols);
+    std::uniform_int_distribution<int64_t> band(-200,200);
+    std::uniform_int_distribution<int64_t> step(-1,1);
+
+    std::vector<int64_t> prices(symbols+1);
+    for ( int64_t& p : prices )
+	p = 1000000;
+
+    alertbook book;
+    uint64_t delivered = 0;
+    book.callback( [&delivered](const sl_alert_t*, std::size_t n) { delivered += n; } );
+
+    std::vector<std::vector<rule>> scan(symbols+1);
+    clock::time_point start = clock::now();
+    for ( std::size_t i=0; i<rules; i++ )
+    {
+	const sl_symbol_t s = pick(random);
+	const int64_t threshold = prices[s] + band(random)*1000;
+	const sl_alert_direction_t d = (i%2) ? SLADAbove : SLADBelow;
+	book.add(s,d,threshold,true);
+	scan[s].push_back(rule{threshold,d});
+    }
+    const double add_ns = elapsed_ns(start)/rules;
+
+    for ( sl_symbol_t s=1; s<=symbols; s++ )
+	book.update(s,0,prices[s]);
+
+    std::vector<std::pair<sl_symbol_t,int64_t>> stream(quotes);
+    for ( std::pair<sl_symbol_t,int64_t>& q : stream )
+    {
+	q.first = pick(random);
+	q.second = (prices[q.first] += step(random)*1000);
+    }
+
+    std::vector<int64_t> last(prices.size(),1000000);
+    start = clock::now();
+    for ( const std::pair<sl_symbol_t,int64_t>& q : stream )
+    {
+	book.update(q.first,0,q.second);
+	book.deliver();
+    }
+    const double update_ns = elapsed_ns(start)/quotes;
+
+    /* The same stream, checking every alert on the symbol */
+    uint64_t scanned = 0;
+    start = clock::now();
+    for ( const std::pair<sl_symbol_t,int64_t>& q : stream )
+    {
+	const int64_t from = last[q.first];
+	const int64_t to = q.second;
+	for ( const rule& r : scan[q.first] )
+	    if ( (r.direction==SLADAbove) ? (from<r.threshold && r.threshold<=to)
+					  : (to<=r.threshold && r.threshold<from) )
+		scanned++;
+	last[q.first] = to;
+    }
+    const double scan_ns = elapsed_ns(start)/quotes;
+
+    if (scanned!=delivered)
+    {
+	std::cerr << "Indexed and scanned alerts disagree: " << delivered
+		  << " against " << scanned << endl;
+	return 1;
+    }
+
+    cout << rules << " alerts on " << symbols << " symbols, " << quotes << " quotes, "
+	 << std::fixed << std::setprecision(2) << double(delivered)/quotes
+	 << " alerts fired per quote" << endl
+	 << "  add:      " << std::setprecision(1) << add_ns << " ns per alert" << endl
+	 << "  indexed:  " << update_ns << " ns per quote" << endl
+	 << "  scanned:  " << scan_ns << " ns per quote (" << scan_ns/update_ns
+	 << "x slower)" << endl;
+    return 0;
+}
@@ -0,0 +1,160 @@
+/**
+ * @file
+ *
+ * Counts the system allocations made by a quote fetch, once the library has
+ * warmed up. Requests are served in test mode, so no network access is made,
+ * but the response is decoded exactly as a live one would be.
+ */
+
+/*
+The MIT License (MIT)
+
+Copyright (c) 2015 David Bradshaw
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include <iostream>
+#include <atomic>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <stocklib/stocklib_p.h>
+
+#include "bench.h"
+
+using std::cout;
+using std::endl;
+
+namespace
+{
+    std::atomic<uint64_t> g_allocations{0};
+    std::atomic<uint64_t> g_frees{0};
+}
+
+#ifdef __GLIBC__
+
+/* Interpose on the C allocator, so that every allocation is counted, whether
+   made by operator new, by the library, or by jansson */
+extern "C"
+{
+    extern void* __libc_malloc(size_t);
+    extern void* __libc_calloc(size_t,size_t);
+    extern void* __libc_realloc(void*,size_t);
+    extern void __libc_free(void*);
+
+    void* malloc(size_t n)
+    {
+	g_allocations++;
+	return __libc_malloc(n);
+    }
+
+    void* calloc(size_t n, size_t sz)
+    {
+	g_allocations++;
+	return __libc_calloc(n,sz);
+    }
+
+    void* realloc(void* p, size_t n)
+    {
+	g_allocations++;
+	return __libc_realloc(p,n);
+    }
+
+    void free(void* p)
+    {
+	if (p)
+	    g_frees++;
+	__libc_free(p);
+    }
+}
+
+#endif
+
+alloc_counts bench_alloc_counts()
+{
+    return { g_allocations.load(), g_frees.load() };
+}
+
+namespace
+{
+    /**
+     * Measures the allocations made by count calls to fn
+     */
+    template<class F>
+    double per_call(int count, F fn)
+    {
+	const alloc_counts before = bench_alloc_counts();
+	for ( int i=0; i<count; i++ )
+	    fn();
+	const alloc_counts after = bench_alloc_counts();
+
+	return double(after.allocations - before.allocations) / count;
+    }
+
+    void report(const char* what, double cold, double warm)
+    {
+	cout << what << ": " << cold << " allocations cold, "
+	     << warm << " per quote warm" << endl;
+    }
+}
+
+/**
+ * Options: -n <count> sets the number of fetches measured (default 10000)
+ */
+int bench_alloc(int argc, char* argv[])
+{
+    int count = 10000;
+    int opt;
+    while ( (opt = getopt(argc,argv,"n:")) != -1 )
+	if (opt=='n')
+	    count = atoi(optarg);
+
+#ifndef __GLIBC__
+    cout << "Allocation counting is not supported on this platform" << endl;
+#endif
+
+    setenv("STOCKLIB_NAMECACHE","",1);
+    stocklib_init();
+    stocklib_p_test_mode(true);
+    stocklib_p_test_behavior(SLTBNormalRequest);
+
+    char buffer[SL_MAX_BUFFER];
+    sl_quote_t quote;
+
+    auto text = [&]() { stocklib_fetch_synch("AAPL",buffer); };
+    auto typed = [&]() { stocklib_fetch_quote_synch("AAPL",&quote); };
+    auto asynch = [&]()
+    {
+	SLHANDLE h = stocklib_fetch_quote_asynch("AAPL",&quote);
+	stocklib_asynch_wait(h);
+	stocklib_asynch_dispose(h);
+    };
+
+    const double text_cold = per_call(1,text);
+    report("stocklib_fetch_synch", text_cold, per_call(count,text));
+
+    const double typed_cold = per_call(1,typed);
+    report("stocklib_fetch_quote_synch", typed_cold, per_call(count,typed));
+
+    const double asynch_cold = per_call(1,asynch);
+    report("stocklib_fetch_quote_asynch", asynch_cold, per_call(count,asynch));
+
+    return 0;
+}
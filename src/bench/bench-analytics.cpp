@@ -0,0 +1,155 @@
+/**
+ * @file
+ *
+ * Times the analytics kernels over a universe of symbols, for each
+ * instruction set the processor supports, against the scalar baseline.
+ */
+
+/*
+The MIT License (MIT)
+
+Copyright (c) 2015 David Bradshaw
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <chrono>
+#include <cmath>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <stocklib/analytics.h>
+
+#include "bench.h"
+
+using std::cout;
+using std::endl;
+
+namespace
+{
+    typedef std::chrono::steady_clock clock;
+
+    /**
+     * @return The best time of repeats calls to fn, in nanoseconds per symbol
+     */
+    template<class F>
+    double best(int repeats, std::size_t symbols, F fn)
+    {
+	double fastest = 0.0;
+	for ( int i=0; i<repeats; i++ )
+	{
+	    const clock::time_point start = clock::now();
+	    fn();
+	    const double ns = std::chrono::duration<double,std::nano>(clock::now()-start).count();
+	    if ( i==0 || ns<fastest )
+		fastest = ns;
+	}
+	return fastest/symbols;
+    }
+
+    /** Times every kernel for one universe size */
+    void run(std::size_t n, std::size_t window, int repeats)
+    {
+	std::vector<double> panel(window*n);
+	for ( std::size_t r=0; r<window; r++ )
+	    for ( std::size_t i=0; i<n; i++ )
+		panel[r*n+i] = 100.0 + 20.0*std::sin(0.001*i + 0.1*r) + 0.01*r;
+
+	const double* previous = &panel[(window-2)*n];
+	const double* current = &panel[(window-1)*n];
+	std::vector<double> a(n), b(n), c(n), d(n);
+
+	const char* kernels[] = { "simple_returns", "log_returns", "zscores", "window_stats" };
+	double baseline[4] = { 0.0 };
+
+	cout << n << " symbols, window of " << window << " (ns per symbol):" << endl;
+	for ( int s=analytics::scalar; s<=analytics::detect(); s++ )
+	{
+	    const analytics::isa_t set = static_cast<analytics::isa_t>(s);
+	    analytics::use(set);
+
+	    const double times[] = {
+		best(repeats,n,[&]() { analytics::simple_returns(previous,current,a.data(),n); }),
+		best(repeats,n,[&]() { analytics::log_returns(previous,current,a.data(),n); }),
+		best(repeats,n,[&]() { analytics::zscores(a.data(),b.data(),n); }),
+		best(repeats,n,[&]() { analytics::window_stats(panel.data(),window,n,a.data(),
+							       b.data(),c.data(),d.data()); }),
+	    };
+
+	    for ( int k=0; k<4; k++ )
+	    {
+		if (set==analytics::scalar)
+		    baseline[k] = times[k];
+		cout << "  " << std::setw(7) << std::left << analytics::name(set)
+		     << std::setw(15) << kernels[k] << std::right << std::fixed
+		     << std::setprecision(3) << std::setw(9) << times[k]
+		     << std::setprecision(1) << std::setw(7) << baseline[k]/times[k] << "x" << endl;
+	    }
+	}
+    }
+}
+
+/**
+ * Options: -n <symbols> times one universe size instead of 10000 and 100000,
+ * -w <window> sets the window for window_stats (default 20), and
+ * -r <repeats> the number of timings to take the best of (default 50)
+ */
+int bench_analytics(int argc, char* argv[])
+{
+    std::size_t symbols = 0;
+    std::size_t window = 20;
+    int repeats = 50;
+    int opt;
+    while ( (opt = getopt(argc,argv,"n:w:r:")) != -1 )
+	switch (opt)
+	{
+	case 'n':
+	    symbols = atol(optarg);
+	    break;
+	case 'w':
+	    window = atol(optarg);
+	    break;
+	case 'r':
+	    repeats = atoi(optarg);
+	    break;
+	}
+
+    if ( window<2 || repeats<1 )
+    {
+	std::cerr << "The window must be at least 2, and repeats at least 1" << endl;
+	return 1;
+    }
+
+    const analytics::isa_t chosen = analytics::isa();
+    cout << "Kernels run with " << analytics::name(chosen) << endl;
+
+    if (symbols)
+	run(symbols,window,repeats);
+    else
+    {
+	run(10000,window,repeats);
+	run(100000,window,repeats);
+    }
+
+    analytics::use(chosen);
+    return 0;
+}
@@ -0,0 +1,158 @@
+/**
+ * @file
+ *
+ * Measures the compression ratio and decode throughput of the tick codec on
+ * synthetic polled streams: one quote a second per symbol, with jitter, and
+ * prices moving a few cents at a time.
+ */
+
+/*
+The MIT License (MIT)
+
+Copyright (c) 2015 David Bradshaw
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <random>
+#include <chrono>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <stocklib/tickcodec.h>
+
+#include "bench.h"
+
+using std::cout;
+using std::endl;
+
+namespace
+{
+    typedef std::chrono::steady_clock clock;
+
+    /** Bytes per tick in the archive's uncompressed columns */
+    const double raw_tick = sizeof(uint32_t) + 2*sizeof(int64_t);
+
+    /**
+     * Encodes and decodes streams of ticks, and reports the results
+     *
+     * @param label Describes the streams
+     * @param jitter The most a poll is early or late, in microseconds
+     */
+    void run(const char* label, std::size_t symbols, std::size_t ticks, int64_t jitter, int repeats)
+    {
+	std::mt19937_64 random(1);
+	std::uniform_int_distribution<int64_t> late(-jitter,jitter);
+	std::uniform_int_distribution<int64_t> cents(-3,3);
+
+	std::vector<tickcodec::block> blocks;
+	std::vector<uint8_t> data;
+	std::vector<int64_t> ts(ticks), prices(ticks);
+
+	double encode_ns = 0.0;
+	for ( std::size_t s=0; s<symbols; s++ )
+	{
+	    int64_t t = 1433116800000000LL + s;
+	    int64_t p = 100000 + 1000*s;
+	    for ( std::size_t i=0; i<ticks; i++ )
+	    {
+		t += 1000000 + late(random);
+		p += 100*cents(random);
+		ts[i] = t;
+		prices[i] = p;
+	    }
+
+	    const clock::time_point start = clock::now();
+	    for ( std::size_t i=0; i<ticks; i+=tickcodec::block_size )
+	    {
+		tickcodec::block b;
+		tickcodec::encode(&ts[i],&prices[i],std::min(tickcodec::block_size,ticks-i),b,data);
+		blocks.push_back(b);
+	    }
+	    encode_ns += std::chrono::duration<double,std::nano>(clock::now()-start).count();
+	}
+
+	const std::size_t packed = data.size() + blocks.size()*sizeof(tickcodec::block);
+	data.resize(data.size()+tickcodec::padding);
+
+	double best = 0.0;
+	volatile int64_t sink = 0;	// Keeps the decoding from being optimized away
+	int64_t out_ts[tickcodec::block_size];
+	int64_t out_prices[tickcodec::block_size];
+	for ( int r=0; r<repeats; r++ )
+	{
+	    const clock::time_point start = clock::now();
+	    for ( const tickcodec::block& b : blocks )
+	    {
+		tickcodec::decode(b,data.data(),out_ts,out_prices);
+		sink = sink + (out_ts[b.count-1] ^ out_prices[b.count-1]);
+	    }
+	    const double ns = std::chrono::duration<double,std::nano>(clock::now()-start).count();
+	    if ( r==0 || ns<best )
+		best = ns;
+	}
+
+	const double total = double(symbols)*ticks;
+	cout << label << ": " << std::fixed << std::setprecision(2)
+	     << packed/total << " bytes per tick, "
+	     << std::setprecision(1) << raw_tick*total/packed << "x smaller than columns" << endl
+	     << "  encode " << std::setprecision(1) << encode_ns/total << " ns per tick, decode "
+	     << best/total << " ns per tick ("
+	     << std::setprecision(2) << (2*sizeof(int64_t)*total)/best << " GB/s decoded)" << endl;
+    }
+}
+
+/**
+ * Options: -s <symbols> (default 1000), -n <ticks per symbol> (default
+ * 10000), -r <repeats> to take the best decode time of (default 10)
+ */
+int bench_codec(int argc, char* argv[])
+{
+    std::size_t symbols = 1000;
+    std::size_t ticks = 10000;
+    int repeats = 10;
+    int opt;
+    while ( (opt = getopt(argc,argv,"s:n:r:")) != -1 )
+	switch (opt)
+	{
+	case 's':
+	    symbols = atol(optarg);
+	    break;
+	case 'n':
+	    ticks = atol(optarg);
+	    break;
+	case 'r':
+	    repeats = atoi(optarg);
+	    break;
+	}
+
+    if ( !symbols || !ticks || repeats<1 )
+    {
+	std::cerr << "Symbols, ticks and repeats must be positive" << endl;
+	return 1;
+    }
+
+    run("Polled every second, on the second",symbols,ticks,0,repeats);
+    run("Polled every second, +/-1ms jitter",symbols,ticks,1000,repeats);
+    run("Polled every second, +/-100ms jitter",symbols,ticks,100000,repeats);
+    return 0;
+}
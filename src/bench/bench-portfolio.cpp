@@ -0,0 +1,175 @@
+/**
+ * @file
+ *
+ * Measures the cost of revaluing portfolios as quotes arrive, against
+ * summing every position again, and how fast portfolios can be queried while
+ * quotes are revaluing them.
+ */
+
+/*
+The MIT License (MIT)
+
+Copyright (c) 2015 David Bradshaw
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <random>
+#include <chrono>
+#include <thread>
+#include <atomic>
+#include <string>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <stocklib/portfoliobook.h>
+
+#include "bench.h"
+
+using std::cout;
+using std::endl;
+
+namespace
+{
+    typedef std::chrono::steady_clock clock;
+
+    double elapsed_ns(clock::time_point start)
+    {
+	return std::chrono::duration<double,std::nano>(clock::now()-start).count();
+    }
+}
+
+/**
+ * Options: -p <portfolios> (default 1000), -n <positions per portfolio>
+ * (default 50), -s <symbols> (default 2000), -q <quotes> (default 1000000)
+ */
+int bench_portfolio(int argc, char* argv[])
+{
+    std::size_t portfolios = 1000;
+    std::size_t positions = 50;
+    std::size_t symbols = 2000;
+    std::size_t quotes = 1000000;
+    int opt;
+    while ( (opt = getopt(argc,argv,"p:n:s:q:")) != -1 )
+	switch (opt)
+	{
+	case 'p':
+	    portfolios = atol(optarg);
+	    break;
+	case 'n':
+	    positions = atol(optarg);
+	    break;
+	case 's':
+	    symbols = atol(optarg);
+	    break;
+	case 'q':
+	    quotes = atol(optarg);
+	    break;
+	}
+
+    if ( !portfolios || !positions || !symbols || !quotes )
+    {
+	std::cerr << "Portfolios, positions, symbols and quotes must be positive" << endl;
+	return 1;
+    }
+
+    std::mt19937 random(42);
+    std::uniform_int_distribution<uint32_t> pick(1,symbols);
+    std::uniform_int_distribution<int64_t> quantity(1,1000);
+    std::uniform_int_distribution<int64_t> cents(-3,3);
+
+    std::vector<portfoliobook::entry> entries;
+    for ( std::size_t p=0; p<portfolios; p++ )
+	for ( std::size_t i=0; i<positions; i++ )
+	    entries.push_back( {"p"+std::to_string(p),pick(random),quantity(random),0} );
+
+    portfoliobook book;
+    clock::time_point start = clock::now();
+    book.hold(entries);
+    const double hold_ns = elapsed_ns(start);
+
+    std::vector<int64_t> prices(symbols+1,1000000);
+    for ( uint32_t s=1; s<=symbols; s++ )
+	book.update(s,prices[s]);
+
+    std::vector<std::pair<uint32_t,int64_t>> stream(quotes);
+    for ( std::pair<uint32_t,int64_t>& q : stream )
+    {
+	q.first = pick(random);
+	q.second = (prices[q.first] += 100*cents(random));
+    }
+
+    start = clock::now();
+    for ( const std::pair<uint32_t,int64_t>& q : stream )
+	book.update(q.first,q.second);
+    const double update_ns = elapsed_ns(start)/quotes;
+
+    /* What each quote would cost if every portfolio holding the symbol were
+       summed again */
+    std::vector<std::vector<portfoliobook::id_t>> holders(symbols+1);
+    for ( std::size_t i=0; i<entries.size(); i++ )
+	if ( holders[entries[i].symbol].empty() || holders[entries[i].symbol].back()!=i/positions )
+	    holders[entries[i].symbol].push_back(i/positions);
+    volatile int64_t sink = 0;	// Keeps the sums from being optimized away
+    const std::size_t sampled = std::min<std::size_t>(quotes,10000);
+    start = clock::now();
+    for ( std::size_t q=0; q<sampled; q++ )
+	for ( portfoliobook::id_t p : holders[stream[q].first] )
+	{
+	    int64_t value = 0;
+	    for ( std::size_t i=p*positions; i<(p+1)*positions; i++ )
+		value += entries[i].quantity*prices[entries[i].symbol];
+	    sink = sink + value;
+	}
+    const double recompute_ns = elapsed_ns(start)/sampled;
+
+    /* Queries while a thread applies the quotes again */
+    std::atomic<bool> done{false};
+    std::thread writer( [&]()
+			{
+			    for ( const std::pair<uint32_t,int64_t>& q : stream )
+				book.update(q.first,q.second);
+			    done = true;
+			} );
+    uint64_t queries = 0;
+    start = clock::now();
+    portfoliobook::totals t;
+    while (!done)
+    {
+	book.value(queries%portfolios,t);
+	sink = sink + t.value;
+	queries++;
+    }
+    const double query_ns = elapsed_ns(start)/queries;
+    writer.join();
+
+    const double per_quote = double(entries.size())/symbols;
+    cout << portfolios << " portfolios of " << positions << " positions, in "
+	 << symbols << " symbols (" << std::fixed << std::setprecision(1)
+	 << per_quote << " positions per symbol)" << endl
+	 << "  load:       " << std::setprecision(0) << hold_ns/1e6 << " ms" << endl
+	 << "  update:     " << std::setprecision(1) << update_ns << " ns per quote" << endl
+	 << "  recompute:  " << recompute_ns << " ns per quote ("
+	 << recompute_ns/update_ns << "x slower)" << endl
+	 << "  query:      " << query_ns << " ns, while updating" << endl;
+    return 0;
+}
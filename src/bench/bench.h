@@ -0,0 +1,62 @@
+/**
+ * @file
+ * Declarations shared by the benchmark programs.
+ */
+
+/*
+The MIT License (MIT)
+
+Copyright (c) 2015 David Bradshaw
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#ifndef BENCH_H
+#define BENCH_H
+
+#include <cstdint>
+
+/**
+ * Counts of calls to the system allocator, made by this process
+ */
+struct alloc_counts
+{
+    uint64_t allocations;	///< Calls to malloc(), calloc() and realloc()
+    uint64_t frees;		///< Calls to free()
+};
+
+/**
+ * @return The allocation counts so far. All zero if counting is not
+ * supported on this platform.
+ */
+alloc_counts bench_alloc_counts();
+
+/** @name Benchmarks
+ * Each takes the arguments following its name on the command line, and
+ * returns the process exit code.
+ */
+//@{
+int bench_alloc(int argc, char* argv[]);
+int bench_analytics(int argc, char* argv[]);
+int bench_codec(int argc, char* argv[]);
+int bench_portfolio(int argc, char* argv[]);
+int bench_alerts(int argc, char* argv[]);
+//@}
+
+#endif
@@ -0,0 +1,91 @@
+/**
+ * @file
+ *
+ * Benchmarks for the stocklib library. Run with the name of a benchmark,
+ * followed by its options.
+ *
+ * Example usage:
+ * @code
+ * me@mymachine ~/ $ stock_bench alloc -n 10000
+ * @endcode
+ */
+
+/*
+The MIT License (MIT)
+
+Copyright (c) 2015 David Bradshaw
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include <config.h>
+#include <iostream>
+#include <string.h>
+
+#include <curl/curl.h>
+
+#include "bench.h"
+
+using std::cout;
+using std::cerr;
+using std::endl;
+
+namespace
+{
+    struct benchmark
+    {
+	const char* name;
+	const char* description;
+	int (*run)(int, char*[]);
+    };
+
+    const benchmark g_benchmarks[] =
+    {
+	{ "alloc", "System allocations per quote fetch", &bench_alloc },
+	{ "analytics", "Analytics kernel throughput by instruction set", &bench_analytics },
+	{ "codec", "Tick compression ratio and decode throughput", &bench_codec },
+	{ "portfolio", "Incremental portfolio revaluation against summing again", &bench_portfolio },
+	{ "alerts", "Indexed price alert checks against scanning every alert", &bench_alerts },
+    };
+
+    void usage()
+    {
+	cerr << "Usage: stock_bench <benchmark> [options]" << endl << endl;
+	for ( const benchmark& b : g_benchmarks )
+	    cerr << "  " << b.name << "\t" << b.description << endl;
+    }
+}
+
+int main( int argc, char* argv[] )
+{
+    if (argc < 2)
+    {
+	usage();
+	return 1;
+    }
+
+    curl_global_init(CURL_GLOBAL_ALL);
+
+    for ( const benchmark& b : g_benchmarks )
+	if (!strcmp(argv[1],b.name))
+	    return b.run(argc-1,argv+1);
+
+    usage();
+    return 1;
+}
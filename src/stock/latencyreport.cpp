@@ -0,0 +1,161 @@
+/**
+ * @file
+ * Implementation of the latencyreport class.
+ */
+
+/*
+The MIT License (MIT)
+
+Copyright (c) 2015 David Bradshaw
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include <algorithm>
+#include <iomanip>
+
+#include "latencyreport.h"
+
+const char* const latencyreport::_phase_names[phase_count] =
+{
+    "queue", "dns", "connect", "tls", "ttfb", "transfer", "decode", "callback", "total"
+};
+
+namespace
+{
+    /**
+     * @return The value below which the fraction p of the sorted samples lie
+     */
+    uint64_t percentile(const std::vector<uint64_t>& sorted, double p)
+    {
+	return sorted[ static_cast<std::size_t>(p*(sorted.size()-1)) ];
+    }
+
+    /**
+     * @return The histogram row of a time: 0 for under 1us, then n for
+     * under 2^n us
+     */
+    std::size_t bucket(uint64_t us)
+    {
+	std::size_t b = 0;
+	for ( ; us; us>>=1 )
+	    b++;
+	return b;
+    }
+}
+
+/**
+ * Constructor
+ */
+latencyreport::latencyreport()
+{
+}
+
+/**
+ * Destructor
+ */
+latencyreport::~latencyreport()
+{
+}
+
+/**
+ * Makes room for a number of requests, so adding them allocates nothing
+ */
+void latencyreport::reserve(std::size_t requests)
+{
+    for ( auto& s : _samples )
+	s.reserve(requests);
+}
+
+/**
+ * Adds the timing of one request
+ */
+void latencyreport::add(const sl_timing_t& t)
+{
+    const uint64_t phases[phase_count] =
+    {
+	t.queue_us, t.dns_us, t.connect_us, t.tls_us, t.ttfb_us,
+	t.transfer_us, t.decode_us, t.callback_us, t.total_us
+    };
+    for ( std::size_t p=0; p<phase_count; p++ )
+	_samples[p].push_back(phases[p]);
+}
+
+/**
+ * @return The number of requests added
+ */
+std::size_t latencyreport::size() const
+{
+    return _samples[0].size();
+}
+
+/**
+ * Prints a table of each phase's mean and percentiles, then the histogram.
+ * All times are in microseconds. Sorts the samples.
+ */
+void latencyreport::print(std::ostream& out)
+{
+    if (!size())
+	return;
+
+    const int width = 10;
+    out << std::left << std::setw(width) << "phase (us)" << std::right;
+    for ( const char* h : { "mean", "p50", "p90", "p99", "p99.9", "max" } )
+	out << std::setw(width) << h;
+    out << std::endl;
+
+    std::vector<uint64_t> histogram[phase_count];
+    std::size_t first = bucket_count, last = 0;
+    for ( std::size_t p=0; p<phase_count; p++ )
+    {
+	std::vector<uint64_t>& s = _samples[p];
+	std::sort(s.begin(),s.end());
+
+	uint64_t sum = 0;
+	histogram[p].assign(bucket_count,0);
+	for ( const uint64_t us : s )
+	{
+	    sum += us;
+	    const std::size_t b = std::min<std::size_t>(bucket(us),bucket_count-1);
+	    histogram[p][b]++;
+	    first = std::min(first,b);
+	    last = std::max(last,b);
+	}
+
+	out << std::left << std::setw(width) << _phase_names[p] << std::right
+	    << std::setw(width) << sum/s.size()
+	    << std::setw(width) << percentile(s,0.5)
+	    << std::setw(width) << percentile(s,0.9)
+	    << std::setw(width) << percentile(s,0.99)
+	    << std::setw(width) << percentile(s,0.999)
+	    << std::setw(width) << s.back() << std::endl;
+    }
+
+    out << std::endl << std::left << std::setw(width) << "under (us)" << std::right;
+    for ( const char* name : _phase_names )
+	out << std::setw(width) << name;
+    out << std::endl;
+    for ( std::size_t b=first; b<=last; b++ )
+    {
+	out << std::left << std::setw(width) << (1ULL<<b) << std::right;
+	for ( std::size_t p=0; p<phase_count; p++ )
+	    out << std::setw(width) << histogram[p][b];
+	out << std::endl;
+    }
+}
@@ -0,0 +1,73 @@
+/**
+ * @file
+ * Public header for the latencyreport class, which summarizes request
+ * timings for the benchmark mode of the stock program.
+ */
+
+/*
+The MIT License (MIT)
+
+Copyright (c) 2015 David Bradshaw
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#ifndef LATENCYREPORT_H
+#define LATENCYREPORT_H
+
+#include <vector>
+#include <ostream>
+#include <cstdint>
+
+#include <stocklib/stocklib.h>
+
+/**
+ * Gathers the timings of many requests, and reports the distribution of each
+ * phase: its mean and percentiles, and a histogram with one column per phase
+ * and one row per power of two microseconds.
+ */
+class latencyreport
+{
+public:
+
+    /** @name Lifecycle Management */
+    //@{
+    latencyreport();
+    latencyreport( const latencyreport& ) = delete;
+    latencyreport& operator=( const latencyreport& ) = delete;
+    virtual ~latencyreport();
+    //@}
+
+    /** @name Public API */
+    ///@{
+    void reserve(std::size_t requests);
+    void add(const sl_timing_t& timing);
+    std::size_t size() const;
+    void print(std::ostream& out);
+    ///@}
+
+private:
+    static const std::size_t phase_count = 9;
+    static const std::size_t bucket_count = 40;
+    static const char* const _phase_names[phase_count];
+
+    std::vector<uint64_t> _samples[phase_count];
+};
+
+#endif
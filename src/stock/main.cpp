@@ -1,13 +1,38 @@
 /**
  * @file 
  *
- * Very simply command line program that retrieves the latest price of
- * the given ticker symbol. 
+ * Command line program that retrieves the latest prices of the given ticker
+ * symbols. Tickers may be given as arguments, listed in a file, or piped in
+ * on standard input with a ticker of -, and are fetched concurrently, each
+ * result being printed as soon as it arrives.
  *
  * Example usage:
  * @code
  * me@mymachine ~/ $ stock AAPL
+ * me@mymachine ~/ $ stock -j 32 --ordered AAPL MSFT GOOG
+ * me@mymachine ~/ $ stock -f tickers.txt
+ * me@mymachine ~/ $ cut -d, -f1 holdings.csv | stock -
+ * me@mymachine ~/ $ stock --format=ndjson -f tickers.txt > quotes.json
+ * me@mymachine ~/ $ stock --watch 2 AAPL MSFT GOOG
+ * me@mymachine ~/ $ stock --bench -n 10000 -c 64 --endpoint http://127.0.0.1:8080 AAPL MSFT
+ * me@mymachine ~/ $ stock --daemon --max-age 5 AAPL MSFT
  * @endcode
+ *
+ * Results are written through a recordwriter, as plain text or in one of its
+ * machine-readable formats, and are only flushed line by line when standard
+ * output is a terminal.
+ *
+ * In watch mode the program keeps running, refreshing every ticker on a
+ * timer over the same connections, and redraws only the lines which changed.
+ *
+ * The benchmark mode fetches the tickers over and over, a given number of
+ * times in all, and reports the throughput, and where the time of each
+ * request went, phase by phase. Aimed at a local stand-in for the server, it
+ * measures the library and its transport rather than the internet.
+ *
+ * In client mode the program starts nothing itself, but asks a running
+ * stockd for the quotes, which it answers from memory when they are recent
+ * enough.
  */
 
 /*
@@ -36,44 +61,701 @@ SOFTWARE.
 
 #include <config.h>
 #include <iostream>
+#include <fstream>
 #include <string>
+#include <vector>
+#include <deque>
+#include <memory>
+#include <map>
+#include <set>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <cstdint>
+#include <limits>
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <time.h>
+#include <signal.h>
+#include <unistd.h>
+#include <getopt.h>
+#include <sys/socket.h>
+#include <sys/un.h>
 
 #include <curl/curl.h>
 #include <stocklib/stocklib.h>
+#include <stocklib/queryprotocol.h>
+#include "recordwriter.h"
+#include "latencyreport.h"
 
 using std::cout;
+using std::cerr;
 using std::endl;
 using std::string;
 
 namespace
 {
-    string g_ticker="AAPL";
+    /**
+     * Options from the command line
+     */
+    struct options
+    {
+	std::vector<string> tickers;
+	unsigned jobs{16};		///< Most requests in flight at once
+	bool ordered{false};		///< Print in input order, not completion order
+	bool timing{false};		///< Report the elapsed time on stderr
+	bool bare{false};		///< Print just the price, for a single ticker argument
+	unsigned watch_ms{0};		///< Refresh interval in watch mode, or 0
+	recordwriter::format_t format{recordwriter::text};
+	bool formatted{false};		///< A format was asked for
+	bool bench{false};		///< Run the benchmark instead
+	unsigned requests{1000};	///< Requests made by the benchmark
+	string endpoint;		///< Server to use instead of the real one
+	bool daemon{false};		///< Ask stockd, rather than fetching
+	string socket{queryprotocol::default_socket_path()};
+	unsigned max_age_ms{1000};	///< Oldest cached quote the daemon may answer with
+	unsigned keep_ms{0};		///< Have the daemon keep the tickers fresh, if not 0
+    };
+
+    /**
+     * One ticker to fetch
+     */
+    struct request
+    {
+	string ticker;
+	sl_quote_t quote;
+	int64_t requested{0};		///< When the request was made
+	sl_timing_t timing;		///< Where its time went, if timed
+	SLHANDLE handle{nullptr};
+	sl_result_t result{SL_PENDING};
+    };
+
+    /* Requests completed but not yet collected, by index */
+    std::mutex g_done_mutex;
+    std::condition_variable g_done_cv;
+    std::deque<std::size_t> g_done;
+
+    void usage()
+    {
+	cerr << "Usage: stock [options] [TICKER...]" << endl << endl
+	     << "Prints the latest price of each ticker (AAPL if none are given). A ticker" << endl
+	     << "of - reads tickers from standard input." << endl << endl
+	     << "  -f, --file FILE   read tickers from FILE, separated by white space" << endl
+	     << "  -j, --jobs N      fetch up to N tickers at once (default 16, at most 1024)" << endl
+	     << "  -c N              the same as --jobs" << endl
+	     << "  -o, --ordered     print results in input order, not as they arrive" << endl
+	     << "  -t, --time        report the elapsed time on standard error" << endl
+	     << "      --format FMT  write text (the default), csv, ndjson or binary records" << endl
+	     << "  -w, --watch SECS  keep refreshing every SECS seconds, redrawing changes" << endl
+	     << "      --endpoint URL  send requests to URL, such as a local stand-in" << endl
+	     << "      --bench       fetch the tickers repeatedly, and report throughput and" << endl
+	     << "                    latency by phase" << endl
+	     << "  -n N              requests made by --bench (default 1000)" << endl
+	     << "  -d, --daemon      ask a running stockd, which answers from its cache" << endl
+	     << "      --socket PATH the daemon's socket, implying --daemon" << endl
+	     << "      --max-age SECS  accept cached quotes up to SECS old (default 1)" << endl
+	     << "      --subscribe SECS  have the daemon refresh the tickers every SECS" << endl
+	     << "  -h, --help        show this help" << endl;
+    }
+
+    /**
+     * Appends the white space separated tickers in a stream
+     */
+    void read_tickers(std::istream& in, std::vector<string>& tickers)
+    {
+	string ticker;
+	while (in >> ticker)
+	    tickers.push_back(ticker);
+    }
+
+    /// Most requests allowed in flight by --jobs
+    const unsigned max_jobs = 1024;
+
+    /**
+     * Reads a count given on the command line. The text is read as a signed
+     * number, so that a negative count is refused rather than wrapping round,
+     * and a count above the limit is clamped to it.
+     *
+     * @return false, having reported it, if the text is not a count of at
+     * least 1
+     */
+    bool parse_count(const char* text, const char* name, unsigned limit, unsigned& count)
+    {
+	char* end;
+	errno = 0;
+	const long long n = strtoll(text,&end,10);
+	if ( (end==text) || *end || (n<1) )
+	{
+	    cerr << "stock: " << name << " must be at least 1" << endl;
+	    return false;
+	}
+	count = ( (errno==ERANGE) || (static_cast<unsigned long long>(n)>limit) )
+	    ? limit : static_cast<unsigned>(n);
+	return true;
+    }
+
+    /**
+     * Reads a time in seconds given on the command line, clamping times too
+     * long to count in milliseconds
+     *
+     * @return false, having reported it, if the text is not a time of at
+     * least min_ms
+     */
+    bool parse_seconds(const char* text, const char* name, unsigned min_ms, unsigned& ms)
+    {
+	char* end;
+	const double secs = strtod(text,&end);
+	if ( (end==text) || *end || !(secs*1000>=min_ms) )
+	{
+	    cerr << "stock: " << name << " must be at least " << min_ms/1000.0 << " seconds" << endl;
+	    return false;
+	}
+	const double limit = std::numeric_limits<unsigned>::max();
+	ms = (secs*1000>limit) ? std::numeric_limits<unsigned>::max() : static_cast<unsigned>(secs*1000);
+	return true;
+    }
+
+    /**
+     * @return false if the command line is not valid, or asks for help
+     */
+    bool parse(int argc, char* argv[], options& opts)
+    {
+	static const struct option longopts[] =
+	{
+	    { "file", required_argument, nullptr, 'f' },
+	    { "jobs", required_argument, nullptr, 'j' },
+	    { "ordered", no_argument, nullptr, 'o' },
+	    { "time", no_argument, nullptr, 't' },
+	    { "watch", required_argument, nullptr, 'w' },
+	    { "format", required_argument, nullptr, 'F' },
+	    { "endpoint", required_argument, nullptr, 'E' },
+	    { "bench", no_argument, nullptr, 'B' },
+	    { "daemon", no_argument, nullptr, 'd' },
+	    { "socket", required_argument, nullptr, 'S' },
+	    { "max-age", required_argument, nullptr, 'A' },
+	    { "subscribe", required_argument, nullptr, 'K' },
+	    { "help", no_argument, nullptr, 'h' },
+	    { nullptr, 0, nullptr, 0 }
+	};
+
+	bool from_file = false;
+	int opt;
+	while ( (opt = getopt_long(argc,argv,"f:j:c:otw:n:dh",longopts,nullptr)) != -1 )
+	    switch (opt)
+	    {
+	    case 'f':
+	    {
+		std::ifstream in(optarg);
+		if (!in)
+		{
+		    cerr << "stock: cannot read " << optarg << endl;
+		    return false;
+		}
+		read_tickers(in,opts.tickers);
+		from_file = true;
+		break;
+	    }
+	    case 'j':
+	    case 'c':
+		if (!parse_count(optarg,"--jobs",max_jobs,opts.jobs))
+		    return false;
+		break;
+	    case 'o':
+		opts.ordered = true;
+		break;
+	    case 't':
+		opts.timing = true;
+		break;
+	    case 'w':
+		if (!parse_seconds(optarg,"--watch",100,opts.watch_ms))
+		    return false;
+		break;
+	    case 'F':
+		if (!recordwriter::parse_format(optarg,opts.format))
+		{
+		    cerr << "stock: unknown format " << optarg << endl;
+		    return false;
+		}
+		opts.formatted = true;
+		break;
+	    case 'E':
+		opts.endpoint = optarg;
+		break;
+	    case 'B':
+		opts.bench = true;
+		break;
+	    case 'd':
+		opts.daemon = true;
+		break;
+	    case 'S':
+		opts.socket = optarg;
+		opts.daemon = true;
+		break;
+	    case 'A':
+		if (!parse_seconds(optarg,"--max-age",0,opts.max_age_ms))
+		    return false;
+		break;
+	    case 'K':
+		if (!parse_seconds(optarg,"--subscribe",100,opts.keep_ms))
+		    return false;
+		break;
+	    case 'n':
+		if (!parse_count(optarg,"-n",std::numeric_limits<unsigned>::max(),opts.requests))
+		    return false;
+		break;
+	    default:
+		usage();
+		return false;
+	    }
+
+	// Standard input is only read when asked for, so that stock behaves the
+	// same under cron, or inside a loop reading its own input
+	bool from_stdin = false;
+	for ( int i=optind; i<argc; i++ )
+	{
+	    if (string(argv[i])=="-")
+		from_stdin = true;
+	    else
+		opts.tickers.push_back(argv[i]);
+	}
+	if (from_stdin)
+	    read_tickers(std::cin,opts.tickers);
+
+	if ( (optind==argc) && !from_file )
+	    opts.tickers.push_back("AAPL");
+
+	if ( opts.daemon && (opts.watch_ms || opts.bench) )
+	{
+	    cerr << "stock: --daemon cannot be used with --watch or --bench" << endl;
+	    return false;
+	}
+
+	opts.bare = (opts.tickers.size()==1) && !from_file && !from_stdin && !opts.watch_ms
+	    && !opts.formatted && !opts.bench;
+	return true;
+    }
+
+    /**
+     * @return The wall-clock time, in microseconds since the epoch
+     */
+    int64_t now_us()
+    {
+	using namespace std::chrono;
+	return duration_cast<microseconds>(system_clock::now().time_since_epoch()).count();
+    }
+
+    /**
+     * Called by the library when a request completes, with the request's
+     * index. The handle may not be used here, so the request is collected by
+     * the main thread.
+     */
+    void on_complete(SLHANDLE, void* data)
+    {
+	std::lock_guard<std::mutex> lock(g_done_mutex);
+	g_done.push_back(reinterpret_cast<uintptr_t>(data));
+	g_done_cv.notify_one();
+    }
+
+    void start(std::vector<request>& requests, std::size_t i)
+    {
+	request& r = requests[i];
+	r.requested = now_us();
+	r.handle = stocklib_fetch_quote_asynch(r.ticker.c_str(),&r.quote,SLPRNormal);
+
+	// The request may already have completed, in which case the library
+	// calls on_complete at once instead; it is called exactly once either way
+	stocklib_asynch_register_callback(r.handle,&on_complete,
+					  reinterpret_cast<void*>(static_cast<uintptr_t>(i)));
+    }
+
+    /**
+     * Waits for a request to complete, and releases its handle
+     *
+     * @param timed true to fill in the request's timing, if it succeeded
+     * @return The request's index
+     */
+    std::size_t collect(std::vector<request>& requests, bool timed=false)
+    {
+	std::size_t i;
+	{
+	    std::unique_lock<std::mutex> lock(g_done_mutex);
+	    g_done_cv.wait(lock, []() { return !g_done.empty(); } );
+	    i = g_done.front();
+	    g_done.pop_front();
+	}
+
+	request& r = requests[i];
+	r.result = stocklib_asynch_result(r.handle);
+	if ( timed && (r.result==SL_OK) )
+	    stocklib_asynch_timing(r.handle,&r.timing);
+	stocklib_asynch_dispose(r.handle);
+	r.handle = nullptr;
+	return i;
+    }
+
+    void print(const request& r, recordwriter& out)
+    {
+	if (r.result==SL_OK)
+	{
+	    const char* name = (r.quote.flags & SLQFName) ? stocklib_ticker_to_name(r.ticker.c_str()) : nullptr;
+	    out.write({ r.ticker.c_str(), name, r.quote.price, r.requested, r.quote.timestamp });
+	}
+	else
+	    cerr << "stock: " << r.ticker << ": An error occurred." << endl;
+    }
+
+    /**
+     * Fetches every ticker, keeping up to opts.jobs requests in flight, and
+     * prints each result as soon as it, and in ordered mode every result
+     * before it, has arrived
+     *
+     * @return The number of tickers which could not be fetched
+     */
+    std::size_t fetch_all(const options& opts, recordwriter& out)
+    {
+	std::vector<request> requests(opts.tickers.size());
+	for ( std::size_t i=0; i<requests.size(); i++ )
+	    requests[i].ticker = opts.tickers[i];
+
+	std::size_t started = 0;
+	std::size_t printed = 0;
+	std::size_t failed = 0;
+	for ( std::size_t collected=0; collected<requests.size(); collected++ )
+	{
+	    while ( (started<requests.size()) && (started-collected<opts.jobs) )
+		start(requests,started++);
+
+	    const std::size_t i = collect(requests);
+	    if (requests[i].result!=SL_OK)
+		failed++;
+
+	    if (!opts.ordered)
+		print(requests[i],out);
+	    else
+		for ( ; (printed<requests.size()) && (requests[printed].result!=SL_PENDING); printed++ )
+		    print(requests[printed],out);
+	}
+	return failed;
+    }
+
+    /**
+     * Makes opts.requests requests, cycling through the tickers, with
+     * opts.jobs in flight at all times, then reports the throughput and the
+     * latency of each phase
+     *
+     * @return The number of requests which failed
+     */
+    std::size_t benchmark(const options& opts)
+    {
+	std::vector<request> slots( std::min<std::size_t>(opts.jobs,opts.requests) );
+	latencyreport report;
+	report.reserve(opts.requests);
+
+	std::size_t issued = 0;
+	const auto issue = [&](std::size_t slot)
+	{
+	    slots[slot].ticker = opts.tickers[issued++ % opts.tickers.size()];
+	    start(slots,slot);
+	};
+
+	const std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+	for ( std::size_t i=0; i<slots.size(); i++ )
+	    issue(i);
+
+	std::size_t failed = 0;
+	for ( std::size_t done=0; done<opts.requests; done++ )
+	{
+	    const std::size_t i = collect(slots,true);
+	    if (slots[i].result==SL_OK)
+		report.add(slots[i].timing);
+	    else
+		failed++;
+	    if (issued<opts.requests)
+		issue(i);
+	}
+	const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now()-begin).count();
+
+	cout << opts.requests << " requests, " << slots.size() << " at once, in " << seconds << "s: "
+	     << static_cast<uint64_t>(opts.requests/seconds) << " per second, " << failed << " failed"
+	     << endl << endl;
+	report.print(cout);
+	return failed;
+    }
+
+    /**
+     * Sends a request to the daemon, and reads its response
+     *
+     * @return false if the daemon could not be asked, or gave no answer
+     */
+    bool ask(int fd, const queryprotocol::request& req, queryprotocol::response& resp)
+    {
+	string frame;
+	queryprotocol::encode(req,frame);
+	return queryprotocol::write_frame(fd,frame) &&
+	    queryprotocol::read_frame(fd,frame) &&
+	    queryprotocol::decode(frame,resp) &&
+	    (resp.code==queryprotocol::ok);
+    }
+
+    /**
+     * Quotes the tickers through the daemon, in batches small enough for a
+     * response frame, and prints them
+     *
+     * @return The exit status
+     */
+    int ask_daemon(const options& opts)
+    {
+	// A ticker too long for the protocol could never be answered
+	for ( const string& t : opts.tickers )
+	    if (t.size()>queryprotocol::max_ticker)
+	    {
+		cerr << "stock: " << t.substr(0,16) << "...: tickers sent to the daemon must be at most "
+		     << queryprotocol::max_ticker << " characters" << endl;
+		return 1;
+	    }
+
+	struct sockaddr_un addr;
+	memset(&addr,0,sizeof(addr));
+	addr.sun_family = AF_UNIX;
+	strncpy(addr.sun_path,opts.socket.c_str(),sizeof(addr.sun_path)-1);
+
+	const int fd = socket(AF_UNIX,SOCK_STREAM,0);
+	if ( (fd<0) || (0!=connect(fd,reinterpret_cast<struct sockaddr*>(&addr),sizeof(addr))) )
+	{
+	    cerr << "stock: cannot reach the daemon at " << opts.socket << endl;
+	    return 1;
+	}
+
+	// Small enough that a batch of the longest tickers fits in one frame
+	static const std::size_t batch = queryprotocol::max_frame/(queryprotocol::max_ticker+1)/2;
+	recordwriter out(STDOUT_FILENO,opts.format,isatty(STDOUT_FILENO));
+	std::size_t failed = 0;
+	bool answered = true;
+	const std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+	for ( std::size_t first=0; answered && (first<opts.tickers.size()); first+=batch )
+	{
+	    queryprotocol::request req;
+	    queryprotocol::response resp;
+	    const std::size_t last = std::min(first+batch,opts.tickers.size());
+	    req.tickers.assign(opts.tickers.begin()+first,opts.tickers.begin()+last);
+
+	    if (opts.keep_ms)
+	    {
+		req.op = queryprotocol::subscribe;
+		req.argument = opts.keep_ms;
+		answered = ask(fd,req,resp);
+	    }
+
+	    req.op = queryprotocol::quote;
+	    req.argument = opts.max_age_ms;
+	    const int64_t requested = now_us();
+	    answered = answered && ask(fd,req,resp) && (resp.quotes.size()==req.tickers.size());
+
+	    for ( const auto& q : resp.quotes )
+	    {
+		if (!(q.flags & SLQFPrice))
+		{
+		    cerr << "stock: " << q.ticker << ": An error occurred." << endl;
+		    failed++;
+		}
+		else if (opts.bare)
+		{
+		    char price[SL_MAX_BUFFER];
+		    stocklib_format_price(q.price,price);
+		    cout << price << endl;
+		}
+		else
+		    out.write({ q.ticker.c_str(), q.name.empty() ? nullptr : q.name.c_str(),
+				q.price, requested, q.timestamp });
+	    }
+	}
+	close(fd);
+
+	const bool written = out.flush();
+	if (opts.timing)
+	{
+	    const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now()-begin).count();
+	    cerr << opts.tickers.size() << " tickers in " << seconds*1e6 << "us from the daemon" << endl;
+	}
+	if (!answered)
+	    cerr << "stock: the daemon did not answer" << endl;
+	return (failed || !written || !answered) ? 1 : 0;
+    }
+
+    /**
+     * The lines of the watch display, updated by the subscription's callback,
+     * which is never run concurrently
+     */
+    struct watch_display
+    {
+	std::vector<string> tickers;
+	std::map<sl_symbol_t,std::size_t> rows;	///< Symbol to line
+	std::vector<int64_t> prices;
+	std::vector<bool> priced;
+	bool tty{false};
+	recordwriter* out{nullptr};	///< Writes records instead, if set
+    };
+
+    /**
+     * Writes one ticker's line. On a terminal the line is redrawn in place,
+     * the cursor being kept below the last line; otherwise each change is
+     * appended as a new line.
+     */
+    void draw(const watch_display& d, std::size_t row, const sl_quote_t& q, int64_t change)
+    {
+	char price[SL_MAX_BUFFER] = "error";
+	char delta[SL_MAX_BUFFER+1] = "";
+	char when[16] = "";
+	if (q.flags & SLQFPrice)
+	{
+	    stocklib_format_price(q.price,price);
+	    if (change)
+	    {
+		delta[0] = (change>0) ? '+' : '-';
+		stocklib_format_price( (change>0) ? change : -change, delta+1 );
+	    }
+	}
+	const time_t t = q.timestamp/1000000;
+	struct tm local;
+	strftime(when,sizeof(when),"%H:%M:%S",localtime_r(&t,&local));
+
+	const std::size_t up = d.tickers.size()-row;
+	if (d.tty)
+	    printf("\033[%zuA\r\033[2K",up);
+	printf("%-10s %12s %10s  %s\n",d.tickers[row].c_str(),price,delta,when);
+	if ( d.tty && (up>1) )
+	    printf("\033[%zuB",up-1);
+	fflush(stdout);
+    }
+
+    void on_quote(const sl_quote_t* q, void* data)
+    {
+	watch_display& d = *static_cast<watch_display*>(data);
+	const auto r = d.rows.find(q->symbol);
+	if (r==d.rows.end())
+	    return;
+
+	const bool priced = (q->flags & SLQFPrice)!=0;
+	if (d.out)
+	{
+	    // The library batches the requests, so only the time of receipt is known
+	    const char* ticker = stocklib_symbol_name(q->symbol);
+	    if (priced)
+		d.out->write({ ticker, (q->flags & SLQFName) ? stocklib_ticker_to_name(ticker) : nullptr,
+			       q->price, q->timestamp, q->timestamp });
+	    return;
+	}
+
+	const std::size_t row = r->second;
+	const int64_t change = (priced && d.priced[row]) ? q->price-d.prices[row] : 0;
+	d.priced[row] = priced;
+	d.prices[row] = q->price;
+	draw(d,row,*q,change);
+    }
+
+    /**
+     * Keeps the tickers refreshed until interrupted. The subscription is
+     * aligned, so each refresh is one batched request, and asks for changes
+     * only, so only lines which changed are redrawn.
+     */
+    int watch(const options& opts)
+    {
+	// Taken by sigwait() below; blocked first, so every library thread
+	// inherits the mask
+	sigset_t signals;
+	sigemptyset(&signals);
+	sigaddset(&signals,SIGINT);
+	sigaddset(&signals,SIGTERM);
+	pthread_sigmask(SIG_BLOCK,&signals,nullptr);
+
+	watch_display d;
+	std::unique_ptr<recordwriter> out;
+	if (opts.formatted)
+	    out.reset( d.out = new recordwriter(STDOUT_FILENO,opts.format,true) );
+	else
+	    d.tty = isatty(STDOUT_FILENO);
+	std::vector<const char*> tickers;
+	std::set<string> seen;
+	for ( const string& t : opts.tickers )
+	    if (seen.insert(t).second)
+	    {
+		d.rows[stocklib_symbol_id(t.c_str())] = d.tickers.size();
+		d.tickers.push_back(t);
+	    }
+	for ( const string& t : d.tickers )
+	    tickers.push_back(t.c_str());
+	d.prices.resize(d.tickers.size());
+	d.priced.resize(d.tickers.size());
+
+	if (d.tty)
+	    for ( std::size_t row=0; row<d.tickers.size(); row++ )
+		printf("%-10s %12s\n",d.tickers[row].c_str(),"...");
+	fflush(stdout);
+
+	const sl_subscription_t s = stocklib_subscribe(tickers.data(),tickers.size(),opts.watch_ms,
+						       &on_quote,&d,SLSFChangesOnly|SLSFAligned);
+	int signal;
+	sigwait(&signals,&signal);
+	stocklib_unsubscribe(s);
+	return 0;
+    }
 }
 
 int main( int argc, char* argv[] )
 {
-    /* Extract symbol from command line, if supplied */
-    if (argc > 1 )
-	g_ticker = argv[1];
+    options opts;
+    if (!parse(argc,argv,opts))
+	return 2;
+
+    /* The daemon does the fetching, so needs neither library here */
+    if (opts.daemon)
+	return ask_daemon(opts);
 
     /* Initialise the CURL library */
     curl_global_init(CURL_GLOBAL_ALL);
 
     /* Initialise the stocklib library */
     stocklib_init();
+    if (!opts.endpoint.empty())
+	stocklib_set_endpoint(opts.endpoint.c_str());
 
-    /* Fetch a result */
-    char buffer[SL_MAX_BUFFER];
-    
-    if (SL_OK != stocklib_fetch_synch(g_ticker.c_str(),buffer) )
+    if (opts.watch_ms)
+	return watch(opts);
+
+    /* A single ticker on the command line prints just its price */
+    if (opts.bare)
     {
-	cout << "An error occurred." << endl;
-	return 1;
+	char buffer[SL_MAX_BUFFER];
+	if (SL_OK != stocklib_fetch_synch(opts.tickers[0].c_str(),buffer) )
+	{
+	    cout << "An error occurred." << endl;
+	    return 1;
+	}
+	cout << buffer << endl;
+	return 0;
     }
 
-    /* Output the result */
-    cout << buffer << endl;
+    stocklib_reserve_connections(opts.jobs);
+
+    if (opts.bench)
+	return benchmark(opts) ? 1 : 0;
+
+    recordwriter out(STDOUT_FILENO,opts.format,isatty(STDOUT_FILENO));
+    const std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+    const std::size_t failed = fetch_all(opts,out);
+    const bool written = out.flush();
+
+    if (opts.timing)
+    {
+	const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now()-begin).count();
+	cerr << opts.tickers.size() << " tickers in " << seconds << "s ("
+	     << opts.tickers.size()/seconds << " per second, " << opts.jobs << " at once)" << endl;
+    }
 
     /* Done! */
-    return 0;
+    if (!written)
+	cerr << "stock: cannot write results" << endl;
+    return (failed || !written) ? 1 : 0;
 }
@@ -0,0 +1,307 @@
+/**
+ * @file
+ * Implementation of the recordwriter class.
+ */
+
+/*
+The MIT License (MIT)
+
+Copyright (c) 2015 David Bradshaw
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include <algorithm>
+#include <string>
+#include <cstring>
+#include <cstdio>
+#include <cerrno>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include <stocklib/stocklib.h>
+#include "recordwriter.h"
+
+namespace
+{
+    /**
+     * Appends a string as the inside of a JSON string literal
+     */
+    void append_json(std::string& out, const char* s)
+    {
+	for ( ; *s; s++ )
+	{
+	    const unsigned char c = *s;
+	    if ( (c=='"') || (c=='\\') )
+	    {
+		out += '\\';
+		out += c;
+	    }
+	    else if (c<0x20)
+	    {
+		char escape[8];
+		snprintf(escape,sizeof(escape),"\\u%04x",c);
+		out += escape;
+	    }
+	    else
+		out += c;
+	}
+    }
+
+    /**
+     * Appends a CSV field, quoted if it holds a separator, quote or line break
+     */
+    void append_csv(std::string& out, const char* s)
+    {
+	if (!strpbrk(s,",\"\r\n"))
+	{
+	    out += s;
+	    return;
+	}
+	out += '"';
+	for ( ; *s; s++ )
+	{
+	    if (*s=='"')
+		out += '"';
+	    out += *s;
+	}
+	out += '"';
+    }
+
+    void append_le(std::string& out, uint64_t value, unsigned bytes)
+    {
+	for ( unsigned i=0; i<bytes; i++, value>>=8 )
+	    out += static_cast<char>(value & 0xff);
+    }
+}
+
+/**
+ * Constructor. The csv and binary formats write their header immediately,
+ * though it is not flushed until the first record is.
+ *
+ * @param fd the file descriptor to write to, which the writer does not close
+ * @param format the format to write records in
+ * @param autoflush true to flush after every record
+ */
+recordwriter::recordwriter(int fd, format_t format, bool autoflush) :
+    _fd(fd),
+    _format(format),
+    _autoflush(autoflush)
+{
+    _chunks.reserve(max_chunks);
+    static const char csv_header[] = "symbol,name,price,requested,received\n";
+    static const char binary_header[] = "SLQ1";
+    if (format==csv)
+	append(csv_header,sizeof(csv_header)-1);
+    else if (format==binary)
+	append(binary_header,sizeof(binary_header)-1);
+}
+
+/**
+ * Destructor. Flushes whatever has not yet been written.
+ */
+recordwriter::~recordwriter()
+{
+    flush();
+}
+
+/**
+ * Looks up a format by name
+ *
+ * @param name text, csv, ndjson or binary
+ * @param format receives the format
+ * @return false if the name is not recognized
+ */
+bool recordwriter::parse_format(const char* name, format_t& format)
+{
+    static const struct { const char* name; format_t format; } formats[] =
+    {
+	{ "text", text },
+	{ "csv", csv },
+	{ "ndjson", ndjson },
+	{ "binary", binary }
+    };
+    for ( const auto& f : formats )
+	if (!strcmp(name,f.name))
+	{
+	    format = f.format;
+	    return true;
+	}
+    return false;
+}
+
+/**
+ * Writes a record, which is buffered unless the writer flushes every record
+ */
+void recordwriter::write(const record& r)
+{
+    format(r);
+    append(_scratch.data(),_scratch.size());
+    if (_autoflush)
+	flush();
+}
+
+/**
+ * Writes everything buffered, in one writev() call unless the kernel takes
+ * less than all of it
+ *
+ * @return false if this or an earlier write failed
+ */
+bool recordwriter::flush()
+{
+    struct iovec iov[max_chunks+1];
+    std::size_t count = 0;
+    for ( ; count<_filled; count++ )
+    {
+	iov[count].iov_base = _chunks[count].get();
+	iov[count].iov_len = chunk_size;
+    }
+    if (_used)
+    {
+	iov[count].iov_base = _chunks[count].get();
+	iov[count++].iov_len = _used;
+    }
+    _filled = 0;
+    _used = 0;
+
+    struct iovec* next = iov;
+    while ( _good && count )
+    {
+	ssize_t written = writev(_fd,next,count);
+	if (written<0)
+	{
+	    _good = (errno==EINTR);
+	    continue;
+	}
+	for ( ; count && (static_cast<std::size_t>(written)>=next->iov_len); count-- )
+	    written -= (next++)->iov_len;
+	if (count)
+	{
+	    next->iov_base = static_cast<char*>(next->iov_base)+written;
+	    next->iov_len -= written;
+	}
+    }
+    return _good;
+}
+
+/**
+ * @return false if a write has failed, in which case later records are
+ * discarded
+ */
+bool recordwriter::good() const
+{
+    return _good;
+}
+
+/**
+ * Formats a record into the scratch buffer
+ */
+void recordwriter::format(const record& r)
+{
+    _scratch.clear();
+    char price[SL_MAX_BUFFER];
+    if (_format!=binary)
+	stocklib_format_price(r.price,price);
+
+    switch (_format)
+    {
+    case text:
+	_scratch += r.symbol;
+	_scratch += ' ';
+	_scratch += price;
+	_scratch += '\n';
+	break;
+
+    case csv:
+	append_csv(_scratch,r.symbol);
+	_scratch += ',';
+	append_csv(_scratch,r.name ? r.name : "");
+	_scratch += ',';
+	_scratch += price;
+	_scratch += ',';
+	_scratch += std::to_string(r.requested);
+	_scratch += ',';
+	_scratch += std::to_string(r.received);
+	_scratch += '\n';
+	break;
+
+    case ndjson:
+	_scratch += "{\"symbol\":\"";
+	append_json(_scratch,r.symbol);
+	_scratch += "\",\"name\":";
+	if (r.name)
+	{
+	    _scratch += '"';
+	    append_json(_scratch,r.name);
+	    _scratch += '"';
+	}
+	else
+	    _scratch += "null";
+	_scratch += ",\"price\":";
+	_scratch += price;
+	_scratch += ",\"requested\":";
+	_scratch += std::to_string(r.requested);
+	_scratch += ",\"received\":";
+	_scratch += std::to_string(r.received);
+	_scratch += "}\n";
+	break;
+
+    case binary:
+    {
+	// Over-long strings are truncated to keep within the field widths
+	const std::size_t symbol = std::min<std::size_t>(strlen(r.symbol),UINT8_MAX);
+	const std::size_t name = r.name ? std::min<std::size_t>(strlen(r.name),1024) : 0;
+	append_le(_scratch,2+1+2+3*8+symbol+name,2);
+	append_le(_scratch,symbol,1);
+	append_le(_scratch,name,2);
+	append_le(_scratch,r.price,8);
+	append_le(_scratch,r.requested,8);
+	append_le(_scratch,r.received,8);
+	_scratch.append(r.symbol,symbol);
+	if (name)
+	    _scratch.append(r.name,name);
+	break;
+    }
+    }
+}
+
+/**
+ * Copies bytes into the chunks, writing them all out once every chunk is full
+ */
+void recordwriter::append(const char* data, std::size_t length)
+{
+    while (length)
+    {
+	if (_filled==_chunks.size())
+	    _chunks.emplace_back(new char[chunk_size]);
+
+	const std::size_t space = chunk_size-_used;
+	const std::size_t n = (length<space) ? length : space;
+	memcpy(_chunks[_filled].get()+_used,data,n);
+	data += n;
+	length -= n;
+	_used += n;
+	if (_used==chunk_size)
+	{
+	    _used = 0;
+	    if (++_filled==max_chunks)
+		flush();
+	}
+    }
+}
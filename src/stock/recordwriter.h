@@ -0,0 +1,119 @@
+/**
+ * @file
+ * Public header for the recordwriter class, which writes quotes to standard
+ * output in machine-readable formats.
+ */
+
+/*
+The MIT License (MIT)
+
+Copyright (c) 2015 David Bradshaw
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#ifndef RECORDWRITER_H
+#define RECORDWRITER_H
+
+#include <vector>
+#include <memory>
+#include <string>
+#include <cstdint>
+
+/**
+ * Writes quote records to a file descriptor in one of several formats:
+ *
+ * - text: `TICKER PRICE`, one per line
+ * - csv: a header line, then `symbol,name,price,requested,received` per
+ *   record, the name quoted as RFC 4180 requires
+ * - ndjson: one JSON object per line, with the same fields; the name is null
+ *   when it is not known
+ * - binary: the four bytes `SLQ1`, then per record, little-endian: the record
+ *   length in bytes, including itself (uint16); the symbol length (uint8);
+ *   the name length, 0 if unknown (uint16); the price in units of
+ *   1/SL_PRICE_SCALE, and the request and receipt times in microseconds since
+ *   the Unix epoch (int64 each); then the symbol and the name, unterminated
+ *
+ * Prices are decimal in the text formats, and timestamps always microseconds
+ * since the Unix epoch.
+ *
+ * Records are gathered in a list of large chunks, which are handed to the
+ * kernel together by one writev() call once enough have filled, so that a
+ * large run costs a few system calls rather than one per record. When
+ * writing to something a person is watching, such as a terminal, the writer
+ * can instead flush after every record.
+ */
+class recordwriter
+{
+public:
+
+    enum format_t
+    {
+	text,
+	csv,
+	ndjson,
+	binary
+    };
+
+    /** One quote. The name may be NULL. */
+    struct record
+    {
+	const char* symbol;
+	const char* name;
+	int64_t price;
+	int64_t requested;
+	int64_t received;
+    };
+
+    /** @name Lifecycle Management */
+    //@{
+    recordwriter(int fd, format_t format, bool autoflush);
+    recordwriter( const recordwriter& ) = delete;
+    recordwriter& operator=( const recordwriter& ) = delete;
+    virtual ~recordwriter();
+    //@}
+
+    /** @name Public API */
+    ///@{
+    static bool parse_format(const char* name, format_t& format);
+
+    void write(const record& r);
+    bool flush();
+    bool good() const;
+    ///@}
+
+private:
+    void format(const record& r);
+    void append(const char* data, std::size_t length);
+
+    static const std::size_t chunk_size = 64*1024;
+    static const std::size_t max_chunks = 16;
+
+    const int _fd;
+    const format_t _format;
+    const bool _autoflush;
+    bool _good{true};
+
+    std::string _scratch;				///< The record being formatted
+    std::vector<std::unique_ptr<char[]>> _chunks;
+    std::size_t _filled{0};				///< Chunks full, before the current one
+    std::size_t _used{0};				///< Bytes used in the current chunk
+};
+
+#endif
@@ -0,0 +1,390 @@
+/**
+ * @file
+ *
+ * The stock daemon, which holds the library's state (its caches, pooled
+ * connections and subscriptions) for as long as it runs, and answers quote
+ * requests from clients such as `stock --daemon` over a Unix-domain socket,
+ * in the binary protocol described by queryprotocol. A quote recent enough
+ * for the client is answered from memory, with no request upstream.
+ *
+ * Example usage:
+ * @code
+ * me@mymachine ~/ $ stockd &
+ * me@mymachine ~/ $ stock --daemon AAPL MSFT
+ * @endcode
+ */
+
+/*
+The MIT License (MIT)
+
+Copyright (c) 2015 David Bradshaw
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include <config.h>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <set>
+#include <unordered_map>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <chrono>
+#include <cstdint>
+#include <cerrno>
+#include <cstring>
+#include <stdlib.h>
+#include <signal.h>
+#include <unistd.h>
+#include <getopt.h>
+#include <sys/stat.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#include <curl/curl.h>
+#include <stocklib/stocklib.h>
+#include <stocklib/queryprotocol.h>
+
+using std::cerr;
+using std::endl;
+using std::string;
+
+namespace
+{
+    struct options
+    {
+	string socket{queryprotocol::default_socket_path()};
+	unsigned connections{16};	///< Requests run at once
+    };
+
+    /**
+     * The latest good quote of every symbol fetched, however it was fetched
+     */
+    class quotecache
+    {
+    public:
+	void remember(const sl_quote_t& q)
+	{
+	    if (!(q.flags & SLQFPrice))
+		return;
+	    std::lock_guard<std::mutex> lock(_mutex);
+	    sl_quote_t& held = _quotes[q.symbol];
+	    if (q.timestamp>=held.timestamp)
+		held = q;
+	}
+
+	/**
+	 * @return true if the cache holds a quote no older than max_age_us
+	 */
+	bool lookup(sl_symbol_t symbol, int64_t max_age_us, int64_t now, sl_quote_t& q)
+	{
+	    std::lock_guard<std::mutex> lock(_mutex);
+	    const auto i = _quotes.find(symbol);
+	    if ( (i==_quotes.end()) || (now-i->second.timestamp > max_age_us) )
+		return false;
+	    q = i->second;
+	    return true;
+	}
+
+    private:
+	std::mutex _mutex;
+	std::unordered_map<sl_symbol_t,sl_quote_t> _quotes;
+    };
+
+    quotecache g_cache;
+
+    /* Symbols kept fresh by a subscription, which lasts as long as the daemon */
+    std::mutex g_subscribed_mutex;
+    std::set<sl_symbol_t> g_subscribed;
+
+    int64_t now_us()
+    {
+	using namespace std::chrono;
+	return duration_cast<microseconds>(system_clock::now().time_since_epoch()).count();
+    }
+
+    void usage()
+    {
+	cerr << "Usage: stockd [options]" << endl << endl
+	     << "Answers quote requests from stock --daemon over a Unix-domain socket, holding" << endl
+	     << "the library's caches and connections between requests." << endl << endl
+	     << "  -s, --socket PATH  listen on PATH (default " << queryprotocol::default_socket_path() << ")" << endl
+	     << "  -j, --jobs N       fetch up to N tickers at once (default 16, at most 1024)" << endl
+	     << "  -h, --help         show this help" << endl;
+    }
+
+    /// Most requests allowed in flight by --jobs
+    const unsigned max_jobs = 1024;
+
+    bool parse(int argc, char* argv[], options& opts)
+    {
+	static const struct option longopts[] =
+	{
+	    { "socket", required_argument, nullptr, 's' },
+	    { "jobs", required_argument, nullptr, 'j' },
+	    { "help", no_argument, nullptr, 'h' },
+	    { nullptr, 0, nullptr, 0 }
+	};
+
+	int opt;
+	while ( (opt = getopt_long(argc,argv,"s:j:h",longopts,nullptr)) != -1 )
+	    switch (opt)
+	    {
+	    case 's':
+		opts.socket = optarg;
+		break;
+	    case 'j':
+	    {
+		// Read signed, so that a negative count is refused rather than
+		// wrapping round, and clamped
+		char* end;
+		errno = 0;
+		const long long n = strtoll(optarg,&end,10);
+		if ( (end==optarg) || *end || (n<1) )
+		{
+		    cerr << "stockd: --jobs must be at least 1" << endl;
+		    return false;
+		}
+		opts.connections = ( (errno==ERANGE) || (n>max_jobs) ) ? max_jobs : static_cast<unsigned>(n);
+		break;
+	    }
+	    default:
+		usage();
+		return false;
+	    }
+	return optind==argc;
+    }
+
+    /**
+     * Counts down the fetches of one request as they complete. Waiting here,
+     * rather than in stocklib_asynch_wait(), leaves the library free to serve
+     * other clients meanwhile.
+     */
+    struct countdown
+    {
+	std::mutex mutex;
+	std::condition_variable cv;
+	std::size_t remaining{0};
+
+	static void done(SLHANDLE, void* data)
+	{
+	    countdown& c = *static_cast<countdown*>(data);
+	    std::lock_guard<std::mutex> lock(c.mutex);
+	    if (--c.remaining==0)
+		c.cv.notify_one();
+	}
+
+	void wait()
+	{
+	    std::unique_lock<std::mutex> lock(mutex);
+	    cv.wait(lock, [this]() { return remaining==0; } );
+	}
+    };
+
+    /**
+     * Answers each ticker from the cache if its quote is recent enough, and
+     * fetches the rest, all at once
+     */
+    void quote(const queryprotocol::request& req, queryprotocol::response& resp)
+    {
+	const std::size_t count = req.tickers.size();
+	const int64_t max_age_us = static_cast<int64_t>(req.argument)*1000;
+	const int64_t now = now_us();
+
+	std::vector<sl_quote_t> quotes(count);
+	std::vector<SLHANDLE> handles(count,nullptr);
+	countdown pending;
+	pending.remaining = 1;			// Held until every fetch has started
+	for ( std::size_t i=0; i<count; i++ )
+	{
+	    const char* ticker = req.tickers[i].c_str();
+	    if (g_cache.lookup(stocklib_symbol_id(ticker),max_age_us,now,quotes[i]))
+		continue;
+	    {
+		std::lock_guard<std::mutex> lock(pending.mutex);
+		pending.remaining++;
+	    }
+	    handles[i] = stocklib_fetch_quote_asynch(ticker,&quotes[i],SLPRInteractive);
+	    stocklib_asynch_register_callback(handles[i],&countdown::done,&pending);
+	}
+	countdown::done(nullptr,&pending);
+	pending.wait();
+
+	resp.code = queryprotocol::ok;
+	resp.quotes.resize(count);
+	for ( std::size_t i=0; i<count; i++ )
+	{
+	    const sl_quote_t& q = quotes[i];
+	    if (handles[i])
+	    {
+		// Each callback runs exactly once, but make sure the fetch has
+		// reported its outcome before giving up the handle
+		while (!stocklib_is_complete(handles[i]))
+		    std::this_thread::yield();
+		stocklib_asynch_dispose(handles[i]);
+		g_cache.remember(q);
+	    }
+
+	    queryprotocol::quote_record& r = resp.quotes[i];
+	    r.ticker = req.tickers[i];
+	    r.price = q.price;
+	    r.timestamp = q.timestamp;
+	    r.flags = q.flags;
+	    const char* name = (q.flags & SLQFName) ? stocklib_ticker_to_name(r.ticker.c_str()) : nullptr;
+	    r.name = name ? name : "";
+	}
+    }
+
+    void on_quote(const sl_quote_t* q, void*)
+    {
+	g_cache.remember(*q);
+    }
+
+    /**
+     * Subscribes to the tickers not already kept fresh
+     */
+    void subscribe(const queryprotocol::request& req, queryprotocol::response& resp)
+    {
+	std::vector<const char*> tickers;
+	{
+	    std::lock_guard<std::mutex> lock(g_subscribed_mutex);
+	    for ( const string& t : req.tickers )
+		if (g_subscribed.insert(stocklib_symbol_id(t.c_str())).second)
+		    tickers.push_back(t.c_str());
+	}
+	if (!tickers.empty())
+	    stocklib_subscribe(tickers.data(),tickers.size(),std::max<uint32_t>(req.argument,100),
+			       &on_quote,nullptr);
+	resp.code = queryprotocol::ok;
+    }
+
+    /**
+     * Serves one client until it disconnects or sends something malformed
+     */
+    void serve(int fd)
+    {
+	string body, frame;
+	queryprotocol::request req;
+	queryprotocol::response resp;
+	while (queryprotocol::read_frame(fd,body))
+	{
+	    resp = queryprotocol::response();
+	    const bool good = queryprotocol::decode(body,req);
+	    if (!good)
+		resp.code = queryprotocol::bad_request;
+	    else if (req.op==queryprotocol::quote)
+		quote(req,resp);
+	    else if (req.op==queryprotocol::subscribe)
+		subscribe(req,resp);
+
+	    queryprotocol::encode(resp,frame);
+	    if ( !queryprotocol::write_frame(fd,frame) || !good )
+		break;
+	}
+	close(fd);
+    }
+
+    /**
+     * Binds the socket, unless another daemon is already listening on it.
+     * A socket file left behind by a daemon which died is replaced.
+     *
+     * @return The listening socket, or -1
+     */
+    int listen_on(const string& path)
+    {
+	struct sockaddr_un addr;
+	memset(&addr,0,sizeof(addr));
+	addr.sun_family = AF_UNIX;
+	if (path.size()>=sizeof(addr.sun_path))
+	{
+	    cerr << "stockd: socket path too long: " << path << endl;
+	    return -1;
+	}
+	strcpy(addr.sun_path,path.c_str());
+
+	const int fd = socket(AF_UNIX,SOCK_STREAM,0);
+	if (fd<0)
+	    return -1;
+
+	if (0==connect(fd,reinterpret_cast<struct sockaddr*>(&addr),sizeof(addr)))
+	{
+	    cerr << "stockd: already running on " << path << endl;
+	    close(fd);
+	    return -1;
+	}
+	unlink(path.c_str());
+
+	// Only this user may connect
+	const mode_t mask = umask(077);
+	const bool bound = (0==bind(fd,reinterpret_cast<struct sockaddr*>(&addr),sizeof(addr)));
+	umask(mask);
+	if ( !bound || (0!=listen(fd,SOMAXCONN)) )
+	{
+	    cerr << "stockd: cannot listen on " << path << ": " << strerror(errno) << endl;
+	    close(fd);
+	    return -1;
+	}
+	return fd;
+    }
+}
+
+int main( int argc, char* argv[] )
+{
+    options opts;
+    if (!parse(argc,argv,opts))
+	return 2;
+
+    // Taken by sigwait() below; blocked first, so every thread inherits the mask
+    sigset_t signals;
+    sigemptyset(&signals);
+    sigaddset(&signals,SIGINT);
+    sigaddset(&signals,SIGTERM);
+    pthread_sigmask(SIG_BLOCK,&signals,nullptr);
+
+    const int listener = listen_on(opts.socket);
+    if (listener<0)
+	return 1;
+
+    curl_global_init(CURL_GLOBAL_ALL);
+    stocklib_init();
+    stocklib_reserve_connections(opts.connections);
+
+    std::thread( [listener]()
+		 {
+		     for (;;)
+		     {
+			 const int fd = accept(listener,nullptr,nullptr);
+			 if (fd>=0)
+			     std::thread(&serve,fd).detach();
+			 else if ( (errno!=EINTR) && (errno!=ECONNABORTED) )
+			     break;
+		     }
+		 } ).detach();
+
+    int signal;
+    sigwait(&signals,&signal);
+    close(listener);
+    unlink(opts.socket.c_str());
+
+    // Clients, subscriptions and the scheduler may still be running, so leave
+    // without destroying the library's state under them
+    _exit(0);
+}
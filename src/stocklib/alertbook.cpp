@@ -0,0 +1,226 @@
+/**
+ * @file
+ * Implementation of the alertbook class.
+ */
+
+/*
+The MIT License (MIT)
+
+Copyright (c) 2015 David Bradshaw
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include <utility>
+
+#include "alertbook.h"
+
+/**
+ * Constructor. Fired alerts are dropped until a callback is set.
+ */
+alertbook::alertbook()
+{
+}
+
+/**
+ * Destructor
+ */
+alertbook::~alertbook()
+{
+}
+
+/**
+ * Adds an alert
+ *
+ * @param symbol the symbol to watch
+ * @param direction whether the alert fires when the price rises to the
+ *        threshold or falls to it
+ * @param threshold the price, in units of 1/SL_PRICE_SCALE
+ * @param repeat true to fire on every crossing, false to fire once
+ * @return the alert's id
+ */
+alertbook::id_t alertbook::add(sl_symbol_t symbol, sl_alert_direction_t direction,
+			       int64_t threshold, bool repeat)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+
+    if (symbol>=_symbols.size())
+	_symbols.resize(symbol+1);
+    symbol_alerts& s = _symbols[symbol];
+
+    const id_t id = _next_id++;
+    index& alerts = (direction==SLADAbove) ? s.above : s.below;
+    _alerts[id] = location{symbol,direction,alerts.insert(std::make_pair(threshold,rule{id,repeat}))};
+    return id;
+}
+
+/**
+ * Removes an alert. An alert which has fired once, and does not repeat, is
+ * already gone.
+ *
+ * @return false if there is no such alert
+ */
+bool alertbook::remove(id_t id)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+
+    const auto a = _alerts.find(id);
+    if (a==_alerts.end())
+	return false;
+
+    symbol_alerts& s = _symbols[a->second.symbol];
+    ((a->second.direction==SLADAbove) ? s.above : s.below).erase(a->second.where);
+    _alerts.erase(a);
+    return true;
+}
+
+/**
+ * Removes every alert, forgets every price, and drops any fired alerts not
+ * yet delivered
+ */
+void alertbook::clear()
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    _symbols.clear();
+    _alerts.clear();
+    _pending.clear();
+    _fired = 0;
+}
+
+/**
+ * Sets the function which receives fired alerts. An empty function drops
+ * them.
+ */
+void alertbook::callback(deliver_fn deliver)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    _deliver = deliver;
+}
+
+/**
+ * Moves a symbol's price, queueing the alerts whose thresholds it crossed
+ * for deliver()
+ *
+ * @param symbol the symbol quoted
+ * @param timestamp when it was quoted
+ * @param price its price
+ * @return true if any alert fired
+ */
+bool alertbook::update(sl_symbol_t symbol, int64_t timestamp, int64_t price)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+
+    // The price is kept even with no alerts, to measure later crossings from
+    if (symbol>=_symbols.size())
+	_symbols.resize(symbol+1);
+    symbol_alerts& s = _symbols[symbol];
+
+    const int64_t last = s.price;
+    const bool quoted = s.quoted;
+    s.price = price;
+    s.quoted = true;
+    if (!quoted)
+	return false;
+
+    const std::size_t before = _pending.size();
+    if (price>last)
+    {
+	// Thresholds in (last,price]
+	fire_bare(s.above, s.above.upper_bound(last), s.above.upper_bound(price),
+		  symbol, SLADAbove, timestamp, price);
+    }
+    else if (price<last)
+    {
+	// Thresholds in [price,last)
+	fire_bare(s.below, s.below.lower_bound(price), s.below.lower_bound(last),
+		  symbol, SLADBelow, timestamp, price);
+    }
+
+    return _pending.size()!=before;
+}
+
+/**
+ * Passes the alerts fired so far to the callback, in batches, until none are
+ * left. Returns at once if another thread is delivering, or if called from
+ * the callback; that call delivers them instead.
+ */
+void alertbook::deliver()
+{
+    std::unique_lock<std::mutex> lock(_mutex);
+    if (_delivering)
+	return;
+    _delivering = true;
+
+    std::vector<sl_alert_t> batch;
+    while (!_pending.empty())
+    {
+	batch.swap(_pending);
+	const deliver_fn deliver = _deliver;
+
+	lock.unlock();
+	if (deliver)
+	    deliver(batch.data(),batch.size());
+	batch.clear();
+	lock.lock();
+    }
+
+    _delivering = false;
+}
+
+/**
+ * @return The number of alerts held
+ */
+std::size_t alertbook::size() const
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _alerts.size();
+}
+
+/**
+ * @return The number of times alerts have fired
+ */
+uint64_t alertbook::fired() const
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _fired;
+}
+
+/**
+ * Queues a range of alerts from an index as fired, and removes those which
+ * do not repeat. Call with the lock held.
+ */
+void alertbook::fire_bare(index& alerts, index::iterator from, index::iterator to,
+			  sl_symbol_t symbol, sl_alert_direction_t direction,
+			  int64_t timestamp, int64_t price)
+{
+    while (from!=to)
+    {
+	_pending.push_back( sl_alert_t{ from->second.id, symbol, direction,
+					from->first, price, timestamp } );
+	_fired++;
+
+	if (from->second.repeat)
+	{
+	    ++from;
+	    continue;
+	}
+	_alerts.erase(from->second.id);
+	from = alerts.erase(from);
+    }
+}
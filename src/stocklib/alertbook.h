@@ -0,0 +1,141 @@
+/**
+ * @file
+ * Public header for the alertbook class, which fires price alerts as quotes
+ * cross their thresholds.
+ */
+
+/*
+The MIT License (MIT)
+
+Copyright (c) 2015 David Bradshaw
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#ifndef ALERTBOOK_H
+#define ALERTBOOK_H
+
+#include <vector>
+#include <deque>
+#include <map>
+#include <unordered_map>
+#include <mutex>
+#include <functional>
+#include <cstdint>
+
+#include <stocklib/stocklib.h>
+
+/**
+ * Holds price alerts, each on one symbol, which fire when a quote crosses
+ * their threshold: an alert above a threshold fires when the price rises from
+ * below it to at least it, and an alert below a threshold when the price
+ * falls from above it to at most it. The first quote of a symbol sets the
+ * price moves are measured from, and fires nothing.
+ *
+ * Each symbol keeps its alerts above and below in two indexes sorted by
+ * threshold. A quote moving the price up can only fire alerts above, with
+ * thresholds between the old price and the new, and those are found by one
+ * search of the index; likewise for a quote moving the price down. A quote
+ * therefore costs O(log n + fired), however many alerts are held.
+ *
+ * An alert fires once and is removed, unless it repeats, in which case it
+ * fires on every crossing.
+ *
+ * Fired alerts are queued, and passed in batches to the callback by
+ * deliver(), so a batch of quotes leads to one call. The callback is never
+ * run concurrently, nor with the lock held, so it may add and remove alerts,
+ * and anything it causes to fire is delivered before deliver() returns.
+ */
+class alertbook
+{
+public:
+
+    /** Identifies an alert. Never 0. */
+    typedef sl_alert_id_t id_t;
+
+    /** Receives a batch of fired alerts */
+    typedef std::function<void(const sl_alert_t* alerts, std::size_t count)> deliver_fn;
+
+    /** @name Lifecycle Management */
+    //@{
+    alertbook();
+    alertbook( const alertbook& ) = delete;
+    alertbook& operator=( const alertbook& ) = delete;
+    virtual ~alertbook();
+    //@}
+
+    /** @name Public API */
+    ///@{
+    id_t add(sl_symbol_t symbol, sl_alert_direction_t direction, int64_t threshold,
+	     bool repeat=false);
+    bool remove(id_t id);
+    void clear();
+    void callback(deliver_fn deliver);
+
+    bool update(sl_symbol_t symbol, int64_t timestamp, int64_t price);
+    void deliver();
+
+    std::size_t size() const;
+    uint64_t fired() const;
+    ///@}
+
+protected:
+
+    struct rule
+    {
+	id_t id;
+	bool repeat;
+    };
+
+    /** Thresholds to their alerts */
+    typedef std::multimap<int64_t,rule> index;
+
+    struct symbol_alerts
+    {
+	index above;
+	index below;
+	int64_t price{0};
+	bool quoted{false};
+    };
+
+    /** Where an alert is indexed */
+    struct location
+    {
+	sl_symbol_t symbol;
+	sl_alert_direction_t direction;
+	index::iterator where;
+    };
+
+    void fire_bare(index& alerts, index::iterator from, index::iterator to,
+		   sl_symbol_t symbol, sl_alert_direction_t direction,
+		   int64_t timestamp, int64_t price);
+
+private:
+
+    std::deque<symbol_alerts> _symbols;	///< By symbol; growing never moves them
+    std::unordered_map<id_t,location> _alerts;
+    std::vector<sl_alert_t> _pending;
+    deliver_fn _deliver;
+    bool _delivering{false};
+    id_t _next_id{1};
+    uint64_t _fired{0};
+    mutable std::mutex _mutex;
+};
+
+#endif
@@ -0,0 +1,436 @@
+/**
+ * @file
+ * Implementation of the analytics class
+ */
+
+/*
+The MIT License (MIT)
+
+Copyright (c) 2015 David Bradshaw
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include <cmath>
+#include <cfloat>
+#include <limits>
+#include <algorithm>
+#include <vector>
+#include <atomic>
+#include <stdexcept>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define ANALYTICS_X86
+#include <immintrin.h>
+#endif
+
+#include <stocklib/stocklib.h>
+#include "analytics.h"
+#include "tickring.h"
+
+namespace
+{
+    /* Constants for the vectorized logarithms (ln 2 split as in fdlibm) */
+    const double ln2_hi = 6.93147180369123816490e-01;
+    const double ln2_lo = 1.90821492927058770002e-10;
+    const double two52 = 4503599627370496.0;
+
+    /**
+     * Coefficients of log(m) = 2(s + s^3/3 + s^5/5 + ...), s = (m-1)/(m+1), in
+     * powers of s^2. With m in [sqrt(1/2), sqrt(2)], |s| < 0.172, and the
+     * terms left out are below one part in 10^18.
+     */
+    const double log_series[] = {
+	2.0/1, 2.0/3, 2.0/5, 2.0/7, 2.0/9, 2.0/11,
+	2.0/13, 2.0/15, 2.0/17, 2.0/19, 2.0/21, 2.0/23
+    };
+    const int log_terms = sizeof(log_series)/sizeof(log_series[0]);
+
+    /**
+     * Portable scalar kernels, the baseline for the vectorized ones
+     */
+    namespace scalar_kernels
+    {
+	typedef double vec;
+	const std::size_t width = 1;
+
+	inline vec load(const double* p) { return *p; }
+	inline void store(double* p, vec v) { *p = v; }
+	inline vec set1(double x) { return x; }
+	inline vec add(vec a, vec b) { return a+b; }
+	inline vec sub(vec a, vec b) { return a-b; }
+	inline vec mul(vec a, vec b) { return a*b; }
+	inline vec div(vec a, vec b) { return a/b; }
+	inline vec fmadd(vec a, vec b, vec c) { return a*b+c; }
+	inline vec vmin(vec a, vec b) { return std::min(a,b); }
+	inline vec vmax(vec a, vec b) { return std::max(a,b); }
+	inline vec vsqrt(vec a) { return std::sqrt(a); }
+	inline vec vlog(vec a) { return std::log(a); }
+	inline double hsum(vec a) { return a; }
+
+#include "analytics_kernels.h"
+    }
+
+#ifdef ANALYTICS_X86
+
+#pragma GCC push_options
+#pragma GCC target("avx2,fma")
+
+    /**
+     * Kernels for AVX2 with FMA, four doubles to a vector
+     */
+    namespace avx2_kernels
+    {
+	typedef __m256d vec;
+	const std::size_t width = 4;
+
+	inline vec load(const double* p) { return _mm256_loadu_pd(p); }
+	inline void store(double* p, vec v) { _mm256_storeu_pd(p,v); }
+	inline vec set1(double x) { return _mm256_set1_pd(x); }
+	inline vec add(vec a, vec b) { return _mm256_add_pd(a,b); }
+	inline vec sub(vec a, vec b) { return _mm256_sub_pd(a,b); }
+	inline vec mul(vec a, vec b) { return _mm256_mul_pd(a,b); }
+	inline vec div(vec a, vec b) { return _mm256_div_pd(a,b); }
+	inline vec fmadd(vec a, vec b, vec c) { return _mm256_fmadd_pd(a,b,c); }
+	inline vec vmin(vec a, vec b) { return _mm256_min_pd(a,b); }
+	inline vec vmax(vec a, vec b) { return _mm256_max_pd(a,b); }
+	inline vec vsqrt(vec a) { return _mm256_sqrt_pd(a); }
+
+	inline double hsum(vec a)
+	{
+	    __m128d s = _mm_add_pd(_mm256_castpd256_pd128(a),_mm256_extractf128_pd(a,1));
+	    s = _mm_add_sd(s,_mm_unpackhi_pd(s,s));
+	    return _mm_cvtsd_f64(s);
+	}
+
+	/**
+	 * Natural logarithm. The exponent is taken from the bits of each lane,
+	 * and the logarithm of the mantissa, brought into [sqrt(1/2),sqrt(2)],
+	 * from the log_series. Lanes which are not positive normal numbers are
+	 * left to std::log().
+	 */
+	inline vec vlog(vec x)
+	{
+	    const vec normal = _mm256_and_pd(_mm256_cmp_pd(x,set1(DBL_MIN),_CMP_GE_OQ),
+					     _mm256_cmp_pd(x,set1(DBL_MAX),_CMP_LE_OQ));
+	    if ( _mm256_movemask_pd(normal) != 0xf )
+	    {
+		alignas(32) double lanes[width];
+		_mm256_store_pd(lanes,x);
+		for ( std::size_t i=0; i<width; i++ )
+		    lanes[i] = std::log(lanes[i]);
+		return _mm256_load_pd(lanes);
+	    }
+
+	    const __m256i bits = _mm256_castpd_si256(x);
+	    const __m256i biased = _mm256_or_si256(_mm256_srli_epi64(bits,52),
+						   _mm256_castpd_si256(set1(two52)));
+	    vec e = sub(_mm256_castsi256_pd(biased),set1(two52+1023.0));
+	    vec m = _mm256_castsi256_pd(
+		_mm256_or_si256(_mm256_and_si256(bits,_mm256_set1_epi64x(0x000fffffffffffffLL)),
+				_mm256_set1_epi64x(0x3ff0000000000000LL)));
+
+	    const vec big = _mm256_cmp_pd(m,set1(M_SQRT2),_CMP_GT_OQ);
+	    m = _mm256_blendv_pd(m,mul(m,set1(0.5)),big);
+	    e = add(e,_mm256_and_pd(big,set1(1.0)));
+
+	    const vec s = div(sub(m,set1(1.0)),add(m,set1(1.0)));
+	    const vec z = mul(s,s);
+	    vec p = set1(log_series[log_terms-1]);
+	    for ( int k=log_terms-2; k>=0; k-- )
+		p = fmadd(p,z,set1(log_series[k]));
+
+	    return fmadd(e,set1(ln2_hi),fmadd(e,set1(ln2_lo),mul(s,p)));
+	}
+
+#include "analytics_kernels.h"
+    }
+
+#pragma GCC pop_options
+
+#pragma GCC push_options
+#pragma GCC target("avx512f,avx2,fma")
+
+    /**
+     * Kernels for AVX-512F, eight doubles to a vector
+     */
+    namespace avx512_kernels
+    {
+	typedef __m512d vec;
+	const std::size_t width = 8;
+
+	inline vec load(const double* p) { return _mm512_loadu_pd(p); }
+	inline void store(double* p, vec v) { _mm512_storeu_pd(p,v); }
+	inline vec set1(double x) { return _mm512_set1_pd(x); }
+	inline vec add(vec a, vec b) { return _mm512_add_pd(a,b); }
+	inline vec sub(vec a, vec b) { return _mm512_sub_pd(a,b); }
+	inline vec mul(vec a, vec b) { return _mm512_mul_pd(a,b); }
+	inline vec div(vec a, vec b) { return _mm512_div_pd(a,b); }
+	inline vec fmadd(vec a, vec b, vec c) { return _mm512_fmadd_pd(a,b,c); }
+	inline vec vmin(vec a, vec b) { return _mm512_min_pd(a,b); }
+	inline vec vmax(vec a, vec b) { return _mm512_max_pd(a,b); }
+	inline vec vsqrt(vec a) { return _mm512_sqrt_pd(a); }
+
+	inline double hsum(vec a)
+	{
+	    const __m256d h = _mm256_add_pd(_mm512_castpd512_pd256(a),_mm512_extractf64x4_pd(a,1));
+	    __m128d s = _mm_add_pd(_mm256_castpd256_pd128(h),_mm256_extractf128_pd(h,1));
+	    s = _mm_add_sd(s,_mm_unpackhi_pd(s,s));
+	    return _mm_cvtsd_f64(s);
+	}
+
+	/**
+	 * Natural logarithm, as avx2_kernels::vlog()
+	 */
+	inline vec vlog(vec x)
+	{
+	    const __mmask8 normal = _mm512_cmp_pd_mask(x,set1(DBL_MIN),_CMP_GE_OQ)
+		& _mm512_cmp_pd_mask(x,set1(DBL_MAX),_CMP_LE_OQ);
+	    if ( normal != 0xff )
+	    {
+		alignas(64) double lanes[width];
+		_mm512_store_pd(lanes,x);
+		for ( std::size_t i=0; i<width; i++ )
+		    lanes[i] = std::log(lanes[i]);
+		return _mm512_load_pd(lanes);
+	    }
+
+	    const __m512i bits = _mm512_castpd_si512(x);
+	    const __m512i biased = _mm512_or_si512(_mm512_srli_epi64(bits,52),
+						   _mm512_castpd_si512(set1(two52)));
+	    vec e = sub(_mm512_castsi512_pd(biased),set1(two52+1023.0));
+	    vec m = _mm512_castsi512_pd(
+		_mm512_or_si512(_mm512_and_si512(bits,_mm512_set1_epi64(0x000fffffffffffffLL)),
+				_mm512_set1_epi64(0x3ff0000000000000LL)));
+
+	    const __mmask8 big = _mm512_cmp_pd_mask(m,set1(M_SQRT2),_CMP_GT_OQ);
+	    m = _mm512_mask_mul_pd(m,big,m,set1(0.5));
+	    e = _mm512_mask_add_pd(e,big,e,set1(1.0));
+
+	    const vec s = div(sub(m,set1(1.0)),add(m,set1(1.0)));
+	    const vec z = mul(s,s);
+	    vec p = set1(log_series[log_terms-1]);
+	    for ( int k=log_terms-2; k>=0; k-- )
+		p = fmadd(p,z,set1(log_series[k]));
+
+	    return fmadd(e,set1(ln2_hi),fmadd(e,set1(ln2_lo),mul(s,p)));
+	}
+
+#include "analytics_kernels.h"
+    }
+
+#pragma GCC pop_options
+
+#endif
+
+    /** The kernels built for one instruction set */
+    struct kernel_table
+    {
+	void (*simple_returns)(const double*, const double*, double*, std::size_t);
+	void (*log_returns)(const double*, const double*, double*, std::size_t);
+	void (*zscores)(const double*, double*, std::size_t);
+	void (*window_stats)(const double*, std::size_t, std::size_t,
+			     double*, double*, double*, double*);
+    };
+
+    /** Kernel tables, indexed by analytics::isa_t */
+    const kernel_table g_kernels[] = {
+#define KERNEL_TABLE(ns) { &ns::simple_returns, &ns::log_returns, &ns::zscores, &ns::window_stats }
+	KERNEL_TABLE(scalar_kernels),
+#ifdef ANALYTICS_X86
+	KERNEL_TABLE(avx2_kernels),
+	KERNEL_TABLE(avx512_kernels),
+#endif
+#undef KERNEL_TABLE
+    };
+
+    /** The instruction set in use, or -1 before the first kernel is called */
+    std::atomic<int> g_isa{-1};
+
+    const kernel_table& kernels()
+    {
+	return g_kernels[analytics::isa()];
+    }
+}
+
+/**
+ * @return The widest instruction set supported by the processor (and
+ *         operating system) this is running on
+ */
+analytics::isa_t analytics::detect()
+{
+#ifdef ANALYTICS_X86
+    __builtin_cpu_init();
+    if ( __builtin_cpu_supports("avx512f") )
+	return avx512;
+    if ( __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma") )
+	return avx2;
+#endif
+    return scalar;
+}
+
+/**
+ * @return The instruction set the kernels run with, detecting it on first use
+ */
+analytics::isa_t analytics::isa()
+{
+    int set = g_isa.load(std::memory_order_relaxed);
+    if (set<0)
+    {
+	set = detect();
+	g_isa.store(set,std::memory_order_relaxed);
+    }
+    return static_cast<isa_t>(set);
+}
+
+/**
+ * Selects the instruction set the kernels run with. Narrower sets than the
+ * one detected may be selected, to compare them in tests and benchmarks.
+ *
+ * @param set The instruction set to use
+ */
+void analytics::use(isa_t set)
+{
+    if ( set > detect() )
+	throw std::logic_error("The instruction set is not supported by this processor");
+    g_isa.store(set,std::memory_order_relaxed);
+}
+
+/**
+ * @return A printable name for an instruction set
+ */
+const char* analytics::name(isa_t set)
+{
+    switch (set)
+    {
+    case avx512:
+	return "avx512";
+    case avx2:
+	return "avx2";
+    default:
+	return "scalar";
+    }
+}
+
+/**
+ * Computes simple returns, current/previous - 1, for every symbol.
+ *
+ * @param previous Prices at the start of the period
+ * @param current Prices at the end of the period
+ * @param out Receives the returns. May be previous or current.
+ * @param n The number of symbols
+ */
+void analytics::simple_returns(const double* previous, const double* current,
+			       double* out, std::size_t n)
+{
+    kernels().simple_returns(previous,current,out,n);
+}
+
+/**
+ * Computes log returns, log(current/previous), for every symbol.
+ *
+ * @param previous Prices at the start of the period
+ * @param current Prices at the end of the period
+ * @param out Receives the returns. May be previous or current.
+ * @param n The number of symbols
+ */
+void analytics::log_returns(const double* previous, const double* current,
+			    double* out, std::size_t n)
+{
+    kernels().log_returns(previous,current,out,n);
+}
+
+/**
+ * Computes cross-sectional z-scores: each value's distance from the mean of
+ * all n, in standard deviations. If all values are equal, all are 0.
+ *
+ * @param values The values, such as returns, one per symbol
+ * @param out Receives the z-scores. May be values.
+ * @param n The number of symbols
+ */
+void analytics::zscores(const double* values, double* out, std::size_t n)
+{
+    kernels().zscores(values,out,n);
+}
+
+/**
+ * Computes each symbol's mean, standard deviation, minimum and maximum over a
+ * window.
+ *
+ * @param panel window columns of n values, oldest first
+ * @param window The number of columns in the panel. Must be positive.
+ * @param n The number of symbols
+ * @param mean Receives n means
+ * @param stddev Receives n standard deviations
+ * @param min Receives n minima, unless NULL
+ * @param max Receives n maxima, unless NULL
+ */
+void analytics::window_stats(const double* panel, std::size_t window, std::size_t n,
+			     double* mean, double* stddev, double* min, double* max)
+{
+    if (window==0)
+	throw std::logic_error("The window must hold at least one column");
+
+    kernels().window_stats(panel,window,n,mean,stddev,min,max);
+}
+
+/**
+ * Builds a panel for window_stats() from the most recent ticks of each symbol
+ * in a tick history, converting prices to units. A symbol with fewer ticks
+ * than the window has its earliest price repeated in the columns before it,
+ * and a symbol with none is all zeroes.
+ *
+ * @param history The tick history to read
+ * @param symbols The symbols, one per column position
+ * @param n The number of symbols
+ * @param window The number of columns to build
+ * @param panel Receives window*n prices
+ * @return The number of symbols with at least window ticks
+ */
+std::size_t analytics::gather(const tickhistory& history, const uint32_t* symbols,
+			      std::size_t n, std::size_t window, double* panel)
+{
+    std::vector<int64_t> timestamps(window);
+    std::vector<int64_t> prices(window);
+    std::size_t complete = 0;
+
+    for ( std::size_t i=0; i<n; i++ )
+    {
+	const tickring* ring = history.find(symbols[i]);
+	const std::size_t count = ring
+	    ? ring->copy(std::numeric_limits<int64_t>::min(),
+			 std::numeric_limits<int64_t>::max(),
+			 timestamps.data(), prices.data(), window)
+	    : 0;
+
+	if (count==window)
+	    complete++;
+
+	const std::size_t missing = window-count;
+	for ( std::size_t r=0; r<window; r++ )
+	{
+	    double price = 0.0;
+	    if (count)
+		price = static_cast<double>(prices[ (r<missing) ? 0 : r-missing ]) / SL_PRICE_SCALE;
+	    panel[r*n+i] = price;
+	}
+    }
+
+    return complete;
+}
@@ -0,0 +1,93 @@
+/**
+ * @file
+ * Public header for the analytics class, which provides vectorized
+ * cross-sectional kernels over columns of prices.
+ */
+
+/*
+The MIT License (MIT)
+
+Copyright (c) 2015 David Bradshaw
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#ifndef ANALYTICS_H
+#define ANALYTICS_H
+
+#include <cstddef>
+#include <cstdint>
+
+class tickhistory;
+
+/** @class analytics
+ * Kernels which compute returns and window statistics for a whole universe of
+ * symbols at once. Inputs are columns: contiguous arrays holding one value per
+ * symbol. A window of W refresh cycles is a panel of W such columns stored
+ * one after another, oldest first, so that symbol i at cycle r is element
+ * r*n+i. Every kernel then walks memory sequentially, a vector of symbols at
+ * a time.
+ *
+ * Every kernel is built for AVX-512, for AVX2 and for plain scalar code; the
+ * widest the processor supports is chosen the first time a kernel is called.
+ *
+ * Inputs must be finite, and prices positive. Standard deviations are
+ * population standard deviations.
+ */
+class analytics
+{
+public:
+
+    /** Instruction sets for which the kernels are built */
+    enum isa_t
+    {
+	scalar=0,		///< Portable scalar code
+	avx2=1,			///< AVX2 and FMA, four prices per instruction
+	avx512=2		///< AVX-512F, eight prices per instruction
+    };
+
+    analytics() = delete;
+
+    /** @name Dispatch */
+    ///@{
+    static isa_t detect();
+    static isa_t isa();
+    static void use(isa_t set);
+    static const char* name(isa_t set);
+    ///@}
+
+    /** @name Kernels */
+    ///@{
+    static void simple_returns(const double* previous, const double* current,
+			       double* out, std::size_t n);
+    static void log_returns(const double* previous, const double* current,
+			    double* out, std::size_t n);
+    static void zscores(const double* values, double* out, std::size_t n);
+    static void window_stats(const double* panel, std::size_t window, std::size_t n,
+			     double* mean, double* stddev, double* min, double* max);
+    ///@}
+
+    /** @name Data preparation */
+    ///@{
+    static std::size_t gather(const tickhistory& history, const uint32_t* symbols,
+			      std::size_t n, std::size_t window, double* panel);
+    ///@}
+};
+
+#endif
@@ -0,0 +1,179 @@
+/**
+ * @file
+ * The analytics kernels, written once for every instruction set.
+ *
+ * This file is included by analytics.cpp once per instruction set, inside a
+ * namespace which first defines the vector type and its operations:
+ *
+ *  - vec, and width, the number of doubles it holds
+ *  - load(), store() and set1()
+ *  - add(), sub(), mul(), div(), fmadd(), vmin(), vmax() and vsqrt()
+ *  - vlog(), a natural logarithm, and hsum(), a horizontal sum
+ *
+ * Symbols left over after the last full vector are done with scalar code.
+ * There is deliberately no include guard.
+ */
+
+/*
+The MIT License (MIT)
+
+Copyright (c) 2015 David Bradshaw
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+/**
+ * Computes cur/prev - 1 for every symbol
+ */
+void simple_returns(const double* prev, const double* cur, double* out, std::size_t n)
+{
+    const vec one = set1(1.0);
+    std::size_t i = 0;
+
+    for ( ; i+width <= n; i += width )
+	store(out+i, sub(div(load(cur+i),load(prev+i)),one));
+
+    for ( ; i<n; i++ )
+	out[i] = cur[i]/prev[i] - 1.0;
+}
+
+/**
+ * Computes log(cur/prev) for every symbol
+ */
+void log_returns(const double* prev, const double* cur, double* out, std::size_t n)
+{
+    std::size_t i = 0;
+
+    for ( ; i+width <= n; i += width )
+	store(out+i, vlog(div(load(cur+i),load(prev+i))));
+
+    for ( ; i<n; i++ )
+	out[i] = std::log(cur[i]/prev[i]);
+}
+
+/**
+ * Standardizes a column against its own mean and standard deviation. A column
+ * with no spread standardizes to zeroes.
+ */
+void zscores(const double* x, double* out, std::size_t n)
+{
+    if (n==0)
+	return;
+
+    vec acc = set1(0.0);
+    std::size_t i = 0;
+    for ( ; i+width <= n; i += width )
+	acc = add(acc,load(x+i));
+    double sum = hsum(acc);
+    for ( ; i<n; i++ )
+	sum += x[i];
+
+    const double mean = sum/n;
+    const vec vmean = set1(mean);
+
+    acc = set1(0.0);
+    i = 0;
+    for ( ; i+width <= n; i += width )
+    {
+	const vec d = sub(load(x+i),vmean);
+	acc = fmadd(d,d,acc);
+    }
+    double squares = hsum(acc);
+    for ( ; i<n; i++ )
+	squares += (x[i]-mean)*(x[i]-mean);
+
+    const double sd = std::sqrt(squares/n);
+    const double scale = (sd>0.0) ? 1.0/sd : 0.0;
+    const vec vscale = set1(scale);
+
+    i = 0;
+    for ( ; i+width <= n; i += width )
+	store(out+i, mul(sub(load(x+i),vmean),vscale));
+    for ( ; i<n; i++ )
+	out[i] = (x[i]-mean)*scale;
+}
+
+/**
+ * Computes the statistics of each symbol over a window, a vector of symbols
+ * at a time. The first pass over the window's rows sums them and tracks the
+ * extremes, and the second, which finds the rows still in cache, sums the
+ * squared deviations from the mean.
+ */
+void window_stats(const double* panel, std::size_t window, std::size_t n,
+		  double* mean, double* stddev, double* min, double* max)
+{
+    const double scale = 1.0/window;
+    const vec vscale = set1(scale);
+    std::size_t i = 0;
+
+    for ( ; i+width <= n; i += width )
+    {
+	vec sum = load(panel+i);
+	vec lo = sum;
+	vec hi = sum;
+	for ( std::size_t r=1; r<window; r++ )
+	{
+	    const vec v = load(panel+r*n+i);
+	    sum = add(sum,v);
+	    lo = vmin(lo,v);
+	    hi = vmax(hi,v);
+	}
+
+	const vec mu = mul(sum,vscale);
+	vec squares = set1(0.0);
+	for ( std::size_t r=0; r<window; r++ )
+	{
+	    const vec d = sub(load(panel+r*n+i),mu);
+	    squares = fmadd(d,d,squares);
+	}
+
+	store(mean+i,mu);
+	store(stddev+i,vsqrt(mul(squares,vscale)));
+	if (min)
+	    store(min+i,lo);
+	if (max)
+	    store(max+i,hi);
+    }
+
+    for ( ; i<n; i++ )
+    {
+	double sum = panel[i];
+	double lo = sum;
+	double hi = sum;
+	for ( std::size_t r=1; r<window; r++ )
+	{
+	    const double v = panel[r*n+i];
+	    sum += v;
+	    lo = std::min(lo,v);
+	    hi = std::max(hi,v);
+	}
+
+	const double mu = sum*scale;
+	double squares = 0.0;
+	for ( std::size_t r=0; r<window; r++ )
+	    squares += (panel[r*n+i]-mu)*(panel[r*n+i]-mu);
+
+	mean[i] = mu;
+	stddev[i] = std::sqrt(squares*scale);
+	if (min)
+	    min[i] = lo;
+	if (max)
+	    max[i] = hi;
+    }
+}
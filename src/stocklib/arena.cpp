@@ -0,0 +1,226 @@
+/**
+ * @file
+ * Implementation of the arena class.
+ */
+
+/*
+The MIT License (MIT)
+
+Copyright (c) 2015 David Bradshaw
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <new>
+#include <algorithm>
+
+#include "arena.h"
+
+namespace
+{
+    thread_local arena* t_current = nullptr;
+
+    inline std::size_t align_up(std::size_t n, std::size_t align)
+    {
+	return (n + align - 1) & ~(align - 1);
+    }
+
+    // Usable space starts after the header, suitably aligned
+    const std::size_t HEADER = 32;
+
+    /**
+     * Placed in front of each allocation made by scoped_malloc(), to record
+     * where it came from. Its size keeps the allocation after it aligned.
+     */
+    struct origin
+    {
+	uint64_t tag;
+	uint64_t unused;
+    };
+
+    const uint64_t ORIGIN_ARENA = 0x414e4552415f534dULL;
+    const uint64_t ORIGIN_HEAP = 0x484541505f5f534dULL;
+}
+
+arena::scope::scope(arena& a) : _previous(t_current)
+{
+    t_current = &a;
+}
+
+arena::scope::~scope()
+{
+    t_current = _previous;
+}
+
+/**
+ * Constructor. No memory is allocated until the first allocation.
+ *
+ * @param block_size The size of the blocks obtained from the system
+ */
+arena::arena(std::size_t block_size) : _block_size(block_size)
+{
+    static_assert( sizeof(block) <= HEADER, "arena block header too large" );
+    static_assert( HEADER % default_align == 0, "arena header misaligns blocks" );
+}
+
+arena::~arena()
+{
+    while (_blocks)
+    {
+	block* next = _blocks->next;
+	free(_blocks);
+	_blocks = next;
+    }
+}
+
+/**
+ * Allocates memory from the arena. It remains valid until release() is
+ * called, or the arena is destroyed.
+ *
+ * @param size The number of bytes required
+ * @param align The alignment required (a power of two, at most
+ * default_align)
+ * @return The memory
+ */
+void* arena::allocate(std::size_t size, std::size_t align)
+{
+    std::size_t offset = _blocks ? align_up(_blocks->offset,align) : 0;
+
+    if ( !_blocks || (offset + size > _blocks->size) )
+    {
+	block* b = new_block( std::max(_block_size, align_up(size,HEADER)) );
+	b->next = _blocks;
+	_blocks = b;
+	offset = 0;
+    }
+
+    _blocks->offset = offset + size;
+    _used += size;
+    _allocations++;
+
+    return reinterpret_cast<char*>(_blocks) + HEADER + offset;
+}
+
+/**
+ * Frees everything allocated from the arena in one step. If more than one
+ * block was in use, they are replaced by a single block large enough to hold
+ * all of their contents, so that the next round of similar work fits in it.
+ */
+void arena::release()
+{
+    if (!_blocks)
+	return;
+
+    if (_blocks->next)
+    {
+	std::size_t total = 0;
+	while (_blocks)
+	{
+	    block* next = _blocks->next;
+	    total += _blocks->size;
+	    free(_blocks);
+	    _blocks = next;
+	}
+	_blocks = new_block(total);
+	_blocks->next = nullptr;
+    }
+
+    _blocks->offset = 0;
+    _used = 0;
+}
+
+/**
+ * @return true if the memory at p was allocated from this arena
+ */
+bool arena::owns(const void* p) const
+{
+    const char* c = reinterpret_cast<const char*>(p);
+    for ( const block* b = _blocks; b; b = b->next )
+    {
+	const char* start = reinterpret_cast<const char*>(b) + HEADER;
+	if ( (c >= start) && (c < start + b->size) )
+	    return true;
+    }
+    return false;
+}
+
+arena::block* arena::new_block(std::size_t size)
+{
+    block* b = reinterpret_cast<block*>(malloc(HEADER + size));
+    if (!b)
+	throw std::bad_alloc();
+
+    b->size = size;
+    b->offset = 0;
+    _system_allocations++;
+    return b;
+}
+
+/**
+ * @return The arena made current on this thread by an arena::scope, or
+ * nullptr if there is none
+ */
+arena* arena::current()
+{
+    return t_current;
+}
+
+/**
+ * A malloc() replacement, which allocates from the current arena if there is
+ * one. Each allocation is tagged with its origin, so that scoped_free() can
+ * tell arena memory from heap memory whichever arena (if any) is current
+ * when it is freed.
+ */
+void* arena::scoped_malloc(std::size_t size)
+{
+    origin* o;
+    if (t_current)
+    {
+	o = static_cast<origin*>(t_current->allocate(sizeof(origin)+size));
+	o->tag = ORIGIN_ARENA;
+    }
+    else
+    {
+	o = static_cast<origin*>(malloc(sizeof(origin)+size));
+	if (!o)
+	    return nullptr;
+	o->tag = ORIGIN_HEAP;
+    }
+    return o+1;
+}
+
+/**
+ * A free() replacement, matching scoped_malloc(). Memory from any arena is
+ * left for that arena's release(); heap memory is passed to free(). The
+ * pointer must have come from scoped_malloc().
+ */
+void arena::scoped_free(void* p)
+{
+    if (!p)
+	return;
+
+    origin* o = static_cast<origin*>(p)-1;
+    if (o->tag==ORIGIN_HEAP)
+    {
+	o->tag = 0;
+	free(o);
+    }
+}
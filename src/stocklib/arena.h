@@ -0,0 +1,128 @@
+/**
+ * @file
+ * Public header for the arena class, a monotonic allocator for the short-lived
+ * allocations made while serving one request.
+ */
+
+/*
+The MIT License (MIT)
+
+Copyright (c) 2015 David Bradshaw
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * A monotonic (bump-pointer) allocator.
+ *
+ * Memory is handed out sequentially from large blocks, and never freed
+ * individually; release() frees everything at once. After a release, the
+ * arena keeps a single block big enough for everything allocated before, so
+ * an arena re-used for similar work makes no further system allocations.
+ *
+ * C libraries with pluggable allocators (such as jansson) can be pointed at
+ * scoped_malloc() and scoped_free(). These allocate from the arena made
+ * current on the calling thread by an arena::scope, and fall back to malloc()
+ * and free() when no scope is active. Memory from an arena may be passed to
+ * scoped_free() from any thread and under any scope (or none); it is only
+ * reclaimed by its own arena's release(). Only memory from scoped_malloc()
+ * may be passed to scoped_free(), so such a library must be pointed at them
+ * before it allocates anything.
+ *
+ * @note An arena is not thread-safe. Each is meant for one request at a time.
+ */
+class arena
+{
+public:
+
+    /**
+     * Makes an arena the target of scoped_malloc() on the calling thread, for
+     * the lifetime of the scope. Scopes may be nested.
+     */
+    class scope
+    {
+    public:
+	explicit scope(arena& a);
+	~scope();
+	scope( const scope& ) = delete;
+	scope& operator=( const scope& ) = delete;
+
+    private:
+	arena* const _previous;
+    };
+
+    /** @name Lifecycle Management */
+    //@{
+    explicit arena(std::size_t block_size=4096);
+    arena( const arena& ) = delete;
+    arena& operator=( const arena& ) = delete;
+    virtual ~arena();
+    //@}
+
+    /** @name Public API */
+    ///@{
+    void* allocate(std::size_t size, std::size_t align=default_align);
+    void release();
+    bool owns(const void* p) const;
+
+    /** @return The number of allocations served since construction */
+    uint64_t allocations() const { return _allocations; }
+
+    /** @return The number of blocks obtained from the system since construction */
+    uint64_t system_allocations() const { return _system_allocations; }
+
+    /** @return The number of bytes handed out since the last release() */
+    std::size_t used() const { return _used; }
+    ///@}
+
+    /** The alignment of memory returned by allocate(), unless asked otherwise */
+    static const std::size_t default_align = alignof(long double);
+
+    static arena* current();
+    static void* scoped_malloc(std::size_t size);
+    static void scoped_free(void* p);
+
+protected:
+
+    /** A block of memory, followed directly by its usable space */
+    struct block
+    {
+	block* next;
+	std::size_t size;
+	std::size_t offset;
+    };
+
+    block* new_block(std::size_t size);
+
+private:
+
+    const std::size_t _block_size;
+    block* _blocks{nullptr};	///< The block in use, heading a list of earlier ones
+    std::size_t _used{0};
+    uint64_t _allocations{0};
+    uint64_t _system_allocations{0};
+};
+
+#endif
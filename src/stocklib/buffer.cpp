@@ -29,6 +29,7 @@ SOFTWARE.
 #include <stdlib.h>
 #include <memory.h>
 #include "buffer.h"
+#include "arena.h"
 
 
 buffer::buffer(unsigned long sz) : size(sz)
@@ -37,10 +38,29 @@ buffer::buffer(unsigned long sz) : size(sz)
     reset();
 }
 
+/**
+ * Constructs a buffer whose storage is drawn from an arena, and so is freed
+ * when the arena is released rather than when the buffer is destroyed.
+ *
+ * @param sz The initial size
+ * @param a The arena
+ * @param growable true if append() may grow the buffer, by drawing a larger
+ * block from the arena, rather than reject data which does not fit
+ */
+buffer::buffer(unsigned long sz, arena& a, bool growable) : size(sz), _owned(false)
+{
+    _buffer = reinterpret_cast<char*>(a.allocate(sz,1));
+    if (growable)
+	_arena = &a;
+    reset();
+}
+
 buffer::buffer( buffer&& o ) : size(o.size)
 {
     _buffer = o._buffer;
     index = o.index;
+    _owned = o._owned;
+    _arena = o._arena;
     o._buffer = nullptr;
     o.index=0;
 }
@@ -49,7 +69,8 @@ buffer::~buffer()
 {
     if ( _buffer != nullptr )
     {
-	free(_buffer);
+	if (_owned)
+	    free(_buffer);
 	_buffer = nullptr;
     }
 }
@@ -67,6 +88,22 @@ unsigned long buffer::remaining_bytes() const
 
 bool buffer::append(const void* pData, unsigned long sz)
 {
+    if ( (sz > remaining_bytes()) && _arena )
+    {
+	// Move to a block at least twice the size. The old one stays in the
+	// arena until it is released.
+	const unsigned long used = index-_buffer;
+	unsigned long grown = 2*size;
+	if (grown < used+sz)
+	    grown = used+sz;
+
+	char* b = reinterpret_cast<char*>(_arena->allocate(grown,1));
+	memcpy(b,_buffer,used);
+	_buffer = b;
+	index = b+used;
+	size = grown;
+    }
+
     if (sz <= remaining_bytes() )
     {
 	memcpy(index,pData,sz);
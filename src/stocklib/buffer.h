@@ -29,12 +29,15 @@ SOFTWARE.
 #ifndef BUFFER_H
 #define BUFFER_H
 
+class arena;
+
 class buffer
 {
  public:
     
     /* Lifecycle Management */
     buffer(unsigned long sz);
+    buffer(unsigned long sz, arena& a, bool growable=false);
     buffer( buffer&& );
     buffer( buffer const & ) = delete;
     buffer& operator=(buffer const &) = delete;
@@ -48,9 +51,11 @@ class buffer
     const char* contents() const;
 
 protected:
-    const unsigned long size;
+    unsigned long size;
     char* _buffer;
     char* index;
+    bool _owned{true};		///< False if the storage belongs to an arena
+    arena* _arena{nullptr};	///< Set if the buffer may grow, drawing on this arena
 
 };
 
@@ -0,0 +1,441 @@
+/**
+ * @file
+ * Public header for the directory class template, a concurrent read-mostly
+ * map from symbol id to per-symbol data.
+ */
+
+/*
+The MIT License (MIT)
+
+Copyright (c) 2015 David Bradshaw
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#ifndef DIRECTORY_H
+#define DIRECTORY_H
+
+#include <atomic>
+#include <mutex>
+#include <deque>
+#include <cstdint>
+#include <cstddef>
+#include <stdexcept>
+
+#include "epoch.h"
+
+/** @class directory
+ * A map from dense integer identifiers (as issued by symboltable) to values
+ * of type T, optimised for many concurrent readers and occasional writers.
+ *
+ * Each value is immutable once published. A store() allocates a new value
+ * and swaps it in with a single atomic exchange; the old value is retired and
+ * freed once no reader can still be looking at it (see epoch). Readers
+ * therefore take no lock and write to no shared memory, beyond setting an
+ * entry's reference bit the first time it is read after a store.
+ *
+ * Writers are serialised per shard (identifier modulo shard count), so
+ * updates to different symbols rarely contend.
+ *
+ * The number of resident entries may be capped, in which case a store() to a
+ * full directory evicts an existing entry first: one of the same shard if it
+ * has any other, and otherwise one of the first other shard whose lock can be
+ * taken without waiting. The eviction policy is either first-in-first-out, or
+ * CLOCK (second chance), which spares entries that have been read since the
+ * hand last passed them. Both are applied within a shard, so the order of
+ * eviction is only approximately global.
+ *
+ * The cap is exact for a single writer. Concurrent stores may briefly exceed
+ * it by up to one entry per writer when every other shard is busy; the
+ * excess is evicted by the next store.
+ */
+template<class T>
+class directory
+{
+public:
+
+    typedef uint32_t id_t;
+
+    /** Eviction policies applied when the directory is at capacity */
+    enum policy_t
+    {
+	evict_fifo,	///< Evict the oldest entry
+	evict_clock	///< Evict the oldest entry not read since it was last considered
+    };
+
+    /** @name Lifecycle Management */
+    //@{
+
+    /**
+     * Constructor
+     *
+     * @param max_entries The maximum number of resident entries, or zero for
+     * no limit
+     * @param policy The eviction policy used once max_entries is reached
+     */
+    directory(std::size_t max_entries=0, policy_t policy=evict_clock)
+	: _segments(new std::atomic<entry*>[max_segments])
+    {
+	for ( std::size_t i=0; i<max_segments; i++ )
+	    _segments[i].store(nullptr,std::memory_order_relaxed);
+	configure(max_entries,policy);
+    }
+
+    directory( const directory& ) = delete;
+    directory& operator=( const directory& ) = delete;
+
+    virtual ~directory()
+    {
+	clear();
+	for ( std::size_t i=0; i<max_segments; i++ )
+	    delete [] _segments[i].load();
+	delete [] _segments;
+    }
+    //@}
+
+    /** @name Public API */
+    ///@{
+
+    /**
+     * Calls fn with the value stored for an identifier, if there is one. The
+     * value must not be retained after fn returns.
+     *
+     * @return true if a value was found
+     */
+    template<class F>
+    bool read(id_t id, F fn) const
+    {
+	entry* e = find(id);
+	if (!e)
+	    return false;
+
+	epoch::guard g;
+	const T* value = e->value.load();
+	if (!value)
+	    return false;
+
+	if (!e->referenced.load(std::memory_order_relaxed))
+	    e->referenced.store(true,std::memory_order_relaxed);
+
+	fn(*value);
+	return true;
+    }
+
+    /**
+     * Copies out the value stored for an identifier.
+     *
+     * @return true if a value was found
+     */
+    bool get(id_t id, T& out) const
+    {
+	return read(id,[&out](const T& value) { out = value; });
+    }
+
+    /**
+     * @return true if a value is stored for the identifier
+     */
+    bool contains(id_t id) const
+    {
+	return read(id,[](const T&) {});
+    }
+
+    /**
+     * Stores (or replaces) the value for an identifier, evicting another
+     * entry if the directory is full.
+     */
+    void store(id_t id, const T& value)
+    {
+	entry& e = slot(id);
+	shard& s = _shards[id % shards];
+	std::lock_guard<std::mutex> lock(s.mutex);
+
+	const T* old = e.value.exchange(new T(value));
+	e.referenced.store(false,std::memory_order_relaxed);
+
+	if (old)
+	    retire_bare(s,old);
+	else
+	{
+	    s.resident.push_back(id);
+	    _size.fetch_add(1,std::memory_order_relaxed);
+	    while ( _max_entries && (size() > _max_entries) )
+		if ( !evict_bare(s,id) && !evict_elsewhere_bare(s,id) )
+		    break;
+	}
+
+	reclaim_bare(s);
+    }
+
+    /**
+     * Removes the value for an identifier.
+     *
+     * @return true if there was a value to remove
+     */
+    bool erase(id_t id)
+    {
+	entry* e = find(id);
+	if (!e)
+	    return false;
+
+	shard& s = _shards[id % shards];
+	std::lock_guard<std::mutex> lock(s.mutex);
+
+	const T* old = e->value.exchange(nullptr);
+	if (!old)
+	    return false;
+
+	for ( auto it = s.resident.begin(); it != s.resident.end(); ++it )
+	    if (*it == id)
+	    {
+		s.resident.erase(it);
+		break;
+	    }
+	_size.fetch_sub(1,std::memory_order_relaxed);
+
+	retire_bare(s,old);
+	reclaim_bare(s);
+	return true;
+    }
+
+    /**
+     * Changes the capacity and eviction policy. A directory already over the
+     * new capacity shrinks as it is next written.
+     *
+     * @param max_entries The maximum number of resident entries, or zero for
+     * no limit
+     * @param policy The eviction policy used once max_entries is reached
+     */
+    void configure(std::size_t max_entries, policy_t policy)
+    {
+	for ( shard& s : _shards )
+	    s.mutex.lock();
+
+	_max_entries = max_entries;
+	_policy = policy;
+
+	for ( shard& s : _shards )
+	    s.mutex.unlock();
+    }
+
+    /**
+     * Removes all values.
+     *
+     * @note Must not be called while other threads are using the directory.
+     */
+    void clear()
+    {
+	for ( shard& s : _shards )
+	{
+	    std::lock_guard<std::mutex> lock(s.mutex);
+	    for ( id_t id : s.resident )
+		delete slot(id).value.exchange(nullptr);
+	    s.resident.clear();
+	    for ( const retired& r : s.pending )
+		delete r.value;
+	    s.pending.clear();
+	}
+	_size.store(0);
+	_evictions.store(0);
+    }
+
+    /**
+     * @return The number of resident entries
+     */
+    std::size_t size() const
+    {
+	return _size.load(std::memory_order_relaxed);
+    }
+
+    /**
+     * @return The number of entries evicted to stay within capacity
+     */
+    std::size_t evictions() const
+    {
+	return _evictions.load(std::memory_order_relaxed);
+    }
+
+    /**
+     * @return The configured capacity, or zero if unlimited
+     */
+    std::size_t capacity() const
+    {
+	return _max_entries;
+    }
+
+    ///@}
+
+    /** The number of writer shards */
+    static const std::size_t shards = 16;
+
+protected:
+
+    static const unsigned segment_bits = 12;
+    static const std::size_t segment_size = 1 << segment_bits;
+    static const std::size_t max_segments = 1 << 12;
+
+    struct entry
+    {
+	entry() : value(nullptr), referenced(false) {}
+
+	std::atomic<const T*> value;
+	mutable std::atomic<bool> referenced;
+    };
+
+    struct retired
+    {
+	const T* value;
+	uint64_t tag;
+    };
+
+    struct shard
+    {
+	std::mutex mutex;
+	std::deque<id_t> resident;	///< Resident ids, oldest first
+	std::deque<retired> pending;	///< Replaced values awaiting reclaim
+    };
+
+    /**
+     * @return The entry for an identifier, or nullptr if its segment has
+     * never been written
+     */
+    entry* find(id_t id) const
+    {
+	if ( (id >> segment_bits) >= max_segments )
+	    return nullptr;
+
+	entry* seg = _segments[id >> segment_bits].load();
+	return seg ? &seg[id & (segment_size-1)] : nullptr;
+    }
+
+    /**
+     * @return The entry for an identifier, allocating its segment if needed
+     */
+    entry& slot(id_t id)
+    {
+	entry* e = find(id);
+	if (e)
+	    return *e;
+
+	if ( (id >> segment_bits) >= max_segments )
+	    throw std::length_error("directory identifier out of range");
+
+	std::atomic<entry*>& seg = _segments[id >> segment_bits];
+	entry* fresh = new entry[segment_size];
+	entry* expected = nullptr;
+	if (!seg.compare_exchange_strong(expected,fresh))
+	{
+	    delete [] fresh;
+	    fresh = expected;
+	}
+	return fresh[id & (segment_size-1)];
+    }
+
+    /**
+     * Queues an unlinked value for reclamation. Call with the shard locked.
+     */
+    void retire_bare(shard& s, const T* value)
+    {
+	s.pending.push_back({value,epoch::retire_tag()});
+    }
+
+    /**
+     * Frees any retired values which no reader can still hold. Call with the
+     * shard locked.
+     */
+    void reclaim_bare(shard& s)
+    {
+	if (s.pending.empty())
+	    return;
+
+	const uint64_t oldest = epoch::oldest();
+	while ( !s.pending.empty() && (s.pending.front().tag < oldest) )
+	{
+	    delete s.pending.front().value;
+	    s.pending.pop_front();
+	}
+    }
+
+    /**
+     * Evicts one entry according to the policy. Call with the shard locked.
+     *
+     * @param spare An identifier which must not be evicted (the one just
+     * stored)
+     * @return false if the shard held nothing to evict
+     */
+    bool evict_bare(shard& s, id_t spare)
+    {
+	if ( s.resident.empty() ||
+	     ((s.resident.size() == 1) && (s.resident.front() == spare)) )
+	    return false;
+
+	for (;;)
+	{
+	    const id_t victim = s.resident.front();
+	    s.resident.pop_front();
+
+	    entry& e = slot(victim);
+	    if ( (victim == spare) ||
+		 ((_policy == evict_clock) && e.referenced.exchange(false)) )
+	    {
+		s.resident.push_back(victim);
+		continue;
+	    }
+
+	    retire_bare(s,e.value.exchange(nullptr));
+	    _size.fetch_sub(1,std::memory_order_relaxed);
+	    _evictions.fetch_add(1,std::memory_order_relaxed);
+	    return true;
+	}
+    }
+
+    /**
+     * Evicts one entry from some shard other than s, which the caller has
+     * locked. Shards are only tried, never waited for, so that two writers
+     * doing this at once cannot deadlock.
+     *
+     * @param spare The identifier just stored in s
+     * @return false if no other shard could be locked and had an entry
+     */
+    bool evict_elsewhere_bare(shard& s, id_t spare)
+    {
+	const std::size_t own = &s - _shards;
+	for ( std::size_t i=1; i<shards; i++ )
+	{
+	    shard& o = _shards[(own+i) % shards];
+	    std::unique_lock<std::mutex> lock(o.mutex,std::try_to_lock);
+	    if ( lock && evict_bare(o,spare) )
+	    {
+		reclaim_bare(o);
+		return true;
+	    }
+	}
+	return false;
+    }
+
+private:
+
+    std::atomic<entry*>* const _segments;
+    shard _shards[shards];
+    std::atomic<std::size_t> _size{0};
+    std::atomic<std::size_t> _evictions{0};
+    std::size_t _max_entries{0};
+    policy_t _policy{evict_clock};
+};
+
+#endif
@@ -0,0 +1,157 @@
+/**
+ * @file
+ * Implementation of the epoch class.
+ */
+
+/*
+The MIT License (MIT)
+
+Copyright (c) 2015 David Bradshaw
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include <atomic>
+#include <mutex>
+
+#include "epoch.h"
+
+namespace
+{
+    const unsigned MAX_SLOTS = 256;
+
+    /**
+     * One reader's published epoch, on its own cache line. Zero means the
+     * reader is not in a critical section.
+     */
+    struct alignas(64) slot
+    {
+	std::atomic<uint64_t> active;
+	std::atomic<bool> taken;
+    };
+
+    std::atomic<uint64_t> g_epoch{1};
+    slot g_slots[MAX_SLOTS];
+
+    // Readers which could not claim a slot share this one, under a mutex
+    slot g_overflow;
+    std::mutex g_overflow_mutex;
+    unsigned g_overflow_readers{0};
+
+    /**
+     * Claims a slot for the calling thread on first use, and releases it
+     * when the thread exits.
+     */
+    struct thread_slot
+    {
+	thread_slot()
+	{
+	    for ( unsigned i=0; i<MAX_SLOTS; i++ )
+	    {
+		bool expected = false;
+		if (g_slots[i].taken.compare_exchange_strong(expected,true))
+		{
+		    s = &g_slots[i];
+		    return;
+		}
+	    }
+	}
+
+	~thread_slot()
+	{
+	    if (s)
+	    {
+		s->active.store(0);
+		s->taken.store(false);
+	    }
+	}
+
+	slot* s{nullptr};
+	unsigned depth{0};
+    };
+
+    thread_local thread_slot t_slot;
+}
+
+epoch::guard::guard()
+{
+    thread_slot& ts = t_slot;
+
+    if (ts.depth++)
+	return;
+
+    if (ts.s)
+	ts.s->active.store(g_epoch.load());
+    else
+    {
+	std::lock_guard<std::mutex> lock(g_overflow_mutex);
+	if (!g_overflow_readers++)
+	    g_overflow.active.store(g_epoch.load());
+    }
+}
+
+epoch::guard::~guard()
+{
+    thread_slot& ts = t_slot;
+
+    if (--ts.depth)
+	return;
+
+    if (ts.s)
+	ts.s->active.store(0,std::memory_order_release);
+    else
+    {
+	std::lock_guard<std::mutex> lock(g_overflow_mutex);
+	if (!--g_overflow_readers)
+	    g_overflow.active.store(0,std::memory_order_release);
+    }
+}
+
+/**
+ * Called by a writer immediately after unlinking an object. Readers entering
+ * from now on cannot reach the object.
+ *
+ * @return The tag to keep with the retired object
+ */
+uint64_t epoch::retire_tag()
+{
+    return g_epoch.fetch_add(1);
+}
+
+/**
+ * @return The oldest epoch any reader may still be in. Objects retired with
+ * a tag strictly less than this may be freed.
+ */
+uint64_t epoch::oldest()
+{
+    uint64_t oldest = UINT64_MAX;
+
+    for ( unsigned i=0; i<MAX_SLOTS; i++ )
+    {
+	const uint64_t a = g_slots[i].active.load();
+	if (a && (a<oldest))
+	    oldest = a;
+    }
+
+    const uint64_t a = g_overflow.active.load();
+    if (a && (a<oldest))
+	oldest = a;
+
+    return oldest;
+}
@@ -0,0 +1,71 @@
+/**
+ * @file
+ * Epoch-based reclamation, allowing readers to traverse shared structures
+ * without locks while writers replace and free parts of them.
+ */
+
+/*
+The MIT License (MIT)
+
+Copyright (c) 2015 David Bradshaw
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#ifndef EPOCH_H
+#define EPOCH_H
+
+#include <cstdint>
+
+/**
+ * A process-wide epoch-based reclamation domain.
+ *
+ * Readers wrap each lock-free traversal in an epoch::guard. A writer which
+ * unlinks an object from a shared structure calls retire_tag() immediately
+ * afterwards, and keeps the object until the tag is older than oldest(). At
+ * that point no reader can still hold a reference to it, and it may be freed.
+ *
+ * Entering and leaving a guard costs two stores to a slot private to the
+ * calling thread; readers never write to shared cache lines. Guards may be
+ * nested.
+ */
+class epoch
+{
+public:
+
+    /**
+     * Marks the lifetime of a read-side critical section.
+     */
+    class guard
+    {
+    public:
+	guard();
+	~guard();
+	guard( const guard& ) = delete;
+	guard& operator=( const guard& ) = delete;
+    };
+
+    static uint64_t retire_tag();
+    static uint64_t oldest();
+
+private:
+    epoch() = delete;
+};
+
+#endif
@@ -29,7 +29,9 @@ SOFTWARE.
 #ifndef I_RESULTOR_H
 #define I_RESULTOR_H
 
+#include <atomic>
 #include <exception>
+#include <stdexcept>
 #include <type_traits>
 
 /**
@@ -41,6 +43,11 @@ SOFTWARE.
  *
  * @note The default value of the result immediately after construction is zero,
  *       regardless of whether or not this is a valid  
+ *
+ * The ready flag is atomic. Setting it publishes the result and exception
+ * with release semantics, and ready() reads it with acquire semantics, so a
+ * thread which sees ready() return true also sees the result (and anything
+ * else the worker wrote beforehand), without taking a lock.
  */
 template<class R,class E>
 class i_resultor
@@ -56,13 +63,13 @@ public:
     i_resultor( const R& initial = R() ) : _result(initial) {} 
 
     /**
-     * Returns a reference to the current result, if available. 
+     * Returns the current result, if available. 
      * If not available, std::logic_error is thrown.
      */
-    const R& result() const 
+    R result() const 
     {
-	if (_ready)
-	    return _result;
+	if (ready())
+	    return _result.load(std::memory_order_relaxed);
 	else
 	    throw std::logic_error("The requested result is not available.");
     }
@@ -82,18 +89,40 @@ public:
      */
     bool ready() const
     {
-	return _ready;
+	return _ready.load(std::memory_order_acquire);
     }
     
 protected:
 
     /**
-     * Called by child classes to set or clear the ready flag
+     * Called by child classes to set or clear the ready flag. Setting the
+     * flag publishes everything written before it.
      * @param r Call with true to indicate a result is ready, false otherwise
      */
     void set_ready(bool r=true ) 
     {
-	_ready=r;
+	_ready.store(r,std::memory_order_release);
+    }
+
+    /**
+     * Called by child classes to store the result without publishing it, so
+     * that further work (such as a completion function) can be done before
+     * set_ready() is called. Until then, only the calling thread may rely on
+     * stored_result().
+     * @param r The result to store.
+     */
+    void store_result( const R& r )
+    {
+	_result.store(r,std::memory_order_relaxed);
+    }
+
+    /**
+     * @return The most recently stored result, whether or not it has been
+     * published.
+     */
+    R stored_result() const
+    {
+	return _result.load(std::memory_order_relaxed);
     }
 
     /** 
@@ -103,7 +132,7 @@ protected:
      */
     void set_result( const R& r )
     {
-	_result = r;
+	store_result(r);
 	set_ready();
     }
 
@@ -122,14 +151,14 @@ protected:
 
     void reset_result(const R& initial)
     {
+	set_ready(false);
 	_exception = E();
-	_result = initial;
-	_ready = false;
+	store_result(initial);
     }
 
 private:
-    bool _ready{false};
-    R _result{R()};
+    std::atomic<bool> _ready{false};
+    std::atomic<R> _result;
     E _exception{E()};
     
 };
@@ -0,0 +1,407 @@
+/**
+ * @file
+ * Implementation of the namefile class.
+ */
+
+/*
+The MIT License (MIT)
+
+Copyright (c) 2015 David Bradshaw
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include <string.h>
+#include <stdio.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "deathrattle.h"
+#include "namefile.h"
+
+namespace
+{
+    const char MAGIC[8] = { 'S','T','K','N','A','M','E','S' };
+    const uint32_t INITIAL_CAPACITY = 256;
+}
+
+const uint32_t namefile::version = 1;
+const std::size_t namefile::max_ticker = 23;
+const std::size_t namefile::max_name = 223;
+
+/**
+ * The file header. Padded to a cache line.
+ */
+struct namefile::header
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t record_size;
+    uint32_t capacity;		///< Number of records, a power of two
+    uint32_t count;		///< Number of occupied records
+    uint8_t reserved[40];
+};
+
+/**
+ * A single hash table slot. The hash is written last when a record is first
+ * published (zero means empty), and the seq field is a sequence lock: odd
+ * while the name is being rewritten.
+ */
+struct namefile::record
+{
+    uint32_t hash;
+    uint32_t seq;
+    char ticker[24];
+    char name[224];
+};
+
+namefile::namefile()
+{
+    static_assert(sizeof(header)==64,"namefile header layout");
+    static_assert(sizeof(record)==256,"namefile record layout");
+}
+
+namefile::~namefile()
+{
+    close();
+}
+
+/**
+ * Opens (or creates) the cache file at the given path. If the file exists
+ * but has a different format version, or is damaged, it is recreated.
+ *
+ * @return true if the cache is ready for use
+ */
+bool namefile::open(const std::string& path)
+{
+    close();
+    _path = path;
+
+    if (map_bare())
+	return true;
+
+    // Missing, stale or damaged - start again
+    if (create_bare(_path,INITIAL_CAPACITY) && map_bare())
+	return true;
+
+    close();
+    return false;
+}
+
+/**
+ * Unmaps and closes the file. The file itself is left in place.
+ */
+void namefile::close()
+{
+    if (_map)
+	munmap(_map,_map_size);
+    if (_fd>=0)
+	::close(_fd);
+
+    _map = nullptr;
+    _map_size = 0;
+    _fd = -1;
+}
+
+bool namefile::is_open() const
+{
+    return _map!=nullptr;
+}
+
+/**
+ * Looks up a ticker, copying its name into the buffer provided.
+ *
+ * @return true if the name was found
+ */
+bool namefile::lookup(const char* ticker, char* name, std::size_t size)
+{
+    if (!_map || (strlen(ticker)>max_ticker))
+	return false;
+
+    // Pick up a file replaced by another process
+    if (stale_bare() && !map_bare())
+	return false;
+
+    record* r = find_bare(ticker,hash(ticker));
+    if (!r)
+	return false;
+
+    uint32_t before, after;
+    do
+    {
+	before = __atomic_load_n(&r->seq,__ATOMIC_ACQUIRE);
+	if (before & 1)
+	    continue;
+
+	strncpy(name,r->name,size);
+	name[size-1] = '\0';
+
+	__atomic_thread_fence(__ATOMIC_ACQUIRE);
+	after = __atomic_load_n(&r->seq,__ATOMIC_RELAXED);
+    } while ( (before & 1) || (before!=after) );
+
+    return true;
+}
+
+/**
+ * Adds or updates a ticker's name.
+ *
+ * @return true if the name was stored
+ */
+bool namefile::insert(const char* ticker, const char* name)
+{
+    if (!_map || (strlen(ticker)>max_ticker) || (strlen(name)>max_name))
+	return false;
+
+    if (flock(_fd,LOCK_EX)!=0)
+	return false;
+    deathrattle unlock( [this]() { flock(this->_fd,LOCK_UN); } );
+
+    if (stale_bare())
+    {
+	// Another process replaced the file; switch to it and lock that
+	unlock.abort();
+	flock(_fd,LOCK_UN);
+	return map_bare() && insert(ticker,name);
+    }
+
+    const uint32_t h = hash(ticker);
+    record* r = find_bare(ticker,h);
+
+    if (r)
+    {
+	if (strcmp(r->name,name)==0)
+	    return true;
+
+	// Rewrite in place under the sequence lock
+	__atomic_store_n(&r->seq,r->seq+1,__ATOMIC_RELAXED);
+	__atomic_thread_fence(__ATOMIC_RELEASE);
+	strncpy(r->name,name,sizeof(r->name));
+	__atomic_store_n(&r->seq,r->seq+1,__ATOMIC_RELEASE);
+	return true;
+    }
+
+    header* hdr = static_cast<header*>(_map);
+
+    // Keep the table at most three-quarters full
+    if ( (hdr->count+1)*4 > hdr->capacity*3 )
+    {
+	if (!grow_bare())
+	    return false;
+	unlock.abort();
+	flock(_fd,LOCK_UN);
+	return insert(ticker,name);
+    }
+
+    record* records = reinterpret_cast<record*>(hdr+1);
+    const uint32_t mask = hdr->capacity-1;
+    uint32_t i = h & mask;
+    while (__atomic_load_n(&records[i].hash,__ATOMIC_RELAXED))
+	i = (i+1) & mask;
+
+    r = &records[i];
+    strncpy(r->ticker,ticker,sizeof(r->ticker));
+    strncpy(r->name,name,sizeof(r->name));
+    r->seq = 0;
+    __atomic_store_n(&r->hash,h,__ATOMIC_RELEASE);
+    hdr->count++;
+
+    return true;
+}
+
+/**
+ * @return the number of names stored in the file
+ */
+std::size_t namefile::count() const
+{
+    if (!_map)
+	return 0;
+    return static_cast<const header*>(_map)->count;
+}
+
+/**
+ * Maps the file at _path, checking that its header is valid.
+ */
+bool namefile::map_bare()
+{
+    if (_map)
+	munmap(_map,_map_size);
+    if (_fd>=0)
+	::close(_fd);
+    _map = nullptr;
+    _fd = -1;
+
+    _fd = ::open(_path.c_str(),O_RDWR|O_CLOEXEC);
+    if (_fd<0)
+	return false;
+
+    struct stat st;
+    if ( (fstat(_fd,&st)!=0) || (st.st_size<(off_t)sizeof(header)) )
+	return false;
+
+    _map_size = st.st_size;
+    _map = mmap(nullptr,_map_size,PROT_READ|PROT_WRITE,MAP_SHARED,_fd,0);
+    if (_map==MAP_FAILED)
+    {
+	_map = nullptr;
+	return false;
+    }
+
+    const header* hdr = static_cast<const header*>(_map);
+    const bool valid =
+	(memcmp(hdr->magic,MAGIC,sizeof(MAGIC))==0) &&
+	(hdr->version==version) &&
+	(hdr->record_size==sizeof(record)) &&
+	(hdr->capacity>0) && ((hdr->capacity & (hdr->capacity-1))==0) &&
+	(_map_size==sizeof(header)+hdr->capacity*sizeof(record));
+
+    if (!valid)
+    {
+	munmap(_map,_map_size);
+	_map = nullptr;
+	return false;
+    }
+
+    return true;
+}
+
+/**
+ * Writes an empty table to a temporary file, then renames it over path, so
+ * that other processes never see a partially initialised file.
+ */
+bool namefile::create_bare(const std::string& path, uint32_t capacity)
+{
+    const std::string tmp = path + ".tmp." + std::to_string(getpid());
+    const std::size_t size = sizeof(header) + capacity*sizeof(record);
+
+    int fd = ::open(tmp.c_str(),O_RDWR|O_CREAT|O_TRUNC|O_CLOEXEC,0644);
+    if (fd<0)
+	return false;
+    deathrattle d( [fd]() { ::close(fd); } );
+
+    if (ftruncate(fd,size)!=0)
+    {
+	unlink(tmp.c_str());
+	return false;
+    }
+
+    header hdr;
+    memset(&hdr,0,sizeof(hdr));
+    memcpy(hdr.magic,MAGIC,sizeof(MAGIC));
+    hdr.version = version;
+    hdr.record_size = sizeof(record);
+    hdr.capacity = capacity;
+
+    // Copy across any existing records
+    if (_map)
+    {
+	const header* old = static_cast<const header*>(_map);
+	const record* records = reinterpret_cast<const record*>(old+1);
+
+	void* m = mmap(nullptr,size,PROT_READ|PROT_WRITE,MAP_SHARED,fd,0);
+	if (m==MAP_FAILED)
+	{
+	    unlink(tmp.c_str());
+	    return false;
+	}
+
+	record* dest = reinterpret_cast<record*>(static_cast<header*>(m)+1);
+	for ( uint32_t i=0; i<old->capacity; i++ )
+	{
+	    if (!records[i].hash)
+		continue;
+
+	    uint32_t j = records[i].hash & (capacity-1);
+	    while (dest[j].hash)
+		j = (j+1) & (capacity-1);
+	    dest[j] = records[i];
+	    dest[j].seq = 0;
+	    hdr.count++;
+	}
+
+	munmap(m,size);
+    }
+
+    if ( (pwrite(fd,&hdr,sizeof(hdr),0)!=(ssize_t)sizeof(hdr)) ||
+	 (rename(tmp.c_str(),path.c_str())!=0) )
+    {
+	unlink(tmp.c_str());
+	return false;
+    }
+
+    return true;
+}
+
+/**
+ * Replaces the file with one of double the capacity. Call with the file lock
+ * held.
+ */
+bool namefile::grow_bare()
+{
+    const header* hdr = static_cast<const header*>(_map);
+    if (!create_bare(_path,hdr->capacity*2))
+	return false;
+
+    return map_bare();
+}
+
+/**
+ * Determines whether the file at _path has been replaced since it was mapped.
+ */
+bool namefile::stale_bare() const
+{
+    struct stat mapped, current;
+    if ( (fstat(_fd,&mapped)!=0) || (stat(_path.c_str(),&current)!=0) )
+	return false;
+
+    return (mapped.st_ino!=current.st_ino) || (mapped.st_dev!=current.st_dev);
+}
+
+namefile::record* namefile::find_bare(const char* ticker, uint32_t h) const
+{
+    header* hdr = static_cast<header*>(_map);
+    record* records = reinterpret_cast<record*>(hdr+1);
+    const uint32_t mask = hdr->capacity-1;
+
+    for ( uint32_t i = h & mask; ; i = (i+1) & mask )
+    {
+	const uint32_t rh = __atomic_load_n(&records[i].hash,__ATOMIC_ACQUIRE);
+	if (!rh)
+	    return nullptr;
+	if ( (rh==h) && (strncmp(records[i].ticker,ticker,sizeof(records[i].ticker))==0) )
+	    return &records[i];
+    }
+}
+
+/**
+ * FNV-1a, never zero
+ */
+uint32_t namefile::hash(const char* ticker)
+{
+    uint32_t h = 2166136261u;
+    for ( ; *ticker; ticker++ )
+    {
+	h ^= (unsigned char)(*ticker);
+	h *= 16777619u;
+    }
+    return h ? h : 1;
+}
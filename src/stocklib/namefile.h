@@ -0,0 +1,96 @@
+/**
+ * @file
+ * Public header for the namefile class, a persistent memory-mapped cache of
+ * security names.
+ */
+
+/*
+The MIT License (MIT)
+
+Copyright (c) 2015 David Bradshaw
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#ifndef NAMEFILE_H
+#define NAMEFILE_H
+
+#include <string>
+#include <cstdint>
+#include <cstddef>
+
+/**
+ * A persistent ticker->name cache, stored as a memory-mapped hash table.
+ *
+ * The file is used in place: opening it costs an mmap() and a header check,
+ * with no parsing. Records have a fixed size, so tickers longer than
+ * max_ticker or names longer than max_name are not stored.
+ *
+ * Several processes may share one file. Writers serialise on an advisory file
+ * lock, and every record is published or updated so that a concurrent reader
+ * never sees a partial record. When the table fills, a larger copy is written
+ * to a temporary file and renamed over the original.
+ *
+ * A file whose header does not match the current format version is discarded
+ * and recreated.
+ *
+ * @note Within a process, calls must be serialised by the caller.
+ */
+class namefile
+{
+public:
+
+    namefile();
+    namefile( const namefile& ) = delete;
+    namefile& operator=( const namefile& ) = delete;
+    virtual ~namefile();
+
+    bool open(const std::string& path);
+    void close();
+    bool is_open() const;
+
+    bool lookup(const char* ticker, char* name, std::size_t size);
+    bool insert(const char* ticker, const char* name);
+    std::size_t count() const;
+
+    static const uint32_t version;	///< Current file format version
+    static const std::size_t max_ticker; ///< Longest ticker that can be stored
+    static const std::size_t max_name;	///< Longest name that can be stored
+
+protected:
+
+    struct header;
+    struct record;
+
+    bool map_bare();
+    bool create_bare(const std::string& path, uint32_t capacity);
+    bool grow_bare();
+    bool stale_bare() const;
+    record* find_bare(const char* ticker, uint32_t hash) const;
+    static uint32_t hash(const char* ticker);
+
+private:
+
+    std::string _path;
+    int _fd{-1};
+    void* _map{nullptr};
+    std::size_t _map_size{0};
+};
+
+#endif
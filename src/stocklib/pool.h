@@ -0,0 +1,155 @@
+/**
+ * @file
+ * A free list of reusable objects. Objects released to the pool are recycled
+ * and handed back out by acquire(), instead of being deleted and
+ * re-allocated.
+ */
+
+/*
+The MIT License (MIT)
+
+Copyright (c) 2015 David Bradshaw
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#ifndef POOL_H
+#define POOL_H
+
+#include <vector>
+#include <functional>
+#include <cstddef>
+
+/** @class pool
+ * A class which keeps a free list of idle objects for re-use.
+ *
+ * Objects are created by the caller with new, and handed to the pool with
+ * release() once they are no longer needed. The pool runs the recycle action
+ * on each released object, then keeps it on its free list. A later call to
+ * acquire() hands the object back out, avoiding a fresh allocation and
+ * construction. The pool owns every object on its free list, and deletes them
+ * when it is drained or destroyed.
+ *
+ * At most max_idle objects are kept; any object released to a full pool is
+ * recycled, then deleted. Recycling it first lets the recycle action wait
+ * until nothing else is still using the object.
+ *
+ * @note This class is not thread-safe. Callers must provide their own locking.
+ */
+template<class T>
+class pool
+{
+public:
+
+    /**
+     * The type of the recycle function, which returns a released object to a
+     * re-usable state.
+     */
+    typedef void (recycle_func)(T&);
+
+    /** @name Lifecycle Management */
+    //@{
+
+    /**
+     * Constructor
+     *
+     * @param recycle The action performed upon each object when it is
+     * released to the pool
+     * @param max_idle The maximum number of idle objects retained
+     */
+    pool(std::function<recycle_func> recycle, std::size_t max_idle=64)
+	: _recycle(recycle), _max_idle(max_idle)
+    {
+	_free.reserve(max_idle);
+    }
+
+    pool( const pool& ) = delete;
+    pool& operator=( const pool& ) = delete;
+
+    /**
+     * Deletes all idle objects
+     */
+    virtual ~pool()
+    {
+	drain();
+    }
+    //@}
+
+    /** @name Public API */
+    ///@{
+
+    /**
+     * Takes an idle object from the free list.
+     *
+     * @return A recycled object, or nullptr if the pool is empty. Ownership
+     * passes to the caller.
+     */
+    T* acquire()
+    {
+	if (_free.empty())
+	    return nullptr;
+
+	T* element = _free.back();
+	_free.pop_back();
+	return element;
+    }
+
+    /**
+     * Recycles an object and places it on the free list. Ownership passes to
+     * the pool. If the pool is full, the recycled object is deleted instead.
+     *
+     * @param element The object to release. It must have been allocated with
+     * new.
+     */
+    void release(T* element)
+    {
+	_recycle(*element);
+	if (_free.size() < _max_idle)
+	    _free.push_back(element);
+	else
+	    delete element;
+    }
+
+    /**
+     * Deletes all idle objects
+     */
+    void drain()
+    {
+	for ( T* el : _free )
+	    delete el;
+	_free.clear();
+    }
+
+    /**
+     * @return The number of idle objects currently held
+     */
+    std::size_t idle() const
+    {
+	return _free.size();
+    }
+
+    ///@}
+
+protected:
+    std::function<recycle_func> _recycle; ///< Stores the recycle action
+    const std::size_t _max_idle;	  ///< Maximum number of idle objects
+    std::vector<T*> _free;		  ///< The free list
+};
+
+#endif
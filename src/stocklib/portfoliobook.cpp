@@ -0,0 +1,481 @@
+/**
+ * @file
+ * Implementation of the portfoliobook class.
+ */
+
+/*
+The MIT License (MIT)
+
+Copyright (c) 2015 David Bradshaw
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include <fstream>
+#include <sstream>
+#include <utility>
+#include <cstdlib>
+#include <cmath>
+
+#include "portfoliobook.h"
+#include "epoch.h"
+#include <stocklib/stocklib.h>
+
+namespace
+{
+    /**
+     * Parses a decimal amount (e.g. "99.99") into fixed-point units of
+     * 1/SL_PRICE_SCALE, rounding any digits beyond the scale
+     *
+     * @return false if the text is not a number
+     */
+    bool parse_amount(const std::string& text, int64_t& amount)
+    {
+	char* end = nullptr;
+	const double d = strtod(text.c_str(),&end);
+	if ( text.empty() || (*end!='\0') || !(std::fabs(d)<1e12) )
+	    return false;
+	amount = static_cast<int64_t>( (d<0) ? d*SL_PRICE_SCALE-0.5 : d*SL_PRICE_SCALE+0.5 );
+	return true;
+    }
+
+    /**
+     * Parses a whole number of units
+     *
+     * @return false if the text is not an integer
+     */
+    bool parse_quantity(const std::string& text, int64_t& quantity)
+    {
+	char* end = nullptr;
+	quantity = strtoll(text.c_str(),&end,10);
+	return !text.empty() && (*end=='\0');
+    }
+
+    template<class T> T load_relaxed(const T& field)
+    {
+	return __atomic_load_n(&field,__ATOMIC_RELAXED);
+    }
+
+    template<class T> void store_relaxed(T& field, T value)
+    {
+	__atomic_store_n(&field,value,__ATOMIC_RELAXED);
+    }
+}
+
+/**
+ * Constructor
+ */
+portfoliobook::portfoliobook() :
+    _layout(new layout)
+{
+}
+
+/**
+ * Destructor. There must be no queries or updates in progress.
+ */
+portfoliobook::~portfoliobook()
+{
+    for ( const retired& r : _retired )
+	delete r.l;
+    delete _layout.load();
+}
+
+/**
+ * Adds positions to the portfolios, creating any portfolios not yet in the
+ * book. A position in a symbol the portfolio already holds is added to the
+ * existing one. Positions in symbols already quoted are valued at once.
+ *
+ * @param entries the positions to add
+ */
+void portfoliobook::hold(const std::vector<entry>& entries)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+
+    layout* l = new layout(*_layout.load(std::memory_order_relaxed));
+
+    std::map<std::pair<id_t,symbol_t>,uint32_t> where;
+    for ( id_t b=0; b<l->books.size(); b++ )
+	for ( uint32_t p=0; p<l->books[b].positions.size(); p++ )
+	    where[std::make_pair(b,l->books[b].positions[p].symbol)] = p;
+
+    for ( const entry& e : entries )
+    {
+	const auto name = l->names.insert(std::make_pair(e.portfolio,l->books.size()));
+	if (name.second)
+	{
+	    l->books.push_back(book());
+	    l->books.back().name = e.portfolio;
+	}
+	const id_t id = name.first->second;
+	book& b = l->books[id];
+
+	const auto pos = where.insert(std::make_pair(std::make_pair(id,e.symbol),b.positions.size()));
+	if (pos.second)
+	{
+	    b.positions.push_back(position{e.symbol,e.quantity,e.cost,0,0});
+	    if (e.symbol>=l->holders.size())
+		l->holders.resize(e.symbol+1);
+	    l->holders[e.symbol].push_back(slot{id,pos.first->second});
+	    continue;
+	}
+
+	/* The book is not yet published, so needs no sequence lock */
+	position& p = b.positions[pos.first->second];
+	p.quantity += e.quantity;
+	p.cost += e.cost;
+	if (p.priced)
+	{
+	    b.value += e.quantity*p.price;
+	    b.cost += e.cost;
+	}
+    }
+
+    /* A new position in a symbol already quoted takes its price from any
+       other position in it */
+    for ( std::vector<slot>& holders : l->holders )
+    {
+	const slot* quoted = nullptr;
+	for ( const slot& s : holders )
+	    if (l->books[s.book].positions[s.position].priced)
+		quoted = &s;
+	if (!quoted)
+	    continue;
+
+	const int64_t price = l->books[quoted->book].positions[quoted->position].price;
+	for ( const slot& s : holders )
+	{
+	    book& b = l->books[s.book];
+	    position& p = b.positions[s.position];
+	    if (p.priced)
+		continue;
+	    p.price = price;
+	    p.priced = 1;
+	    b.value += p.quantity*price;
+	    b.cost += p.cost;
+	    b.priced++;
+	}
+    }
+
+    publish_bare(l);
+}
+
+/**
+ * Adds the positions listed in a text file. Each line holds a portfolio
+ * name, a ticker and a quantity, separated by white space, and optionally
+ * the cost of each unit, as a decimal:
+ *
+ *     # portfolio  ticker  quantity  cost
+ *     growth       AAPL    100       125.50
+ *     income       T       -200
+ *
+ * Text following a '#' is ignored. A position without a cost is taken to have
+ * cost nothing. Nothing is added unless the whole file is valid.
+ *
+ * @param path the file
+ * @param intern gives the symbol of each ticker
+ * @param bad_line if given, receives the number of the first line which
+ *        could not be parsed, or 0 if the file could not be read
+ * @return false if the file could not be read or parsed
+ */
+bool portfoliobook::load(const std::string& path, const intern_fn& intern, unsigned* bad_line)
+{
+    if (bad_line)
+	*bad_line = 0;
+
+    std::ifstream in(path);
+    if (!in)
+	return false;
+
+    std::vector<entry> entries;
+    std::string line;
+    for ( unsigned number=1; std::getline(in,line); number++ )
+    {
+	line = line.substr(0,line.find('#'));
+
+	std::istringstream fields(line);
+	std::string portfolio, ticker, quantity, cost, extra;
+	if ( !(fields >> portfolio) )
+	    continue;
+	fields >> ticker >> quantity >> cost >> extra;
+
+	entry e;
+	int64_t unit_cost = 0;
+	if ( ticker.empty() || !parse_quantity(quantity,e.quantity) || !extra.empty() ||
+	     ( !cost.empty() && !parse_amount(cost,unit_cost) ) )
+	{
+	    if (bad_line)
+		*bad_line = number;
+	    return false;
+	}
+
+	e.portfolio = portfolio;
+	e.symbol = intern(ticker.c_str());
+	e.cost = e.quantity*unit_cost;
+	entries.push_back(e);
+    }
+
+    if (in.bad())
+	return false;
+
+    hold(entries);
+    return true;
+}
+
+/**
+ * Removes every portfolio
+ */
+void portfoliobook::clear()
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    publish_bare(new layout);
+}
+
+/**
+ * Revalues every position in a symbol at a new price, adjusting the
+ * aggregates of each portfolio holding it by the change in the position's
+ * value. Returns at once, without taking the lock, if no portfolio holds the
+ * symbol.
+ *
+ * @param symbol the symbol quoted
+ * @param price its price
+ * @return false if no portfolio holds the symbol
+ */
+bool portfoliobook::update(symbol_t symbol, int64_t price)
+{
+    {
+	epoch::guard g;
+	const layout* l = _layout.load(std::memory_order_acquire);
+	if ( (symbol>=l->holders.size()) || l->holders[symbol].empty() )
+	    return false;
+    }
+
+    std::lock_guard<std::mutex> lock(_mutex);
+    layout* l = _layout.load(std::memory_order_relaxed);
+    if ( (symbol>=l->holders.size()) || l->holders[symbol].empty() )
+	return false;
+
+    for ( const slot& s : l->holders[symbol] )
+    {
+	book& b = l->books[s.book];
+	position& p = b.positions[s.position];
+
+	begin_write(b);
+	if (p.priced)
+	{
+	    store_relaxed(b.value, b.value + p.quantity*(price-p.price));
+	}
+	else
+	{
+	    store_relaxed(b.value, b.value + p.quantity*price);
+	    store_relaxed(b.cost, b.cost + p.cost);
+	    store_relaxed(b.priced, b.priced+1);
+	    store_relaxed(p.priced, 1u);
+	}
+	store_relaxed(p.price, price);
+	end_write(b);
+    }
+
+    _updates++;
+    return true;
+}
+
+/**
+ * Finds a portfolio by name. A portfolio keeps its id until the book is
+ * cleared.
+ *
+ * @return false if there is no such portfolio
+ */
+bool portfoliobook::find(const std::string& name, id_t& id) const
+{
+    epoch::guard g;
+    const layout* l = _layout.load(std::memory_order_acquire);
+    const auto i = l->names.find(name);
+    if (i==l->names.end())
+	return false;
+    id = i->second;
+    return true;
+}
+
+/**
+ * @return The number of portfolios. Their ids run from 0.
+ */
+std::size_t portfoliobook::portfolios() const
+{
+    epoch::guard g;
+    return _layout.load(std::memory_order_acquire)->books.size();
+}
+
+/**
+ * @return Every symbol held by some portfolio, in order
+ */
+std::vector<portfoliobook::symbol_t> portfoliobook::symbols() const
+{
+    epoch::guard g;
+    const layout* l = _layout.load(std::memory_order_acquire);
+    std::vector<symbol_t> held;
+    for ( symbol_t s=0; s<l->holders.size(); s++ )
+	if (!l->holders[s].empty())
+	    held.push_back(s);
+    return held;
+}
+
+/**
+ * Reads a portfolio's aggregates, as they stood after some update. Takes no
+ * lock.
+ *
+ * @return false if there is no such portfolio
+ */
+bool portfoliobook::value(id_t portfolio, totals& t) const
+{
+    epoch::guard g;
+    const layout* l = _layout.load(std::memory_order_acquire);
+    if (portfolio>=l->books.size())
+	return false;
+
+    const book& b = l->books[portfolio];
+    read(b, [&]()
+	 {
+	     t.value = load_relaxed(b.value);
+	     t.cost = load_relaxed(b.cost);
+	     t.priced = load_relaxed(b.priced);
+	 } );
+    t.pnl = t.value - t.cost;
+    t.positions = b.positions.size();
+    return true;
+}
+
+/**
+ * Reads a portfolio's positions and aggregates, all as they stood after the
+ * same update, and weighs each position by its share of the portfolio's
+ * value. Takes no lock.
+ *
+ * @param portfolio the portfolio
+ * @param out receives the positions, in the order they were added
+ * @param t if given, receives the aggregates
+ * @return false if there is no such portfolio
+ */
+bool portfoliobook::holdings(id_t portfolio, std::vector<holding>& out, totals* t) const
+{
+    epoch::guard g;
+    const layout* l = _layout.load(std::memory_order_acquire);
+    if (portfolio>=l->books.size())
+	return false;
+
+    const book& b = l->books[portfolio];
+    totals sum;
+    out.resize(b.positions.size());
+    read(b, [&]()
+	 {
+	     sum.value = load_relaxed(b.value);
+	     sum.cost = load_relaxed(b.cost);
+	     sum.priced = load_relaxed(b.priced);
+	     for ( std::size_t i=0; i<out.size(); i++ )
+	     {
+		 out[i].price = load_relaxed(b.positions[i].price);
+		 out[i].priced = load_relaxed(b.positions[i].priced);
+	     }
+	 } );
+    sum.pnl = sum.value - sum.cost;
+    sum.positions = b.positions.size();
+
+    for ( std::size_t i=0; i<out.size(); i++ )
+    {
+	holding& h = out[i];
+	h.symbol = b.positions[i].symbol;
+	h.quantity = b.positions[i].quantity;
+	h.cost = b.positions[i].cost;
+	if (!h.priced)
+	    h.price = 0;
+	h.value = h.quantity*h.price;
+	h.weight = sum.value ? static_cast<double>(h.value)/sum.value : 0.0;
+    }
+
+    if (t)
+	*t = sum;
+    return true;
+}
+
+/**
+ * @return The number of quotes which revalued some position
+ */
+uint64_t portfoliobook::updates() const
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _updates;
+}
+
+/**
+ * Marks a book's aggregates as changing. Stores which follow cannot be seen
+ * before the odd sequence number.
+ */
+void portfoliobook::begin_write(book& b)
+{
+    store_relaxed(b.seq, b.seq+1);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+}
+
+/**
+ * Marks a book's aggregates as consistent again
+ */
+void portfoliobook::end_write(book& b)
+{
+    __atomic_store_n(&b.seq, b.seq+1, __ATOMIC_RELEASE);
+}
+
+/**
+ * Calls f, which reads the fields of a book written under its sequence lock,
+ * until it has read them with no update in progress
+ */
+template<class F> void portfoliobook::read(const book& b, F f)
+{
+    for (;;)
+    {
+	const uint64_t seq = __atomic_load_n(&b.seq,__ATOMIC_ACQUIRE);
+	if (seq & 1)
+	    continue;
+	f();
+	__atomic_thread_fence(__ATOMIC_ACQUIRE);
+	if (load_relaxed(b.seq)==seq)
+	    return;
+    }
+}
+
+/**
+ * Replaces the layout, keeping the old one until no query can be reading it.
+ * Call with the lock held.
+ */
+void portfoliobook::publish_bare(layout* l)
+{
+    const layout* old = _layout.exchange(l,std::memory_order_acq_rel);
+    _retired.push_back({old,epoch::retire_tag()});
+    reclaim_bare();
+}
+
+/**
+ * Frees old layouts no query can still be reading. Call with the lock held.
+ */
+void portfoliobook::reclaim_bare()
+{
+    const uint64_t oldest = epoch::oldest();
+    while ( !_retired.empty() && (_retired.front().tag<oldest) )
+    {
+	delete _retired.front().l;
+	_retired.pop_front();
+    }
+}
@@ -0,0 +1,190 @@
+/**
+ * @file
+ * Public header for the portfoliobook class, which values portfolios
+ * incrementally as quotes arrive.
+ */
+
+/*
+The MIT License (MIT)
+
+Copyright (c) 2015 David Bradshaw
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#ifndef PORTFOLIOBOOK_H
+#define PORTFOLIOBOOK_H
+
+#include <string>
+#include <vector>
+#include <map>
+#include <deque>
+#include <mutex>
+#include <atomic>
+#include <functional>
+#include <cstdint>
+
+/**
+ * Values a set of portfolios which may hold the same symbols, keeping each
+ * portfolio's market value, cost and profit and loss up to date as quotes
+ * arrive.
+ *
+ * A quote changes the aggregates of each portfolio holding the symbol by the
+ * change in value of that one position, so an update costs O(1) per holder,
+ * however many positions the portfolios have. Only positions which have been
+ * priced count towards the aggregates.
+ *
+ * Queries take no lock, so never hold up updates. Each portfolio carries a
+ * sequence lock, which a query checks to be sure that what it read was not
+ * changed part way, retrying if it was.
+ *
+ * Holdings may be added at any time. Adding them builds a new copy of the
+ * book's layout, carrying over the prices so far, which is published for
+ * later updates and queries, while queries under way finish with the old one
+ * (see epoch). Adding holdings therefore costs O(n); load() adds a whole file
+ * at once.
+ *
+ * Prices are in units of 1/SL_PRICE_SCALE, quantities in whole units, and
+ * values and costs in units of 1/SL_PRICE_SCALE.
+ */
+class portfoliobook
+{
+public:
+
+    /** Identifies a portfolio */
+    typedef uint32_t id_t;
+
+    /** Identifies a symbol, as sl_symbol_t */
+    typedef uint32_t symbol_t;
+
+    /** Gives a ticker's symbol (see stocklib_symbol_id()) */
+    typedef std::function<symbol_t(const char*)> intern_fn;
+
+    /** A position to add to a portfolio */
+    struct entry
+    {
+	std::string portfolio;
+	symbol_t symbol;
+	int64_t quantity;		///< Negative for a short position
+	int64_t cost;			///< What the position cost in all
+    };
+
+    /** A portfolio's aggregates */
+    struct totals
+    {
+	int64_t value{0};		///< Market value of the priced positions
+	int64_t cost{0};		///< Cost of the priced positions
+	int64_t pnl{0};			///< value - cost
+	uint32_t positions{0};
+	uint32_t priced{0};		///< Positions with a price
+    };
+
+    /** A position, as valued by a query */
+    struct holding
+    {
+	symbol_t symbol;
+	int64_t quantity;
+	int64_t cost;
+	int64_t price;			///< The last price, if priced
+	int64_t value;			///< quantity*price, or 0 if not priced
+	double weight;			///< value as a fraction of the portfolio's
+	bool priced;
+    };
+
+    /** @name Lifecycle Management */
+    //@{
+    portfoliobook();
+    portfoliobook( const portfoliobook& ) = delete;
+    portfoliobook& operator=( const portfoliobook& ) = delete;
+    virtual ~portfoliobook();
+    //@}
+
+    /** @name Public API */
+    ///@{
+    void hold(const std::vector<entry>& entries);
+    bool load(const std::string& path, const intern_fn& intern, unsigned* bad_line=nullptr);
+    void clear();
+    bool update(symbol_t symbol, int64_t price);
+
+    bool find(const std::string& name, id_t& id) const;
+    std::size_t portfolios() const;
+    std::vector<symbol_t> symbols() const;
+    bool value(id_t portfolio, totals& t) const;
+    bool holdings(id_t portfolio, std::vector<holding>& out, totals* t=nullptr) const;
+    uint64_t updates() const;
+    ///@}
+
+protected:
+
+    struct position
+    {
+	symbol_t symbol;
+	int64_t quantity;
+	int64_t cost;
+	int64_t price;			///< Written under the book's sequence lock
+	uint32_t priced;		///< Written under the book's sequence lock
+    };
+
+    /** One portfolio. The fields below seq are written under it. */
+    struct book
+    {
+	std::string name;
+	std::vector<position> positions;
+	uint64_t seq{0};		///< Odd while an update is in progress
+	int64_t value{0};
+	int64_t cost{0};
+	uint32_t priced{0};
+    };
+
+    /** A position holding a symbol */
+    struct slot
+    {
+	id_t book;
+	uint32_t position;
+    };
+
+    /** Everything but the prices, rebuilt whenever holdings are added */
+    struct layout
+    {
+	std::vector<book> books;
+	std::map<std::string,id_t> names;
+	std::vector<std::vector<slot>> holders;	///< By symbol
+    };
+
+    struct retired
+    {
+	const layout* l;
+	uint64_t tag;
+    };
+
+    static void begin_write(book& b);
+    static void end_write(book& b);
+    template<class F> static void read(const book& b, F f);
+    void publish_bare(layout* l);
+    void reclaim_bare();
+
+private:
+
+    std::atomic<layout*> _layout;
+    std::deque<retired> _retired;
+    uint64_t _updates{0};
+    mutable std::mutex _mutex;		///< Serializes updates and layout changes
+};
+
+#endif
@@ -32,6 +32,12 @@ SOFTWARE.
 #include <functional>
 #include <exception>
 #include <stdexcept>
+#include <system_error>
+#include <string>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <algorithm>
 
 /**
  * Template class representing a computational problem to be solved. 
@@ -201,4 +207,152 @@ protected:
     virtual To do_work(Ti i)=0;
 };
 
+/**
+ * The outcome of applying a map_problem's method to one element of its
+ * input. Either ok is set and value holds the output, or error describes what
+ * went wrong.
+ *
+ * @param To The type of the output from the method
+ */
+template<class To>
+struct element_result
+{
+    bool ok{false};		///< Whether the method returned normally
+    To value{};			///< The output of the method, if ok
+    std::string error;		///< The exception message, if not ok
+};
+
+/**
+ * A problem which applies a method to every element of a vector of inputs,
+ * spreading the work across the available cores.
+ *
+ * The inputs are divided into chunks, which worker threads claim one at a
+ * time until none remain, so uneven per-element costs still balance out. The
+ * outputs are returned in input order. An exception thrown for one element is
+ * recorded in that element's result, and does not stop the rest of the batch.
+ *
+ * A map_problem is a problem like any other, so it can be run by a task:
+ *
+ *     task<std::vector<Ti>,std::vector<element_result<To>>> t(new map_problem<Ti,To>(f,inputs));
+ *
+ * @note The method is called concurrently from several threads, so it must
+ * be safe to do so.
+ *
+ * @param Ti The type of each input element
+ * @param To The type of each output element
+ */
+template<class Ti,class To>
+class map_problem : public contained_problem<std::vector<Ti>,std::vector<element_result<To>>>
+{
+public:
+
+    typedef std::vector<Ti> input_t;
+    typedef std::vector<element_result<To>> output_t;
+
+    /**
+     * Represents the type of the per-element method
+     */
+    typedef To element_fn_t(const Ti&);
+
+    /**
+     * Constructor
+     *
+     * @param f The method to apply to each element
+     * @param inputs The input elements
+     * @param threads The maximum number of threads to use, including the
+     * calling thread. Zero means one per core.
+     * @param chunk The number of elements claimed by a thread at a time. Zero
+     * chooses a size giving each thread several chunks.
+     */
+    map_problem(const std::function<element_fn_t> f, const input_t& inputs,
+		unsigned threads=0, std::size_t chunk=0)
+	: contained_problem<input_t,output_t>(inputs), _fn(f),
+	  _threads(threads), _chunk(chunk)
+    {
+    }
+
+    map_problem( map_problem&& o)=delete;
+    map_problem( const map_problem& o)=delete;
+    map_problem& operator=( const map_problem& )=delete;
+    map_problem& operator=( const map_problem&& )=delete;
+
+    virtual ~map_problem()
+    {
+    }
+
+protected:
+
+    virtual output_t do_work(input_t inputs)
+    {
+	const std::size_t n = inputs.size();
+	output_t results(n);
+
+	if (!n)
+	    return results;
+
+	unsigned threads = _threads ? _threads : std::thread::hardware_concurrency();
+	threads = std::max(1u,threads);
+
+	const std::size_t chunk = _chunk ? _chunk : std::max<std::size_t>(1,n/(threads*4));
+	threads = std::min<std::size_t>(threads,(n+chunk-1)/chunk);
+
+	std::atomic<std::size_t> next{0};
+	auto worker = [&]()
+	{
+	    std::size_t start;
+	    while ( (start = next.fetch_add(chunk)) < n )
+	    {
+		const std::size_t end = std::min(start+chunk,n);
+		for ( std::size_t i=start; i<end; i++ )
+		    solve_element(inputs[i],results[i]);
+	    }
+	};
+
+	// The calling thread works too, alongside threads-1 helpers
+	std::vector<std::thread> helpers;
+	for ( unsigned t=1; t<threads; t++ )
+	{
+	    try
+	    {
+		helpers.push_back( std::thread(worker) );
+	    }
+	    catch ( const std::system_error& )
+	    {
+		break;
+	    }
+	}
+
+	worker();
+
+	for ( auto& h : helpers )
+	    h.join();
+
+	return results;
+    }
+
+    /**
+     * Applies the method to a single element, capturing any exception
+     */
+    void solve_element(const Ti& input, element_result<To>& result) const
+    {
+	try
+	{
+	    result.value = _fn(input);
+	    result.ok = true;
+	}
+	catch( const std::exception& e )
+	{
+	    result.error = e.what();
+	}
+	catch( ... )
+	{
+	    result.error = "An unknown error occurred while solving a problem";
+	}
+    }
+
+    const std::function<element_fn_t> _fn;
+    const unsigned _threads;
+    const std::size_t _chunk;
+};
+
 #endif
@@ -0,0 +1,280 @@
+/**
+ * @file
+ * Implementation of the queryprotocol class.
+ */
+
+/*
+The MIT License (MIT)
+
+Copyright (c) 2015 David Bradshaw
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include <utility>
+#include <stdexcept>
+#include <cstring>
+#include <cerrno>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+
+#include "queryprotocol.h"
+
+namespace
+{
+    void put(std::string& out, uint64_t value, unsigned bytes)
+    {
+	for ( unsigned i=0; i<bytes; i++, value>>=8 )
+	    out += static_cast<char>(value & 0xff);
+    }
+
+    /**
+     * Reads little-endian fields from a body, failing once it runs out
+     */
+    struct reader
+    {
+	const std::string& body;
+	std::size_t pos{0};
+	bool good{true};
+
+	reader(const std::string& b) : body(b) {}
+
+	uint64_t get(unsigned bytes)
+	{
+	    if (body.size()-pos < bytes)
+	    {
+		good = false;
+		return 0;
+	    }
+	    uint64_t value = 0;
+	    for ( unsigned i=0; i<bytes; i++ )
+		value |= static_cast<uint64_t>(static_cast<uint8_t>(body[pos+i])) << (8*i);
+	    pos += bytes;
+	    return value;
+	}
+
+	std::string get_string(std::size_t length)
+	{
+	    if (body.size()-pos < length)
+	    {
+		good = false;
+		return std::string();
+	    }
+	    pos += length;
+	    return body.substr(pos-length,length);
+	}
+
+	/** @return true if every field was read, and nothing is left over */
+	bool done() const
+	{
+	    return good && (pos==body.size());
+	}
+    };
+
+    /**
+     * Starts a frame, leaving room for its length
+     */
+    void begin_frame(std::string& frame)
+    {
+	frame.assign(4,'\0');
+    }
+
+    void end_frame(std::string& frame)
+    {
+	std::string length;
+	put(length,frame.size()-4,4);
+	frame.replace(0,4,length);
+    }
+
+    /**
+     * Reads exactly length bytes, unless the peer closes the connection
+     */
+    bool read_all(int fd, char* data, std::size_t length)
+    {
+	while (length)
+	{
+	    const ssize_t n = read(fd,data,length);
+	    if (n>0)
+	    {
+		data += n;
+		length -= n;
+	    }
+	    else if ( (n==0) || (errno!=EINTR) )
+		return false;
+	}
+	return true;
+    }
+}
+
+/**
+ * Encodes a request as a frame. The request must hold at most max_tickers
+ * tickers, none longer than max_ticker characters; callers are expected to
+ * check, so that every ticker asked for is answered.
+ */
+void queryprotocol::encode(const request& r, std::string& frame)
+{
+    if (r.tickers.size()>max_tickers)
+	throw std::logic_error("Too many tickers in one request");
+    for ( const std::string& t : r.tickers )
+	if (t.size()>max_ticker)
+	    throw std::logic_error("Ticker too long to encode");
+
+    begin_frame(frame);
+    put(frame,r.op,1);
+    put(frame,r.argument,4);
+    put(frame,r.tickers.size(),2);
+    for ( const std::string& t : r.tickers )
+    {
+	put(frame,t.size(),1);
+	frame += t;
+    }
+    end_frame(frame);
+}
+
+/**
+ * Encodes a response as a frame. Names are truncated to 65535 characters.
+ */
+void queryprotocol::encode(const response& r, std::string& frame)
+{
+    begin_frame(frame);
+    put(frame,r.code,1);
+    const std::size_t count = (r.quotes.size()<UINT16_MAX) ? r.quotes.size() : UINT16_MAX;
+    put(frame,count,2);
+    for ( std::size_t i=0; i<count; i++ )
+    {
+	const quote_record& q = r.quotes[i];
+	const std::size_t ticker = (q.ticker.size()<UINT8_MAX) ? q.ticker.size() : UINT8_MAX;
+	const std::size_t name = (q.name.size()<UINT16_MAX) ? q.name.size() : UINT16_MAX;
+	put(frame,q.flags,1);
+	put(frame,q.price,8);
+	put(frame,q.timestamp,8);
+	put(frame,ticker,1);
+	put(frame,name,2);
+	frame.append(q.ticker,0,ticker);
+	frame.append(q.name,0,name);
+    }
+    end_frame(frame);
+}
+
+/**
+ * Decodes the body of a request frame
+ *
+ * @return false if the body is malformed
+ */
+bool queryprotocol::decode(const std::string& body, request& r)
+{
+    reader in(body);
+    r.op = in.get(1);
+    r.argument = in.get(4);
+    const std::size_t count = in.get(2);
+    r.tickers.clear();
+    for ( std::size_t i=0; (i<count) && in.good; i++ )
+	r.tickers.push_back( in.get_string(in.get(1)) );
+    return in.done() && (r.op>=ping) && (r.op<=subscribe);
+}
+
+/**
+ * Decodes the body of a response frame
+ *
+ * @return false if the body is malformed
+ */
+bool queryprotocol::decode(const std::string& body, response& r)
+{
+    reader in(body);
+    r.code = in.get(1);
+    const std::size_t count = in.get(2);
+    r.quotes.clear();
+    for ( std::size_t i=0; (i<count) && in.good; i++ )
+    {
+	quote_record q;
+	q.flags = in.get(1);
+	q.price = in.get(8);
+	q.timestamp = in.get(8);
+	const std::size_t ticker = in.get(1);
+	const std::size_t name = in.get(2);
+	q.ticker = in.get_string(ticker);
+	q.name = in.get_string(name);
+	r.quotes.push_back(std::move(q));
+    }
+    return in.done();
+}
+
+/**
+ * Reads one frame, blocking until it has all arrived
+ *
+ * @param fd a connected socket
+ * @param body receives the frame's body
+ * @return false if the connection closed or failed, or the frame is too
+ *         large to accept
+ */
+bool queryprotocol::read_frame(int fd, std::string& body)
+{
+    char header[4];
+    if (!read_all(fd,header,sizeof(header)))
+	return false;
+
+    std::size_t length = 0;
+    for ( int i=3; i>=0; i-- )
+	length = (length<<8) | static_cast<uint8_t>(header[i]);
+    if (length>max_frame)
+	return false;
+
+    body.resize(length);
+    return read_all(fd,&body[0],length);
+}
+
+/**
+ * Writes a whole encoded frame. A peer which has gone away causes a failure,
+ * not a SIGPIPE.
+ *
+ * @return false if the connection failed
+ */
+bool queryprotocol::write_frame(int fd, const std::string& frame)
+{
+    const char* data = frame.data();
+    std::size_t length = frame.size();
+    while (length)
+    {
+	const ssize_t n = send(fd,data,length,MSG_NOSIGNAL);
+	if (n>0)
+	{
+	    data += n;
+	    length -= n;
+	}
+	else if ( (n==0) || (errno!=EINTR) )
+	    return false;
+    }
+    return true;
+}
+
+/**
+ * @return The socket the daemon listens on: $STOCKD_SOCKET if set, otherwise
+ * stockd.sock in $XDG_RUNTIME_DIR, or in /tmp with the user id in its name
+ */
+std::string queryprotocol::default_socket_path()
+{
+    const char* env = getenv("STOCKD_SOCKET");
+    if ( env && *env )
+	return env;
+    if ( (env = getenv("XDG_RUNTIME_DIR")) && *env )
+	return std::string(env) + "/stockd.sock";
+    return "/tmp/stockd-" + std::to_string(getuid()) + ".sock";
+}
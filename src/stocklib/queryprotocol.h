@@ -0,0 +1,126 @@
+/**
+ * @file
+ * Public header for the queryprotocol class, which frames the requests and
+ * responses passed between the stock daemon and its clients.
+ */
+
+/*
+The MIT License (MIT)
+
+Copyright (c) 2015 David Bradshaw
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#ifndef QUERYPROTOCOL_H
+#define QUERYPROTOCOL_H
+
+#include <vector>
+#include <string>
+#include <cstdint>
+#include <cstddef>
+
+/** @class queryprotocol
+ * The binary protocol spoken between the stock daemon and its clients over a
+ * Unix-domain socket. Each message is a frame: its body's length as a
+ * little-endian uint32, then the body. A client sends requests and reads one
+ * response to each, in order, and may keep the connection for as many
+ * requests as it likes.
+ *
+ * A request body is, little-endian:
+ *  - the opcode (uint8)
+ *  - an argument (uint32): for a quote, the oldest quote in milliseconds
+ *    which may be answered from the daemon's cache; for a subscription, the
+ *    refresh interval in milliseconds
+ *  - the number of tickers (uint16), then each ticker's length (uint8) and
+ *    characters
+ *
+ * A response body is:
+ *  - the status (uint8)
+ *  - the number of quotes (uint16), then for each: its sl_quote_flags_t
+ *    (uint8), price in units of 1/SL_PRICE_SCALE (int64), timestamp in
+ *    microseconds since the Unix epoch (int64), the lengths of its ticker
+ *    (uint8) and name (uint16), and their characters
+ *
+ * Quotes are answered in the order their tickers were asked for. Malformed
+ * frames are rejected by decode(), never trusted.
+ */
+class queryprotocol
+{
+public:
+
+    enum opcode
+    {
+	ping=1,			///< Answered at once, with no quotes
+	quote=2,		///< Quote each ticker
+	subscribe=3		///< Keep each ticker fresh in the daemon's cache
+    };
+
+    enum status
+    {
+	ok=0,
+	bad_request=1
+    };
+
+    /** The largest frame body either side will accept */
+    static const std::size_t max_frame = 1<<20;
+
+    /** The longest ticker a request can carry */
+    static const std::size_t max_ticker = 255;
+
+    /** The most tickers a request can carry */
+    static const std::size_t max_tickers = 65535;
+
+    struct request
+    {
+	uint8_t op{ping};
+	uint32_t argument{0};
+	std::vector<std::string> tickers;
+    };
+
+    struct quote_record
+    {
+	std::string ticker;
+	std::string name;		///< Empty if unknown
+	int64_t price{0};
+	int64_t timestamp{0};
+	uint8_t flags{0};
+    };
+
+    struct response
+    {
+	uint8_t code{ok};
+	std::vector<quote_record> quotes;
+    };
+
+    /** @name Public API */
+    ///@{
+    static void encode(const request& r, std::string& frame);
+    static void encode(const response& r, std::string& frame);
+    static bool decode(const std::string& body, request& r);
+    static bool decode(const std::string& body, response& r);
+
+    static bool read_frame(int fd, std::string& body);
+    static bool write_frame(int fd, const std::string& frame);
+
+    static std::string default_socket_path();
+    ///@}
+};
+
+#endif
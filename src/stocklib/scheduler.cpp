@@ -0,0 +1,222 @@
+/**
+ * @file
+ * Implementation of the scheduler class.
+ */
+
+/*
+The MIT License (MIT)
+
+Copyright (c) 2015 David Bradshaw
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include <algorithm>
+
+#include "scheduler.h"
+
+using std::chrono::duration_cast;
+using std::chrono::microseconds;
+using std::chrono::milliseconds;
+using std::chrono::seconds;
+
+/**
+ * Constructor. No threads are started until the first job is submitted.
+ *
+ * @param workers The number of worker threads
+ */
+scheduler::scheduler(unsigned workers) : _worker_count(std::max(1u,workers))
+{
+    _deadlines[(int)priority::interactive] = milliseconds(50);
+    _deadlines[(int)priority::normal] = seconds(1);
+    _deadlines[(int)priority::bulk] = seconds(30);
+}
+
+/**
+ * Destructor. Waits for every job to finish, including those which have not
+ * yet started. Jobs are not discarded, since whoever submitted one may be
+ * waiting for it: a fetch task, for example, has already begun by the time it
+ * is queued, and only finishes once its job has run.
+ */
+scheduler::~scheduler()
+{
+    {
+	std::lock_guard<std::mutex> lock(_mutex);
+	_stopping = true;
+    }
+    _cv.notify_all();
+
+    for ( auto& t : _workers )
+	t.join();
+}
+
+/**
+ * Queues a job, due after its class's relative deadline.
+ *
+ * @param job The job to run
+ * @param p The job's priority class
+ */
+void scheduler::submit(std::function<void()> job, priority p)
+{
+    clock::duration relative;
+    {
+	std::lock_guard<std::mutex> lock(_mutex);
+	relative = _deadlines[(int)p];
+    }
+    submit(job,p,clock::now()+relative);
+}
+
+/**
+ * Queues a job with an explicit deadline.
+ *
+ * @param job The job to run
+ * @param p The job's priority class, for statistics
+ * @param deadline The time by which the job should have started
+ */
+void scheduler::submit(std::function<void()> job, priority p, clock::time_point deadline)
+{
+    {
+	std::lock_guard<std::mutex> lock(_mutex);
+	start_bare();
+
+	_heap.push_back( { deadline, _sequence++, clock::now(), p, job } );
+	std::push_heap(_heap.begin(),_heap.end(),later);
+	_stats[(int)p].queued++;
+    }
+    _cv.notify_one();
+}
+
+/**
+ * Changes the relative deadline given to jobs of a class. Jobs already queued
+ * keep their deadlines.
+ */
+void scheduler::set_deadline(priority p, clock::duration relative)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    _deadlines[(int)p] = relative;
+}
+
+/**
+ * Raises the number of worker threads to at least the number given. Workers
+ * are never removed. If the workers are running, the new ones start at once.
+ */
+void scheduler::reserve(unsigned workers)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    if (workers<=_worker_count)
+	return;
+
+    _worker_count = workers;
+    if (!_workers.empty())
+	while (_workers.size()<_worker_count)
+	    _workers.push_back( std::thread( [this]() { this->run(); } ) );
+}
+
+/**
+ * @return The number of worker threads
+ */
+unsigned scheduler::workers() const
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _worker_count;
+}
+
+/**
+ * @return The queueing statistics for a priority class
+ */
+scheduler::stats_t scheduler::stats(priority p) const
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _stats[(int)p];
+}
+
+/**
+ * Clears the queueing statistics, apart from the count of waiting jobs
+ */
+void scheduler::reset_stats()
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    for ( stats_t& s : _stats )
+    {
+	const uint64_t queued = s.queued;
+	s = stats_t();
+	s.queued = queued;
+    }
+}
+
+/**
+ * @return The number of jobs waiting for a worker
+ */
+std::size_t scheduler::pending() const
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _heap.size();
+}
+
+/**
+ * Heap ordering: the entry due last sinks to the bottom
+ */
+bool scheduler::later(const entry& a, const entry& b)
+{
+    if (a.deadline != b.deadline)
+	return a.deadline > b.deadline;
+    return a.sequence > b.sequence;
+}
+
+/**
+ * Starts the workers, if they are not running. Call with the mutex held.
+ */
+void scheduler::start_bare()
+{
+    if (!_workers.empty())
+	return;
+
+    for ( unsigned i=0; i<_worker_count; i++ )
+	_workers.push_back( std::thread( [this]() { this->run(); } ) );
+}
+
+/**
+ * The body of each worker thread
+ */
+void scheduler::run()
+{
+    std::unique_lock<std::mutex> lock(_mutex);
+
+    for (;;)
+    {
+	_cv.wait( lock, [this]() { return _stopping || !_heap.empty(); } );
+	if (_heap.empty())
+	    return;
+
+	std::pop_heap(_heap.begin(),_heap.end(),later);
+	entry e = std::move(_heap.back());
+	_heap.pop_back();
+
+	stats_t& s = _stats[(int)e.cls];
+	const uint64_t delay = duration_cast<microseconds>(clock::now()-e.submitted).count();
+	s.queued--;
+	s.dispatched++;
+	s.total_delay_us += delay;
+	s.max_delay_us = std::max(s.max_delay_us,delay);
+
+	lock.unlock();
+	e.job();
+	lock.lock();
+    }
+}
@@ -0,0 +1,129 @@
+/**
+ * @file
+ * Public header for the scheduler class, which runs jobs on a fixed set of
+ * worker threads in earliest-deadline-first order.
+ */
+
+/*
+The MIT License (MIT)
+
+Copyright (c) 2015 David Bradshaw
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#ifndef SCHEDULER_H
+#define SCHEDULER_H
+
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <chrono>
+#include <cstdint>
+
+/**
+ * Runs submitted jobs on a fixed number of worker threads. Waiting jobs are
+ * dispatched earliest deadline first.
+ *
+ * Every job belongs to a priority class, and unless given an explicit
+ * deadline, is due a fixed interval after submission, the interval depending
+ * on its class. Interactive jobs have the shortest interval, so they
+ * overtake any backlog of normal or bulk jobs. A bulk job waits behind newer
+ * interactive work only until its own deadline has passed; so, unlike with
+ * strict priorities, no class can be starved indefinitely.
+ *
+ * The time each job spends queued is recorded per class.
+ */
+class scheduler
+{
+public:
+
+    typedef std::chrono::steady_clock clock;
+
+    /** Priority classes */
+    enum class priority
+    {
+	interactive=0,		///< A user is waiting on the result
+	normal=1,		///< Ordinary requests
+	bulk=2			///< Background work, such as refreshes
+    };
+
+    /** The number of priority classes */
+    static const unsigned classes = 3;
+
+    /** Queueing statistics for one priority class */
+    struct stats_t
+    {
+	uint64_t dispatched{0};		///< Jobs handed to a worker
+	uint64_t total_delay_us{0};	///< Sum of their queueing delays
+	uint64_t max_delay_us{0};	///< Longest queueing delay
+	uint64_t queued{0};		///< Jobs currently waiting
+    };
+
+    /** @name Lifecycle Management */
+    //@{
+    explicit scheduler(unsigned workers);
+    scheduler( const scheduler& ) = delete;
+    scheduler& operator=( const scheduler& ) = delete;
+    virtual ~scheduler();
+    //@}
+
+    /** @name Public API */
+    ///@{
+    void submit(std::function<void()> job, priority p);
+    void submit(std::function<void()> job, priority p, clock::time_point deadline);
+    void set_deadline(priority p, clock::duration relative);
+    void reserve(unsigned workers);
+    unsigned workers() const;
+    stats_t stats(priority p) const;
+    void reset_stats();
+    std::size_t pending() const;
+    ///@}
+
+protected:
+
+    struct entry
+    {
+	clock::time_point deadline;
+	uint64_t sequence;		///< Breaks ties in submission order
+	clock::time_point submitted;
+	priority cls;
+	std::function<void()> job;
+    };
+
+    static bool later(const entry& a, const entry& b);
+    void start_bare();
+    void run();
+
+private:
+
+    unsigned _worker_count;
+    std::vector<std::thread> _workers;
+    std::vector<entry> _heap;
+    clock::duration _deadlines[classes];
+    stats_t _stats[classes];
+    uint64_t _sequence{0};
+    bool _stopping{false};
+    mutable std::mutex _mutex;
+    std::condition_variable _cv;
+};
+
+#endif
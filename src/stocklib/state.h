@@ -38,9 +38,10 @@ SOFTWARE.
 #include <exception>
 #include <stdexcept>
 #include <functional>
+#include <chrono>
+#include <vector>
 
-#define LOCK std::lock_guard<std::recursive_mutex>(this->_mutex)
-#define LOCK2 std::lock_guard<std::mutex>(this->_statechange_mutex)
+#define LOCK std::lock_guard<std::recursive_mutex> guard(this->_mutex)
 
 /**
  * A thread-safe state machine implementation, with a dynamic definition which
@@ -74,6 +75,11 @@ public:
     typedef std::map<S,action_table> transition_table;
     typedef std::map<S,std::function<void()>> function_table;
 
+    /**
+     * The clock used for deadlines passed to wait_for_any_state()
+     */
+    typedef std::chrono::steady_clock clock;
+
     virtual ~state_machine()
     {
     }
@@ -143,7 +149,13 @@ public:
      * @note If defined, the entry actions for the state will be executed
      * before this call returns. 
      */
-    void initialize(S initial) const { LOCK; _state=initial; do_entry_actions_bare(); }
+    void initialize(S initial) const
+    {
+	LOCK;
+	_state=initial;
+	do_entry_actions_bare();
+	notify_waiters_bare(initial);
+    }
 
     /**
      * Queries the state the state machine is currently in.
@@ -153,11 +165,14 @@ public:
 
     /**
      * Performs on action on the state machine. Note that this may have no
-     * effect if an applicable transition has not been defined.
+     * effect if an applicable transition has not been defined. The lock is
+     * held throughout, so the exit and entry actions and the wakeup of any
+     * waiters have all finished before another thread can observe or change
+     * the state.
      * 
      * @param a The action to perform
      */
-    void action(A a) const { LOCK; LOCK2; action_bare(a); } 
+    void action(A a) const { LOCK; action_bare(a); } 
 
     /**
      * Defines entry actions for the given state. Whenever a transition to the
@@ -218,29 +233,41 @@ public:
      */
     void wait_for_state_entry(S s) const
     {
-	std::unique_lock<std::recursive_mutex> main_lock(_mutex);
-	std::unique_lock<std::mutex> event_lock(_statechange_mutex);
-	event_lock.unlock();
+	wait_for_any_state( { s } );
+    }
 
-	if (_state==s)
-	{
-	    // We're already done. Release the main mutex and return.
-	    main_lock.unlock();
-	    return;
-	}
-	
-	// Now lock the statechange lock and release the main lock. Another thread
-	// must own both in order to change the state.
-	event_lock.lock();
-	main_lock.unlock();
+    /**
+     * Blocks the calling thread indefinitely until any one of the given states
+     * is entered. If the state machine is already in one of the given states,
+     * this function returns immediately.
+     *
+     * Only threads waiting on the state actually entered are woken by a
+     * transition; waiters on other states are left undisturbed.
+     *
+     * @param s The set of states to wait for
+     * @return The state that was entered
+     */
+    S wait_for_any_state(const std::set<S>& s) const
+    {
+	S entered;
+	wait_bare(s,nullptr,entered);
+	return entered;
+    }
 
-	bool achievedState=false;
-	while(!achievedState)
-	{
-	    _state_change.wait(event_lock);
-	    if (_state==s)
-		achievedState=true;
-	}
+    /**
+     * Blocks the calling thread until any one of the given states is entered,
+     * or until the deadline passes, whichever is sooner. If the state machine
+     * is already in one of the given states, this function returns
+     * immediately.
+     *
+     * @param s The set of states to wait for
+     * @param deadline The point in time after which to give up waiting
+     * @return true if one of the states was entered, false on timeout
+     */
+    bool wait_for_any_state(const std::set<S>& s, const clock::time_point& deadline) const
+    {
+	S entered;
+	return wait_bare(s,&deadline,entered);
     }
 
 protected:
@@ -280,7 +307,7 @@ protected:
 	    do_entry_actions_bare();
 	    
 	    // Notify waiters
-	    _state_change.notify_all();
+	    notify_waiters_bare(newState);
 	    
 	}
 	else
@@ -337,8 +364,101 @@ protected:
 	return _exit_actions.find(s)!=_exit_actions.end();
     }
 
+    /**
+     * Wakes only those threads waiting for entry into state s. Each waiter is
+     * signalled at most once, even if it is waiting on several states.
+     */
+    void notify_waiters_bare(S s) const
+    {
+	std::lock_guard<std::mutex> event_lock(_statechange_mutex);
+
+	const auto i = _waiters.find(s);
+	if (i==_waiters.end())
+	    return;
+
+	for ( auto w : (*i).second )
+	{
+	    if (!w->signalled)
+	    {
+		w->signalled = true;
+		w->entered = s;
+		w->cv.notify_one();
+	    }
+	}
+    }
+
+    bool wait_bare(const std::set<S>& s, const clock::time_point* deadline, S& entered) const
+    {
+	std::unique_lock<std::recursive_mutex> main_lock(_mutex);
+	std::unique_lock<std::mutex> event_lock(_statechange_mutex);
+
+	if (s.find(_state)!=s.end())
+	{
+	    // We're already done
+	    entered = _state;
+	    return true;
+	}
+
+	// Register on the waiter list of each target state, then release the
+	// main lock. The event lock is held until we are parked on our own
+	// condition variable, so a notification cannot be missed.
+	waiter w;
+	std::vector<std::pair<S,typename waiter_list::iterator>> registrations;
+	for ( auto st : s )
+	{
+	    auto& l = _waiters[st];
+	    registrations.push_back( { st, l.insert(l.end(),&w) } );
+	}
+	main_lock.unlock();
+
+	while (!w.signalled)
+	{
+	    if (deadline)
+	    {
+		if (w.cv.wait_until(event_lock,*deadline)==std::cv_status::timeout)
+		    break;
+	    }
+	    else
+		w.cv.wait(event_lock);
+	}
+
+	// Deregister
+	for ( auto& r : registrations )
+	{
+	    auto& l = _waiters[r.first];
+	    l.erase(r.second);
+	    if (l.empty())
+		_waiters.erase(r.first);
+	}
+
+	if (w.signalled)
+	    entered = w.entered;
+
+	// The transition that woke us may still be finishing under the main
+	// lock. Wait for it to be released, so that the caller can safely act
+	// on (or destroy) the object once we return.
+	event_lock.unlock();
+	main_lock.lock();
+
+	return w.signalled;
+    }
+
 
 private:
+
+    /**
+     * A single blocked thread, parked on its own condition variable
+     */
+    struct waiter
+    {
+	std::condition_variable cv;
+	bool signalled{false};
+	S entered;
+    };
+
+    typedef std::list<waiter*> waiter_list;
+    typedef std::map<S,waiter_list> waiter_table;
+
     mutable std::recursive_mutex _mutex;
     mutable std::mutex _statechange_mutex;
     std::set<S> _states;
@@ -347,7 +467,7 @@ private:
     mutable S _state;
     function_table _entry_actions;
     function_table _exit_actions;
-    mutable std::condition_variable _state_change;
+    mutable waiter_table _waiters;
 
 };
 
@@ -32,25 +32,92 @@ SOFTWARE.
 #include <set>
 #include <mutex>
 #include <map>
+#include <vector>
+#include <chrono>
+#include <atomic>
 
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
+#include <sys/stat.h>
 
 #include "stocklib_p.h"
 #include "tickerproblem.h"
+#include "pool.h"
+#include "deathrattle.h"
+#include "symboltable.h"
+#include "namefile.h"
+#include "directory.h"
+#include "scheduler.h"
+#include "subscriber.h"
+#include "tickring.h"
+#include "tickarchive.h"
+#include "portfoliobook.h"
+#include "alertbook.h"
 
 typedef std::set<urltask*> taskset;
 
+static void fetch_batch(const std::vector<sl_symbol_t>&, std::vector<sl_quote_t>&);
+
 #define MLOCK std::lock_guard<std::recursive_mutex> lock(g_mutex)
 
 namespace 
 {
+    /**
+     * Per-symbol data held in the ticker directory
+     */
+    struct tickerinfo
+    {
+	std::string name;
+    };
+
     BOOL g_initialized{false};
-    sl_test_behavior_t g_behavior{SLTBNone};
-    BOOL g_testmode{false};
+    std::atomic<sl_test_behavior_t> g_behavior{SLTBNone};
+    std::atomic<BOOL> g_testmode{false};
     taskset g_taskset;
     std::recursive_mutex g_mutex;
-    std::map<std::string,std::string> g_namecache;
+    directory<tickerinfo> g_directory;
+    namefile g_namefile;
+    std::mutex g_namefile_mutex;
+    pool<tickertask> g_taskpool( [](tickertask& t) { t.recycle(); } );
+    symboltable g_symbols;
+    tickhistory g_history;
+    tickarchive g_archive;
+    portfoliobook g_book;
+    alertbook g_alerts;
+
+    /* Declared last, so its workers stop before anything they use is destroyed */
+    scheduler g_scheduler(16);
+
+    /* Declared after the scheduler, so it is destroyed first, while its
+       requests can still be completed */
+    subscriber g_subscriber( &fetch_batch, [](std::function<void()> job)
+			     {
+				 g_scheduler.submit(job,scheduler::priority::bulk);
+			     } );
+}
+
+/**
+ * Determines the location of the persistent name cache: $STOCKLIB_NAMECACHE
+ * if set (an empty value disables the persistent cache), otherwise
+ * stocklib-names under $XDG_CACHE_HOME or ~/.cache.
+ */
+inline std::string namefile_path()
+{
+    const char* env = getenv("STOCKLIB_NAMECACHE");
+    if (env)
+	return env;
+
+    std::string dir;
+    if ( (env = getenv("XDG_CACHE_HOME")) && *env )
+	dir = env;
+    else if ( (env = getenv("HOME")) && *env )
+	dir = std::string(env) + "/.cache";
+    else
+	return "";
+
+    mkdir(dir.c_str(),0700);
+    return dir + "/stocklib-names";
 }
 
 inline void init_guard()
@@ -66,20 +133,190 @@ void stocklib_init()
 	throw std::logic_error("stocklib is already initialized");
     
     g_initialized = true;
+    tickerproblem::route_json_allocations();
     g_behavior = SLTBNone;
     g_testmode = false;
-    g_namecache.clear();
+    g_directory.clear();
+    g_directory.configure(0,directory<tickerinfo>::evict_clock);
     g_taskset.clear();
+    g_taskpool.drain();
+    g_symbols.clear();
+    g_history.clear();
+    g_history.configure(256);
+    g_scheduler.reset_stats();
+    g_subscriber.reset_stats();
+
+    const std::string path = namefile_path();
+    if (!path.empty())
+    {
+	std::lock_guard<std::mutex> lock(g_namefile_mutex);
+	g_namefile.open(path);
+    }
 }
 
 void stocklib_p_reset()
 {
+    g_subscriber.clear();
+
     MLOCK;
     g_initialized=false;
     g_taskset.clear();
     g_testmode = false;
     g_behavior = SLTBNone;
-    g_namecache.clear();
+    g_directory.clear();
+    g_taskpool.drain();
+    g_symbols.clear();
+    g_history.clear();
+    g_archive.close();
+    g_book.clear();
+    g_alerts.clear();
+    g_alerts.callback(alertbook::deliver_fn());
+    urlproblem::set_endpoint("");
+    std::lock_guard<std::mutex> flock(g_namefile_mutex);
+    g_namefile.close();
+}
+
+/**
+ * Looks up a name in the cache, copying it into buffer (if not NULL). Names
+ * held in the directory are read without any lock. On a miss, the persistent
+ * cache is consulted, and any name found there is brought into the directory.
+ *
+ * @return true if the cache holds a name for the symbol
+ */
+inline bool namecache_lookup(sl_symbol_t symbol, char* buffer)
+{
+    if ( g_directory.read(symbol,[buffer](const tickerinfo& info)
+			  { if (buffer) strcpy(buffer,info.name.c_str()); }) )
+	return true;
+
+    char name[namefile::max_name+1];
+    {
+	std::lock_guard<std::mutex> lock(g_namefile_mutex);
+	if ( !g_namefile.is_open() ||
+	     !g_namefile.lookup(g_symbols.name(symbol),name,sizeof(name)) )
+	    return false;
+    }
+
+    g_directory.store(symbol,tickerinfo{name});
+
+    if (buffer)
+	strcpy(buffer,name);
+    return true;
+}
+
+/**
+ * Stores a name in the cache. Outside of test mode, the name is also written
+ * through to the persistent cache. Storing the name already held is a no-op,
+ * so refreshing a quote does not replace its directory entry.
+ */
+inline void namecache_store(sl_symbol_t symbol, const std::string& name)
+{
+    bool same=false;
+    if ( g_directory.read(symbol,[&name,&same](const tickerinfo& info)
+			  { same = (info.name==name); }) && same )
+	return;
+
+    g_directory.store(symbol,tickerinfo{name});
+
+    std::lock_guard<std::mutex> lock(g_namefile_mutex);
+    if (g_namefile.is_open() && !g_testmode)
+	g_namefile.insert(g_symbols.name(symbol),name.c_str());
+}
+
+/**
+ * Parses a decimal price (e.g. "99.99") into fixed-point units of
+ * 1/SL_PRICE_SCALE. Digits beyond the scale are truncated. 
+ *
+ * @return false if the text is not a number
+ */
+inline bool parse_price(const std::string& text, int64_t& price)
+{
+    const char* p = text.c_str();
+    bool negative = false;
+    bool digits = false;
+    int64_t whole = 0;
+    int64_t frac = 0;
+    int64_t frac_scale = SL_PRICE_SCALE;
+
+    if (*p=='-')
+    {
+	negative=true;
+	p++;
+    }
+
+    for ( ; (*p>='0') && (*p<='9'); p++, digits=true )
+	whole = whole*10 + (*p-'0');
+
+    if (*p=='.')
+    {
+	for ( p++; (*p>='0') && (*p<='9'); p++, digits=true )
+	{
+	    if (frac_scale>1)
+	    {
+		frac_scale /= 10;
+		frac += (*p-'0')*frac_scale;
+	    }
+	}
+    }
+
+    if ( !digits || (*p!='\0') )
+	return false;
+
+    price = whole*SL_PRICE_SCALE + frac;
+    if (negative)
+	price = -price;
+
+    return true;
+}
+
+/**
+ * @return The current time in microseconds since the Unix epoch
+ */
+inline int64_t timestamp_now()
+{
+    using namespace std::chrono;
+    return duration_cast<microseconds>(system_clock::now().time_since_epoch()).count();
+}
+
+/**
+ * Records a decoded price in the tick history, and in the archive if one is
+ * open, revalues any portfolio holding the symbol, and queues any alerts it
+ * fires. Alerts are delivered once the caller has released the library lock.
+ */
+inline void record_tick(sl_symbol_t symbol, int64_t timestamp, int64_t price)
+{
+    g_history.record(symbol,timestamp,price);
+    if (g_archive.is_open())
+	g_archive.append(g_symbols.name(symbol),timestamp,price);
+    g_book.update(symbol,price);
+    g_alerts.update(symbol,timestamp,price);
+}
+
+/**
+ * Takes a task from the pool, or creates one if the pool is empty, and aims
+ * it at the given ticker.
+ */
+inline tickertask* acquire_task(const char* ticker)
+{
+    const sl_test_behavior_t b = (g_testmode)?g_behavior.load():SLTBNone;
+
+    tickertask* pTask = g_taskpool.acquire();
+    if (pTask)
+	pTask->retarget(ticker,b);
+    else
+	pTask = new tickertask(ticker,b);
+
+    return pTask;
+}
+
+/**
+ * Returns an executor which queues work on the scheduler at the given
+ * priority.
+ */
+inline std::function<void(std::function<void()>)> executor(sl_priority_t priority)
+{
+    const scheduler::priority p = static_cast<scheduler::priority>(priority);
+    return [p](std::function<void()> job) { g_scheduler.submit(job,p); };
 }
 
 void stocklib_p_test_mode(BOOL enable)
@@ -98,6 +335,114 @@ void stocklib_p_test_behavior( sl_test_behavior_t b )
     g_behavior = b;
 }
 
+/**
+ * Copies the price from a task's output into the program buffer, and records
+ * the company name in the name cache, and the price in the tick history.
+ * Reads the output in place; no copy of the output map is made.
+ */
+inline void copy_output(const std::map<std::string,std::string>& out,
+			sl_symbol_t symbol, char* output)
+{
+    const auto response = out.find("response");
+    strcpy(output, (response!=out.end()) ? response->second.c_str() : "" );
+
+    int64_t price;
+    if ( (response!=out.end()) && parse_price(response->second,price) )
+	record_tick(symbol,timestamp_now(),price);
+
+    const auto name = out.find("companyname");
+    namecache_store(symbol, (name!=out.end()) ? name->second : std::string() );
+}
+
+/**
+ * Fills a typed quote from the output of a problem, and records the company
+ * name in the name cache, and the price in the tick history. 
+ *
+ * @param out The output
+ * @param name_key The key of the company name in the output
+ * @param price_key The key of the price in the output
+ * @param quote The quote to fill, whose symbol is already set
+ * @return true if a valid price was decoded
+ */
+inline bool fill_quote(const std::map<std::string,std::string>& out,
+		       const std::string& name_key, const std::string& price_key,
+		       sl_quote_t* quote)
+{
+    quote->timestamp = timestamp_now();
+    quote->flags = SLQFNone;
+
+    const auto name = out.find(name_key);
+    if (name!=out.end())
+    {
+	namecache_store(quote->symbol,name->second);
+	quote->flags |= SLQFName;
+    }
+
+    const auto response = out.find(price_key);
+    if ( (response!=out.end()) && parse_price(response->second,quote->price) )
+    {
+	quote->flags |= SLQFPrice;
+	record_tick(quote->symbol,quote->timestamp,quote->price);
+    }
+
+    return (quote->flags & SLQFPrice);
+}
+
+/**
+ * Fills a typed quote from a task's output, and records the company name in
+ * the name cache. 
+ *
+ * @return true if a valid price was decoded
+ */
+inline bool copy_quote(const std::map<std::string,std::string>& out,
+		       sl_quote_t* quote)
+{
+    static const std::string name_key("companyname");
+    static const std::string price_key("response");
+
+    return fill_quote(out,name_key,price_key,quote);
+}
+
+/**
+ * Fetches a batch of symbols for the subscription engine, in one request,
+ * producing one quote per symbol. Runs on the scheduler; each worker keeps
+ * its own problem object, so its arena is re-used from batch to batch.
+ */
+static void fetch_batch(const std::vector<sl_symbol_t>& symbols, std::vector<sl_quote_t>& quotes)
+{
+    static thread_local std::unique_ptr<batchproblem> t_problem;
+
+    std::vector<std::string> tickers;
+    tickers.reserve(symbols.size());
+    for ( const sl_symbol_t s : symbols )
+	tickers.push_back(g_symbols.name(s));
+
+    const sl_test_behavior_t b = (g_testmode)?g_behavior.load():SLTBNone;
+    if (t_problem)
+	t_problem->retarget(tickers,b);
+    else
+	t_problem.reset(new batchproblem(tickers,b));
+
+    std::map<std::string,std::string> out;
+    try
+    {
+	out = t_problem->solve();
+    }
+    catch ( const std::exception& )
+    {
+	// Every quote in the batch is delivered as failed
+    }
+
+    quotes.resize(symbols.size());
+    for ( std::size_t i=0; i<symbols.size(); i++ )
+    {
+	quotes[i].symbol = symbols[i];
+	fill_quote(out,batchproblem::name_key(tickers[i]),
+		   batchproblem::price_key(tickers[i]),&quotes[i]);
+    }
+    g_alerts.deliver();
+}
+
 int stocklib_p_open_handles()
 {
     MLOCK;
@@ -106,85 +451,371 @@ int stocklib_p_open_handles()
     return g_taskset.size();
 }
 
-SLHANDLE stocklib_fetch_asynch(const char* ticker, char* output)
+int stocklib_p_pooled_handles()
+{
+    MLOCK;
+    init_guard();
+
+    return g_taskpool.idle();
+}
+
+SLHANDLE stocklib_fetch_asynch(const char* ticker, char* output, sl_priority_t priority)
 {
     MLOCK;
     init_guard();
 
-    // Create a problem
-    tickerproblem* pProblem = new tickerproblem(ticker,(g_testmode)?g_behavior:SLTBNone);
+    const sl_symbol_t symbol = g_symbols.intern(ticker);
 
-    // Create a urltask
-    urltask* pNewTask = new urltask(pProblem);
+    // Take a task from the pool
+    tickertask* pNewTask = acquire_task(ticker);
     
     g_taskset.insert(pNewTask);
+    pNewTask->set_issued(true);
 
+    pNewTask->request_timings().submitted = urlproblem::timings::clock::now();
     pNewTask->perform_async( [=]()
 			     {
-				 strcpy(output, pNewTask->output()["response"].c_str() );
-				 g_namecache[ticker] = pNewTask->output()["companyname"];
-			     } );
+				 copy_output(pNewTask->output_ref(),symbol,output);
+				 g_alerts.deliver();
+				 pNewTask->request_timings().completed = urlproblem::timings::clock::now();
+			     }, executor(priority) );
     return pNewTask;
 }
 
-void stocklib_asynch_dispose(SLHANDLE h)
+SLHANDLE stocklib_fetch_quote_asynch(const char* ticker, sl_quote_t* quote,
+				     sl_priority_t priority)
 {
     MLOCK;
     init_guard();
 
+    quote->symbol = g_symbols.intern(ticker);
+    quote->flags = SLQFNone;
+
+    tickertask* pNewTask = acquire_task(ticker);
+    
+    g_taskset.insert(pNewTask);
+    pNewTask->set_issued(true);
+
+    pNewTask->request_timings().submitted = urlproblem::timings::clock::now();
+    pNewTask->perform_async( [=]()
+			     {
+				 copy_quote(pNewTask->output_ref(),quote);
+				 g_alerts.deliver();
+				 pNewTask->request_timings().completed = urlproblem::timings::clock::now();
+			     }, executor(priority) );
+    return pNewTask;
+}
+
+void stocklib_asynch_dispose(SLHANDLE h)
+{
+    std::unique_lock<std::recursive_mutex> lock(g_mutex);
+    init_guard();
+
     // Is this a known task?
-    if ( g_taskset.find(h)!=g_taskset.end())
-    {
-	// Yes - now check it is in a disposable state
-	if ( h->ready() )
-	{
-	    auto l = h->obtain_lock();
-	    l.unlock();
-	    l.release();
-	    g_taskset.erase(h);
-	    delete h;
-	}
-	else
-	    throw std::logic_error("Can't dispose of this handle - async request in progress");
-    }
-    else
+    if ( g_taskset.find(h)==g_taskset.end() )
+	throw std::logic_error("Invalid handle");
+
+    // Yes - now check it is in a disposable state
+    if ( h->in_callback() )
+	throw std::logic_error("Can't dispose of this handle from its own callback");
+    else if ( !h->ready() )
+	throw std::logic_error("Can't dispose of this handle - async request in progress");
+
+    // The worker may still be running the completion callback, which may call
+    // back into the library, so wait for it to finish with the lock released
+    lock.unlock();
+    h->wait();
+    lock.lock();
+
+    if ( g_taskset.erase(h)==0 )
 	throw std::logic_error("Invalid handle");
+    h->set_issued(false);
+    g_taskpool.release(static_cast<tickertask*>(h));
 }
 
 sl_result_t stocklib_fetch_synch(const char* ticker, char* output)
 {
+    // Declared first, so alerts are delivered after the lock is released
+    deathrattle alerts( []() { g_alerts.deliver(); } );
     MLOCK;
     init_guard();
 
-    // Create a problem
-    tickerproblem* pProblem = new tickerproblem(ticker,(g_testmode)?g_behavior:SLTBNone);
+    // Take a task from the pool for immediate execution, and return it when done
+    tickertask* pTask = acquire_task(ticker);
+    deathrattle d( [=]() { g_taskpool.release(pTask); } );
 
-    // Create a task on the stack for immediate execution
-    urltask t(pProblem);
-
-    WorkResult r = t.perform_sync();
+    WorkResult r = pTask->perform_sync();
     if (r==WorkResult::Success)
     {
-	strcpy(output, t.output()["response"].c_str() );
-	g_namecache[ticker] = t.output()["companyname"];
+	copy_output(pTask->output_ref(),g_symbols.intern(ticker),output);
 	return SL_OK;
     }
     else
 	return SL_FAIL;
 }
 
-BOOL stocklib_is_complete( SLHANDLE h )
+sl_result_t stocklib_fetch_quote_synch(const char* ticker, sl_quote_t* quote)
 {
+    // Declared first, so alerts are delivered after the lock is released
+    deathrattle alerts( []() { g_alerts.deliver(); } );
     MLOCK;
     init_guard();
 
-    // Is this a known task?
-    if ( g_taskset.find(h)!=g_taskset.end() )
+    quote->symbol = g_symbols.intern(ticker);
+    quote->flags = SLQFNone;
+
+    tickertask* pTask = acquire_task(ticker);
+    deathrattle d( [=]() { g_taskpool.release(pTask); } );
+
+    WorkResult r = pTask->perform_sync();
+    if ( (r==WorkResult::Success) && copy_quote(pTask->output_ref(),quote) )
+	return SL_OK;
+    else
+	return SL_FAIL;
+}
+
+sl_symbol_t stocklib_symbol_id( const char* ticker )
+{
+    init_guard();
+
+    return g_symbols.intern(ticker);
+}
+
+const char* stocklib_symbol_name( sl_symbol_t symbol )
+{
+    init_guard();
+
+    return g_symbols.name(symbol);
+}
+
+void stocklib_format_price( int64_t price, char* output )
+{
+    const char* sign = (price<0) ? "-" : "";
+    const uint64_t magnitude = (price<0) ? -(uint64_t)price : price;
+
+    int frac = magnitude % SL_PRICE_SCALE;
+    int places = 4;		// SL_PRICE_SCALE is 10^4
+
+    // Drop trailing zeros, keeping at least two decimal places
+    while ( (places>2) && (frac%10==0) )
+    {
+	frac /= 10;
+	places--;
+    }
+
+    snprintf(output, SL_MAX_BUFFER, "%s%llu.%0*d", sign,
+	     (unsigned long long)(magnitude / SL_PRICE_SCALE), places, frac);
+}
+
+sl_subscription_t stocklib_subscribe( const char* const* tickers, unsigned count,
+				      unsigned interval_ms, SLQUOTECALLBACK callback,
+				      void* data, unsigned flags, int64_t min_tick )
+{
+    init_guard();
+
+    if ( !count || !interval_ms )
+	return 0;
+
+    std::vector<sl_symbol_t> symbols;
+    symbols.reserve(count);
+    for ( unsigned i=0; i<count; i++ )
+	symbols.push_back(g_symbols.intern(tickers[i]));
+
+    return g_subscriber.subscribe( symbols, std::chrono::milliseconds(interval_ms),
+				   [callback,data](const sl_quote_t& quote)
+				   {
+				       callback(&quote,data);
+				   },
+				   (flags & SLSFChangesOnly), min_tick, (flags & SLSFAligned) );
+}
+
+sl_result_t stocklib_unsubscribe( sl_subscription_t s )
+{
+    init_guard();
+
+    // No lock is taken, since a callback being waited for may call the library
+    return g_subscriber.unsubscribe(s) ? SL_OK : SL_FAIL;
+}
+
+void stocklib_p_subscription_stats(uint64_t* requests, uint64_t* symbols,
+				   uint64_t* suppressed)
+{
+    const subscriber::stats_t s = g_subscriber.stats();
+    *requests = s.requests;
+    *symbols = s.symbols;
+    if (suppressed)
+	*suppressed = s.suppressed;
+}
+
+void stocklib_history_configure( unsigned capacity )
+{
+    init_guard();
+    g_history.configure(capacity);
+}
+
+unsigned stocklib_history( sl_symbol_t symbol, int64_t from, int64_t to,
+			   int64_t* timestamps, int64_t* prices, unsigned max )
+{
+    init_guard();
+
+    const tickring* ring = g_history.find(symbol);
+    return ring ? ring->copy(from,to,timestamps,prices,max) : 0;
+}
+
+sl_result_t stocklib_archive_open( const char* dir, unsigned flags )
+{
+    init_guard();
+    return g_archive.open(dir,(flags & SLAFCompress)!=0) ? SL_OK : SL_FAIL;
+}
+
+void stocklib_archive_flush()
+{
+    init_guard();
+    g_archive.flush();
+}
+
+void stocklib_archive_close()
+{
+    init_guard();
+    g_archive.close();
+}
+
+/**
+ * Copies a portfolio's aggregates to the C API's structure
+ */
+inline void fill_valuation(const portfoliobook::totals& t, sl_valuation_t* valuation)
+{
+    valuation->value = t.value;
+    valuation->cost = t.cost;
+    valuation->pnl = t.pnl;
+    valuation->positions = t.positions;
+    valuation->priced = t.priced;
+}
+
+sl_result_t stocklib_portfolio_load( const char* path, unsigned* bad_line )
+{
+    init_guard();
+    return g_book.load(path,[](const char* ticker) { return g_symbols.intern(ticker); },bad_line)
+	? SL_OK : SL_FAIL;
+}
+
+sl_subscription_t stocklib_portfolio_subscribe( unsigned interval_ms )
+{
+    init_guard();
+
+    const std::vector<sl_symbol_t> symbols = g_book.symbols();
+    if ( symbols.empty() || !interval_ms )
+	return 0;
+
+    // Every quote fetched is recorded, which revalues the book
+    return g_subscriber.subscribe( symbols, std::chrono::milliseconds(interval_ms),
+				   [](const sl_quote_t&) {} );
+}
+
+sl_result_t stocklib_portfolio_value( const char* portfolio, sl_valuation_t* valuation )
+{
+    init_guard();
+
+    portfoliobook::id_t id;
+    portfoliobook::totals t;
+    if ( !g_book.find(portfolio,id) || !g_book.value(id,t) )
+	return SL_FAIL;
+
+    fill_valuation(t,valuation);
+    return SL_OK;
+}
+
+unsigned stocklib_portfolio_holdings( const char* portfolio, sl_holding_t* holdings,
+				      unsigned max, sl_valuation_t* valuation )
+{
+    init_guard();
+
+    portfoliobook::id_t id;
+    std::vector<portfoliobook::holding> h;
+    portfoliobook::totals t;
+    if ( !g_book.find(portfolio,id) || !g_book.holdings(id,h,&t) )
+	return 0;
+
+    for ( unsigned i=0; (i<max) && (i<h.size()); i++ )
     {
-	return h->ready();
+	holdings[i].quantity = h[i].quantity;
+	holdings[i].cost = h[i].cost;
+	holdings[i].price = h[i].price;
+	holdings[i].value = h[i].value;
+	holdings[i].weight = h[i].weight;
+	holdings[i].symbol = h[i].symbol;
+	holdings[i].flags = h[i].priced ? SLQFPrice : SLQFNone;
     }
+    if (valuation)
+	fill_valuation(t,valuation);
+
+    return h.size();
+}
+
+void stocklib_portfolio_clear()
+{
+    init_guard();
+    g_book.clear();
+}
+
+void stocklib_alert_callback( SLALERTCALLBACK callback, void* data )
+{
+    init_guard();
+
+    if (callback)
+	g_alerts.callback( [callback,data](const sl_alert_t* alerts, std::size_t count)
+			   {
+			       callback(alerts,count,data);
+			   } );
     else
+	g_alerts.callback(alertbook::deliver_fn());
+}
+
+sl_alert_id_t stocklib_alert_add( const char* ticker, sl_alert_direction_t direction,
+				  int64_t threshold, unsigned flags )
+{
+    init_guard();
+    return g_alerts.add(g_symbols.intern(ticker),direction,threshold,(flags & SLALRepeat)!=0);
+}
+
+sl_result_t stocklib_alert_remove( sl_alert_id_t alert )
+{
+    init_guard();
+    return g_alerts.remove(alert) ? SL_OK : SL_FAIL;
+}
+
+void stocklib_reserve_connections( unsigned count )
+{
+    init_guard();
+    g_scheduler.reserve(count);
+}
+
+void stocklib_set_endpoint( const char* endpoint )
+{
+    init_guard();
+    urlproblem::set_endpoint( endpoint ? endpoint : "" );
+}
+
+void stocklib_queue_stats( sl_priority_t priority, sl_queue_stats_t* stats )
+{
+    init_guard();
+
+    const scheduler::stats_t s = g_scheduler.stats(static_cast<scheduler::priority>(priority));
+    stats->dispatched = s.dispatched;
+    stats->total_delay_us = s.total_delay_us;
+    stats->max_delay_us = s.max_delay_us;
+    stats->queued = s.queued;
+}
+
+BOOL stocklib_is_complete( SLHANDLE h )
+{
+    init_guard();
+
+    // Atomic loads only, with no lock, so polling never contends with other
+    // calls or with the request completing
+    if (!h->issued())
 	throw std::logic_error("Invalid handle");
+    return h->ready();
 }
 
 sl_result_t stocklib_asynch_wait( SLHANDLE h, int timeout)
@@ -244,6 +875,42 @@ sl_result_t stocklib_asynch_result(SLHANDLE h)
 	throw std::logic_error("Invalid handle");
 }
 
+/**
+ * @return The time from one point to a later one, in microseconds, or zero if
+ * the later point was never reached
+ */
+inline uint64_t elapsed_us(urlproblem::timings::clock::time_point from,
+			   urlproblem::timings::clock::time_point to)
+{
+    using namespace std::chrono;
+    return (to>from) ? duration_cast<microseconds>(to-from).count() : 0;
+}
+
+sl_result_t stocklib_asynch_timing(SLHANDLE h, sl_timing_t* timing)
+{
+    MLOCK;
+    init_guard();
+
+    if ( g_taskset.find(h)==g_taskset.end() )
+	throw std::logic_error("Invalid handle");
+    if ( !h->ready() )
+	return SL_PENDING;
+    if ( h->result() != WorkResult::Success )
+	return SL_FAIL;
+
+    const urlproblem::timings& t = h->request_timings();
+    timing->queue_us = elapsed_us(t.submitted,t.started);
+    timing->dns_us = static_cast<uint64_t>(t.dns*1e6);
+    timing->connect_us = static_cast<uint64_t>(t.connect*1e6);
+    timing->tls_us = static_cast<uint64_t>(t.tls*1e6);
+    timing->ttfb_us = static_cast<uint64_t>(t.ttfb*1e6);
+    timing->transfer_us = static_cast<uint64_t>(t.transfer*1e6);
+    timing->decode_us = elapsed_us(t.fetched,t.decoded);
+    timing->callback_us = elapsed_us(t.decoded,t.completed);
+    timing->total_us = elapsed_us(t.submitted,t.completed);
+    return SL_OK;
+}
+
 sl_result_t stocklib_wait_all()
 {
     MLOCK;
@@ -252,14 +919,8 @@ sl_result_t stocklib_wait_all()
     // Wait for all tasks to complete
     for ( auto h : g_taskset )
     {
-	// Wait for entry into the finish state
-	if (!h->ready())
-	    h->wait();
-
-	// Wait for state entry actions to complete
-	auto l = h->obtain_lock();
-	l.unlock();
-	l.release();
+	// Wait for entry into the finish state, which follows any callback
+	h->wait();
 
     }
 
@@ -269,72 +930,91 @@ sl_result_t stocklib_wait_all()
 
 sl_result_t stocklib_cleanup()
 {
-    MLOCK;
+    std::unique_lock<std::recursive_mutex> lock(g_mutex);
     init_guard();
 
     for ( auto h : g_taskset )
-    {
-	if (h->ready())
-	    delete h;
-	else
+	if ( !h->ready() || h->in_callback() )
 	    return SL_FAIL;
-    }
 
-    g_taskset.clear();
+    // As in stocklib_asynch_dispose(), wait for any callbacks still running
+    // with the lock released
+    const std::vector<urltask*> handles(g_taskset.begin(),g_taskset.end());
+    lock.unlock();
+    for ( auto h : handles )
+	h->wait();
+    lock.lock();
+
+    for ( auto h : handles )
+    {
+	if ( g_taskset.erase(h) )
+	{
+	    h->set_issued(false);
+	    g_taskpool.release(static_cast<tickertask*>(h));
+	}
+    }
     return SL_OK;
 
 }
 
 BOOL stocklib_p_namecache_has_ticker(const char* ticker)
 {
-    MLOCK;
-    return g_namecache.find(ticker)!=g_namecache.end();
+    sl_symbol_t symbol;
+    return g_symbols.find(ticker,symbol) && namecache_lookup(symbol,NULL);
+}
+
+void stocklib_p_record_tick(const char* ticker, int64_t price)
+{
+    init_guard();
+    record_tick(g_symbols.intern(ticker),timestamp_now(),price);
+    g_alerts.deliver();
 }
 
 int stocklib_p_namecache_count()
 {
-    MLOCK;
-    return g_namecache.size();
+    return g_directory.size();
 }
 
 const char* stocklib_p_namecache_resolve(const char* ticker)
 {
-    MLOCK;
     static thread_local char buffer[256];
-    
-    if (g_namecache.count(ticker))
-    {
-	strcpy(buffer,g_namecache[ticker].c_str());
+
+    sl_symbol_t symbol;
+    if ( g_symbols.find(ticker,symbol) && namecache_lookup(symbol,buffer) )
 	return buffer;
-    }
     else
 	return NULL;
 }
 
-const char* stocklib_p_namecache_insert( const char* ticker, const char* name )
+void stocklib_p_namecache_insert( const char* ticker, const char* name )
 {
     MLOCK;
-    g_namecache[ticker] = name;
+    namecache_store(g_symbols.intern(ticker),name);
 }
 
 const char* stocklib_ticker_to_name( const char* ticker )
 {
-    MLOCK;
+    init_guard();
     static thread_local char buffer[256];
 
-    if (g_namecache.count(ticker))
-    {
-	strcpy(buffer,g_namecache[ticker].c_str());
+    const sl_symbol_t symbol = g_symbols.intern(ticker);
+
+    if ( namecache_lookup(symbol,buffer) )
 	return buffer;
-    }
     else
     {
-	if ( SL_OK == stocklib_fetch_synch(ticker,buffer) )
-	{
-	    strcpy(buffer,g_namecache[ticker].c_str());
+	if ( (SL_OK == stocklib_fetch_synch(ticker,buffer)) &&
+	     namecache_lookup(symbol,buffer) )
 	    return buffer;
-	}
 	else
 	    return NULL;
     }
 }
+
+void stocklib_namecache_configure( unsigned max_entries, sl_eviction_t policy )
+{
+    init_guard();
+    g_directory.configure(max_entries,
+			  (policy==SLEVFifo) ? directory<tickerinfo>::evict_fifo
+					     : directory<tickerinfo>::evict_clock);
+}
@@ -32,6 +32,7 @@ SOFTWARE.
 #define STOCKLIB_H
 
 #include <config.h>
+#include <stdint.h>
 
 typedef char BOOL;
 
@@ -40,6 +41,177 @@ typedef char BOOL;
  */
 #define SL_MAX_BUFFER (32)
 
+/**
+ * Prices in sl_quote_t are fixed-point integers, in units of 1/SL_PRICE_SCALE
+ */
+#define SL_PRICE_SCALE (10000)
+
+/**
+ * Compact integer identifier for an interned ticker symbol
+ */
+typedef uint32_t sl_symbol_t;
+
+/**
+ * Flags describing which fields of an sl_quote_t are valid
+ */
+typedef enum
+{
+    SLQFNone=0,			/**< No fields are valid  */
+    SLQFPrice=1,		/**< The price field holds the last trade price  */
+    SLQFName=2			/**< The company name is available via stocklib_ticker_to_name()  */
+} sl_quote_flags_t;
+
+/**
+ * A typed, fixed-layout stock quote. Prices can be used in arithmetic
+ * directly, without parsing text.
+ */
+typedef struct
+{
+    int64_t price;		/**< Last trade price, in units of 1/SL_PRICE_SCALE */
+    int64_t timestamp;		/**< Time the quote was received, in microseconds since the Unix epoch */
+    sl_symbol_t symbol;		/**< The interned ticker symbol, see stocklib_symbol_id() */
+    uint32_t flags;		/**< A combination of sl_quote_flags_t values */
+} sl_quote_t;
+
+/**
+ * Identifies a subscription made with stocklib_subscribe(). Never 0.
+ */
+typedef uint32_t sl_subscription_t;
+
+/**
+ * Options for a subscription
+ */
+typedef enum
+{
+    SLSFNone=0,			/**< Deliver every quote fetched  */
+    SLSFChangesOnly=1,		/**< Deliver only quotes which differ from the last one delivered  */
+    SLSFAligned=2		/**< Refresh every symbol together, once per interval  */
+} sl_subscribe_flags_t;
+
+/**
+ * Options for the tick archive
+ */
+typedef enum
+{
+    SLAFNone=0,			/**< Keep each day as written: a file per column, and an index */
+    SLAFCompress=1		/**< Pack each day into a compressed file as it is sealed */
+} sl_archive_flags_t;
+
+/**
+ * Priority classes for asynchronous requests. Requests wait for a free
+ * connection in earliest-deadline-first order, and the deadline of each
+ * request is set by its class, so interactive requests overtake any backlog
+ * of normal or bulk requests.
+ */
+typedef enum
+{
+    SLPRInteractive=0,		/**< A user is waiting on the result (due within 50ms)  */
+    SLPRNormal=1,		/**< Ordinary requests (due within 1s)  */
+    SLPRBulk=2			/**< Background work, such as refreshes (due within 30s)  */
+} sl_priority_t;
+
+/**
+ * Queueing statistics for one priority class
+ */
+typedef struct
+{
+    uint64_t dispatched;	/**< Requests which have started  */
+    uint64_t total_delay_us;	/**< Total time those requests spent queued, in microseconds  */
+    uint64_t max_delay_us;	/**< Longest time any of them spent queued, in microseconds  */
+    uint64_t queued;		/**< Requests still waiting to start  */
+} sl_queue_stats_t;
+
+/**
+ * Where the time of one asynchronous request went, in microseconds. The
+ * network phases come from curl; on a re-used connection, the DNS, connect
+ * and TLS phases are zero.
+ */
+typedef struct
+{
+    uint64_t queue_us;		/**< Waiting for a connection  */
+    uint64_t dns_us;		/**< Resolving the host name  */
+    uint64_t connect_us;	/**< Establishing the TCP connection  */
+    uint64_t tls_us;		/**< The TLS handshake  */
+    uint64_t ttfb_us;		/**< From sending the request to the first byte of the response  */
+    uint64_t transfer_us;	/**< Receiving the rest of the response  */
+    uint64_t decode_us;		/**< Decoding the response  */
+    uint64_t callback_us;	/**< Recording the quote, revaluing portfolios and delivering alerts  */
+    uint64_t total_us;		/**< From submission to completion  */
+} sl_timing_t;
+
+/**
+ * A portfolio's value, counting only positions in symbols which have been
+ * quoted. Amounts are in units of 1/SL_PRICE_SCALE.
+ */
+typedef struct
+{
+    int64_t value;		/**< Market value of the quoted positions  */
+    int64_t cost;		/**< What the quoted positions cost  */
+    int64_t pnl;		/**< Profit or loss: value - cost  */
+    uint32_t positions;		/**< Positions in the portfolio  */
+    uint32_t priced;		/**< Positions in symbols which have been quoted  */
+} sl_valuation_t;
+
+/**
+ * A position in a portfolio. Amounts are in units of 1/SL_PRICE_SCALE.
+ */
+typedef struct
+{
+    int64_t quantity;		/**< Units held; negative if short  */
+    int64_t cost;		/**< What the position cost in all  */
+    int64_t price;		/**< The last price quoted, if flags has SLQFPrice  */
+    int64_t value;		/**< quantity*price, or 0 if not quoted  */
+    double weight;		/**< value as a fraction of the portfolio's value  */
+    sl_symbol_t symbol;		/**< The interned ticker symbol  */
+    uint32_t flags;		/**< SLQFPrice if the symbol has been quoted  */
+} sl_holding_t;
+
+/**
+ * Identifies a price alert. Never 0.
+ */
+typedef uint64_t sl_alert_id_t;
+
+/**
+ * Which way the price must cross an alert's threshold
+ */
+typedef enum
+{
+    SLADAbove=0,		/**< Fire when the price rises to the threshold or beyond  */
+    SLADBelow=1			/**< Fire when the price falls to the threshold or beyond  */
+} sl_alert_direction_t;
+
+/**
+ * Options for a price alert
+ */
+typedef enum
+{
+    SLALNone=0,			/**< Fire once, then remove the alert  */
+    SLALRepeat=1		/**< Fire every time the threshold is crossed  */
+} sl_alert_flags_t;
+
+/**
+ * A price alert which has fired
+ */
+typedef struct
+{
+    sl_alert_id_t alert;	/**< The alert, as returned by stocklib_alert_add()  */
+    sl_symbol_t symbol;		/**< The interned ticker symbol  */
+    sl_alert_direction_t direction;	/**< Which way the price crossed  */
+    int64_t threshold;		/**< The alert's threshold, in units of 1/SL_PRICE_SCALE  */
+    int64_t price;		/**< The price which crossed it  */
+    int64_t timestamp;		/**< When that price was quoted, in microseconds since the Unix epoch  */
+} sl_alert_t;
+
+/**
+ * Policies for choosing which name cache entry to drop when the in-memory
+ * cache is full
+ */
+typedef enum
+{
+    SLEVFifo=0,			/**< Drop the oldest entry  */
+    SLEVClock=1			/**< Drop the oldest entry not read recently (default)  */
+} sl_eviction_t;
+
 /**
  * Enumeration with possible return codes from the library API.
  */
@@ -71,6 +243,24 @@ extern "C" {
      */
     typedef void (*SLCALLBACK)(SLHANDLE h,void* data);
 
+    /**
+     * Type definition for subscription callbacks
+     *
+     * @param quote The quote just fetched. It is only valid during the call.
+     * @param data an application-defined pointer to some data
+     */
+    typedef void (*SLQUOTECALLBACK)(const sl_quote_t* quote,void* data);
+
+    /**
+     * Type definition for price alert callbacks
+     *
+     * @param alerts The alerts which have fired, in the order they fired.
+     *        They are only valid during the call.
+     * @param count The number of alerts
+     * @param data an application-defined pointer to some data
+     */
+    typedef void (*SLALERTCALLBACK)(const sl_alert_t* alerts,unsigned count,void* data);
+
 
     /**
      * Initializes the library. Must be called exactly once per run of the 
@@ -80,6 +270,16 @@ extern "C" {
      * stocklib_fetch_asynch() should be balanced with calls to
      * stocklib_asynch_dispose() to avoid memory leaks.
      *
+     * @note The persistent name cache is opened here. Its location is taken
+     * from the STOCKLIB_NAMECACHE environment variable if set (set it empty to
+     * disable the persistent cache), otherwise it is stocklib-names in
+     * $XDG_CACHE_HOME, or in ~/.cache.
+     *
+     * @note The first call installs allocation functions for the jansson JSON
+     * library, which apply to the whole process. A program which uses jansson
+     * itself must not hold any jansson object created before this call across
+     * it.
+     *
      * @warning You MUST initialize the curl library with a call to
      * curl_global_init() before using the stocklib library!  
      */
@@ -87,13 +287,15 @@ extern "C" {
 
     /**
      * Returns the full name of the security represeted by the ticker symbol
-     * provided. 
+     * provided. Cached names are returned without taking any lock, so this
+     * call may be made freely from many threads at once.
      *
      * @note The first time this call is made with a given symbol, and internet
      * lookup is performed. The result is then cached. Subsequent calls with the
      * same ticker symbol will return the cached result. Cache entries do not
-     * expire, and do not survive calls to stocklib_cleanup(). The cache is
-     * memory based and is therefore clear on each run of the application.  
+     * expire. The cache is backed by a memory-mapped file (see stocklib_init()),
+     * so names resolved by one run of the application are available to later
+     * runs, and to other applications using the library, without a lookup.
      *
      * @param ticker The ticker symbol to resolve to a name
      * @return The name of the underlying security, or NULL if a problem
@@ -101,6 +303,17 @@ extern "C" {
      */
     extern const char* stocklib_ticker_to_name( const char* ticker );
 
+    /**
+     * Limits the number of names held in memory by the name cache. Once the
+     * limit is reached, caching another name evicts one chosen by the policy.
+     * Evicted names remain in the persistent cache, if there is one. By
+     * default there is no limit.
+     *
+     * @param max_entries the maximum number of names held, or 0 for no limit
+     * @param policy how to choose the name to evict
+     */
+    extern void stocklib_namecache_configure( unsigned max_entries, sl_eviction_t policy );
+
     /**
      * Synchronously fetches the latest trade price of a stock. 
      *
@@ -128,12 +341,77 @@ extern "C" {
      *
      * @param ticker the ticker symbol for the stock
      * @param output a program-owned buffer where the output will be written.
+     * @param priority the priority class of the request
+     * @return a handle which can be used to identify this particular transaction. 
+     */
+    extern SLHANDLE stocklib_fetch_asynch( const char* ticker, char* output,
+					   sl_priority_t priority=SLPRNormal );
+
+    /**
+     * Synchronously fetches the latest quote for a stock, as a typed
+     * structure.
+     *
+     * If the function returns SL_OK, the quote has been fully populated,
+     * including a valid price. If the function fails, the symbol field is
+     * still set, and the flags indicate which (if any) other fields are
+     * valid.
+     *
+     * @param ticker the ticker symbol for the stock
+     * @param quote a program-owned structure to receive the quote
+     * @return a result code indicating the outcome of the request
+     */
+    extern sl_result_t stocklib_fetch_quote_synch( const char* ticker, sl_quote_t* quote );
+
+    /**
+     * Begins the asynchronous fetching of the latest quote for a stock, as a
+     * typed structure. The symbol field is set, and the flags cleared, before
+     * this call returns; the remaining fields are written when the operation
+     * completes. The handle is used exactly like one returned by
+     * stocklib_fetch_asynch().
+     *
+     * @warning Each call to this function must be matched with a call to
+     *          stocklib_asynch_dispose(), otherwise a memory leak will occur. 
+     *
+     * @param ticker the ticker symbol for the stock
+     * @param quote a program-owned structure to receive the quote
+     * @param priority the priority class of the request
      * @return a handle which can be used to identify this particular transaction. 
      */
-    extern SLHANDLE stocklib_fetch_asynch( const char* ticker, char* output );
+    extern SLHANDLE stocklib_fetch_quote_asynch( const char* ticker, sl_quote_t* quote,
+						 sl_priority_t priority=SLPRNormal );
+
+    /**
+     * Returns the interned identifier of a ticker symbol, interning it first if
+     * necessary. The same ticker always maps to the same identifier.
+     *
+     * @param ticker the ticker symbol
+     * @return the symbol identifier
+     */
+    extern sl_symbol_t stocklib_symbol_id( const char* ticker );
+
+    /**
+     * Returns the ticker symbol for an interned identifier.
+     *
+     * @param symbol an identifier previously returned by stocklib_symbol_id(),
+     *        or found in an sl_quote_t
+     * @return the ticker symbol, or NULL if the identifier is unknown. The
+     *         string remains valid for as long as the library is initialized.
+     */
+    extern const char* stocklib_symbol_name( sl_symbol_t symbol );
+
+    /**
+     * Formats a fixed-point price as text, with at least two decimal places.
+     *
+     * @param price a price in units of 1/SL_PRICE_SCALE
+     * @param output a program-owned buffer of at least SL_MAX_BUFFER bytes
+     */
+    extern void stocklib_format_price( int64_t price, char* output );
 
     /**
      * Clears up the memory allocated during a call be stocklib_fetch_asynch().
+     * If the operation's callback is still running, this waits for it to
+     * return; the callback may call the library meanwhile, but must not
+     * dispose of its own handle.
      *
      * @param h a handle to a valid asynchronous operation, which has not yet
      *          been disposed of.  
@@ -149,6 +427,15 @@ extern "C" {
      * tells you nothing about whether or not the operation was successful, or
      * encountered an error. 
      *
+     * Once this returns true, the program buffer (or quote) passed with the
+     * request has been written, and may be read without further
+     * synchronization. The call takes no lock, so it is cheap to poll.
+     *
+     * A handle which has been disposed of is rejected with std::logic_error,
+     * as by the other calls. The check reads a marker in the handle rather
+     * than looking it up, so it cannot detect a pointer which was never a
+     * handle, nor one whose memory has since been reused.
+     *
      * @param h a handle to a valid asynchronous operation, which has not yet been
      *          disposed of via stocklib_asynch_dispose(). 
      *
@@ -168,6 +455,19 @@ extern "C" {
      */
     extern sl_result_t stocklib_asynch_result( SLHANDLE h );
 
+    /**
+     * Reports where the time of a successful asynchronous operation went,
+     * from being queued to the completion of the library's own work. The
+     * application's callback, if any, runs after that.
+     *
+     * @param h a handle to a valid asynchronous operation, which has not yet been
+     *          disposed of via stocklib_asynch_dispose().
+     * @param timing a program-owned structure to receive the timing
+     * @return SL_OK, SL_PENDING if the operation has not completed, or SL_FAIL
+     *         if it failed
+     */
+    extern sl_result_t stocklib_asynch_timing( SLHANDLE h, sl_timing_t* timing );
+
 
     /**
      * Waits for a valid asynchronous operation to complete, then returns the
@@ -187,7 +487,8 @@ extern "C" {
     /**
      * Registers a callback which will be called upon completion of an asychronous
      * operation. If the operation has already completed, the callback will be called
-     * immediately. 
+     * immediately. Either way it is called exactly once, so it is safe to register
+     * it after starting the operation.
      *
      * @param h    A handle to the operation on which to set the callback
      * @param c    A pointer to the callback function
@@ -197,6 +498,241 @@ extern "C" {
      */
     extern sl_result_t stocklib_asynch_register_callback(SLHANDLE h, SLCALLBACK c, void* data);
 
+    /**
+     * Subscribes to a set of ticker symbols, which are then fetched again
+     * every interval, for as long as the subscription lasts. Each fetched
+     * quote is passed to the callback, including failed ones (which lack the
+     * SLQFPrice flag). The callback is called from a library thread, but
+     * never concurrently for the same subscription.
+     *
+     * Symbols from all subscriptions that fall due at about the same time are
+     * combined into a single upstream request, and refresh times are
+     * randomized slightly to spread the load. A few library threads serve
+     * any number of subscriptions.
+     *
+     * With SLSFAligned, the subscription's symbols are instead all fetched
+     * at once, and again exactly once per interval, so that each refresh
+     * takes as few requests as possible (one per 50 symbols).
+     *
+     * With SLSFChangesOnly, the last quote delivered for each symbol is
+     * remembered, and a quote is only delivered if its price has moved by at
+     * least min_tick since, or it has gained or lost a price. Repeated
+     * failures are delivered once. The first quote for each symbol is always
+     * delivered.
+     *
+     * @param tickers an array of ticker symbols
+     * @param count the number of ticker symbols
+     * @param interval_ms how often to refresh each symbol, in milliseconds
+     * @param callback the function which receives each quote
+     * @param data an application-defined pointer passed to the callback
+     * @param flags a combination of sl_subscribe_flags_t values
+     * @param min_tick with SLSFChangesOnly, the smallest price move which is
+     *        delivered, in units of 1/SL_PRICE_SCALE. 0 delivers any move.
+     * @return the subscription, or 0 if no tickers or interval were given
+     */
+    extern sl_subscription_t stocklib_subscribe( const char* const* tickers, unsigned count,
+						 unsigned interval_ms, SLQUOTECALLBACK callback,
+						 void* data, unsigned flags=SLSFNone,
+						 int64_t min_tick=0 );
+
+    /**
+     * Ends a subscription. Once this returns, the callback will not be
+     * called for the subscription again. A callback may end its own
+     * subscription, but not another.
+     *
+     * @param s a subscription returned by stocklib_subscribe()
+     * @return SL_OK, or SL_FAIL if there is no such subscription
+     */
+    extern sl_result_t stocklib_unsubscribe( sl_subscription_t s );
+
+    /**
+     * Sets how many recent ticks are kept for each symbol. Every quote the
+     * library decodes with a valid price is recorded in the history of its
+     * symbol, and the oldest tick is dropped once the history is full. Only
+     * symbols quoted after this call are affected. The default is 256.
+     *
+     * @param capacity the number of ticks kept per symbol
+     */
+    extern void stocklib_history_configure( unsigned capacity );
+
+    /**
+     * Copies the recorded ticks of a symbol with timestamps in a time window,
+     * oldest first, into contiguous program-owned arrays. If the window holds
+     * more than max ticks, the most recent max are copied. The call takes no
+     * lock, and may be made while the symbol is being refreshed.
+     *
+     * @param symbol the symbol, see stocklib_symbol_id()
+     * @param from the start of the window, inclusive, in microseconds since
+     *        the Unix epoch (as for sl_quote_t timestamps)
+     * @param to the end of the window, inclusive
+     * @param timestamps receives the timestamp of each tick
+     * @param prices receives the price of each tick, in units of
+     *        1/SL_PRICE_SCALE
+     * @param max the number of elements in each array
+     * @return the number of ticks copied
+     */
+    extern unsigned stocklib_history( sl_symbol_t symbol, int64_t from, int64_t to,
+				      int64_t* timestamps, int64_t* prices, unsigned max );
+
+    /**
+     * Starts archiving every tick recorded in the history to disk, in a
+     * columnar archive directory with a set of files per UTC day (see the
+     * tickarchive class). Ticks are written in batches; stocklib_archive_flush()
+     * writes any held back.
+     *
+     * With SLAFCompress, each day is compressed as it is sealed, at the end
+     * of the day or by stocklib_archive_close(), to a small fraction of its
+     * size (see the tickcodec class).
+     *
+     * @param dir the archive directory, created if it does not exist
+     * @param flags a combination of sl_archive_flags_t values
+     * @return SL_OK, or SL_FAIL if the directory could not be created or is
+     *         being written by another process
+     */
+    extern sl_result_t stocklib_archive_open( const char* dir, unsigned flags=SLAFNone );
+
+    /**
+     * Writes any ticks held back to the archive.
+     */
+    extern void stocklib_archive_flush();
+
+    /**
+     * Stops archiving, writing any ticks held back and indexing the current
+     * day.
+     */
+    extern void stocklib_archive_close();
+
+    /**
+     * Adds the positions listed in a holdings file to the portfolio book.
+     * Each line holds a portfolio name, a ticker, a quantity and optionally
+     * the cost of each unit, separated by white space; text following a '#'
+     * is ignored. Nothing is added unless the whole file is valid.
+     *
+     * Every quote the library decodes with a valid price revalues the
+     * positions in its symbol, changing the aggregates of each portfolio
+     * holding it by the change in that position's value, so the cost of a
+     * quote does not grow with the size of the portfolios.
+     *
+     * @param path the holdings file
+     * @param bad_line if not NULL, receives the number of the first line
+     *        which could not be parsed, or 0 if the file could not be read
+     * @return SL_OK, or SL_FAIL if the file could not be read or parsed
+     */
+    extern sl_result_t stocklib_portfolio_load( const char* path, unsigned* bad_line );
+
+    /**
+     * Keeps the symbols held in the portfolio book quoted, refreshing them
+     * every interval. The subscription covers the symbols held when it is
+     * made; end it with stocklib_unsubscribe().
+     *
+     * @param interval_ms how often to refresh each symbol, in milliseconds
+     * @return the subscription, or 0 if nothing is held or no interval was
+     *         given
+     */
+    extern sl_subscription_t stocklib_portfolio_subscribe( unsigned interval_ms );
+
+    /**
+     * Reads a portfolio's value. Takes no lock, and may be called while
+     * quotes are revaluing the portfolio; the value is as it stood after
+     * some quote.
+     *
+     * @param portfolio the portfolio's name
+     * @param valuation a program-owned structure to receive the value
+     * @return SL_OK, or SL_FAIL if there is no such portfolio
+     */
+    extern sl_result_t stocklib_portfolio_value( const char* portfolio, sl_valuation_t* valuation );
+
+    /**
+     * Reads a portfolio's positions, each weighed by its share of the
+     * portfolio's value, in the order they were added. Takes no lock; the
+     * positions, and the valuation if asked for, are all as they stood after
+     * the same quote.
+     *
+     * @param portfolio the portfolio's name
+     * @param holdings a program-owned array to receive the positions
+     * @param max the number of elements in the array
+     * @param valuation if not NULL, receives the portfolio's value
+     * @return the number of positions in the portfolio, of which the first
+     *         max are copied, or 0 if there is no such portfolio
+     */
+    extern unsigned stocklib_portfolio_holdings( const char* portfolio, sl_holding_t* holdings,
+						 unsigned max, sl_valuation_t* valuation );
+
+    /**
+     * Removes every portfolio from the portfolio book.
+     */
+    extern void stocklib_portfolio_clear();
+
+    /**
+     * Sets the function which receives price alerts as they fire. Alerts are
+     * checked against every quote the library decodes with a valid price,
+     * and those fired by one request are passed to the callback together.
+     * The callback is called from the thread which decoded the quotes, with
+     * no library lock held, but never concurrently; it may add and remove
+     * alerts.
+     *
+     * @param callback the function which receives fired alerts, or NULL to
+     *        drop them
+     * @param data an application-defined pointer passed to the callback
+     */
+    extern void stocklib_alert_callback( SLALERTCALLBACK callback, void* data );
+
+    /**
+     * Adds a price alert, which fires when a quote for the ticker crosses
+     * the threshold in the given direction: from below it to at least it,
+     * or from above it to at most it. The first quote for a ticker sets the
+     * price from which crossings are measured, and fires nothing.
+     *
+     * Alerts are indexed by threshold, so checking a quote costs O(log n +
+     * fired) however many alerts are held.
+     *
+     * @param ticker the ticker symbol to watch
+     * @param direction which way the price must cross the threshold
+     * @param threshold the price, in units of 1/SL_PRICE_SCALE
+     * @param flags a combination of sl_alert_flags_t values
+     * @return the alert
+     */
+    extern sl_alert_id_t stocklib_alert_add( const char* ticker, sl_alert_direction_t direction,
+					     int64_t threshold, unsigned flags=SLALNone );
+
+    /**
+     * Removes a price alert.
+     *
+     * @param alert an alert returned by stocklib_alert_add()
+     * @return SL_OK, or SL_FAIL if there is no such alert, or it has fired
+     *         and did not repeat
+     */
+    extern sl_result_t stocklib_alert_remove( sl_alert_id_t alert );
+
+    /**
+     * Raises the number of requests the library runs at once, each on its
+     * own connection, to at least the number given. The default is 16. The
+     * number is never lowered.
+     *
+     * @param count the number of requests to run at once
+     */
+    extern void stocklib_reserve_connections( unsigned count );
+
+    /**
+     * Sends all requests made from now on to another server, such as a local
+     * stand-in used for benchmarking, which must answer in the same format.
+     * The scheme, host and port of each request are replaced by the
+     * endpoint; the path and query are kept.
+     *
+     * @param endpoint a URL such as "http://127.0.0.1:8080", or NULL to use
+     *        the real server again
+     */
+    extern void stocklib_set_endpoint( const char* endpoint );
+
+    /**
+     * Reports how long asynchronous requests of a priority class have waited
+     * for a connection, since the library was initialized.
+     *
+     * @param priority the priority class
+     * @param stats a program-owned structure to receive the statistics
+     */
+    extern void stocklib_queue_stats( sl_priority_t priority, sl_queue_stats_t* stats );
+
     /**
      * Waits for all pending operations to complete.
      */
@@ -78,7 +78,33 @@ extern void stocklib_p_test_behavior( sl_test_behavior_t b);
  * @return the number of open handles
  */
 extern int  stocklib_p_open_handles();
+
+/**
+ * Queries the number of disposed handles held in the pool for re-use by
+ * subsequent requests.
+ *
+ * @return the number of pooled handles
+ */
+extern int  stocklib_p_pooled_handles();
     
+/**
+ * Queries the work done by the subscription engine since the library was
+ * initialized.
+ *
+ * @param requests receives the number of batched requests made
+ * @param symbols receives the number of symbols fetched by those requests
+ * @param suppressed if not NULL, receives the number of unchanged quotes not
+ * delivered
+ */
+extern void stocklib_p_subscription_stats(uint64_t* requests, uint64_t* symbols,
+					  uint64_t* suppressed=nullptr);
+
+/**
+ * Records a tick as though a quote with that price had just been decoded,
+ * revaluing portfolios and delivering any alerts it fires.
+ */
+extern void stocklib_p_record_tick(const char* ticker, int64_t price);
+
 /**
  * Performs a hard reset of the library. If handles are open,
  * they are not cleaned up (resulting in memory leaks), and
@@ -108,7 +134,7 @@ extern const char* stocklib_p_namecache_resolve(const char* ticker);
 /**
  * Inserts an entry into the name cache
  */
-extern const char* stocklib_p_namecache_insert(const char* ticker, const char* name);
+extern void stocklib_p_namecache_insert(const char* ticker, const char* name);
 
 #ifdef STOCKLIB_P_H_C
 }
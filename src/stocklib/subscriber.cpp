@@ -0,0 +1,461 @@
+/**
+ * @file
+ * Implementation of the subscriber class.
+ */
+
+/*
+The MIT License (MIT)
+
+Copyright (c) 2015 David Bradshaw
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include <algorithm>
+#include <stdexcept>
+
+#include "subscriber.h"
+
+namespace
+{
+    /** The subscription whose callback is running on this thread, if any */
+    thread_local const void* t_delivering = nullptr;
+}
+
+/**
+ * Constructor. The timer thread is not started until the first subscription
+ * is made.
+ *
+ * @param fetch Fetches a batch of symbols
+ * @param executor Runs each batched request
+ * @param max_batch The most symbols combined into one request
+ * @param max_inflight The most requests outstanding at once
+ * @param window Symbols falling due this soon after the earliest due symbol
+ * are fetched along with it
+ */
+subscriber::subscriber(fetch_fn fetch, executor_fn executor, unsigned max_batch,
+		       unsigned max_inflight, clock::duration window) :
+    _fetch(fetch), _executor(executor), _max_batch(std::max(1u,max_batch)),
+    _max_inflight(std::max(1u,max_inflight)), _window(window),
+    _random(std::random_device()())
+{
+}
+
+/**
+ * Destructor. Removes every subscription, and waits for outstanding requests
+ * to finish.
+ */
+subscriber::~subscriber()
+{
+    {
+	std::lock_guard<std::mutex> lock(_mutex);
+	_stopping = true;
+    }
+    _cv.notify_all();
+
+    if (_timer.joinable())
+	_timer.join();
+
+    clear();
+}
+
+/**
+ * Subscribes to a set of symbols. Each symbol is first fetched at a random
+ * time within the interval, then about once per interval thereafter, unless
+ * the subscription is aligned.
+ *
+ * @param symbols The symbols to keep fresh
+ * @param interval How often to fetch each symbol
+ * @param deliver Receives each quote fetched, including failed ones
+ * @param changes_only If true, quotes which have not changed since the last
+ * one delivered for the symbol are not delivered
+ * @param min_tick The smallest price move counted as a change, in units of
+ * 1/SL_PRICE_SCALE. Any move counts if this is 0.
+ * @param aligned If true, every symbol is fetched at once, and again exactly
+ * once per interval
+ * @return The identifier of the new subscription
+ */
+subscriber::id_t subscriber::subscribe(const std::vector<sl_symbol_t>& symbols,
+				       clock::duration interval, deliver_fn deliver,
+				       bool changes_only, int64_t min_tick, bool aligned)
+{
+    if (symbols.empty())
+	throw std::logic_error("A subscription must have at least one symbol");
+    if (interval<=clock::duration::zero())
+	throw std::logic_error("The refresh interval must be positive");
+
+    id_t id;
+    {
+	std::lock_guard<std::mutex> lock(_mutex);
+	start_bare();
+
+	subscription_ptr sub = std::make_shared<subscription>();
+	sub->id = id = _next_id++;
+	sub->symbols = symbols;
+	sub->interval = interval;
+	sub->deliver = deliver;
+	sub->changes_only = changes_only;
+	sub->min_tick = std::max<int64_t>(1,min_tick);
+	sub->aligned = aligned;
+	if (changes_only)
+	    sub->last.resize(symbols.size());
+	_subscriptions[sub->id] = sub;
+
+	const clock::time_point now = clock::now();
+	for ( std::size_t i=0; i<symbols.size(); i++ )
+	    schedule_bare( { now, 0, sub, i },
+			   aligned ? now : now + jitter_bare(interval,true) );
+    }
+    _cv.notify_all();
+
+    return id;
+}
+
+/**
+ * Ends a subscription. Unless called from the subscription's own callback,
+ * this waits for any callback in progress to return, so no callback for the
+ * subscription is running once it returns.
+ *
+ * @warning A callback may end its own subscription, but not another.
+ *
+ * @return false if there is no such subscription
+ */
+bool subscriber::unsubscribe(id_t id)
+{
+    std::unique_lock<std::mutex> lock(_mutex);
+
+    const auto it = _subscriptions.find(id);
+    if (it==_subscriptions.end())
+	return false;
+
+    subscription_ptr sub = it->second;
+    detach_bare(sub);
+
+    if (t_delivering!=sub.get())
+	_cv.wait( lock, [&sub]() { return sub->inflight==0; } );
+
+    return true;
+}
+
+/**
+ * Ends every subscription, and waits for outstanding requests to finish.
+ */
+void subscriber::clear()
+{
+    std::unique_lock<std::mutex> lock(_mutex);
+
+    for ( auto& s : _subscriptions )
+	s.second->active = false;
+    _subscriptions.clear();
+    _heap.clear();
+
+    _cv.wait( lock, [this]() { return _inflight==0; } );
+}
+
+/**
+ * @return The number of active subscriptions
+ */
+std::size_t subscriber::subscriptions() const
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _subscriptions.size();
+}
+
+/**
+ * @return Counters describing the requests made and quotes delivered
+ */
+subscriber::stats_t subscriber::stats() const
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _stats;
+}
+
+/**
+ * Clears the counters
+ */
+void subscriber::reset_stats()
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    _stats = stats_t();
+}
+
+/**
+ * Heap ordering: the entry due last sinks to the bottom
+ */
+bool subscriber::later(const due_entry& a, const due_entry& b)
+{
+    if (a.due != b.due)
+	return a.due > b.due;
+    return a.sequence > b.sequence;
+}
+
+/**
+ * Starts the timer thread, if it is not running. Call with the mutex held.
+ */
+void subscriber::start_bare()
+{
+    if (!_timer.joinable())
+	_timer = std::thread( [this]() { this->run(); } );
+}
+
+/**
+ * The body of the timer thread. Sleeps until the earliest symbol is due (and
+ * a request slot is free), then dispatches everything collected.
+ */
+void subscriber::run()
+{
+    std::unique_lock<std::mutex> lock(_mutex);
+
+    for (;;)
+    {
+	if (_stopping)
+	    return;
+
+	if ( _heap.empty() || (_inflight>=_max_inflight) )
+	{
+	    _cv.wait(lock);
+	    continue;
+	}
+
+	const clock::time_point due = _heap.front().due;
+	if (due > clock::now())
+	{
+	    _cv.wait_until(lock,due);
+	    continue;
+	}
+
+	std::vector<batch> batches;
+	collect_bare(batches);
+
+	lock.unlock();
+	for ( batch& b : batches )
+	{
+	    auto pb = std::make_shared<batch>(std::move(b));
+	    _executor( [this,pb]() { this->perform(pb); } );
+	}
+	lock.lock();
+    }
+}
+
+/**
+ * Takes every symbol due within the coalescing window from the schedule, and
+ * combines them into batches, as far as the free request slots allow. The
+ * symbols taken are rescheduled. Call with the mutex held.
+ */
+void subscriber::collect_bare(std::vector<batch>& batches)
+{
+    const clock::time_point now = clock::now();
+    const clock::time_point horizon = now + _window;
+    std::vector<due_entry> taken;
+
+    while ( !_heap.empty() && (_heap.front().due<=horizon) )
+    {
+	std::pop_heap(_heap.begin(),_heap.end(),later);
+	due_entry e = std::move(_heap.back());
+	_heap.pop_back();
+
+	const sl_symbol_t symbol = e.sub->symbols[e.index];
+
+	// Join the current batch, if the symbol is already in it or it has room
+	std::size_t pos = 0;
+	if (!batches.empty())
+	{
+	    const std::vector<sl_symbol_t>& s = batches.back().symbols;
+	    pos = std::find(s.begin(),s.end(),symbol) - s.begin();
+	}
+
+	if ( batches.empty() || ( (pos==batches.back().symbols.size()) &&
+				  (pos>=_max_batch) ) )
+	{
+	    if (_inflight+batches.size() >= _max_inflight)
+	    {
+		// No free request slot: leave the symbol where it was
+		_heap.push_back(std::move(e));
+		std::push_heap(_heap.begin(),_heap.end(),later);
+		break;
+	    }
+	    batches.push_back(batch());
+	    pos = 0;
+	}
+
+	batch& b = batches.back();
+	if (pos==b.symbols.size())
+	    b.symbols.push_back(symbol);
+	b.targets.push_back( { e.sub, pos, e.index } );
+	e.sub->inflight++;
+
+	taken.push_back(std::move(e));
+    }
+
+    _inflight += batches.size();
+
+    // Reschedule relative to when each symbol was due, so refreshes do not
+    // drift; a symbol which has fallen behind starts a fresh interval
+    for ( due_entry& e : taken )
+    {
+	clock::time_point next = e.due + e.sub->interval;
+	if (!e.sub->aligned)
+	    next += jitter_bare(e.sub->interval,false);
+	if (next<=now)
+	    next = now + e.sub->interval;
+	schedule_bare(std::move(e),next);
+    }
+}
+
+/**
+ * Places an entry on the schedule. Call with the mutex held.
+ */
+void subscriber::schedule_bare(due_entry e, clock::time_point due)
+{
+    e.due = due;
+    e.sequence = _sequence++;
+    _heap.push_back(std::move(e));
+    std::push_heap(_heap.begin(),_heap.end(),later);
+}
+
+/**
+ * Chooses a random offset for a due time. Call with the mutex held.
+ *
+ * @param interval The subscription's interval
+ * @param initial true for a symbol's first fetch, which is spread over the
+ * whole interval; otherwise the offset is within a tenth of the interval
+ */
+subscriber::clock::duration subscriber::jitter_bare(clock::duration interval, bool initial)
+{
+    typedef clock::duration::rep rep;
+
+    const rep span = initial ? interval.count() : interval.count()/10;
+    if (span<=0)
+	return clock::duration::zero();
+
+    std::uniform_int_distribution<rep> d( initial ? 0 : -span, initial ? span-1 : span );
+    return clock::duration(d(_random));
+}
+
+/**
+ * Performs one batched request, and delivers its quotes. Runs on the
+ * executor.
+ */
+void subscriber::perform(const std::shared_ptr<batch>& b)
+{
+    std::vector<sl_quote_t> quotes;
+    try
+    {
+	_fetch(b->symbols,quotes);
+    }
+    catch ( const std::exception& )
+    {
+	quotes.clear();
+    }
+
+    // Anything the fetch did not produce is delivered as a failed quote
+    if (quotes.size()!=b->symbols.size())
+    {
+	quotes.resize(b->symbols.size());
+	for ( std::size_t i=0; i<quotes.size(); i++ )
+	    quotes[i] = sl_quote_t{ 0, 0, b->symbols[i], SLQFNone };
+    }
+
+    uint64_t delivered = 0;
+    uint64_t suppressed = 0;
+    for ( const target& t : b->targets )
+    {
+	subscription& s = *t.sub;
+	std::lock_guard<std::mutex> lock(s.deliver_mutex);
+
+	if ( s.active && s.changes_only && !changed(s,t.index,quotes[t.quote]) )
+	    suppressed++;
+	else if (s.active)
+	{
+	    t_delivering = &s;
+	    try
+	    {
+		s.deliver(quotes[t.quote]);
+	    }
+	    catch ( const std::exception& )
+	    {
+	    }
+	    t_delivering = nullptr;
+	    delivered++;
+	}
+    }
+
+    {
+	std::lock_guard<std::mutex> lock(_mutex);
+	for ( const target& t : b->targets )
+	    t.sub->inflight--;
+	_inflight--;
+
+	_stats.requests++;
+	_stats.symbols += b->symbols.size();
+	_stats.deliveries += delivered;
+	_stats.suppressed += suppressed;
+
+	// Notified under the lock, since once the count reaches zero the
+	// destructor may proceed
+	_cv.notify_all();
+    }
+}
+
+/**
+ * Decides whether a quote differs enough from the last one delivered for the
+ * symbol to be delivered, and if so, records it as the last. Call with the
+ * subscription's deliver_mutex held.
+ *
+ * @param s The subscription, which wants changes only
+ * @param index The position of the symbol in the subscription
+ * @param quote The quote just fetched
+ */
+bool subscriber::changed(subscription& s, std::size_t index, const sl_quote_t& quote)
+{
+    last_value& last = s.last[index];
+    const bool priced = (quote.flags & SLQFPrice);
+
+    if ( last.delivered && (priced == bool(last.flags & SLQFPrice)) )
+    {
+	// Two failures in a row, or a move smaller than the tick
+	if (!priced)
+	    return false;
+
+	const int64_t move = (quote.price > last.price) ? quote.price - last.price
+							: last.price - quote.price;
+	if (move < s.min_tick)
+	    return false;
+    }
+
+    last.price = quote.price;
+    last.flags = quote.flags;
+    last.delivered = true;
+    return true;
+}
+
+/**
+ * Removes a subscription, and its symbols from the schedule. Callbacks which
+ * have not yet started will not be run. Call with the mutex held.
+ */
+void subscriber::detach_bare(const subscription_ptr& sub)
+{
+    sub->active = false;
+    _subscriptions.erase(sub->id);
+
+    _heap.erase( std::remove_if( _heap.begin(), _heap.end(),
+				 [&sub](const due_entry& e) { return e.sub==sub; } ),
+		 _heap.end() );
+    std::make_heap(_heap.begin(),_heap.end(),later);
+}
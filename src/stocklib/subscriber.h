@@ -0,0 +1,209 @@
+/**
+ * @file
+ * Public header for the subscriber class, which keeps sets of ticker symbols
+ * fresh by polling them in batches.
+ */
+
+/*
+The MIT License (MIT)
+
+Copyright (c) 2015 David Bradshaw
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#ifndef SUBSCRIBER_H
+#define SUBSCRIBER_H
+
+#include <vector>
+#include <map>
+#include <memory>
+#include <random>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+#include <stocklib/stocklib.h>
+
+/**
+ * Keeps subscribed symbols fresh by fetching them again at a fixed interval,
+ * and delivers each fetched quote to the subscription's callback.
+ *
+ * Each subscribed symbol has its own due time. The first is spread at random
+ * across the interval, and later ones are jittered by a tenth of the
+ * interval, so that a large subscription does not hit the upstream server all
+ * at once. When the timer thread wakes, it takes every symbol that falls due
+ * within the coalescing window and combines them into requests of up to
+ * max_batch symbols each. Requests are run by an executor, and at most
+ * max_inflight of them are outstanding at once; symbols falling due while
+ * that many are in flight wait their turn.
+ *
+ * Callbacks for one subscription are never run concurrently.
+ *
+ * A subscription may ask to be aligned instead. Its symbols are then all
+ * fetched at once, and again exactly once per interval, so each refresh is
+ * one request (for up to max_batch symbols), at the cost of spreading the
+ * load.
+ *
+ * A subscription may ask for changes only. The last quote delivered for each
+ * of its symbols is then kept, and a fetched quote is only delivered if its
+ * price has moved by at least the minimum tick since, or it has gained or
+ * lost a price.
+ */
+class subscriber
+{
+public:
+
+    typedef std::chrono::steady_clock clock;
+
+    /** Identifies a subscription. Never 0. */
+    typedef uint32_t id_t;
+
+    /**
+     * Fetches a batch of symbols, producing exactly one quote per symbol, in
+     * the same order. Quotes which could not be fetched have no SLQFPrice
+     * flag.
+     */
+    typedef std::function<void(const std::vector<sl_symbol_t>&,
+			       std::vector<sl_quote_t>&)> fetch_fn;
+
+    /** Runs a request (see task::perform_async()) */
+    typedef std::function<void(std::function<void()>)> executor_fn;
+
+    /** Receives each quote fetched for a subscription */
+    typedef std::function<void(const sl_quote_t&)> deliver_fn;
+
+    /** Counters describing the work done */
+    struct stats_t
+    {
+	uint64_t requests{0};		///< Batched requests made
+	uint64_t symbols{0};		///< Symbols fetched by those requests
+	uint64_t deliveries{0};		///< Quotes delivered to callbacks
+	uint64_t suppressed{0};		///< Unchanged quotes not delivered
+    };
+
+    /** @name Lifecycle Management */
+    //@{
+    subscriber(fetch_fn fetch, executor_fn executor, unsigned max_batch=50,
+	       unsigned max_inflight=4,
+	       clock::duration window=std::chrono::milliseconds(100));
+    subscriber( const subscriber& ) = delete;
+    subscriber& operator=( const subscriber& ) = delete;
+    virtual ~subscriber();
+    //@}
+
+    /** @name Public API */
+    ///@{
+    id_t subscribe(const std::vector<sl_symbol_t>& symbols,
+		   clock::duration interval, deliver_fn deliver,
+		   bool changes_only=false, int64_t min_tick=0, bool aligned=false);
+    bool unsubscribe(id_t id);
+    void clear();
+    std::size_t subscriptions() const;
+    stats_t stats() const;
+    void reset_stats();
+    ///@}
+
+protected:
+
+    /** The last quote delivered for a symbol, as far as changes matter */
+    struct last_value
+    {
+	int64_t price{0};
+	uint32_t flags{SLQFNone};
+	bool delivered{false};
+    };
+
+    struct subscription
+    {
+	id_t id;
+	std::vector<sl_symbol_t> symbols;
+	clock::duration interval;
+	deliver_fn deliver;
+	bool changes_only{false};
+	int64_t min_tick{0};
+	bool aligned{false};		///< Refresh every symbol together, without jitter
+	std::vector<last_value> last;	///< By position in symbols; guarded by deliver_mutex
+	std::atomic<bool> active{true};
+	unsigned inflight{0};		///< Requests which will deliver to it
+	std::mutex deliver_mutex;	///< Serializes its callbacks
+    };
+
+    typedef std::shared_ptr<subscription> subscription_ptr;
+
+    /** A symbol of a subscription, and when it is next due */
+    struct due_entry
+    {
+	clock::time_point due;
+	uint64_t sequence;		///< Breaks ties in scheduling order
+	subscription_ptr sub;
+	std::size_t index;		///< Position in sub->symbols
+    };
+
+    /** Where one of a batch's quotes is to be delivered */
+    struct target
+    {
+	subscription_ptr sub;
+	std::size_t quote;		///< Position in the batch's symbols
+	std::size_t index;		///< Position in sub->symbols
+    };
+
+    /** A combined request, and where its quotes are to be delivered */
+    struct batch
+    {
+	std::vector<sl_symbol_t> symbols;
+	std::vector<target> targets;
+    };
+
+    static bool later(const due_entry& a, const due_entry& b);
+    void start_bare();
+    void run();
+    void collect_bare(std::vector<batch>& batches);
+    void schedule_bare(due_entry e, clock::time_point due);
+    clock::duration jitter_bare(clock::duration interval, bool initial);
+    void perform(const std::shared_ptr<batch>& b);
+    static bool changed(subscription& s, std::size_t index, const sl_quote_t& quote);
+    void detach_bare(const subscription_ptr& sub);
+
+private:
+
+    const fetch_fn _fetch;
+    const executor_fn _executor;
+    const unsigned _max_batch;
+    const unsigned _max_inflight;
+    const clock::duration _window;
+
+    std::map<id_t,subscription_ptr> _subscriptions;
+    std::vector<due_entry> _heap;
+    id_t _next_id{1};
+    uint64_t _sequence{0};
+    unsigned _inflight{0};
+    stats_t _stats;
+    std::minstd_rand _random;
+    bool _stopping{false};
+    std::thread _timer;
+    mutable std::mutex _mutex;
+    std::condition_variable _cv;
+};
+
+#endif
@@ -34,8 +34,9 @@ SOFTWARE.
 #ifndef SWEEPUP_H
 #define SWEEPUP_H
 
-#include <list>
+#include <vector>
 #include <functional>
+#include <cstddef>
 
 /** @class sweepup
  * A class which holds a list of objects, and then executes a function
@@ -49,7 +50,9 @@ SOFTWARE.
  * argument to the function.
  *
  * @note A common way to use this class is to create an instance on the stack. When the
- * object goes out of scope, the sweepup action is performed on each listed resource. */
+ * object goes out of scope, the sweepup action is performed on each listed resource. 
+ *
+ * The first few elements are held inline, so typical use allocates no memory. */
 template<class T>
 class sweepup
 {
@@ -85,7 +88,9 @@ class sweepup
      */
     virtual ~sweepup()
 	{
-	    for ( T* el : _list ) 
+	    for ( std::size_t i=0; i<_count && i<inline_capacity; i++ )
+		action(*_inline[i]);
+	    for ( T* el : _overflow ) 
 		action(*el);
 	}
     //@}
@@ -104,13 +109,20 @@ class sweepup
      */
     virtual void add(T& element)
     {
-	_list.push_back(&element);
+	if (_count < inline_capacity)
+	    _inline[_count] = &element;
+	else
+	    _overflow.push_back(&element);
+	_count++;
     }
 
     ///@}
 
  protected:
-    std::list<T*> _list;	        ///< Stores the list of objects
+    static const std::size_t inline_capacity = 4;
+    T* _inline[inline_capacity];	///< Stores the first few objects
+    std::size_t _count{0};		///< The number of objects added
+    std::vector<T*> _overflow;		///< Stores any further objects
     std::function<action_func> action;	///< Stores the action to perform 
 };
 
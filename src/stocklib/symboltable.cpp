@@ -0,0 +1,242 @@
+/**
+ * @file
+ * Implementation of the symboltable class.
+ */
+
+/*
+The MIT License (MIT)
+
+Copyright (c) 2015 David Bradshaw
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include <string.h>
+#include <stdexcept>
+
+#include "symboltable.h"
+
+namespace
+{
+    const unsigned SEGMENT_BITS = 12;
+    const std::size_t SEGMENT_SIZE = 1 << SEGMENT_BITS;
+    const std::size_t MAX_SEGMENTS = 1 << 12;
+    const std::size_t INITIAL_INDEX_CAPACITY = 1024;
+}
+
+const std::size_t symboltable::max_symbols = SEGMENT_SIZE*MAX_SEGMENTS;
+
+symboltable::index::index(std::size_t capacity) :
+    mask(capacity-1), slots(new std::atomic<uint32_t>[capacity])
+{
+    for ( std::size_t i=0; i<capacity; i++ )
+	slots[i].store(0,std::memory_order_relaxed);
+}
+
+symboltable::index::~index()
+{
+    delete [] slots;
+}
+
+/**
+ * @class symboltable
+ *
+ * Names are stored in fixed-size segments which are never moved, so a name
+ * can be read without a lock once its identifier has been published. The hash
+ * index is replaced (never resized in place) when it fills, and replaced
+ * indexes are retired rather than freed, so a reader holding an old index
+ * remains safe. A reader which misses in an index that has since been
+ * replaced simply retries with the new one.
+ */
+
+symboltable::symboltable() :
+    _segments(new std::atomic<std::string*>[MAX_SEGMENTS]),
+    _index(new index(INITIAL_INDEX_CAPACITY))
+{
+    for ( std::size_t i=0; i<MAX_SEGMENTS; i++ )
+	_segments[i].store(nullptr,std::memory_order_relaxed);
+}
+
+symboltable::~symboltable()
+{
+    clear();
+    delete _index.load();
+    delete [] _segments;
+}
+
+/**
+ * Returns the identifier of a symbol, allocating the next identifier if the
+ * symbol has not been seen before.
+ *
+ * @throws std::length_error if the table is full
+ */
+symboltable::id_t symboltable::intern(const char* symbol)
+{
+    id_t id;
+
+    if (find(symbol,id))
+	return id;
+
+    std::lock_guard<std::mutex> lock(_write_mutex);
+
+    // Another thread may have won the race
+    if (find(symbol,id))
+	return id;
+
+    id = _count.load(std::memory_order_relaxed);
+    if (id>=max_symbols)
+	throw std::length_error("Symbol table is full");
+
+    const std::size_t seg = id >> SEGMENT_BITS;
+    if (!_segments[seg].load(std::memory_order_relaxed))
+	_segments[seg].store(new std::string[SEGMENT_SIZE],std::memory_order_release);
+
+    _segments[seg].load(std::memory_order_relaxed)[id & (SEGMENT_SIZE-1)] = symbol;
+
+    // Keep the index at most half full
+    if ( (id+1)*2 > (_index.load(std::memory_order_relaxed)->mask+1) )
+	grow_bare();
+
+    insert_bare(_index.load(std::memory_order_relaxed),id);
+    _count.store(id+1,std::memory_order_release);
+
+    return id;
+}
+
+/**
+ * Looks up a symbol without interning it. Lock-free.
+ *
+ * @param symbol The ticker symbol
+ * @param id Receives the identifier, if found
+ * @return true if the symbol has been interned
+ */
+bool symboltable::find(const char* symbol, id_t& id) const
+{
+    const uint32_t h = hash(symbol);
+
+    for (;;)
+    {
+	const index* ix = _index.load(std::memory_order_acquire);
+
+	for ( uint32_t i = h & ix->mask; ; i = (i+1) & ix->mask )
+	{
+	    const uint32_t slot = ix->slots[i].load(std::memory_order_acquire);
+	    if (!slot)
+		break;
+
+	    if (entry(slot-1)==symbol)
+	    {
+		id = slot-1;
+		return true;
+	    }
+	}
+
+	// A genuine miss, unless the index was replaced while we searched
+	if (_index.load(std::memory_order_acquire)==ix)
+	    return false;
+    }
+}
+
+/**
+ * Returns the symbol for an identifier. Lock-free.
+ *
+ * @return The symbol, or nullptr if the identifier has not been allocated
+ */
+const char* symboltable::name(id_t id) const
+{
+    if (id < _count.load(std::memory_order_acquire))
+	return entry(id).c_str();
+    else
+	return nullptr;
+}
+
+/**
+ * @return The number of interned symbols. Identifiers in the range
+ * [0,size()) are valid.
+ */
+std::size_t symboltable::size() const
+{
+    return _count.load(std::memory_order_acquire);
+}
+
+/**
+ * Forgets all symbols. Previously returned identifiers and names become
+ * invalid.
+ *
+ * @warning Must not be called concurrently with any other member function.
+ */
+void symboltable::clear()
+{
+    std::lock_guard<std::mutex> lock(_write_mutex);
+
+    for ( std::size_t i=0; i<MAX_SEGMENTS; i++ )
+    {
+	delete [] _segments[i].load();
+	_segments[i].store(nullptr);
+    }
+
+    for ( auto ix : _retired )
+	delete ix;
+    _retired.clear();
+
+    delete _index.load();
+    _index.store(new index(INITIAL_INDEX_CAPACITY));
+    _count.store(0);
+}
+
+/**
+ * FNV-1a
+ */
+uint32_t symboltable::hash(const char* symbol)
+{
+    uint32_t h = 2166136261u;
+    for ( ; *symbol; symbol++ )
+    {
+	h ^= (unsigned char)(*symbol);
+	h *= 16777619u;
+    }
+    return h;
+}
+
+const std::string& symboltable::entry(id_t id) const
+{
+    return _segments[id >> SEGMENT_BITS].load(std::memory_order_acquire)[id & (SEGMENT_SIZE-1)];
+}
+
+void symboltable::insert_bare(index* ix, id_t id)
+{
+    uint32_t i = hash(entry(id).c_str()) & ix->mask;
+    while (ix->slots[i].load(std::memory_order_relaxed))
+	i = (i+1) & ix->mask;
+
+    ix->slots[i].store(id+1,std::memory_order_release);
+}
+
+void symboltable::grow_bare()
+{
+    index* old = _index.load(std::memory_order_relaxed);
+    index* ix = new index( 2*(old->mask+1) );
+
+    const id_t count = _count.load(std::memory_order_relaxed);
+    for ( id_t id=0; id<count; id++ )
+	insert_bare(ix,id);
+
+    _index.store(ix,std::memory_order_release);
+    _retired.push_back(old);
+}
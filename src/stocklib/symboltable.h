@@ -0,0 +1,103 @@
+/**
+ * @file
+ * Public header for the symboltable class, which interns ticker symbols as
+ * compact integer identifiers.
+ */
+
+/*
+The MIT License (MIT)
+
+Copyright (c) 2015 David Bradshaw
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#ifndef SYMBOLTABLE_H
+#define SYMBOLTABLE_H
+
+#include <string>
+#include <vector>
+#include <atomic>
+#include <mutex>
+#include <cstdint>
+
+/**
+ * A table which maps ticker symbols to dense integer identifiers, and back.
+ *
+ * Identifiers are allocated sequentially from zero, so they can be used
+ * directly as array indices by per-symbol structures. Once interned, a symbol
+ * keeps its identifier (and its name pointer stays valid) until clear() is
+ * called.
+ *
+ * Lookups (find(), name(), size()) are lock-free, and may run concurrently
+ * with each other and with intern(). Only intern() takes a lock, and only when
+ * the symbol is new.
+ */
+class symboltable
+{
+public:
+
+    typedef uint32_t id_t;
+
+    symboltable();
+    symboltable( const symboltable& ) = delete;
+    symboltable& operator=( const symboltable& ) = delete;
+    virtual ~symboltable();
+
+    id_t intern(const char* symbol);
+    bool find(const char* symbol, id_t& id) const;
+    const char* name(id_t id) const;
+    std::size_t size() const;
+    void clear();
+
+    /** The maximum number of symbols which may be interned */
+    static const std::size_t max_symbols;
+
+protected:
+
+    /**
+     * Open-addressed hash index from symbol to identifier. Each slot holds
+     * an identifier plus one, or zero if empty. An index is never modified
+     * once it is full enough to need replacing; a larger copy is published
+     * instead.
+     */
+    struct index
+    {
+	index(std::size_t capacity);
+	~index();
+
+	const uint32_t mask;
+	std::atomic<uint32_t>* const slots;
+    };
+
+    static uint32_t hash(const char* symbol);
+    const std::string& entry(id_t id) const;
+    void insert_bare(index* ix, id_t id);
+    void grow_bare();
+
+private:
+
+    std::atomic<std::string*>* const _segments;
+    std::atomic<uint32_t> _count{0};
+    std::atomic<index*> _index;
+    std::vector<index*> _retired;
+    std::mutex _write_mutex;
+};
+
+#endif
@@ -142,6 +142,26 @@ public:
 	
     }
 
+    /**
+     * Begins the task, then hands it to an executor to be performed, instead
+     * of starting a thread for it. The executor is called once, and must
+     * arrange for the function it is given to be called exactly once.
+     *
+     * @param f The completion function, as for perform_async()
+     * @param executor The executor, which takes the work to be done
+     */
+    virtual void perform_async(std::function<void()> f,
+			       std::function<void(std::function<void()>)> executor)
+    {
+	std::lock_guard<std::recursive_mutex> guard(_mutex);
+	state.action(TaskAction::Begin);
+
+	executor( [this,f]()
+		  {
+		      this->perform(f);
+		  } );
+    }
+
     virtual WorkResult wait() const
     {
 	state.wait_for_state_entry(TaskState::Finished);
@@ -170,6 +190,25 @@ public:
 	return *_output;
     }
 
+    /**
+     * Returns a reference to the output, without copying it and without
+     * taking a lock. The output is immutable from the moment a successful
+     * result is stored until the task is reset, so the reference may be used
+     * from the completion function onwards.
+     *
+     * If no successful result is available, std::logic_error is thrown.
+     *
+     * @warning The reference is invalidated by reset(), and by destruction or
+     * recycling of the task.
+     */
+    const To& output_ref() const
+    {
+	if ( (this->stored_result()==WorkResult::Success) && _output )
+	    return *_output;
+	else
+	    throw std::logic_error("The task output is not available.");
+    }
+
 private:
 
     virtual void perform(std::function<void()> f) final
@@ -177,8 +216,12 @@ private:
 	bool doCompletion=false;
 	try
 	{
-	    _output = std::unique_ptr<To>(new To((*_problem)() ));
-	    i_worker<To,extype>::set_result(WorkResult::Success);
+	    // Re-use the output object from a previous run, if there is one
+	    if (_output)
+		*_output = (*_problem)();
+	    else
+		_output = std::unique_ptr<To>(new To((*_problem)() ));
+	    i_worker<To,extype>::store_result(WorkResult::Success);
 	    doCompletion=true;
 	}
 	catch ( const extype& e )
@@ -191,13 +234,30 @@ private:
 					    extype("Unexpected exception thrown from problem execution"));
 	}
 
-	if (doCompletion) f();
+	// The result is published only once the completion function has run, so
+	// anyone who sees ready() also sees its effects
+	if (doCompletion)
+	{
+	    f();
+	    i_worker<To,extype>::set_ready();
+	}
+	completed();
 	state.action(TaskAction::Finish);	
 
     }
 
 protected:
 
+    /**
+     * Called by the thread performing the task once the result has been
+     * published, immediately before the task enters the Finished state. No
+     * lock is held. Whatever is done here has finished by the time anyone
+     * waiting for the task sees it finish.
+     */
+    virtual void completed()
+    {
+    }
+
     mutable std::recursive_mutex _mutex;
     std::unique_ptr<problem<Ti,To>>  _problem;
     std::unique_ptr<To> _output = nullptr;
@@ -0,0 +1,1098 @@
+/**
+ * @file
+ * Implementation of the tickarchive and archiveday classes
+ */
+
+/*
+The MIT License (MIT)
+
+Copyright (c) 2015 David Bradshaw
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include <fstream>
+#include <limits>
+#include <map>
+#include <string.h>
+#include <stdio.h>
+#include <time.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "deathrattle.h"
+#include "tickarchive.h"
+
+namespace
+{
+    const char COLUMN_MAGIC[8] = { 'S','T','K','C','O','L','M','N' };
+    const char INDEX_MAGIC[8] = { 'S','T','K','I','N','D','E','X' };
+    const char PACKED_MAGIC[8] = { 'S','T','K','P','A','C','K','D' };
+
+    /** File extensions, by tickarchive::column_t */
+    const char* const EXTENSIONS[3] = { "sym", "ts", "px" };
+
+    /** Element sizes, by tickarchive::column_t */
+    const uint32_t ELEMENT_SIZES[3] = { sizeof(uint32_t), sizeof(int64_t), sizeof(int64_t) };
+
+    const int64_t NO_DAY = std::numeric_limits<int64_t>::min();
+
+    /** One symbol's ticks, gathered for packing */
+    struct series_data
+    {
+	std::vector<int64_t> timestamps;
+	std::vector<int64_t> prices;
+    };
+
+    /**
+     * Writes all of a buffer, retrying after partial writes and interruptions
+     */
+    bool write_all(int fd, const void* data, std::size_t bytes)
+    {
+	const char* p = static_cast<const char*>(data);
+	while (bytes)
+	{
+	    const ssize_t n = ::write(fd,p,bytes);
+	    if (n<0)
+	    {
+		if (errno==EINTR)
+		    continue;
+		return false;
+	    }
+	    p += n;
+	    bytes -= n;
+	}
+	return true;
+    }
+}
+
+/**
+ * The header of a column file. Padded to a cache line, so the column's
+ * elements that follow it are aligned.
+ */
+struct tickarchive::column_header
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t column;		///< A column_t
+    uint32_t element_size;
+    uint32_t reserved0;
+    int64_t day;		///< Days since the Unix epoch
+    uint8_t reserved[32];
+};
+
+/**
+ * The header of a day's index, which is followed by an index_entry for each
+ * symbol quoted that day, in identifier order, and then the postings: the
+ * rows of each symbol in turn, in ascending order.
+ */
+struct tickarchive::index_header
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t entries;
+    uint64_t rows;
+    int64_t day;
+    uint8_t reserved[32];
+};
+
+/**
+ * A symbol's rows in the postings of an index
+ */
+struct tickarchive::index_entry
+{
+    uint32_t symbol;
+    uint32_t count;
+    uint64_t offset;		///< Of the symbol's first row in the postings
+};
+
+/**
+ * The header of a packed day, which is followed by a series_entry for each
+ * symbol quoted that day, in identifier order, then the tickcodec::block
+ * headers of every series in turn, then the blocks' packed data.
+ */
+struct tickarchive::packed_header
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t series;
+    uint64_t rows;
+    int64_t day;
+    uint64_t blocks;
+    int64_t first_timestamp;
+    int64_t last_timestamp;
+    uint64_t data_size;		///< Not counting tickcodec::padding
+};
+
+/**
+ * A symbol's blocks in a packed day
+ */
+struct tickarchive::series_entry
+{
+    uint32_t symbol;
+    uint32_t reserved;
+    uint64_t first_block;
+    uint64_t blocks;
+    uint64_t rows;
+};
+
+const uint32_t tickarchive::version = 1;
+const int64_t tickarchive::day_length = 86400LL*1000000LL;
+
+/**
+ * Constructor
+ *
+ * @param buffer_rows The number of ticks buffered before they are written
+ */
+tickarchive::tickarchive(std::size_t buffer_rows) :
+    _buffer_rows(buffer_rows ? buffer_rows : 1), _day(NO_DAY)
+{
+    static_assert(sizeof(column_header)==64,"tickarchive column header layout");
+    static_assert(sizeof(index_header)==64,"tickarchive index header layout");
+    static_assert(sizeof(index_entry)==16,"tickarchive index entry layout");
+    static_assert(sizeof(packed_header)==64,"tickarchive packed header layout");
+    static_assert(sizeof(series_entry)==32,"tickarchive series entry layout");
+    static_assert(sizeof(tickcodec::block)==48,"tickcodec block layout");
+}
+
+/**
+ * Destructor. Seals the current day.
+ */
+tickarchive::~tickarchive()
+{
+    close();
+}
+
+/**
+ * Opens an archive directory for writing, creating it if need be.
+ *
+ * @param dir The archive directory
+ * @param compress Whether to pack each day as it is sealed
+ * @return true if the archive is ready for appends, or false if it could not
+ *         be created or is open in another writer
+ */
+bool tickarchive::open(const std::string& dir, bool compress)
+{
+    close();
+
+    std::lock_guard<std::mutex> lock(_mutex);
+
+    mkdir(dir.c_str(),0755);
+
+    int lock_fd = ::open((dir+"/lock").c_str(),O_RDWR|O_CREAT|O_CLOEXEC,0644);
+    if (lock_fd<0)
+	return false;
+    if (flock(lock_fd,LOCK_EX|LOCK_NB)!=0)
+    {
+	::close(lock_fd);
+	return false;
+    }
+
+    std::vector<std::string> tickers;
+    int symbols_fd = ::open((dir+"/symbols").c_str(),O_WRONLY|O_APPEND|O_CREAT|O_CLOEXEC,0644);
+    if ( (symbols_fd<0) || !read_symbols(dir,tickers) )
+    {
+	if (symbols_fd>=0)
+	    ::close(symbols_fd);
+	::close(lock_fd);
+	return false;
+    }
+
+    for ( std::size_t i=0; i<tickers.size(); i++ )
+	_ids[tickers[i]] = i;
+
+    _dir = dir;
+    _compress = compress;
+    _lock_fd = lock_fd;
+    _symbols_fd = symbols_fd;
+    _day = NO_DAY;
+    _last_timestamp = std::numeric_limits<int64_t>::min();
+    _open = true;
+    return true;
+}
+
+/**
+ * Writes out buffered ticks, seals the current day and closes the archive
+ */
+void tickarchive::close()
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+
+    _open = false;
+    close_day_bare();
+
+    if (_symbols_fd>=0)
+	::close(_symbols_fd);
+    if (_lock_fd>=0)
+	::close(_lock_fd);
+
+    _symbols_fd = -1;
+    _lock_fd = -1;
+    _ids.clear();
+    _dir.clear();
+}
+
+/**
+ * @return true if the archive is open. Takes no lock, so callers may check
+ *         cheaply before preparing a tick to append.
+ */
+bool tickarchive::is_open() const
+{
+    return _open.load(std::memory_order_relaxed);
+}
+
+/**
+ * Appends a tick. If it falls on a later day than the last, the last day is
+ * sealed first. Does nothing if the archive is not open.
+ *
+ * @param ticker The symbol's ticker
+ * @param timestamp In microseconds since the Unix epoch
+ * @param price In units of 1/SL_PRICE_SCALE
+ */
+void tickarchive::append(const char* ticker, int64_t timestamp, int64_t price)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+
+    if (_lock_fd<0)
+	return;
+
+    timestamp = std::max(timestamp,_last_timestamp);
+    const int64_t d = day(timestamp);
+    if (d!=_day)
+    {
+	close_day_bare();
+	if (!open_day_bare(d))
+	    return;
+
+	// The day may already hold later ticks, from an earlier run
+	timestamp = std::max(timestamp,_last_timestamp);
+    }
+
+    const id_t id = intern_bare(ticker);
+    _symbol_buffer.push_back(id);
+    _timestamp_buffer.push_back(timestamp);
+    _price_buffer.push_back(price);
+    _last_timestamp = timestamp;
+    _appended++;
+
+    if (_symbol_buffer.size()>=_buffer_rows)
+	flush_bare();
+}
+
+/**
+ * Writes buffered ticks to the current day's columns
+ */
+void tickarchive::flush()
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    flush_bare();
+}
+
+/**
+ * @return The number of ticks appended since construction
+ */
+uint64_t tickarchive::appended() const
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _appended;
+}
+
+/**
+ * @return The UTC day, counted from the Unix epoch, of a timestamp
+ */
+int64_t tickarchive::day(int64_t timestamp)
+{
+    return (timestamp>=0) ? timestamp/day_length : -((-timestamp-1)/day_length)-1;
+}
+
+/**
+ * @return The path of one of a day's files, named for its date, as
+ *         dir/YYYYMMDD.extension
+ */
+std::string tickarchive::path(const std::string& dir, int64_t day, const char* extension)
+{
+    const time_t t = static_cast<time_t>(day*86400);
+    struct tm tm;
+    gmtime_r(&t,&tm);
+
+    char date[16];
+    strftime(date,sizeof(date),"%Y%m%d",&tm);
+    return dir + "/" + date + "." + extension;
+}
+
+/**
+ * @return The days present in an archive directory, in order
+ */
+std::vector<int64_t> tickarchive::days(const std::string& dir)
+{
+    std::vector<int64_t> result;
+
+    DIR* d = opendir(dir.c_str());
+    if (!d)
+	return result;
+    deathrattle r( [d]() { closedir(d); } );
+
+    while (struct dirent* e = readdir(d))
+    {
+	struct tm tm;
+	memset(&tm,0,sizeof(tm));
+	const char* end = strptime(e->d_name,"%Y%m%d",&tm);
+	if ( (end!=e->d_name+8) || (strcmp(end,".ts") && strcmp(end,".tkz")) )
+	    continue;
+
+	result.push_back(timegm(&tm)/86400);
+    }
+
+    // A packed day being added to has both
+    std::sort(result.begin(),result.end());
+    result.erase(std::unique(result.begin(),result.end()),result.end());
+    return result;
+}
+
+/**
+ * Reads an archive's symbols file
+ *
+ * @param dir The archive directory
+ * @param tickers Receives the tickers, indexed by archive identifier
+ * @return false if the file exists but could not be read
+ */
+bool tickarchive::read_symbols(const std::string& dir, std::vector<std::string>& tickers)
+{
+    tickers.clear();
+
+    std::ifstream in(dir+"/symbols");
+    if (!in)
+	return (access((dir+"/symbols").c_str(),F_OK)!=0);
+
+    std::string line;
+    while (std::getline(in,line))
+	tickers.push_back(line);
+
+    return !in.bad();
+}
+
+/**
+ * @return The archive identifier of a ticker, recording it in the symbols
+ *         file if it is new
+ */
+tickarchive::id_t tickarchive::intern_bare(const char* ticker)
+{
+    const auto i = _ids.find(ticker);
+    if (i!=_ids.end())
+	return i->second;
+
+    const id_t id = _ids.size();
+    const std::string line = std::string(ticker) + "\n";
+    write_all(_symbols_fd,line.data(),line.size());
+    _ids[ticker] = id;
+    return id;
+}
+
+/**
+ * Opens a day's columns for appending, creating them if need be. A day
+ * whose files are damaged or of another format version is started again,
+ * and one whose columns are of unequal length is cut back to the shortest.
+ * Any index the day has is removed, since it will no longer cover every row.
+ */
+bool tickarchive::open_day_bare(int64_t d)
+{
+    int fds[3] = { -1, -1, -1 };
+    deathrattle r( [&fds]()
+		   {
+		       for ( int fd : fds )
+			   if (fd>=0)
+			       ::close(fd);
+		   } );
+
+    bool valid = true;
+    uint64_t rows = std::numeric_limits<uint64_t>::max();
+
+    for ( int c=0; c<3; c++ )
+    {
+	fds[c] = ::open(path(_dir,d,EXTENSIONS[c]).c_str(),O_RDWR|O_CREAT|O_CLOEXEC,0644);
+	if (fds[c]<0)
+	    return false;
+
+	struct stat st;
+	column_header hdr;
+	if ( (fstat(fds[c],&st)!=0) ||
+	     (st.st_size<(off_t)sizeof(hdr)) ||
+	     (pread(fds[c],&hdr,sizeof(hdr),0)!=(ssize_t)sizeof(hdr)) ||
+	     (memcmp(hdr.magic,COLUMN_MAGIC,sizeof(COLUMN_MAGIC))!=0) ||
+	     (hdr.version!=version) || (hdr.column!=(uint32_t)c) ||
+	     (hdr.element_size!=ELEMENT_SIZES[c]) || (hdr.day!=d) )
+	{
+	    valid = false;
+	    continue;
+	}
+
+	rows = std::min<uint64_t>(rows,(st.st_size-sizeof(hdr))/ELEMENT_SIZES[c]);
+    }
+
+    if (!valid)
+	rows = 0;
+
+    for ( int c=0; c<3; c++ )
+    {
+	if (ftruncate(fds[c],sizeof(column_header)+rows*ELEMENT_SIZES[c])!=0)
+	    return false;
+
+	if (!valid)
+	{
+	    column_header hdr;
+	    memset(&hdr,0,sizeof(hdr));
+	    memcpy(hdr.magic,COLUMN_MAGIC,sizeof(COLUMN_MAGIC));
+	    hdr.version = version;
+	    hdr.column = c;
+	    hdr.element_size = ELEMENT_SIZES[c];
+	    hdr.day = d;
+	    if (pwrite(fds[c],&hdr,sizeof(hdr),0)!=(ssize_t)sizeof(hdr))
+		return false;
+	}
+
+	if (lseek(fds[c],0,SEEK_END)<0)
+	    return false;
+    }
+
+    packedday packed;
+    if (packed.open(_dir,d))
+	_last_timestamp = std::max(_last_timestamp,packed.last_timestamp());
+
+    if (rows)
+    {
+	int64_t last;
+	const off_t offset = sizeof(column_header)+(rows-1)*sizeof(int64_t);
+	if (pread(fds[column_timestamp],&last,sizeof(last),offset)==(ssize_t)sizeof(last))
+	    _last_timestamp = std::max(_last_timestamp,last);
+    }
+
+    unlink(path(_dir,d,"idx").c_str());
+
+    for ( int c=0; c<3; c++ )
+    {
+	_fds[c] = fds[c];
+	fds[c] = -1;
+    }
+    _day = d;
+    return true;
+}
+
+/**
+ * Writes buffered ticks to the current day's columns: timestamps first and
+ * symbols last, so a crash part way leaves the symbol column shortest
+ */
+void tickarchive::flush_bare()
+{
+    if ( _symbol_buffer.empty() || (_fds[0]<0) )
+	return;
+
+    write_all(_fds[column_timestamp],_timestamp_buffer.data(),
+	      _timestamp_buffer.size()*sizeof(int64_t));
+    write_all(_fds[column_price],_price_buffer.data(),
+	      _price_buffer.size()*sizeof(int64_t));
+    write_all(_fds[column_symbol],_symbol_buffer.data(),
+	      _symbol_buffer.size()*sizeof(id_t));
+
+    _symbol_buffer.clear();
+    _timestamp_buffer.clear();
+    _price_buffer.clear();
+}
+
+/**
+ * Writes the current day's index from its symbol column. The index is
+ * written to a temporary file and renamed into place, so readers never see
+ * a partial index.
+ */
+void tickarchive::seal_bare()
+{
+    struct stat st;
+    if (fstat(_fds[column_symbol],&st)!=0)
+	return;
+
+    const std::size_t rows = (st.st_size-sizeof(column_header))/sizeof(id_t);
+    std::vector<id_t> symbols(rows);
+    if ( rows &&
+	 (pread(_fds[column_symbol],symbols.data(),rows*sizeof(id_t),sizeof(column_header))
+	  !=(ssize_t)(rows*sizeof(id_t))) )
+	return;
+
+    std::vector<uint32_t> counts(_ids.size(),0);
+    for ( id_t s : symbols )
+	if (s<counts.size())
+	    counts[s]++;
+
+    std::vector<index_entry> entries;
+    uint64_t offset = 0;
+    for ( id_t s=0; s<counts.size(); s++ )
+	if (counts[s])
+	{
+	    entries.push_back({ s, counts[s], offset });
+	    offset += counts[s];
+	}
+
+    std::vector<uint32_t> postings(offset);
+    std::vector<uint64_t> next(counts.size(),0);
+    for ( const index_entry& e : entries )
+	next[e.symbol] = e.offset;
+    for ( std::size_t i=0; i<rows; i++ )
+	if (symbols[i]<counts.size())
+	    postings[next[symbols[i]]++] = i;
+
+    index_header hdr;
+    memset(&hdr,0,sizeof(hdr));
+    memcpy(hdr.magic,INDEX_MAGIC,sizeof(INDEX_MAGIC));
+    hdr.version = version;
+    hdr.entries = entries.size();
+    hdr.rows = rows;
+    hdr.day = _day;
+
+    const std::string final_path = path(_dir,_day,"idx");
+    const std::string tmp = final_path + ".tmp." + std::to_string(getpid());
+    int fd = ::open(tmp.c_str(),O_WRONLY|O_CREAT|O_TRUNC|O_CLOEXEC,0644);
+    if (fd<0)
+	return;
+
+    const bool written =
+	write_all(fd,&hdr,sizeof(hdr)) &&
+	write_all(fd,entries.data(),entries.size()*sizeof(index_entry)) &&
+	write_all(fd,postings.data(),postings.size()*sizeof(uint32_t));
+    ::close(fd);
+
+    if ( !written || (rename(tmp.c_str(),final_path.c_str())!=0) )
+	unlink(tmp.c_str());
+}
+
+/**
+ * Flushes, seals and closes the current day, if any
+ */
+void tickarchive::close_day_bare()
+{
+    if (_fds[0]<0)
+	return;
+
+    flush_bare();
+    if ( !_compress || !pack(_dir,_day) )
+	seal_bare();
+
+    for ( int& fd : _fds )
+    {
+	::close(fd);
+	fd = -1;
+    }
+    _day = NO_DAY;
+}
+
+/**
+ * Packs a day: its ticks are gathered by symbol and compressed, and written
+ * to a single file, which replaces the day's columns and index. A day which
+ * is already packed but has since been added to is packed again, with the
+ * ticks added after those packed before.
+ *
+ * The packed file is written to a temporary file and renamed into place
+ * before the columns are removed, so the ticks are never absent.
+ *
+ * @param dir The archive directory
+ * @param day The day, counted from the Unix epoch
+ * @return true if the day is packed
+ */
+bool tickarchive::pack(const std::string& dir, int64_t day)
+{
+    std::map<id_t,series_data> all;
+
+    packedday previous;
+    if (previous.open(dir,day))
+	for ( id_t symbol : previous.symbols() )
+	{
+	    series_data& d = all[symbol];
+	    previous.scan(symbol,std::numeric_limits<int64_t>::min(),
+			  std::numeric_limits<int64_t>::max(),
+			  [&d](int64_t t, int64_t p)
+			  {
+			      d.timestamps.push_back(t);
+			      d.prices.push_back(p);
+			  });
+	}
+    previous.close();
+
+    archiveday raw;
+    if (!raw.open(dir,day))
+	return access(path(dir,day,"tkz").c_str(),F_OK)==0;
+
+    for ( std::size_t i=0; i<raw.rows(); i++ )
+    {
+	series_data& d = all[raw.symbols()[i]];
+	d.timestamps.push_back(raw.timestamps()[i]);
+	d.prices.push_back(raw.prices()[i]);
+    }
+    raw.close();
+
+    packed_header hdr;
+    memset(&hdr,0,sizeof(hdr));
+    memcpy(hdr.magic,PACKED_MAGIC,sizeof(PACKED_MAGIC));
+    hdr.version = version;
+    hdr.day = day;
+    hdr.first_timestamp = std::numeric_limits<int64_t>::max();
+    hdr.last_timestamp = std::numeric_limits<int64_t>::min();
+
+    std::vector<series_entry> series;
+    std::vector<tickcodec::block> blocks;
+    std::vector<uint8_t> data;
+
+    for ( const auto& s : all )
+    {
+	const series_data& d = s.second;
+	const std::size_t n = d.timestamps.size();
+	series.push_back({ s.first, 0, blocks.size(), 0, n });
+
+	for ( std::size_t i=0; i<n; i+=tickcodec::block_size )
+	{
+	    tickcodec::block b;
+	    tickcodec::encode(&d.timestamps[i],&d.prices[i],
+			      std::min(tickcodec::block_size,n-i),b,data);
+	    blocks.push_back(b);
+	}
+
+	series.back().blocks = blocks.size()-series.back().first_block;
+	hdr.rows += n;
+	hdr.first_timestamp = std::min(hdr.first_timestamp,d.timestamps.front());
+	hdr.last_timestamp = std::max(hdr.last_timestamp,d.timestamps.back());
+    }
+
+    hdr.series = series.size();
+    hdr.blocks = blocks.size();
+    hdr.data_size = data.size();
+    data.resize(data.size()+tickcodec::padding,0);
+
+    const std::string final_path = path(dir,day,"tkz");
+    const std::string tmp = final_path + ".tmp." + std::to_string(getpid());
+    int fd = ::open(tmp.c_str(),O_WRONLY|O_CREAT|O_TRUNC|O_CLOEXEC,0644);
+    if (fd<0)
+	return false;
+
+    const bool written =
+	write_all(fd,&hdr,sizeof(hdr)) &&
+	write_all(fd,series.data(),series.size()*sizeof(series_entry)) &&
+	write_all(fd,blocks.data(),blocks.size()*sizeof(tickcodec::block)) &&
+	write_all(fd,data.data(),data.size());
+    ::close(fd);
+
+    if ( !written || (rename(tmp.c_str(),final_path.c_str())!=0) )
+    {
+	unlink(tmp.c_str());
+	return false;
+    }
+
+    for ( const char* extension : EXTENSIONS )
+	unlink(path(dir,day,extension).c_str());
+    unlink(path(dir,day,"idx").c_str());
+    return true;
+}
+
+archiveday::archiveday()
+{
+}
+
+archiveday::~archiveday()
+{
+    close();
+}
+
+/**
+ * Maps a day of an archive
+ *
+ * @param dir The archive directory
+ * @param day The day, counted from the Unix epoch (see tickarchive::day())
+ * @return false if the day is not in the archive, or is damaged
+ */
+bool archiveday::open(const std::string& dir, int64_t day)
+{
+    close();
+    _day = day;
+
+    std::size_t rows[3];
+    const void* columns[3];
+    for ( int c=0; c<3; c++ )
+    {
+	columns[c] = map_bare(tickarchive::path(dir,day,EXTENSIONS[c]),c,rows[c]);
+	if (!columns[c])
+	{
+	    close();
+	    return false;
+	}
+    }
+
+    _rows = std::min(rows[0],std::min(rows[1],rows[2]));
+    _symbols = static_cast<const id_t*>(columns[tickarchive::column_symbol]);
+    _timestamps = static_cast<const int64_t*>(columns[tickarchive::column_timestamp]);
+    _prices = static_cast<const int64_t*>(columns[tickarchive::column_price]);
+
+    map_index_bare(tickarchive::path(dir,day,"idx"));
+    return true;
+}
+
+/**
+ * Unmaps the day
+ */
+void archiveday::close()
+{
+    for ( const mapping& m : _mappings )
+	munmap(m.address,m.size);
+    _mappings.clear();
+
+    _rows = 0;
+    _symbols = nullptr;
+    _timestamps = nullptr;
+    _prices = nullptr;
+    _entries = nullptr;
+    _entry_count = 0;
+    _postings = nullptr;
+}
+
+bool archiveday::is_open() const
+{
+    return _timestamps!=nullptr;
+}
+
+/**
+ * @return true if the day has an index covering all of its rows, so that
+ *         symbol scans need not read the symbol column
+ */
+bool archiveday::indexed() const
+{
+    return _postings!=nullptr;
+}
+
+/**
+ * Finds the rows in a time window by binary search of the timestamp column
+ *
+ * @param from The start of the window, inclusive
+ * @param to The end of the window, inclusive
+ */
+archiveday::range archiveday::between(int64_t from, int64_t to) const
+{
+    const int64_t* end = _timestamps+_rows;
+    const int64_t* first = std::lower_bound(_timestamps,end,from);
+    const int64_t* last = (to<from) ? first : std::upper_bound(first,end,to);
+    return { static_cast<std::size_t>(first-_timestamps),
+	     static_cast<std::size_t>(last-_timestamps) };
+}
+
+/**
+ * Finds a symbol's rows in the day's index
+ *
+ * @param symbol The symbol's archive identifier
+ * @param count Receives the number of rows
+ * @return The rows, in ascending order, in the mapped index. NULL if the day
+ *         has no index.
+ */
+const uint32_t* archiveday::postings(id_t symbol, std::size_t& count) const
+{
+    count = 0;
+    if (!indexed())
+	return nullptr;
+
+    const tickarchive::index_entry* end = _entries+_entry_count;
+    const tickarchive::index_entry* e =
+	std::lower_bound(_entries,end,symbol,
+			 [](const tickarchive::index_entry& a, id_t s) { return a.symbol<s; });
+    if ( (e==end) || (e->symbol!=symbol) )
+	return _postings;
+
+    count = e->count;
+    return _postings+e->offset;
+}
+
+/**
+ * Maps a column file, checking its header
+ *
+ * @param rows Receives the number of complete elements in the file
+ * @return The first element, or NULL if the file could not be mapped
+ */
+const void* archiveday::map_bare(const std::string& path, uint32_t column, std::size_t& rows)
+{
+    const int fd = ::open(path.c_str(),O_RDONLY|O_CLOEXEC);
+    if (fd<0)
+	return nullptr;
+    deathrattle r( [fd]() { ::close(fd); } );
+
+    struct stat st;
+    if ( (fstat(fd,&st)!=0) || (st.st_size<(off_t)sizeof(tickarchive::column_header)) )
+	return nullptr;
+
+    void* m = mmap(nullptr,st.st_size,PROT_READ,MAP_SHARED,fd,0);
+    if (m==MAP_FAILED)
+	return nullptr;
+    _mappings.push_back({ m, static_cast<std::size_t>(st.st_size) });
+
+    const tickarchive::column_header* hdr = static_cast<const tickarchive::column_header*>(m);
+    if ( (memcmp(hdr->magic,COLUMN_MAGIC,sizeof(COLUMN_MAGIC))!=0) ||
+	 (hdr->version!=tickarchive::version) || (hdr->column!=column) ||
+	 (hdr->element_size!=ELEMENT_SIZES[column]) || (hdr->day!=_day) )
+	return nullptr;
+
+    rows = (st.st_size-sizeof(*hdr))/hdr->element_size;
+    return hdr+1;
+}
+
+/**
+ * Maps the day's index, if it has one which covers every row
+ */
+void archiveday::map_index_bare(const std::string& path)
+{
+    const int fd = ::open(path.c_str(),O_RDONLY|O_CLOEXEC);
+    if (fd<0)
+	return;
+    deathrattle r( [fd]() { ::close(fd); } );
+
+    struct stat st;
+    if ( (fstat(fd,&st)!=0) || (st.st_size<(off_t)sizeof(tickarchive::index_header)) )
+	return;
+
+    void* m = mmap(nullptr,st.st_size,PROT_READ,MAP_SHARED,fd,0);
+    if (m==MAP_FAILED)
+	return;
+    _mappings.push_back({ m, static_cast<std::size_t>(st.st_size) });
+
+    const tickarchive::index_header* hdr = static_cast<const tickarchive::index_header*>(m);
+    const std::size_t expected = sizeof(*hdr) + hdr->entries*sizeof(tickarchive::index_entry)
+	+ hdr->rows*sizeof(uint32_t);
+    if ( (memcmp(hdr->magic,INDEX_MAGIC,sizeof(INDEX_MAGIC))!=0) ||
+	 (hdr->version!=tickarchive::version) || (hdr->day!=_day) ||
+	 (hdr->rows!=_rows) || (expected!=(std::size_t)st.st_size) )
+	return;
+
+    const tickarchive::index_entry* entries = reinterpret_cast<const tickarchive::index_entry*>(hdr+1);
+    const uint32_t* postings = reinterpret_cast<const uint32_t*>(entries+hdr->entries);
+
+    // Check that the entries are in symbol order, that each one's postings lie
+    // within the index, and that they are ascending rows of the day, so that
+    // lookups and scans cannot stray outside the mappings
+    for ( uint32_t i=0; i<hdr->entries; i++ )
+    {
+	const tickarchive::index_entry& e = entries[i];
+	if ( ( (i>0) && (entries[i-1].symbol>=e.symbol) ) ||
+	     (e.offset>_rows) || (e.count>_rows-e.offset) )
+	    return;
+
+	const uint32_t* p = postings+e.offset;
+	for ( uint32_t j=0; j<e.count; j++ )
+	    if ( (p[j]>=_rows) || ( (j>0) && (p[j-1]>=p[j]) ) )
+		return;
+    }
+
+    _entries = entries;
+    _entry_count = hdr->entries;
+    _postings = postings;
+}
+
+packedday::packedday()
+{
+}
+
+packedday::~packedday()
+{
+    close();
+}
+
+/**
+ * Maps a packed day of an archive
+ *
+ * @param dir The archive directory
+ * @param day The day, counted from the Unix epoch (see tickarchive::day())
+ * @return false if the day is not packed, or is damaged
+ */
+bool packedday::open(const std::string& dir, int64_t day)
+{
+    close();
+    _day = day;
+
+    const int fd = ::open(tickarchive::path(dir,day,"tkz").c_str(),O_RDONLY|O_CLOEXEC);
+    if (fd<0)
+	return false;
+    deathrattle r( [fd]() { ::close(fd); } );
+
+    struct stat st;
+    if ( (fstat(fd,&st)!=0) || (st.st_size<(off_t)sizeof(tickarchive::packed_header)) )
+	return false;
+
+    _map_size = st.st_size;
+    _map = mmap(nullptr,_map_size,PROT_READ,MAP_SHARED,fd,0);
+    if (_map==MAP_FAILED)
+    {
+	_map = nullptr;
+	return false;
+    }
+
+    const tickarchive::packed_header* hdr = static_cast<const tickarchive::packed_header*>(_map);
+    const std::size_t expected = sizeof(*hdr) + hdr->series*sizeof(tickarchive::series_entry)
+	+ hdr->blocks*sizeof(tickcodec::block) + hdr->data_size + tickcodec::padding;
+    if ( (memcmp(hdr->magic,PACKED_MAGIC,sizeof(PACKED_MAGIC))!=0) ||
+	 (hdr->version!=tickarchive::version) || (hdr->day!=day) ||
+	 (expected!=_map_size) )
+    {
+	close();
+	return false;
+    }
+
+    _header = hdr;
+    _series = reinterpret_cast<const tickarchive::series_entry*>(hdr+1);
+    _blocks = reinterpret_cast<const tickcodec::block*>(_series+hdr->series);
+    _data = reinterpret_cast<const uint8_t*>(_blocks+hdr->blocks);
+
+    // Check that every block lies within the data, so decoding cannot
+    // stray outside the mapping
+    for ( uint64_t i=0; i<hdr->blocks; i++ )
+	if ( (_blocks[i].count==0) || (_blocks[i].count>tickcodec::block_size) ||
+	     (_blocks[i].timestamp_bits>64) || (_blocks[i].price_bits>64) ||
+	     (_blocks[i].offset+tickcodec::encoded_size(_blocks[i])>hdr->data_size) )
+	{
+	    close();
+	    return false;
+	}
+    for ( uint32_t i=0; i<hdr->series; i++ )
+	if (_series[i].first_block+_series[i].blocks>hdr->blocks)
+	{
+	    close();
+	    return false;
+	}
+
+    return true;
+}
+
+/**
+ * Unmaps the day
+ */
+void packedday::close()
+{
+    if (_map)
+	munmap(_map,_map_size);
+
+    _map = nullptr;
+    _map_size = 0;
+    _header = nullptr;
+    _series = nullptr;
+    _blocks = nullptr;
+    _data = nullptr;
+}
+
+bool packedday::is_open() const
+{
+    return _header!=nullptr;
+}
+
+/**
+ * @return The number of ticks in the day
+ */
+std::size_t packedday::rows() const
+{
+    return _header ? _header->rows : 0;
+}
+
+/**
+ * @return The latest timestamp in the day
+ */
+int64_t packedday::last_timestamp() const
+{
+    return _header ? _header->last_timestamp : std::numeric_limits<int64_t>::min();
+}
+
+/**
+ * @return The archive identifiers of the symbols quoted in the day, in order
+ */
+std::vector<packedday::id_t> packedday::symbols() const
+{
+    std::vector<id_t> result;
+    for ( uint32_t i=0; _header && i<_header->series; i++ )
+	result.push_back(_series[i].symbol);
+    return result;
+}
+
+/**
+ * Decodes the ticks of a symbol in a time window into program-owned arrays.
+ * If the window holds more than max ticks, the earliest max are copied.
+ *
+ * @return The number of ticks copied
+ */
+std::size_t packedday::copy(id_t symbol, int64_t from, int64_t to,
+			    int64_t* timestamps, int64_t* prices, std::size_t max) const
+{
+    const tickcodec::block* first;
+    const tickcodec::block* last;
+    blocks(symbol,from,to,first,last);
+
+    int64_t ts[tickcodec::block_size];
+    int64_t px[tickcodec::block_size];
+    std::size_t copied = 0;
+
+    for ( const tickcodec::block* b=first; (b!=last) && (copied<max); ++b )
+    {
+	// Whole blocks inside the window decode straight into the output
+	if ( (b->first_timestamp>=from) && (b->last_timestamp<=to) && (max-copied>=b->count) )
+	{
+	    tickcodec::decode(*b,_data,timestamps+copied,prices+copied);
+	    copied += b->count;
+	    continue;
+	}
+
+	tickcodec::decode(*b,_data,ts,px);
+	for ( std::size_t i=0; (i<b->count) && (copied<max); i++ )
+	    if ( (ts[i]>=from) && (ts[i]<=to) )
+	    {
+		timestamps[copied] = ts[i];
+		prices[copied] = px[i];
+		copied++;
+	    }
+    }
+
+    return copied;
+}
+
+/**
+ * Finds the blocks of a symbol which overlap a time window, by binary search
+ * of the block headers
+ *
+ * @param first Receives the first block
+ * @param last Receives the block after the last
+ */
+void packedday::blocks(id_t symbol, int64_t from, int64_t to,
+		       const tickcodec::block*& first, const tickcodec::block*& last) const
+{
+    first = last = _blocks;
+    if (!_header)
+	return;
+
+    const tickarchive::series_entry* end = _series+_header->series;
+    const tickarchive::series_entry* s =
+	std::lower_bound(_series,end,symbol,
+			 [](const tickarchive::series_entry& e, id_t id) { return e.symbol<id; });
+    if ( (s==end) || (s->symbol!=symbol) || (to<from) )
+	return;
+
+    const tickcodec::block* begin = _blocks+s->first_block;
+    const tickcodec::block* finish = begin+s->blocks;
+    first = std::lower_bound(begin,finish,from,
+			     [](const tickcodec::block& b, int64_t t) { return b.last_timestamp<t; });
+    last = std::upper_bound(first,finish,to,
+			    [](int64_t t, const tickcodec::block& b) { return t<b.first_timestamp; });
+}
@@ -0,0 +1,354 @@
+/**
+ * @file
+ * Public header for the tickarchive class, which appends ticks to a columnar
+ * on-disk archive, and the archiveday and packedday classes, which map one
+ * day of it for reading, as written or once packed.
+ */
+
+/*
+The MIT License (MIT)
+
+Copyright (c) 2015 David Bradshaw
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#ifndef TICKARCHIVE_H
+#define TICKARCHIVE_H
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <mutex>
+#include <atomic>
+#include <algorithm>
+#include <cstdint>
+#include <cstddef>
+
+#include "tickcodec.h"
+
+/** @class tickarchive
+ * Appends ticks to an archive directory, one set of files per UTC day. Each
+ * day has a column file for each of symbol, timestamp and price, so that a
+ * scan over one column reads nothing else, and an index written when the day
+ * is sealed: on rolling over to the next day, or on close().
+ *
+ * Symbols are stored as archive identifiers, which are line numbers in the
+ * directory's symbols file and stay the same from one run to the next.
+ *
+ * Within a day, timestamps never decrease: a tick stamped before the last
+ * one appended is stored with the last one's timestamp. Appends are buffered,
+ * and reach the files when the buffer fills, on flush() and on close(). The
+ * columns of a day left unequal by a crash are cut back to the shortest when
+ * the day is next written.
+ *
+ * An archive opened with compression packs each day when it is sealed: the
+ * columns and index are replaced by a single file in which each symbol's
+ * ticks are stored together, compressed in blocks by tickcodec, behind a
+ * block index (see packedday). pack() does the same for a day sealed
+ * without compression.
+ *
+ * Only one writer may have a directory open at a time; open() fails if
+ * another process holds it. All methods are thread-safe.
+ */
+class tickarchive
+{
+public:
+
+    typedef uint32_t id_t;
+
+    /** The columns of a day */
+    enum column_t
+    {
+	column_symbol=0,
+	column_timestamp=1,
+	column_price=2
+    };
+
+    /** @name Lifecycle Management */
+    //@{
+    explicit tickarchive(std::size_t buffer_rows=4096);
+    tickarchive( const tickarchive& ) = delete;
+    tickarchive& operator=( const tickarchive& ) = delete;
+    virtual ~tickarchive();
+    //@}
+
+    /** @name Public API */
+    ///@{
+    bool open(const std::string& dir, bool compress=false);
+    void close();
+    bool is_open() const;
+    void append(const char* ticker, int64_t timestamp, int64_t price);
+    void flush();
+    uint64_t appended() const;
+    ///@}
+
+    static const uint32_t version;	///< Current file format version
+    static const int64_t day_length;	///< Microseconds in a day
+
+    static int64_t day(int64_t timestamp);
+    static std::string path(const std::string& dir, int64_t day, const char* extension);
+    static std::vector<int64_t> days(const std::string& dir);
+    static bool read_symbols(const std::string& dir, std::vector<std::string>& tickers);
+    static bool pack(const std::string& dir, int64_t day);
+
+    struct column_header;
+    struct index_header;
+    struct index_entry;
+    struct packed_header;
+    struct series_entry;
+
+protected:
+
+    id_t intern_bare(const char* ticker);
+    bool open_day_bare(int64_t day);
+    void flush_bare();
+    void seal_bare();
+    void close_day_bare();
+
+private:
+
+    const std::size_t _buffer_rows;
+    std::string _dir;
+    bool _compress{false};
+    int _lock_fd{-1};
+    int _symbols_fd{-1};
+    std::unordered_map<std::string,id_t> _ids;
+
+    int64_t _day{0};
+    int _fds[3]{-1,-1,-1};		///< By column_t
+    int64_t _last_timestamp{0};
+    std::vector<id_t> _symbol_buffer;
+    std::vector<int64_t> _timestamp_buffer;
+    std::vector<int64_t> _price_buffer;
+    uint64_t _appended{0};
+    std::atomic<bool> _open{false};	///< Read without the lock by is_open()
+    mutable std::mutex _mutex;
+};
+
+/** @class archiveday
+ * One day of a tick archive, memory-mapped read-only. The columns are used in
+ * place: opening a day costs three mmap() calls and header checks, and scans
+ * read the mapped pages directly, with no copying or decoding.
+ *
+ * Rows are in time order, so a time range is found by binary search. A
+ * symbol's rows are found from the day's index if the day has been sealed,
+ * or otherwise by scanning the symbol column.
+ *
+ * Rows appended after the day is opened are not seen.
+ */
+class archiveday
+{
+public:
+
+    typedef tickarchive::id_t id_t;
+
+    /** A range of rows, [first,last) */
+    struct range
+    {
+	std::size_t first;
+	std::size_t last;
+    };
+
+    /** @name Lifecycle Management */
+    //@{
+    archiveday();
+    archiveday( const archiveday& ) = delete;
+    archiveday& operator=( const archiveday& ) = delete;
+    virtual ~archiveday();
+    //@}
+
+    /** @name Public API */
+    ///@{
+    bool open(const std::string& dir, int64_t day);
+    void close();
+    bool is_open() const;
+    bool indexed() const;
+
+    /** @return The number of rows in the day */
+    std::size_t rows() const { return _rows; }
+
+    /** @return The symbol column, one identifier per row */
+    const id_t* symbols() const { return _symbols; }
+
+    /** @return The timestamp column, in non-decreasing order */
+    const int64_t* timestamps() const { return _timestamps; }
+
+    /** @return The price column, in units of 1/SL_PRICE_SCALE */
+    const int64_t* prices() const { return _prices; }
+
+    range between(int64_t from, int64_t to) const;
+    const uint32_t* postings(id_t symbol, std::size_t& count) const;
+
+    template<class F>
+    std::size_t scan(id_t symbol, int64_t from, int64_t to, F f) const;
+    ///@}
+
+protected:
+
+    const void* map_bare(const std::string& path, uint32_t column, std::size_t& rows);
+    void map_index_bare(const std::string& path);
+
+private:
+
+    struct mapping
+    {
+	void* address;
+	std::size_t size;
+    };
+
+    int64_t _day{0};
+    std::vector<mapping> _mappings;
+    std::size_t _rows{0};
+    const id_t* _symbols{nullptr};
+    const int64_t* _timestamps{nullptr};
+    const int64_t* _prices{nullptr};
+    const tickarchive::index_entry* _entries{nullptr};
+    std::size_t _entry_count{0};
+    const uint32_t* _postings{nullptr};
+};
+
+/** @class packedday
+ * One packed day of a tick archive, memory-mapped read-only. Each symbol's
+ * ticks are stored together, in blocks compressed by tickcodec. The block
+ * headers carry each block's first and last timestamps, so a time range
+ * is found by binary search of a symbol's blocks, and only the blocks
+ * overlapping it are decoded.
+ */
+class packedday
+{
+public:
+
+    typedef tickarchive::id_t id_t;
+
+    /** @name Lifecycle Management */
+    //@{
+    packedday();
+    packedday( const packedday& ) = delete;
+    packedday& operator=( const packedday& ) = delete;
+    virtual ~packedday();
+    //@}
+
+    /** @name Public API */
+    ///@{
+    bool open(const std::string& dir, int64_t day);
+    void close();
+    bool is_open() const;
+    std::size_t rows() const;
+    int64_t last_timestamp() const;
+    std::vector<id_t> symbols() const;
+    std::size_t copy(id_t symbol, int64_t from, int64_t to,
+		     int64_t* timestamps, int64_t* prices, std::size_t max) const;
+
+    template<class F>
+    std::size_t scan(id_t symbol, int64_t from, int64_t to, F f) const;
+    ///@}
+
+protected:
+
+    void blocks(id_t symbol, int64_t from, int64_t to,
+		const tickcodec::block*& first, const tickcodec::block*& last) const;
+
+private:
+
+    int64_t _day{0};
+    void* _map{nullptr};
+    std::size_t _map_size{0};
+    const tickarchive::packed_header* _header{nullptr};
+    const tickarchive::series_entry* _series{nullptr};
+    const tickcodec::block* _blocks{nullptr};
+    const uint8_t* _data{nullptr};
+};
+
+/**
+ * Calls f(timestamp,price) for each tick of a symbol in a time window, in
+ * time order, reading the mapped columns in place.
+ *
+ * @param symbol The symbol's archive identifier
+ * @param from The start of the window, inclusive
+ * @param to The end of the window, inclusive
+ * @param f The function to call
+ * @return The number of ticks visited
+ */
+template<class F>
+std::size_t archiveday::scan(id_t symbol, int64_t from, int64_t to, F f) const
+{
+    const range r = between(from,to);
+    std::size_t visited = 0;
+
+    if (indexed())
+    {
+	std::size_t count;
+	const uint32_t* rows = postings(symbol,count);
+	for ( const uint32_t* p = std::lower_bound(rows,rows+count,r.first);
+	      (p!=rows+count) && (*p<r.last); ++p )
+	{
+	    f(_timestamps[*p],_prices[*p]);
+	    visited++;
+	}
+    }
+    else
+    {
+	for ( std::size_t i=r.first; i<r.last; i++ )
+	    if (_symbols[i]==symbol)
+	    {
+		f(_timestamps[i],_prices[i]);
+		visited++;
+	    }
+    }
+
+    return visited;
+}
+
+/**
+ * Calls f(timestamp,price) for each tick of a symbol in a time window, in
+ * time order, decoding only the blocks which overlap the window.
+ *
+ * @param symbol The symbol's archive identifier
+ * @param from The start of the window, inclusive
+ * @param to The end of the window, inclusive
+ * @param f The function to call
+ * @return The number of ticks visited
+ */
+template<class F>
+std::size_t packedday::scan(id_t symbol, int64_t from, int64_t to, F f) const
+{
+    const tickcodec::block* first;
+    const tickcodec::block* last;
+    blocks(symbol,from,to,first,last);
+
+    int64_t timestamps[tickcodec::block_size];
+    int64_t prices[tickcodec::block_size];
+    std::size_t visited = 0;
+
+    for ( const tickcodec::block* b=first; b!=last; ++b )
+    {
+	tickcodec::decode(*b,_data,timestamps,prices);
+	for ( std::size_t i=0; i<b->count; i++ )
+	    if ( (timestamps[i]>=from) && (timestamps[i]<=to) )
+	    {
+		f(timestamps[i],prices[i]);
+		visited++;
+	    }
+    }
+
+    return visited;
+}
+
+#endif
@@ -0,0 +1,244 @@
+/**
+ * @file
+ * Implementation of the tickcodec class
+ */
+
+/*
+The MIT License (MIT)
+
+Copyright (c) 2015 David Bradshaw
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include <string.h>
+
+#include "tickcodec.h"
+
+namespace
+{
+    inline uint64_t zigzag(int64_t v)
+    {
+	return (static_cast<uint64_t>(v) << 1) ^ static_cast<uint64_t>(v >> 63);
+    }
+
+    inline int64_t unzigzag(uint64_t u)
+    {
+	return static_cast<int64_t>( (u >> 1) ^ (0-(u & 1)) );
+    }
+
+    /** @return The number of bits needed to hold v */
+    inline unsigned width(uint64_t v)
+    {
+	return v ? 64-__builtin_clzll(v) : 0;
+    }
+
+    inline uint64_t load64(const uint8_t* p)
+    {
+	uint64_t v;
+	memcpy(&v,p,sizeof(v));
+	return v;
+    }
+}
+
+const std::size_t tickcodec::block_size;
+const std::size_t tickcodec::padding;
+
+/**
+ * Encodes a block of ticks. Any timestamps may be encoded, but only those
+ * close to evenly spaced encode compactly.
+ *
+ * @param timestamps The ticks' timestamps
+ * @param prices The ticks' prices
+ * @param count The number of ticks, from 1 to block_size
+ * @param b Receives the block's header
+ * @param data The data area, to which the block's packed data is appended
+ */
+void tickcodec::encode(const int64_t* timestamps, const int64_t* prices, std::size_t count,
+		       block& b, std::vector<uint8_t>& data)
+{
+    memset(&b,0,sizeof(b));
+    b.first_timestamp = timestamps[0];
+    b.last_timestamp = timestamps[count-1];
+    b.first_delta = (count>1) ? int64_t(uint64_t(timestamps[1])-uint64_t(timestamps[0])) : 0;
+    b.first_price = prices[0];
+    b.offset = data.size();
+    b.count = count;
+
+    // Zeroed, as with two ticks or fewer no timestamp deltas are written
+    uint64_t values[block_size] = {};
+
+    uint64_t all = 0;
+    for ( std::size_t i=2; i<count; i++ )
+    {
+	// In unsigned arithmetic, which wraps rather than overflows
+	const uint64_t delta = uint64_t(timestamps[i]) - uint64_t(timestamps[i-1]);
+	const uint64_t previous = uint64_t(timestamps[i-1]) - uint64_t(timestamps[i-2]);
+	values[i-2] = zigzag( static_cast<int64_t>(delta-previous) );
+	all |= values[i-2];
+    }
+    b.timestamp_bits = width(all);
+    pack(values, (count>2) ? count-2 : 0, b.timestamp_bits, data);
+
+    all = 0;
+    for ( std::size_t i=1; i<count; i++ )
+    {
+	values[i-1] = static_cast<uint64_t>(prices[i] ^ prices[i-1]);
+	all |= values[i-1];
+    }
+    b.price_shift = all ? __builtin_ctzll(all) : 0;
+    b.price_bits = width(all >> b.price_shift);
+    for ( std::size_t i=1; i<count; i++ )
+	values[i-1] >>= b.price_shift;
+    pack(values, count-1, b.price_bits, data);
+}
+
+/**
+ * Decodes a block of ticks
+ *
+ * @param b The block's header
+ * @param data The start of the data area. At least padding bytes must be
+ *        readable after the block's packed data.
+ * @param timestamps Receives b.count timestamps
+ * @param prices Receives b.count prices
+ */
+void tickcodec::decode(const block& b, const uint8_t* data,
+		       int64_t* timestamps, int64_t* prices)
+{
+    const std::size_t count = b.count;
+    const std::size_t dods = (count>2) ? count-2 : 0;
+    const uint8_t* p = data + b.offset;
+    uint64_t values[block_size];
+
+    unpack(p,dods,b.timestamp_bits,values);
+    uint64_t timestamp = b.first_timestamp;
+    uint64_t delta = b.first_delta;
+    timestamps[0] = b.first_timestamp;
+    if (count>1)
+    {
+	timestamp += delta;
+	timestamps[1] = timestamp;
+    }
+    for ( std::size_t i=2; i<count; i++ )
+    {
+	delta += unzigzag(values[i-2]);
+	timestamp += delta;
+	timestamps[i] = timestamp;
+    }
+    p += packed_size(dods,b.timestamp_bits);
+
+    unpack(p,count-1,b.price_bits,values);
+    int64_t price = b.first_price;
+    prices[0] = price;
+    for ( std::size_t i=1; i<count; i++ )
+    {
+	price ^= static_cast<int64_t>(values[i-1] << b.price_shift);
+	prices[i] = price;
+    }
+}
+
+/**
+ * @return The number of bytes of packed data of a block
+ */
+std::size_t tickcodec::encoded_size(const block& b)
+{
+    const std::size_t count = b.count;
+    return packed_size( (count>2) ? count-2 : 0, b.timestamp_bits ) +
+	packed_size( count-1, b.price_bits );
+}
+
+/**
+ * @return The bytes taken by count values packed at a width, rounded up to
+ *         whole words
+ */
+std::size_t tickcodec::packed_size(std::size_t count, unsigned bits)
+{
+    return ((count*bits + 63) / 64) * 8;
+}
+
+/**
+ * Appends values to the data area, packed at a width, in little-endian words
+ */
+void tickcodec::pack(const uint64_t* values, std::size_t count, unsigned bits,
+		     std::vector<uint8_t>& data)
+{
+    const std::size_t start = data.size();
+    data.resize( start + packed_size(count,bits) );
+    if (bits==0)
+	return;
+
+    uint8_t* out = &data[start];
+    uint64_t word = 0;
+    unsigned used = 0;
+    for ( std::size_t i=0; i<count; i++ )
+    {
+	word |= values[i] << used;
+	if ( used+bits >= 64 )
+	{
+	    memcpy(out,&word,sizeof(word));
+	    out += sizeof(word);
+	    word = used ? values[i] >> (64-used) : 0;
+	    used = used+bits-64;
+	}
+	else
+	    used += bits;
+    }
+    if (used)
+	memcpy(out,&word,sizeof(word));
+}
+
+/**
+ * Unpacks values packed by pack(). Each value is one unaligned load, shift
+ * and mask, with no dependence on the value before, so the loop is free of
+ * branches and vectorizes. Values wider than 56 bits may straddle more than
+ * eight bytes, and are put together from two words.
+ */
+void tickcodec::unpack(const uint8_t* data, std::size_t count, unsigned bits,
+		       uint64_t* values)
+{
+    if (bits==0)
+    {
+	for ( std::size_t i=0; i<count; i++ )
+	    values[i] = 0;
+	return;
+    }
+
+    const uint64_t mask = (bits==64) ? ~0ULL : (1ULL<<bits)-1;
+
+    if (bits<=56)
+    {
+	for ( std::size_t i=0; i<count; i++ )
+	{
+	    const std::size_t bit = i*bits;
+	    values[i] = (load64(data + (bit>>3)) >> (bit & 7)) & mask;
+	}
+	return;
+    }
+
+    for ( std::size_t i=0; i<count; i++ )
+    {
+	const std::size_t bit = i*bits;
+	const unsigned shift = bit & 63;
+	const uint8_t* word = data + (bit>>6)*8;
+	uint64_t v = load64(word) >> shift;
+	if (shift)
+	    v |= load64(word+8) << (64-shift);
+	values[i] = v & mask;
+    }
+}
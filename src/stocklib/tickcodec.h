@@ -0,0 +1,105 @@
+/**
+ * @file
+ * Public header for the tickcodec class, which compresses blocks of ticks.
+ */
+
+/*
+The MIT License (MIT)
+
+Copyright (c) 2015 David Bradshaw
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#ifndef TICKCODEC_H
+#define TICKCODEC_H
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+/** @class tickcodec
+ * Compresses a symbol's ticks in blocks of up to block_size, after the
+ * Gorilla time series encoding, but laid out so that a block decodes with
+ * straight-line loops rather than a bit-at-a-time parse:
+ *
+ *  - Timestamps are stored as delta-of-deltas. Polling at a steady interval
+ *    makes these zero, or small with jitter. They are zigzag encoded, so
+ *    small negatives are small too, and bit-packed at the width of the
+ *    largest in the block.
+ *  - Prices are stored as the XOR of each with the one before. Fixed-point
+ *    prices that move a few ticks differ only in their low bits, and prices
+ *    quoted to whole cents share trailing zero bits too. The XORs are
+ *    shifted right by the trailing zeros they all share, and bit-packed at
+ *    the width of the largest.
+ *
+ * Choosing the width once per block, rather than per value as a varint or
+ * Gorilla's control bits do, is what lets the decoder unpack every value with
+ * the same load, shift and mask.
+ *
+ * A block's header (see block) holds its first timestamp and price, so it
+ * decodes without reference to any other, and its first and last timestamps,
+ * so a reader can find the blocks of a time range without decoding any.
+ */
+class tickcodec
+{
+public:
+
+    /** The most ticks in a block */
+    static const std::size_t block_size = 256;
+
+    /** Padding needed after the last block, as decoding reads whole words */
+    static const std::size_t padding = 16;
+
+    /** The header of an encoded block */
+    struct block
+    {
+	int64_t first_timestamp;
+	int64_t last_timestamp;
+	int64_t first_delta;		///< Between the first two timestamps
+	int64_t first_price;
+	uint64_t offset;		///< Of the packed data, from the start of the data area
+	uint16_t count;			///< Ticks in the block
+	uint8_t timestamp_bits;		///< Width of each delta-of-delta
+	uint8_t price_bits;		///< Width of each shifted XOR
+	uint8_t price_shift;		///< Trailing zero bits shared by the XORs
+	uint8_t reserved[3];
+    };
+
+    tickcodec() = delete;
+
+    /** @name Public API */
+    ///@{
+    static void encode(const int64_t* timestamps, const int64_t* prices, std::size_t count,
+		       block& b, std::vector<uint8_t>& data);
+    static void decode(const block& b, const uint8_t* data,
+		       int64_t* timestamps, int64_t* prices);
+    static std::size_t encoded_size(const block& b);
+    ///@}
+
+protected:
+
+    static void pack(const uint64_t* values, std::size_t count, unsigned bits,
+		     std::vector<uint8_t>& data);
+    static void unpack(const uint8_t* data, std::size_t count, unsigned bits,
+		       uint64_t* values);
+    static std::size_t packed_size(std::size_t count, unsigned bits);
+};
+
+#endif
@@ -28,25 +28,65 @@ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
 SOFTWARE.
 */
 
-#include <regex>
 #include <functional>
+#include <vector>
 #include <map>
+#include <mutex>
+#include <strings.h>
 #include <jansson.h>
 #include "buffer.h"
+#include "arena.h"
 #include "sweepup.h"
 #include "deathrattle.h"
 #include "tickerproblem.h"
 
 using std::string;
-using std::regex;
 using std::function;
 using std::map;
+using std::vector;
 
+namespace
+{
+    std::once_flag g_json_alloc_once;
+}
+
+/**
+ * Constructor
+ */
 tickerproblem::tickerproblem(const std::string& ticker, sl_test_behavior_t b ) :
     urlproblem(_url_template), _behavior(b), _ticker(ticker)
 {
 }
 
+/**
+ * Routes jansson's allocations through the request arena (see urlproblem),
+ * so decoding a response, by a tickerproblem or a batchproblem, costs no
+ * system allocations once the arena has warmed up. Outside a decode, jansson
+ * falls back to malloc() and free().
+ *
+ * The hooks are process-wide, and scoped_free() can only free memory from
+ * scoped_malloc(), so this is done once, by stocklib_init(). Any jansson
+ * object created before then must have been freed by then.
+ */
+void tickerproblem::route_json_allocations()
+{
+    std::call_once( g_json_alloc_once, []()
+		    {
+			json_set_alloc_funcs( &arena::scoped_malloc, &arena::scoped_free );
+		    } );
+}
+
+/**
+ * Points the problem at a different ticker symbol, so that the object can be
+ * re-used for another request. Must not be called while the problem is being
+ * solved.
+ */
+void tickerproblem::retarget(const std::string& ticker, sl_test_behavior_t b)
+{
+    _ticker.assign(ticker);
+    _behavior = b;
+}
+
 void tickerproblem::fetch(buffer& b, const std::string& url)
 {
     static const char trm = '\0';
@@ -130,16 +170,232 @@ map<string,string> tickerproblem::decode_response(const std::string& response)
 
 std::string tickerproblem::preprocess_url(const std::string& url)
 {
-    /* Format the URL */
-    regex stock_exp("\\{STOCK\\}"); 
-    auto formattedUrl = std::regex_replace(url, stock_exp, _ticker, 
-					   std::regex_constants::format_first_only);
+    /* Format the URL, substituting the first {STOCK} placeholder */
+    static const string placeholder("{STOCK}");
+
+    string formattedUrl(url);
+    const auto pos = formattedUrl.find(placeholder);
+    if (pos != string::npos)
+	formattedUrl.replace(pos, placeholder.length(), _ticker);
+
+    return formattedUrl;
+}
+
+/**
+ * @class batchproblem
+ * A urlproblem which fetches the latest prices and names of many ticker
+ * symbols in a single request. The output holds, for each symbol found, its
+ * price under price_key() and its name under name_key(); symbols the server
+ * did not return are simply absent.
+ */
+
+/**
+ * Constructor
+ *
+ * @param tickers The ticker symbols to fetch
+ * @param b The behavior in test mode
+ */
+batchproblem::batchproblem(const vector<string>& tickers, sl_test_behavior_t b) :
+    urlproblem(_url_template), _behavior(b), _tickers(tickers)
+{
+}
+
+/**
+ * Points the problem at a different set of ticker symbols, so that the object
+ * can be re-used for another request. Must not be called while the problem is
+ * being solved.
+ */
+void batchproblem::retarget(const vector<string>& tickers, sl_test_behavior_t b)
+{
+    _tickers.assign(tickers.begin(),tickers.end());
+    _behavior = b;
+}
+
+/**
+ * @return The output key holding the price of a ticker symbol
+ */
+string batchproblem::price_key(const string& ticker)
+{
+    return "response." + ticker;
+}
+
+/**
+ * @return The output key holding the company name of a ticker symbol
+ */
+string batchproblem::name_key(const string& ticker)
+{
+    return "companyname." + ticker;
+}
+
+void batchproblem::fetch(buffer& b, const std::string& url)
+{
+    static const char trm = '\0';
+
+    switch (_behavior)
+    {
+
+    case SLTBNormalRequest:
+    {
+	/* One fake quote per symbol, as the server would return them */
+	string response("{\"query\":{\"count\":");
+	response += std::to_string(_tickers.size());
+	response += ",\"results\":{\"quote\":[";
+	for ( std::size_t i=0; i<_tickers.size(); i++ )
+	{
+	    if (i)
+		response += ",";
+	    response += "{\"Symbol\":\"" + _tickers[i] +
+		"\",\"LastTradePriceOnly\":\"99.99\",\"Name\":\"Test Inc.\"}";
+	}
+	response += "]}}}";
+
+	b.append(response.c_str(), response.length());
+	b.append(&trm,1);
+	break;
+    }
+
+    case SLTBGibberishRequest:
+    {
+	static const string notfound("{\"query\":{\"count\":0,\"results\":null}}");
+	b.append(notfound.c_str(), notfound.length());
+	b.append(&trm,1);
+	break;
+    }
+
+    case SLTBNone:
+    default:
+	urlproblem::fetch(b,url);
+    }
+}
+
+/**
+ * Decodes the response. The server returns a single quote as an object, and
+ * several as an array. Quotes are matched to the requested symbols by their
+ * Symbol field, ignoring case.
+ *
+ * @throws std::logic_error if the response cannot be parsed at all
+ */
+map<string,string> batchproblem::decode_response(const std::string& response)
+{
+    map<string,string> d;
+
+    /* Ensures all memory is freed correctly, even if an exception is thrown */
+    sweepup<json_t*> trash( [](json_t* obj) { json_decref(obj); }  );
+
+    json_error_t error;
+    json_t* root = json_loads(response.c_str(), 0, &error );
+    if (!root)
+	throw std::logic_error("The batch response could not be parsed");
+    trash.add(root);
+
+    auto query = json_object_get(root,"query");
+    auto results = (query && json_is_object(query)) ? json_object_get(query,"results") : nullptr;
+    auto quotes = (results && json_is_object(results)) ? json_object_get(results,"quote") : nullptr;
+    if (!quotes)
+	return d;
+
+    const size_t count = json_is_array(quotes) ? json_array_size(quotes) : 1;
+    for ( size_t i=0; i<count; i++ )
+    {
+	auto quote = json_is_array(quotes) ? json_array_get(quotes,i) : quotes;
+	if ( !quote || !json_is_object(quote) )
+	    continue;
+
+	/* Find which of the requested tickers this quote is for */
+	auto symbol = json_object_get(quote,"Symbol");
+	const string* ticker = nullptr;
+	if ( symbol && json_is_string(symbol) )
+	{
+	    for ( const string& t : _tickers )
+		if ( strcasecmp(t.c_str(),json_string_value(symbol))==0 )
+		    ticker = &t;
+	}
+	else if (_tickers.size()==1)
+	    ticker = &_tickers.front();
+
+	if (!ticker)
+	    continue;
+
+	auto cname = json_object_get(quote,"Name");
+	if ( cname && json_is_string(cname) )
+	    d[name_key(*ticker)] = json_string_value(cname);
+
+	auto bid = json_object_get(quote,"LastTradePriceOnly");
+	if ( bid && json_is_string(bid) )
+	    d[price_key(*ticker)] = json_string_value(bid);
+    }
+
+    return d;
+}
+
+/**
+ * Substitutes the list of requested symbols into the URL
+ */
+std::string batchproblem::preprocess_url(const std::string& url)
+{
+    static const string placeholder("{STOCKS}");
+
+    string symbols;
+    for ( const string& t : _tickers )
+    {
+	if (!symbols.empty())
+	    symbols += ",";
+	symbols += "%22" + t + "%22";
+    }
+
+    string formattedUrl(url);
+    const auto pos = formattedUrl.find(placeholder);
+    if (pos != string::npos)
+	formattedUrl.replace(pos, placeholder.length(), symbols);
 
     return formattedUrl;
 }
 
+/**
+ * @class tickertask
+ * A urltask which fetches the latest price of a single ticker symbol, and
+ * which can be recycled and re-targeted at another symbol instead of being
+ * deleted.
+ */
+
+tickertask::tickertask(const std::string& ticker, sl_test_behavior_t b) :
+    urltask( new tickerproblem(ticker,b) ),
+    _ticker_problem( static_cast<tickerproblem*>(_problem.get()) )
+{
+}
+
+/**
+ * Returns the object to the NotPerformed state, ready for re-use. If the task
+ * has been run, this blocks until the thread performing it is done with it:
+ * the completion callback runs before the task enters the Finished state, and
+ * the reset cannot take the state machine's lock until that transition has
+ * completed. Any completion callback is removed. This must not be called from
+ * the task's own completion callback, nor with the library lock held, as the
+ * callback may be waiting for that lock.
+ */
+void tickertask::recycle()
+{
+    const TaskState s = state.wait_for_any_state( { TaskState::NotPerformed,
+						    TaskState::Finished } );
+    if (s==TaskState::Finished)
+	reset();
+
+    clear_completion_callback();
+    _ticker_problem->release_arena();
+}
+
+/**
+ * Points a recycled task at another ticker symbol.
+ */
+void tickertask::retarget(const std::string& ticker, sl_test_behavior_t b)
+{
+    _ticker_problem->retarget(ticker,b);
+}
+
 const std::string tickerproblem::_url_template = "https://query.yahooapis.com/v1/public/yql?q=select%20Name,LastTradePriceOnly%20from%20yahoo.finance.quotes%20where%20symbol%20%3D%22{STOCK}%22&format=json&env=store%3A%2F%2Fdatatables.org%2Falltableswithkeys&callback=";
 
+const std::string batchproblem::_url_template = "https://query.yahooapis.com/v1/public/yql?q=select%20Symbol,Name,LastTradePriceOnly%20from%20yahoo.finance.quotes%20where%20symbol%20in%20({STOCKS})&format=json&env=store%3A%2F%2Fdatatables.org%2Falltableswithkeys&callback=";
+
 const std::string tickerproblem::_notfound_response = 
     "{\"query\":{\"count\":0,\"created\":\"2015-03-06T11:53:00Z\", \
     \"lang\":\"en-US\",\"results\":null}}";
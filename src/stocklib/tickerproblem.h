@@ -32,6 +32,7 @@ SOFTWARE.
 #define TICKERPROBLEM_H
 
 #include <string>
+#include <vector>
 #include <map>
 #include <functional>
 
@@ -43,6 +44,10 @@ class tickerproblem : public urlproblem
 public:
     tickerproblem( const std::string&, sl_test_behavior_t);
 
+    void retarget( const std::string&, sl_test_behavior_t);
+
+    static void route_json_allocations();
+
 protected:
 
     virtual std::map<std::string,std::string> decode_response(const std::string&);
@@ -50,11 +55,49 @@ protected:
     virtual void fetch(buffer&, const std::string&);
 private:
 
-    const sl_test_behavior_t _behavior;
+    sl_test_behavior_t _behavior;
     static const std::string _url_template;
     static const std::string _notfound_response;
     static const std::string _fake_response;
-    const std::string _ticker;
+    std::string _ticker;
+};
+
+class batchproblem : public urlproblem
+{
+public:
+    batchproblem( const std::vector<std::string>&, sl_test_behavior_t);
+
+    void retarget( const std::vector<std::string>&, sl_test_behavior_t);
+
+    static std::string price_key(const std::string&);
+    static std::string name_key(const std::string&);
+
+protected:
+
+    virtual std::map<std::string,std::string> decode_response(const std::string&);
+    virtual std::string preprocess_url(const std::string&);
+    virtual void fetch(buffer&, const std::string&);
+private:
+
+    sl_test_behavior_t _behavior;
+    static const std::string _url_template;
+    std::vector<std::string> _tickers;
+};
+
+class tickertask : public urltask
+{
+public:
+    tickertask( const std::string&, sl_test_behavior_t);
+
+    tickertask( tickertask&& ) = delete;
+    tickertask( const tickertask& ) = delete;
+
+    void recycle();
+    void retarget( const std::string&, sl_test_behavior_t);
+
+private:
+
+    tickerproblem* const _ticker_problem;
 };
 
 #endif
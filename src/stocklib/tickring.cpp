@@ -0,0 +1,402 @@
+/**
+ * @file
+ * Implementation of the tickring and tickhistory classes.
+ */
+
+/*
+The MIT License (MIT)
+
+Copyright (c) 2015 David Bradshaw
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include <new>
+#include <limits>
+#include <algorithm>
+#include <stdexcept>
+#include <stdlib.h>
+
+#include "tickring.h"
+
+namespace
+{
+    /**
+     * Allocates memory aligned to a cache line
+     */
+    void* aligned_alloc64(std::size_t bytes)
+    {
+	void* p = nullptr;
+	if ( posix_memalign(&p,64,bytes) != 0 )
+	    throw std::bad_alloc();
+	return p;
+    }
+
+    /**
+     * @return The smallest power of two no less than n (and at least 2)
+     */
+    std::size_t round_up(std::size_t n)
+    {
+	std::size_t r = 2;
+	while (r<n)
+	    r <<= 1;
+	return r;
+    }
+}
+
+/**
+ * Constructor. One slot is always reserved for the writer, so the capacity is
+ * rounded up to leave room for at least the number of ticks requested.
+ *
+ * @param capacity The number of recent ticks to keep
+ */
+tickring::tickring(std::size_t capacity) :
+    _capacity(round_up(capacity+1)), _mask(_capacity-1),
+    _timestamps( static_cast<int64_t*>(aligned_alloc64(_capacity*sizeof(int64_t))) ),
+    _prices( static_cast<int64_t*>(aligned_alloc64(_capacity*sizeof(int64_t))) ),
+    _last_timestamp( std::numeric_limits<int64_t>::min() )
+{
+}
+
+/**
+ * Destructor. There must be no readers.
+ */
+tickring::~tickring()
+{
+    free(_timestamps);
+    free(_prices);
+}
+
+/**
+ * Appends a tick, overwriting the oldest if the ring is full. Safe to call
+ * from several threads, although a ring normally has one writer.
+ *
+ * @return false if the tick was older than the latest, and so ignored
+ */
+bool tickring::push(int64_t timestamp, int64_t price)
+{
+    std::lock_guard<std::mutex> lock(_write_mutex);
+
+    if (timestamp<_last_timestamp)
+	return false;
+    _last_timestamp = timestamp;
+
+    const uint64_t h = _head.load(std::memory_order_relaxed);
+
+    // Readers that see the new contents of the slot also see a head of at
+    // least h, and so know the tick it held before (h-_capacity) is gone
+    std::atomic_thread_fence(std::memory_order_release);
+    __atomic_store_n(&_timestamps[h & _mask], timestamp, __ATOMIC_RELAXED);
+    __atomic_store_n(&_prices[h & _mask], price, __ATOMIC_RELAXED);
+
+    _head.store(h+1,std::memory_order_release);
+    return true;
+}
+
+/**
+ * Finds the ticks with timestamps in [from,to]. The spans refer directly into
+ * the ring, and may be overwritten by the writer while being read; check
+ * valid() after reading them, and discard what was read if it fails.
+ */
+tickring::view tickring::window(int64_t from, int64_t to) const
+{
+    const uint64_t head = _head.load(std::memory_order_acquire);
+    const uint64_t lo = oldest_readable(head);
+
+    const uint64_t begin = lower_bound(lo,head,from);
+    const uint64_t end = (to==std::numeric_limits<int64_t>::max()) ? head
+	: lower_bound(begin,head,to+1);
+
+    view v;
+    v.first = begin;
+    v.parts[0] = span{ nullptr, nullptr, 0 };
+    v.parts[1] = span{ nullptr, nullptr, 0 };
+
+    if (end>begin)
+    {
+	const std::size_t start = begin & _mask;
+	const std::size_t count = end - begin;
+	const std::size_t first = std::min<std::size_t>(count,_capacity-start);
+
+	v.parts[0] = span{ _timestamps+start, _prices+start, first };
+	if (count>first)
+	    v.parts[1] = span{ _timestamps, _prices, count-first };
+    }
+
+    return v;
+}
+
+/**
+ * @return true if none of the ticks in the view has been overwritten since
+ * the view was taken. Call after reading the view.
+ */
+bool tickring::valid(const view& v) const
+{
+    std::atomic_thread_fence(std::memory_order_acquire);
+    const uint64_t head = _head.load(std::memory_order_relaxed);
+    return (v.count()==0) || (v.first>=oldest_readable(head));
+}
+
+/**
+ * Copies the ticks with timestamps in [from,to] into contiguous arrays,
+ * oldest first. If there are more than max, the most recent max are copied.
+ *
+ * @return The number of ticks copied
+ */
+std::size_t tickring::copy(int64_t from, int64_t to, int64_t* timestamps,
+			   int64_t* prices, std::size_t max) const
+{
+    for (;;)
+    {
+	const view v = window(from,to);
+
+	std::size_t skip = (v.count()>max) ? v.count()-max : 0;
+	std::size_t n = 0;
+	for ( const span& s : v.parts )
+	{
+	    for ( std::size_t i=0; i<s.count; i++ )
+	    {
+		if (skip)
+		{
+		    skip--;
+		    continue;
+		}
+		timestamps[n] = __atomic_load_n(&s.timestamps[i], __ATOMIC_RELAXED);
+		prices[n] = __atomic_load_n(&s.prices[i], __ATOMIC_RELAXED);
+		n++;
+	    }
+	}
+
+	if (valid(v))
+	    return n;
+    }
+}
+
+/**
+ * Reads the most recent tick.
+ *
+ * @return false if the ring is empty
+ */
+bool tickring::latest(int64_t& timestamp, int64_t& price) const
+{
+    for (;;)
+    {
+	const uint64_t head = _head.load(std::memory_order_acquire);
+	if (head==0)
+	    return false;
+
+	timestamp = load(_timestamps,head-1);
+	price = load(_prices,head-1);
+
+	std::atomic_thread_fence(std::memory_order_acquire);
+	if ( head-1 >= oldest_readable(_head.load(std::memory_order_relaxed)) )
+	    return true;
+    }
+}
+
+/**
+ * @return The greatest number of ticks the ring can hold
+ */
+std::size_t tickring::capacity() const
+{
+    return _capacity-1;
+}
+
+/**
+ * @return The number of ticks ever pushed
+ */
+uint64_t tickring::pushed() const
+{
+    return _head.load(std::memory_order_acquire);
+}
+
+/**
+ * @return The sequence number of the oldest tick that cannot be in the
+ * process of being overwritten, given the head. The writer may be filling
+ * the slot of sequence number head, which held head-_capacity.
+ */
+uint64_t tickring::oldest_readable(uint64_t head) const
+{
+    return (head>=_capacity) ? head-_capacity+1 : 0;
+}
+
+/**
+ * @return The first sequence number in [lo,hi) whose timestamp is not less
+ * than the one given, or hi if there is none
+ */
+uint64_t tickring::lower_bound(uint64_t lo, uint64_t hi, int64_t timestamp) const
+{
+    while (lo<hi)
+    {
+	const uint64_t mid = lo + (hi-lo)/2;
+	if (load(_timestamps,mid)<timestamp)
+	    lo = mid+1;
+	else
+	    hi = mid;
+    }
+    return lo;
+}
+
+/**
+ * @return The element of an array for a sequence number
+ */
+int64_t tickring::load(const int64_t* array, uint64_t sequence) const
+{
+    return __atomic_load_n(&array[sequence & _mask], __ATOMIC_RELAXED);
+}
+
+/**
+ * @class tickhistory
+ * Rings are never removed while the library runs, so a pointer returned by
+ * find() remains valid until clear() is called.
+ */
+
+/**
+ * Constructor
+ *
+ * @param capacity The number of ticks kept for each symbol
+ */
+tickhistory::tickhistory(std::size_t capacity) :
+    _segments(new std::atomic<std::atomic<tickring*>*>[max_segments]),
+    _capacity(capacity)
+{
+    for ( std::size_t i=0; i<max_segments; i++ )
+	_segments[i].store(nullptr,std::memory_order_relaxed);
+}
+
+tickhistory::~tickhistory()
+{
+    clear();
+    delete [] _segments;
+}
+
+/**
+ * Records a tick for a symbol, creating its ring if this is its first.
+ */
+void tickhistory::record(id_t symbol, int64_t timestamp, int64_t price)
+{
+    if ( (symbol >> segment_bits) >= max_segments )
+	throw std::length_error("tick history identifier out of range");
+
+    tickring* ring = const_cast<tickring*>(find(symbol));
+    if (!ring)
+    {
+	std::lock_guard<std::mutex> lock(_create_mutex);
+
+	std::atomic<std::atomic<tickring*>*>& seg = _segments[symbol >> segment_bits];
+	if (!seg.load())
+	{
+	    std::atomic<tickring*>* fresh = new std::atomic<tickring*>[segment_size];
+	    for ( std::size_t i=0; i<segment_size; i++ )
+		fresh[i].store(nullptr,std::memory_order_relaxed);
+	    seg.store(fresh);
+	}
+
+	std::atomic<tickring*>& slot = seg.load()[symbol & (segment_size-1)];
+	ring = slot.load();
+	if (!ring)
+	{
+	    ring = create(_capacity.load());
+	    slot.store(ring);
+	    _symbols++;
+	}
+    }
+
+    ring->push(timestamp,price);
+}
+
+/**
+ * @return The ring of a symbol, or nullptr if it has no ticks. Takes no lock.
+ */
+const tickring* tickhistory::find(id_t symbol) const
+{
+    if ( (symbol >> segment_bits) >= max_segments )
+	return nullptr;
+
+    std::atomic<tickring*>* seg = _segments[symbol >> segment_bits].load();
+    return seg ? seg[symbol & (segment_size-1)].load() : nullptr;
+}
+
+/**
+ * Sets the number of ticks kept for each symbol. Rings which already exist
+ * keep their capacity.
+ */
+void tickhistory::configure(std::size_t capacity)
+{
+    _capacity = capacity;
+}
+
+/**
+ * @return The number of symbols with a ring
+ */
+std::size_t tickhistory::symbols() const
+{
+    return _symbols.load();
+}
+
+/**
+ * Discards every ring.
+ *
+ * @warning There must be no concurrent readers or writers, and any pointer
+ * obtained from find() is invalidated.
+ */
+void tickhistory::clear()
+{
+    std::lock_guard<std::mutex> lock(_create_mutex);
+
+    for ( std::size_t i=0; i<max_segments; i++ )
+    {
+	std::atomic<tickring*>* seg = _segments[i].exchange(nullptr);
+	if (!seg)
+	    continue;
+
+	for ( std::size_t j=0; j<segment_size; j++ )
+	    if (tickring* ring = seg[j].load())
+		destroy(ring);
+	delete [] seg;
+    }
+
+    _symbols = 0;
+}
+
+/**
+ * Creates a ring in cache-line aligned memory
+ */
+tickring* tickhistory::create(std::size_t capacity)
+{
+    void* p = aligned_alloc64(sizeof(tickring));
+    try
+    {
+	return new (p) tickring(capacity);
+    }
+    catch (...)
+    {
+	free(p);
+	throw;
+    }
+}
+
+/**
+ * Destroys a ring made by create()
+ */
+void tickhistory::destroy(tickring* ring)
+{
+    ring->~tickring();
+    free(ring);
+}
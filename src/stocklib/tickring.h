@@ -0,0 +1,167 @@
+/**
+ * @file
+ * Public header for the tickring class, a fixed-capacity history of recent
+ * quotes for one symbol, and the tickhistory class, which keeps one per
+ * symbol.
+ */
+
+/*
+The MIT License (MIT)
+
+Copyright (c) 2015 David Bradshaw
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#ifndef TICKRING_H
+#define TICKRING_H
+
+#include <atomic>
+#include <mutex>
+#include <cstdint>
+#include <cstddef>
+
+/** @class tickring
+ * A ring buffer holding the most recent ticks (timestamp and price pairs) of
+ * one symbol, in structure-of-arrays layout: timestamps and prices are kept
+ * in separate cache-line aligned arrays, so a scan over either is a
+ * contiguous, vectorizable loop.
+ *
+ * Ticks are appended by push(), which is serialized by a mutex that readers
+ * never touch. Readers take no lock. They ask for a view of a time window,
+ * which refers directly into the arrays as at most two contiguous spans
+ * (two when the window wraps around the end of the ring), and then check
+ * with valid() that the writer has not overwritten any of it in the
+ * meantime. copy() does both, retrying until it has a consistent copy.
+ *
+ * Timestamps must be pushed in non-decreasing order; an older tick than the
+ * latest is ignored.
+ *
+ * The class is cache-line aligned, and its writer's state kept on a line of
+ * its own, so rings of different symbols never share a line, and readers of
+ * a ring do not contend with its writer except on the head counter.
+ */
+class tickring
+{
+public:
+
+    /** A contiguous run of ticks, oldest first */
+    struct span
+    {
+	const int64_t* timestamps;
+	const int64_t* prices;
+	std::size_t count;
+    };
+
+    /** The ticks of a time window, as seen by a reader */
+    struct view
+    {
+	span parts[2];		///< parts[1] is empty unless the window wraps
+	uint64_t first;		///< Sequence number of the first tick
+
+	/** @return The number of ticks in the view */
+	std::size_t count() const { return parts[0].count + parts[1].count; }
+    };
+
+    /** @name Lifecycle Management */
+    //@{
+    explicit tickring(std::size_t capacity);
+    tickring( const tickring& ) = delete;
+    tickring& operator=( const tickring& ) = delete;
+    virtual ~tickring();
+    //@}
+
+    /** @name Public API */
+    ///@{
+    bool push(int64_t timestamp, int64_t price);
+    view window(int64_t from, int64_t to) const;
+    bool valid(const view& v) const;
+    std::size_t copy(int64_t from, int64_t to, int64_t* timestamps,
+		     int64_t* prices, std::size_t max) const;
+    bool latest(int64_t& timestamp, int64_t& price) const;
+    std::size_t capacity() const;
+    uint64_t pushed() const;
+    ///@}
+
+protected:
+
+    uint64_t oldest_readable(uint64_t head) const;
+    uint64_t lower_bound(uint64_t lo, uint64_t hi, int64_t timestamp) const;
+    int64_t load(const int64_t* array, uint64_t sequence) const;
+
+private:
+
+    /* Read-only after construction, and shared freely between cores */
+    const std::size_t _capacity;	///< A power of two
+    const uint64_t _mask;
+    int64_t* const _timestamps;
+    int64_t* const _prices;
+
+    /* Written by the writer on every push, so kept to a line of its own */
+    alignas(64) std::atomic<uint64_t> _head{0};	///< Sequence number of the next tick
+    int64_t _last_timestamp;
+    std::mutex _write_mutex;
+};
+
+/** @class tickhistory
+ * Keeps a tickring for each symbol that has been quoted, indexed by symbol
+ * identifier. Finding a symbol's ring takes no lock. Rings are created on
+ * their first tick, with the capacity configured at the time.
+ */
+class tickhistory
+{
+public:
+
+    typedef uint32_t id_t;
+
+    /** @name Lifecycle Management */
+    //@{
+    explicit tickhistory(std::size_t capacity=256);
+    tickhistory( const tickhistory& ) = delete;
+    tickhistory& operator=( const tickhistory& ) = delete;
+    virtual ~tickhistory();
+    //@}
+
+    /** @name Public API */
+    ///@{
+    void record(id_t symbol, int64_t timestamp, int64_t price);
+    const tickring* find(id_t symbol) const;
+    void configure(std::size_t capacity);
+    std::size_t symbols() const;
+    void clear();
+    ///@}
+
+protected:
+
+    static const unsigned segment_bits = 12;
+    static const std::size_t segment_size = 1 << segment_bits;
+    static const std::size_t max_segments = 1 << 12;
+
+    static tickring* create(std::size_t capacity);
+    static void destroy(tickring* ring);
+
+private:
+
+    std::atomic<std::atomic<tickring*>*>* const _segments;
+    std::atomic<std::size_t> _capacity;
+    std::atomic<std::size_t> _symbols{0};
+    std::mutex _create_mutex;
+};
+
+#endif
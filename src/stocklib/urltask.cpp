@@ -30,6 +30,7 @@ SOFTWARE.
 #include <regex>
 #include <functional>
 #include <map>
+#include <mutex>
 #include <curl/curl.h>
 #include "buffer.h"
 #include "sweepup.h"
@@ -42,6 +43,30 @@ using std::regex;
 using std::function;
 using std::map;
 
+namespace
+{
+    /**
+     * The curl handle of the current thread. Keeping one handle per thread
+     * lets curl re-use its connections (and TLS sessions) across requests.
+     */
+    struct curl_handle
+    {
+	CURL* handle{nullptr};
+
+	~curl_handle()
+	{
+	    if (handle)
+		curl_easy_cleanup(handle);
+	}
+    };
+
+    thread_local curl_handle t_curl;
+
+    /* Replaces the scheme, host and port of every URL fetched, if not empty */
+    std::mutex g_endpoint_mutex;
+    string g_endpoint;
+}
+
 /**
  * @class urlproblem
  * Implementation of a contained problem which fetches a URL from a remote
@@ -53,6 +78,13 @@ using std::map;
  * The class also has provision for modifying the URL before execution, and
  * decoding the response. See preprocess_url() and decode_response()
  * accordingly.
+ *
+ * Each request records when it passed through each stage, and curl's
+ * breakdown of the transfer, in request_timings().
+ *
+ * Short-lived allocations made while serving a request (the receive buffer,
+ * and anything allocated through arena::scoped_malloc() while decoding) come
+ * from a per-problem arena, which is released in one step.
  */
 
 /**
@@ -78,22 +110,103 @@ urlproblem::urlproblem(const std::string& url) :
  */
 map<string,string> urlproblem::do_work(string url)
 {
-    /* Allocate a buffer to receive the response */
-    buffer rxbuffer(1024);
+    release_arena();
+    const string response = fetch_response(url);
+
+    /* Decode the response, with scoped allocations served by the arena */
+    arena::scope scope(_arena);
+    map<string,string> decoded = decode_response(response);
+    _timings.decoded = timings::clock::now();
+    return decoded;
+}
+
+/**
+ * Frees everything allocated for the current request in one step. The arena
+ * keeps its memory for the next request. Called at the start of each request,
+ * and when the task is recycled.
+ */
+void urlproblem::release_arena()
+{
+    _arena.release();
+}
+
+/**
+ * @return The arena serving this problem's requests, for inspection
+ */
+const arena& urlproblem::request_arena() const
+{
+    return _arena;
+}
+
+/**
+ * @return The timings of the latest request. Whoever submits the request
+ * sets the submitted and completed times; the problem sets the rest.
+ */
+urlproblem::timings& urlproblem::request_timings()
+{
+    return _timings;
+}
+
+/**
+ * @return The timings of the latest request
+ */
+const urlproblem::timings& urlproblem::request_timings() const
+{
+    return _timings;
+}
+
+/**
+ * Sends every request made from now on to another server, such as a local
+ * stand-in for benchmarking. The scheme, host and port of each URL are
+ * replaced by the endpoint; its path and query are kept.
+ *
+ * @param endpoint A URL such as http://127.0.0.1:8080, or an empty string to
+ * use the real server again
+ */
+void urlproblem::set_endpoint(const string& endpoint)
+{
+    std::lock_guard<std::mutex> lock(g_endpoint_mutex);
+    g_endpoint = endpoint;
+    while ( !g_endpoint.empty() && (g_endpoint.back()=='/') )
+	g_endpoint.pop_back();
+}
+
+/**
+ * @return The URL, re-aimed at the endpoint given to set_endpoint(), if any
+ */
+string urlproblem::apply_endpoint(const string& url)
+{
+    std::lock_guard<std::mutex> lock(g_endpoint_mutex);
+    if (g_endpoint.empty())
+	return url;
+
+    const auto scheme = url.find("://");
+    const auto path = url.find('/', (scheme==string::npos) ? 0 : scheme+3);
+    return g_endpoint + ( (path==string::npos) ? string() : url.substr(path) );
+}
+
+string urlproblem::fetch_response(const string& url)
+{
+    _timings.started = timings::clock::now();
+    _timings.dns = _timings.connect = _timings.tls = _timings.ttfb = _timings.transfer = 0;
+
+    /* Allocate a buffer to receive the response, from the request arena. It
+       grows as needed, as a batch response can run to many kilobytes */
+    buffer rxbuffer(1024,_arena,true);
 
     /* Preprocess the URL */
-    string processedUrl = preprocess_url(url);
+    string processedUrl = apply_endpoint(preprocess_url(url));
 
     /* Execute the request */
     fetch(rxbuffer,processedUrl);
 
-    /* Decode and return the response */
-    return decode_response(rxbuffer.contents());
+    _timings.fetched = timings::clock::now();
+    return rxbuffer.contents();
 }
 
 void urlproblem::fetch(buffer& b, const std::string& url)
 {
-    perform_query(b,url);
+    perform_query(b,url,_timings);
 }
 
 string urlproblem::preprocess_url(const string& url)
@@ -108,11 +221,17 @@ map<string,string> urlproblem::decode_response(const string& response)
     return m;
 }
 
-void urlproblem::perform_query(buffer& b, const string& url)
+void urlproblem::perform_query(buffer& b, const string& url, timings& t)
 {
 
-    /* Get a handle to the easy curl interface, and load the URL */
-    auto handle = curl_easy_init();
+    /* Re-use this thread's handle to the easy curl interface, keeping its
+       connections open, and load the URL */
+    if (t_curl.handle)
+	curl_easy_reset(t_curl.handle);
+    else
+	t_curl.handle = curl_easy_init();
+
+    auto handle = t_curl.handle;
     curl_easy_setopt(handle, CURLOPT_URL, url.c_str());
 
     /* Set up the callback and write buffer */
@@ -121,9 +240,20 @@ void urlproblem::perform_query(buffer& b, const string& url)
 	
     /* Fetch the data */
     curl_easy_perform(handle);
-	
-    /* Clean-up */
-    curl_easy_cleanup(handle);
+
+    /* Break down the transfer. Curl's times are cumulative from the start */
+    double dns=0, connect=0, tls=0, pretransfer=0, first=0, total=0;
+    curl_easy_getinfo(handle, CURLINFO_NAMELOOKUP_TIME, &dns);
+    curl_easy_getinfo(handle, CURLINFO_CONNECT_TIME, &connect);
+    curl_easy_getinfo(handle, CURLINFO_APPCONNECT_TIME, &tls);
+    curl_easy_getinfo(handle, CURLINFO_PRETRANSFER_TIME, &pretransfer);
+    curl_easy_getinfo(handle, CURLINFO_STARTTRANSFER_TIME, &first);
+    curl_easy_getinfo(handle, CURLINFO_TOTAL_TIME, &total);
+    t.dns = dns;
+    t.connect = (connect>dns) ? connect-dns : 0;
+    t.tls = (tls>connect) ? tls-connect : 0;
+    t.ttfb = (first>pretransfer) ? first-pretransfer : 0;
+    t.transfer = (total>first) ? total-first : 0;
 	
     /* Zero-terminate the data */
     static const char terminate = '\0';
@@ -135,8 +265,10 @@ size_t urlproblem::rx_data(void *rx_buffer,
 			size_t size, size_t nmemb, void *local_buffer)
 {
     buffer* pBuffer = reinterpret_cast<buffer*>(local_buffer);
-    pBuffer->append(rx_buffer,nmemb);
-    return size;
+    const size_t bytes = size*nmemb;
+
+    // Anything other than the full count makes curl abandon the transfer
+    return pBuffer->append(rx_buffer,bytes) ? bytes : 0;
 }
 
 /**
@@ -169,28 +301,163 @@ urltask::urltask(urlproblem* pUrlProblem) : task<string,map<string,string>>( pUr
 {
 }
 
+urltask::~urltask()
+{
+    set_issued(false);
+}
+
+/// The task whose callback the current thread is running, if any
+thread_local const urltask* urltask::t_notifying = nullptr;
+
 /**
- * Registers a functor to be called when the URL query completes. 
+ * Registers a functor to be called when the URL query completes. The functor
+ * is called by the thread which performed the query, before the task enters
+ * the Finished state, so the task cannot be reset or recycled while it runs.
+ * If the query has already got that far, the functor is instead called at
+ * once, from this thread. Either way it is called exactly once.
  *
  * @param c The functor to call
  * @param data Application-defined pointer to relevant data
  */
 void urltask::set_completion_callback( callback* c, void* data )
+{
+    function<callback> fn;
+    {
+	auto lock = state.obtain_lock();
+
+	_callback_fn = function<callback>(c);
+	_callback_data = data;
+	_notified = false;
+
+	if (!_completing || !claim_callback_bare(fn,data))
+	    return;
+    }
+    notify_callback(fn,data);
+}
+
+/**
+ * Removes any functor registered with set_completion_callback(). Used when the
+ * object is recycled for another request.
+ */
+void urltask::clear_completion_callback()
 {
     auto lock = state.obtain_lock();
 
-    _callback_fn = function<callback>(c);
-    _callback_data = data;
-    
-    state.set_entry_function( TaskState::Finished,
-			      [this]() { this->notify_callback(); } );
+    _callback_fn = nullptr;
+    _callback_data = nullptr;
+}
+
+/**
+ * @return true if the calling thread is running this task's completion
+ * callback. The task cannot finish until the callback returns, so it must
+ * not be waited for or recycled from there.
+ */
+bool urltask::in_callback() const
+{
+    return t_notifying==this;
+}
+
+/**
+ * Marks the task as handed out to the application as a handle, or as taken
+ * back. Pooled and destroyed tasks are not issued.
+ */
+void urltask::set_issued(bool issued)
+{
+    _issued.store( issued ? issued_magic : 0, std::memory_order_release );
+}
+
+/**
+ * @return true if the task is currently an application's handle. This is a
+ * single atomic load, so it can validate handles without taking a lock.
+ */
+bool urltask::issued() const
+{
+    return _issued.load(std::memory_order_acquire)==issued_magic;
+}
+
+/**
+ * Waits for the task to finish, as task::wait(), except that when called from
+ * the task's own completion callback the result, which is already published,
+ * is returned at once.
+ */
+WorkResult urltask::wait() const
+{
+    if (in_callback())
+    {
+	std::lock_guard<std::recursive_mutex> guard(_mutex);
+	return result();
+    }
+    return task<string,map<string,string>>::wait();
+}
+
+/**
+ * @return The timings of the latest request, see urlproblem::request_timings()
+ */
+urlproblem::timings& urltask::request_timings()
+{
+    return static_cast<urlproblem*>(_problem.get())->request_timings();
+}
+
+/**
+ * @return The timings of the latest request
+ */
+const urlproblem::timings& urltask::request_timings() const
+{
+    return static_cast<const urlproblem*>(_problem.get())->request_timings();
+}
+
+/**
+ * Resets the task for another run, as task::reset(), forgetting that any
+ * completion callback has been called
+ */
+void urltask::reset()
+{
+    {
+	auto lock = state.obtain_lock();
+	_completing = false;
+	_notified = false;
+    }
+    task<string,map<string,string>>::reset();
+}
+
+void urltask::completed()
+{
+    function<callback> fn;
+    void* data;
+    {
+	auto lock = state.obtain_lock();
+
+	_completing = true;
+	if (!claim_callback_bare(fn,data))
+	    return;
+    }
+    notify_callback(fn,data);
+}
+
+/**
+ * Takes the right to call the registered callback, if there is one and
+ * nobody has yet called it. Call with the state machine locked; whoever
+ * claims the callback calls it once the lock is released, so that it can
+ * call back into the library freely.
+ *
+ * @return true if the callback was claimed, and copied to fn and data
+ */
+bool urltask::claim_callback_bare(function<callback>& fn, void*& data)
+{
+    if ( !_callback_fn || _notified )
+	return false;
 
-    if (state.get_state()==urltask::TaskState::Finished)
-	notify_callback();
+    _notified = true;
+    fn = _callback_fn;
+    data = _callback_data;
+    return true;
 }
 
-void urltask::notify_callback()
+void urltask::notify_callback(const function<callback>& fn, void* data)
 {
-    _callback_fn(this,_callback_data);
+    const urltask* outer = t_notifying;
+    t_notifying = this;
+    fn(this,data);
+    t_notifying = outer;
 }
 
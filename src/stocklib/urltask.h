@@ -34,13 +34,39 @@ SOFTWARE.
 #include <map>
 #include <functional>
 #include <type_traits>
+#include <chrono>
+#include <atomic>
+#include <cstdint>
 
 #include "buffer.h"
+#include "arena.h"
 #include "task.h"
 
 class urlproblem : public contained_problem<std::string,std::map<std::string,std::string>>
 {
 public:
+    /**
+     * When each stage of the latest request happened, and how curl spent
+     * its time on the transfer, in seconds. The curl figures are zero when
+     * no transfer was made, as in test mode.
+     */
+    struct timings
+    {
+	typedef std::chrono::steady_clock clock;
+
+	clock::time_point submitted;	///< Queued for a worker; set by the submitter
+	clock::time_point started;	///< Taken up by a worker
+	clock::time_point fetched;	///< Response received
+	clock::time_point decoded;	///< Response decoded
+	clock::time_point completed;	///< Completion work done; set by the submitter
+
+	double dns{0};
+	double connect{0};
+	double tls{0};
+	double ttfb{0};			///< Request sent to first byte received
+	double transfer{0};		///< First byte to last
+    };
+
     urlproblem(const std::string& url);
 
     urlproblem( urlproblem&& o)=delete;
@@ -48,8 +74,19 @@ public:
     urlproblem& operator=( const urlproblem& )=delete;
     urlproblem& operator=( const urlproblem&& )=delete;
 
+    void release_arena();
+    const arena& request_arena() const;
+
+    timings& request_timings();
+    const timings& request_timings() const;
+
+    static void set_endpoint(const std::string& endpoint);
+    static std::string apply_endpoint(const std::string& url);
+
 protected:
 
+    std::string fetch_response(const std::string&);
+
     virtual std::map<std::string,std::string> do_work(std::string) final;
     virtual void fetch(buffer&, const std::string&);
     virtual std::string preprocess_url(const std::string&);
@@ -58,7 +95,10 @@ protected:
 private:
 
     static size_t rx_data(void*,size_t,size_t,void*);
-    static void perform_query(buffer&,const std::string&);
+    static void perform_query(buffer&,const std::string&,timings&);
+
+    arena _arena;
+    timings _timings;
 
 };
 
@@ -72,18 +112,41 @@ public:
 
     urltask( urltask&& ) = delete;
     urltask( const urltask& ) = delete;
+    virtual ~urltask();
 
     typedef void (callback)(urltask*,void*);
     void set_completion_callback( callback* c, void* data );
+    void clear_completion_callback();
+    bool in_callback() const;
+
+    void set_issued(bool issued);
+    bool issued() const;
+
+    virtual WorkResult wait() const;
+    virtual void reset();
+
+    urlproblem::timings& request_timings();
+    const urlproblem::timings& request_timings() const;
     
 protected:
 
+    virtual void completed();
+
 private:
 
-    void notify_callback();
+    bool claim_callback_bare(std::function<callback>& fn, void*& data);
+    void notify_callback(const std::function<callback>& fn, void* data);
 
     std::function<callback> _callback_fn;
-    void* _callback_data;    
+    void* _callback_data{nullptr};
+    bool _completing{false};	///< The run has reached its callback
+    bool _notified{false};	///< The registered callback has been claimed
+
+    /// Holds issued_magic while the task is an application's handle
+    std::atomic<uint32_t> _issued{0};
+    static const uint32_t issued_magic = 0x534c4831;
+
+    static thread_local const urltask* t_notifying;
     
 };
 
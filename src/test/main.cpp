@@ -12,12 +12,40 @@
 #include "test-state.h"
 #include "test-task.h"
 #include "test-stocklib.h"
+#include "test-pool.h"
+#include "test-symboltable.h"
+#include "test-namefile.h"
+#include "test-directory.h"
+#include "test-scheduler.h"
+#include "test-arena.h"
+#include "test-subscriber.h"
+#include "test-tickring.h"
+#include "test-analytics.h"
+#include "test-tickarchive.h"
+#include "test-tickcodec.h"
+#include "test-portfoliobook.h"
+#include "test-alertbook.h"
+#include "test-queryprotocol.h"
 
 CPPUNIT_TEST_SUITE_REGISTRATION(BufferTestFixture);
 CPPUNIT_TEST_SUITE_REGISTRATION(ProblemTestFixture);
 CPPUNIT_TEST_SUITE_REGISTRATION(StateTestFixture);
 CPPUNIT_TEST_SUITE_REGISTRATION(TaskTestFixture);
 CPPUNIT_TEST_SUITE_REGISTRATION(StockLibTestFixture);
+CPPUNIT_TEST_SUITE_REGISTRATION(PoolTestFixture);
+CPPUNIT_TEST_SUITE_REGISTRATION(SymbolTableTestFixture);
+CPPUNIT_TEST_SUITE_REGISTRATION(NameFileTestFixture);
+CPPUNIT_TEST_SUITE_REGISTRATION(DirectoryTestFixture);
+CPPUNIT_TEST_SUITE_REGISTRATION(SchedulerTestFixture);
+CPPUNIT_TEST_SUITE_REGISTRATION(ArenaTestFixture);
+CPPUNIT_TEST_SUITE_REGISTRATION(SubscriberTestFixture);
+CPPUNIT_TEST_SUITE_REGISTRATION(TickRingTestFixture);
+CPPUNIT_TEST_SUITE_REGISTRATION(AnalyticsTestFixture);
+CPPUNIT_TEST_SUITE_REGISTRATION(TickArchiveTestFixture);
+CPPUNIT_TEST_SUITE_REGISTRATION(TickCodecTestFixture);
+CPPUNIT_TEST_SUITE_REGISTRATION(PortfolioBookTestFixture);
+CPPUNIT_TEST_SUITE_REGISTRATION(AlertBookTestFixture);
+CPPUNIT_TEST_SUITE_REGISTRATION(QueryProtocolTestFixture);
 
 int main(int argc, char* argv[] )
 {
@@ -0,0 +1,262 @@
+#include <vector>
+#include <set>
+#include <random>
+#include <thread>
+
+#include "test-alertbook.h"
+#include <stocklib/alertbook.h>
+
+namespace
+{
+    /** Collects the alerts delivered, and the number of batches */
+    struct collector
+    {
+	std::vector<sl_alert_t> alerts;
+	unsigned batches{0};
+
+	alertbook::deliver_fn fn()
+	{
+	    return [this](const sl_alert_t* a, std::size_t n)
+	    {
+		alerts.insert(alerts.end(),a,a+n);
+		batches++;
+	    };
+	}
+    };
+}
+
+AlertBookTestFixture::AlertBookTestFixture()
+{
+}
+
+AlertBookTestFixture::~AlertBookTestFixture()
+{
+
+}
+
+void AlertBookTestFixture::setUp()
+{
+}
+
+void AlertBookTestFixture::tearDown()
+{
+}
+
+/**
+ * Tests that alerts fire when the price crosses their thresholds, in either
+ * direction, and only then
+ */
+void AlertBookTestFixture::testCrossing()
+{
+    alertbook b;
+    collector c;
+    b.callback(c.fn());
+
+    const alertbook::id_t up = b.add(1,SLADAbove,1500000);
+    const alertbook::id_t down = b.add(1,SLADBelow,1400000);
+    CPPUNIT_ASSERT( up && down && up!=down );
+    CPPUNIT_ASSERT( 2 == b.size() );
+
+    /* The first quote fires nothing, even past a threshold */
+    CPPUNIT_ASSERT( !b.update(1,1,1600000) );
+    CPPUNIT_ASSERT( !b.update(1,2,1450000) );
+    CPPUNIT_ASSERT( !b.update(2,3,1450000) );
+    CPPUNIT_ASSERT( !b.update(1,4,1499999) );
+
+    /* Reaching the threshold exactly is a crossing */
+    CPPUNIT_ASSERT( b.update(1,5,1500000) );
+    b.deliver();
+    CPPUNIT_ASSERT( 1 == c.alerts.size() );
+    CPPUNIT_ASSERT( up == c.alerts[0].alert );
+    CPPUNIT_ASSERT( 1 == c.alerts[0].symbol );
+    CPPUNIT_ASSERT( SLADAbove == c.alerts[0].direction );
+    CPPUNIT_ASSERT( 1500000 == c.alerts[0].threshold );
+    CPPUNIT_ASSERT( 1500000 == c.alerts[0].price );
+    CPPUNIT_ASSERT( 5 == c.alerts[0].timestamp );
+    CPPUNIT_ASSERT( 1 == b.size() );
+
+    /* Fired once only */
+    CPPUNIT_ASSERT( !b.update(1,6,1400001) );
+    CPPUNIT_ASSERT( !b.update(1,7,1600000) );
+
+    CPPUNIT_ASSERT( b.update(1,8,1300000) );
+    b.deliver();
+    CPPUNIT_ASSERT( 2 == c.alerts.size() );
+    CPPUNIT_ASSERT( down == c.alerts[1].alert );
+    CPPUNIT_ASSERT( SLADBelow == c.alerts[1].direction );
+    CPPUNIT_ASSERT( 0 == b.size() );
+    CPPUNIT_ASSERT( 2 == b.fired() );
+}
+
+/**
+ * Tests that repeating alerts fire on every crossing, and stay
+ */
+void AlertBookTestFixture::testRepeat()
+{
+    alertbook b;
+    collector c;
+    b.callback(c.fn());
+
+    b.add(1,SLADAbove,100,true);
+    b.add(1,SLADBelow,100,true);
+    b.update(1,0,90);
+    for ( int i=0; i<5; i++ )
+    {
+	CPPUNIT_ASSERT( b.update(1,0,110) );
+	CPPUNIT_ASSERT( b.update(1,0,90) );
+    }
+    CPPUNIT_ASSERT( !b.update(1,0,95) );
+    b.deliver();
+    CPPUNIT_ASSERT( 10 == c.alerts.size() );
+    CPPUNIT_ASSERT( 1 == c.batches );
+    CPPUNIT_ASSERT( 2 == b.size() );
+}
+
+/**
+ * Tests removing alerts, before and after firing
+ */
+void AlertBookTestFixture::testRemove()
+{
+    alertbook b;
+    collector c;
+    b.callback(c.fn());
+
+    const alertbook::id_t a = b.add(1,SLADAbove,100);
+    const alertbook::id_t same = b.add(1,SLADAbove,100);
+    const alertbook::id_t other = b.add(1,SLADAbove,100);
+    CPPUNIT_ASSERT( b.remove(same) );
+    CPPUNIT_ASSERT( !b.remove(same) );
+    CPPUNIT_ASSERT( !b.remove(12345) );
+
+    b.update(1,0,50);
+    b.update(1,0,150);
+    b.deliver();
+    CPPUNIT_ASSERT( 2 == c.alerts.size() );
+    CPPUNIT_ASSERT( a == c.alerts[0].alert );
+    CPPUNIT_ASSERT( other == c.alerts[1].alert );
+    CPPUNIT_ASSERT( !b.remove(a) );
+
+    b.add(1,SLADBelow,100);
+    b.clear();
+    CPPUNIT_ASSERT( 0 == b.size() );
+    CPPUNIT_ASSERT( !b.update(1,0,10) );
+}
+
+/**
+ * Tests delivery in batches, and that the callback may add alerts which the
+ * same deliver() passes on when they fire
+ */
+void AlertBookTestFixture::testDeliver()
+{
+    alertbook b;
+
+    /* Dropped with no callback */
+    b.add(1,SLADAbove,100);
+    b.update(1,0,50);
+    b.update(1,0,150);
+    b.deliver();
+
+    std::vector<sl_alert_t> seen;
+    b.callback( [&](const sl_alert_t* a, std::size_t n)
+		{
+		    seen.insert(seen.end(),a,a+n);
+		    if ( seen.size()==1 )
+		    {
+			b.add(2,SLADBelow,100);
+			b.update(2,0,50);
+			b.deliver();	// Returns at once; the outer call delivers
+		    }
+		} );
+
+    b.add(1,SLADBelow,120);
+    b.add(2,SLADAbove,200);
+    b.update(2,0,150);
+    b.update(1,0,110);
+    b.deliver();
+    CPPUNIT_ASSERT( 2 == seen.size() );
+    CPPUNIT_ASSERT( 120 == seen[0].threshold );
+    CPPUNIT_ASSERT( 100 == seen[1].threshold );
+
+    b.update(2,0,250);
+    b.update(2,0,40);
+    b.deliver();
+    CPPUNIT_ASSERT( 3 == seen.size() );
+    CPPUNIT_ASSERT( 200 == seen[2].threshold );
+
+    /* Several threads quoting and delivering; every alert arrives once */
+    alertbook t;
+    std::set<alertbook::id_t> ids;
+    std::vector<alertbook::id_t> expected;
+    for ( sl_symbol_t s=1; s<=4; s++ )
+    {
+	t.update(s,0,0);
+	for ( int64_t p=1; p<=1000; p++ )
+	    expected.push_back( t.add(s,SLADAbove,p) );
+    }
+    t.callback( [&](const sl_alert_t* a, std::size_t n)
+		{
+		    for ( std::size_t i=0; i<n; i++ )
+			CPPUNIT_ASSERT( ids.insert(a[i].alert).second );
+		} );
+    std::vector<std::thread> threads;
+    for ( sl_symbol_t s=1; s<=4; s++ )
+	threads.push_back( std::thread( [&t,s]()
+					{
+					    for ( int64_t p=1; p<=1000; p++ )
+					    {
+						t.update(s,p,p);
+						t.deliver();
+					    }
+					} ) );
+    for ( std::thread& th : threads )
+	th.join();
+    t.deliver();
+    CPPUNIT_ASSERT( ids == std::set<alertbook::id_t>(expected.begin(),expected.end()) );
+}
+
+/**
+ * Tests that a move fires exactly the alerts between the old and new prices,
+ * against checking every alert
+ */
+void AlertBookTestFixture::testLargeMove()
+{
+    alertbook b;
+    collector c;
+    b.callback(c.fn());
+
+    std::mt19937 random(3);
+    std::uniform_int_distribution<int64_t> price(0,10000);
+    std::vector<std::pair<int64_t,sl_alert_direction_t>> rules(1);
+    for ( int i=0; i<5000; i++ )
+    {
+	const sl_alert_direction_t d = (i%2) ? SLADAbove : SLADBelow;
+	const int64_t threshold = price(random);
+	CPPUNIT_ASSERT( rules.size() == b.add(1,d,threshold,true) );
+	rules.push_back(std::make_pair(threshold,d));
+    }
+
+    int64_t last = price(random);
+    b.update(1,0,last);
+    for ( int q=0; q<200; q++ )
+    {
+	const int64_t next = price(random);
+	c.alerts.clear();
+	b.update(1,q,next);
+	b.deliver();
+
+	std::set<alertbook::id_t> fired;
+	for ( const sl_alert_t& a : c.alerts )
+	    fired.insert(a.alert);
+	CPPUNIT_ASSERT( fired.size() == c.alerts.size() );
+
+	std::set<alertbook::id_t> expected;
+	for ( alertbook::id_t id=1; id<rules.size(); id++ )
+	{
+	    const int64_t t = rules[id].first;
+	    if ( (rules[id].second==SLADAbove) ? (last<t && t<=next) : (next<=t && t<last) )
+		expected.insert(id);
+	}
+	CPPUNIT_ASSERT( expected == fired );
+	last = next;
+    }
+}
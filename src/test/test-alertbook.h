@@ -0,0 +1,42 @@
+#ifndef TEST_ALERTBOOK_H
+#define TEST_ALERTBOOK_H
+
+#include <cppunit/TestFixture.h>
+#include <cppunit/TestAssert.h>
+#include <cppunit/TestCaller.h>
+#include <cppunit/TestSuite.h>
+#include <cppunit/TestCase.h>
+
+#include <cppunit/extensions/TestFactoryRegistry.h>
+#include <cppunit/extensions/HelperMacros.h>
+
+class AlertBookTestFixture : public CppUnit::TestFixture
+{
+public:
+    AlertBookTestFixture();
+    virtual ~AlertBookTestFixture();
+
+    void setUp();
+    void tearDown();
+
+    /** @name Test Cases */
+    // @{
+    void testCrossing();
+    void testRepeat();
+    void testRemove();
+    void testDeliver();
+    void testLargeMove();
+    // @}
+
+    /** \cond internal */
+    CPPUNIT_TEST_SUITE( AlertBookTestFixture );
+    CPPUNIT_TEST( testCrossing );
+    CPPUNIT_TEST( testRepeat );
+    CPPUNIT_TEST( testRemove );
+    CPPUNIT_TEST( testDeliver );
+    CPPUNIT_TEST( testLargeMove );
+    CPPUNIT_TEST_SUITE_END();
+    /** \endcond */
+};
+
+#endif
@@ -0,0 +1,272 @@
+#include <vector>
+#include <cmath>
+#include <cfloat>
+#include <limits>
+#include <stdexcept>
+#include <cstdint>
+
+#include "test-analytics.h"
+#include <stocklib/analytics.h>
+#include <stocklib/tickring.h>
+
+namespace
+{
+    /** Every instruction set the processor running the tests supports */
+    std::vector<analytics::isa_t> supported()
+    {
+	std::vector<analytics::isa_t> sets;
+	for ( int s=analytics::scalar; s<=analytics::detect(); s++ )
+	    sets.push_back(static_cast<analytics::isa_t>(s));
+	return sets;
+    }
+
+    bool close(double expected, double actual, double relative=1e-13)
+    {
+	return std::fabs(expected-actual) <= relative*std::max(1.0,std::fabs(expected));
+    }
+
+    /** Deterministic prices around 100, which are not a multiple of any vector width */
+    std::vector<double> prices(std::size_t n, unsigned seed)
+    {
+	std::vector<double> p(n);
+	for ( std::size_t i=0; i<n; i++ )
+	    p[i] = 100.0 + 50.0*std::sin(0.37*i + seed) + 0.01*seed;
+	return p;
+    }
+}
+
+AnalyticsTestFixture::AnalyticsTestFixture()
+{
+}
+
+AnalyticsTestFixture::~AnalyticsTestFixture()
+{
+
+}
+
+void AnalyticsTestFixture::setUp()
+{
+    _isa = analytics::isa();
+}
+
+void AnalyticsTestFixture::tearDown()
+{
+    analytics::use(_isa);
+}
+
+/**
+ * Tests choosing the instruction set
+ */
+void AnalyticsTestFixture::testDispatch()
+{
+    CPPUNIT_ASSERT( analytics::isa() <= analytics::detect() );
+
+    analytics::use(analytics::scalar);
+    CPPUNIT_ASSERT( analytics::scalar == analytics::isa() );
+    CPPUNIT_ASSERT( std::string("scalar") == analytics::name(analytics::isa()) );
+
+    analytics::use(analytics::detect());
+    CPPUNIT_ASSERT( analytics::detect() == analytics::isa() );
+
+    if ( analytics::detect() != analytics::avx512 )
+	CPPUNIT_ASSERT_THROW( analytics::use(analytics::avx512), std::logic_error );
+}
+
+/**
+ * Tests simple and log returns against the obvious scalar code, for every
+ * instruction set, including the symbols left over after the last vector
+ */
+void AnalyticsTestFixture::testReturns()
+{
+    for ( std::size_t n : { 0, 1, 7, 8, 37 } )
+    {
+	const std::vector<double> prev = prices(n,1);
+	const std::vector<double> cur = prices(n,2);
+
+	for ( analytics::isa_t set : supported() )
+	{
+	    analytics::use(set);
+	    std::vector<double> simple(n+1,-1.0);
+	    std::vector<double> log(n+1,-1.0);
+	    analytics::simple_returns(prev.data(),cur.data(),simple.data(),n);
+	    analytics::log_returns(prev.data(),cur.data(),log.data(),n);
+
+	    for ( std::size_t i=0; i<n; i++ )
+	    {
+		CPPUNIT_ASSERT( close(cur[i]/prev[i]-1.0, simple[i]) );
+		CPPUNIT_ASSERT( close(std::log(cur[i]/prev[i]), log[i]) );
+	    }
+	    CPPUNIT_ASSERT( -1.0 == simple[n] );
+	    CPPUNIT_ASSERT( -1.0 == log[n] );
+	}
+    }
+
+    /* In place */
+    std::vector<double> prev = prices(19,3);
+    std::vector<double> cur = prices(19,4);
+    const std::vector<double> expected = cur;
+    analytics::simple_returns(prev.data(),cur.data(),cur.data(),cur.size());
+    for ( std::size_t i=0; i<cur.size(); i++ )
+	CPPUNIT_ASSERT( close(expected[i]/prev[i]-1.0, cur[i]) );
+}
+
+/**
+ * Tests the vectorized logarithms over a wide range of ratios, and that
+ * ratios which are not positive normal numbers are handled as std::log()
+ * handles them
+ */
+void AnalyticsTestFixture::testLogAccuracy()
+{
+    std::vector<double> ratios;
+    for ( double r=0.5; r<2.0; r+=0.0009765625 )
+	ratios.push_back(r);
+    for ( double r=1e-300; r<1e300; r*=7.3 )
+	ratios.push_back(r);
+    ratios.push_back(1.0);
+    ratios.push_back(std::sqrt(2.0));
+    ratios.push_back(std::nextafter(1.0,2.0));
+    ratios.push_back(std::nextafter(1.0,0.0));
+
+    const std::vector<double> ones(ratios.size(),1.0);
+
+    for ( analytics::isa_t set : supported() )
+    {
+	analytics::use(set);
+	std::vector<double> out(ratios.size());
+	analytics::log_returns(ones.data(),ratios.data(),out.data(),ratios.size());
+	for ( std::size_t i=0; i<ratios.size(); i++ )
+	{
+	    const double expected = std::log(ratios[i]);
+	    CPPUNIT_ASSERT( std::fabs(expected-out[i]) <= 4*DBL_EPSILON*std::max(1e-300,std::fabs(expected)) + 1e-300 );
+	}
+
+	const double odd[] = { 0.0, -1.0, DBL_MIN/4, std::numeric_limits<double>::infinity(),
+			       1.0, 1.0, 1.0, 1.0 };
+	const double one[] = { 1.0, 1.0, 1.0, 1.0, 1.0, 1.0, 1.0, 1.0 };
+	double result[8];
+	analytics::log_returns(one,odd,result,8);
+	CPPUNIT_ASSERT( std::isinf(result[0]) && result[0]<0 );
+	CPPUNIT_ASSERT( std::isnan(result[1]) );
+	CPPUNIT_ASSERT( close(std::log(DBL_MIN/4),result[2]) );
+	CPPUNIT_ASSERT( std::isinf(result[3]) && result[3]>0 );
+	CPPUNIT_ASSERT( 0.0 == result[4] );
+    }
+}
+
+/**
+ * Tests cross-sectional z-scores
+ */
+void AnalyticsTestFixture::testZScores()
+{
+    const std::vector<double> x = prices(101,5);
+    double mean = 0.0;
+    for ( double v : x )
+	mean += v;
+    mean /= x.size();
+    double var = 0.0;
+    for ( double v : x )
+	var += (v-mean)*(v-mean);
+    const double sd = std::sqrt(var/x.size());
+
+    for ( analytics::isa_t set : supported() )
+    {
+	analytics::use(set);
+	std::vector<double> z(x.size());
+	analytics::zscores(x.data(),z.data(),x.size());
+	for ( std::size_t i=0; i<x.size(); i++ )
+	    CPPUNIT_ASSERT( close((x[i]-mean)/sd, z[i], 1e-12) );
+
+	const std::vector<double> flat(13,42.0);
+	analytics::zscores(flat.data(),z.data(),flat.size());
+	for ( std::size_t i=0; i<flat.size(); i++ )
+	    CPPUNIT_ASSERT( 0.0 == z[i] );
+
+	analytics::zscores(x.data(),z.data(),0);
+    }
+}
+
+/**
+ * Tests per-symbol statistics over a window
+ */
+void AnalyticsTestFixture::testWindowStats()
+{
+    const std::size_t n = 29;
+    const std::size_t window = 6;
+    std::vector<double> panel;
+    for ( std::size_t r=0; r<window; r++ )
+    {
+	const std::vector<double> column = prices(n,r);
+	panel.insert(panel.end(),column.begin(),column.end());
+    }
+
+    CPPUNIT_ASSERT_THROW( analytics::window_stats(panel.data(),0,n,nullptr,nullptr,nullptr,nullptr),
+			  std::logic_error );
+
+    for ( analytics::isa_t set : supported() )
+    {
+	analytics::use(set);
+	std::vector<double> mean(n), sd(n), lo(n), hi(n);
+	analytics::window_stats(panel.data(),window,n,mean.data(),sd.data(),lo.data(),hi.data());
+
+	for ( std::size_t i=0; i<n; i++ )
+	{
+	    double sum = 0.0;
+	    double min = panel[i];
+	    double max = panel[i];
+	    for ( std::size_t r=0; r<window; r++ )
+	    {
+		sum += panel[r*n+i];
+		min = std::min(min,panel[r*n+i]);
+		max = std::max(max,panel[r*n+i]);
+	    }
+	    const double mu = sum/window;
+	    double squares = 0.0;
+	    for ( std::size_t r=0; r<window; r++ )
+		squares += (panel[r*n+i]-mu)*(panel[r*n+i]-mu);
+
+	    CPPUNIT_ASSERT( close(mu,mean[i]) );
+	    CPPUNIT_ASSERT( close(std::sqrt(squares/window),sd[i],1e-12) );
+	    CPPUNIT_ASSERT( min == lo[i] );
+	    CPPUNIT_ASSERT( max == hi[i] );
+	}
+
+	/* Extremes are optional */
+	analytics::window_stats(panel.data(),window,n,mean.data(),sd.data(),nullptr,nullptr);
+	analytics::window_stats(panel.data(),1,n,mean.data(),sd.data(),nullptr,nullptr);
+	for ( std::size_t i=0; i<n; i++ )
+	{
+	    CPPUNIT_ASSERT( panel[i] == mean[i] );
+	    CPPUNIT_ASSERT( 0.0 == sd[i] );
+	}
+    }
+}
+
+/**
+ * Tests building a panel from a tick history
+ */
+void AnalyticsTestFixture::testGather()
+{
+    tickhistory h(8);
+    for ( int64_t t=1; t<=5; t++ )
+	h.record(1,t,t*10000);
+    h.record(2,1,250000);
+    h.record(2,2,260000);
+
+    const uint32_t symbols[] = { 1, 2, 3 };
+    std::vector<double> panel(4*3,-1.0);
+    CPPUNIT_ASSERT( 1 == analytics::gather(h,symbols,3,4,panel.data()) );
+
+    /* Symbol 1: its four latest ticks */
+    CPPUNIT_ASSERT( 2.0 == panel[0*3+0] );
+    CPPUNIT_ASSERT( 5.0 == panel[3*3+0] );
+
+    /* Symbol 2: two ticks, the first repeated before them */
+    CPPUNIT_ASSERT( 25.0 == panel[0*3+1] );
+    CPPUNIT_ASSERT( 25.0 == panel[1*3+1] );
+    CPPUNIT_ASSERT( 25.0 == panel[2*3+1] );
+    CPPUNIT_ASSERT( 26.0 == panel[3*3+1] );
+
+    /* Symbol 3: never quoted */
+    for ( std::size_t r=0; r<4; r++ )
+	CPPUNIT_ASSERT( 0.0 == panel[r*3+2] );
+}
@@ -0,0 +1,49 @@
+#ifndef TEST_ANALYTICS_H
+#define TEST_ANALYTICS_H
+
+#include <cppunit/TestFixture.h>
+#include <cppunit/TestAssert.h>
+#include <cppunit/TestCaller.h>
+#include <cppunit/TestSuite.h>
+#include <cppunit/TestCase.h>
+
+#include <cppunit/extensions/TestFactoryRegistry.h>
+#include <cppunit/extensions/HelperMacros.h>
+
+#include <stocklib/analytics.h>
+
+class AnalyticsTestFixture : public CppUnit::TestFixture
+{
+public:
+    AnalyticsTestFixture();
+    virtual ~AnalyticsTestFixture();
+
+    void setUp();
+    void tearDown();
+
+    /** @name Test Cases */
+    // @{
+    void testDispatch();
+    void testReturns();
+    void testLogAccuracy();
+    void testZScores();
+    void testWindowStats();
+    void testGather();
+    // @}
+
+    /** \cond internal */
+    CPPUNIT_TEST_SUITE( AnalyticsTestFixture );
+    CPPUNIT_TEST( testDispatch );
+    CPPUNIT_TEST( testReturns );
+    CPPUNIT_TEST( testLogAccuracy );
+    CPPUNIT_TEST( testZScores );
+    CPPUNIT_TEST( testWindowStats );
+    CPPUNIT_TEST( testGather );
+    CPPUNIT_TEST_SUITE_END();
+    /** \endcond */
+
+private:
+    analytics::isa_t _isa;
+};
+
+#endif
@@ -0,0 +1,141 @@
+#include <string.h>
+#include <stdint.h>
+
+#include "test-arena.h"
+#include <stocklib/arena.h>
+#include <stocklib/tickerproblem.h>
+
+ArenaTestFixture::ArenaTestFixture()
+{
+}
+
+ArenaTestFixture::~ArenaTestFixture()
+{
+
+}
+
+void ArenaTestFixture::setUp()
+{
+}
+
+void ArenaTestFixture::tearDown()
+{
+}
+
+/**
+ * Tests that allocations are distinct, aligned and owned
+ */
+void ArenaTestFixture::testAllocate()
+{
+    arena a(256);
+    int x;
+
+    char* p1 = reinterpret_cast<char*>(a.allocate(3,1));
+    void* p2 = a.allocate(8);
+    memset(p1,0xff,3);
+
+    CPPUNIT_ASSERT( 0 == reinterpret_cast<uintptr_t>(p2) % arena::default_align );
+    CPPUNIT_ASSERT( p1 != p2 );
+    CPPUNIT_ASSERT( a.owns(p1) && a.owns(p2) );
+    CPPUNIT_ASSERT( !a.owns(&x) );
+    CPPUNIT_ASSERT( 2 == a.allocations() );
+    CPPUNIT_ASSERT( 1 == a.system_allocations() );
+}
+
+/**
+ * Tests that a released arena is re-used without further system allocations,
+ * even when the previous round of work overflowed a block
+ */
+void ArenaTestFixture::testRelease()
+{
+    arena a(256);
+
+    for ( int i=0; i<20; i++ )
+	a.allocate(64);
+    CPPUNIT_ASSERT( a.system_allocations() > 1 );
+
+    a.release();
+    const uint64_t before = a.system_allocations();
+    CPPUNIT_ASSERT( 0 == a.used() );
+
+    for ( int round=0; round<10; round++ )
+    {
+	for ( int i=0; i<20; i++ )
+	    a.allocate(64);
+	a.release();
+    }
+
+    CPPUNIT_ASSERT( before == a.system_allocations() );
+}
+
+/**
+ * Tests an allocation bigger than a block
+ */
+void ArenaTestFixture::testLargeAllocation()
+{
+    arena a(128);
+
+    char* p = reinterpret_cast<char*>(a.allocate(10000));
+    memset(p,0,10000);
+    CPPUNIT_ASSERT( a.owns(p) && a.owns(p+9999) );
+
+    void* q = a.allocate(16);
+    CPPUNIT_ASSERT( a.owns(q) );
+}
+
+/**
+ * Tests routing of scoped_malloc() and scoped_free(), including frees made
+ * under a different scope, or none, from the allocation
+ */
+void ArenaTestFixture::testScope()
+{
+    arena a, b;
+
+    void* outside = arena::scoped_malloc(32);
+    CPPUNIT_ASSERT( !a.owns(outside) );
+    CPPUNIT_ASSERT( nullptr == arena::current() );
+
+    {
+	arena::scope sa(a);
+	void* in_a = arena::scoped_malloc(32);
+	CPPUNIT_ASSERT( a.owns(in_a) );
+
+	void* in_b;
+	{
+	    arena::scope sb(b);
+	    CPPUNIT_ASSERT( &b == arena::current() );
+	    in_b = arena::scoped_malloc(32);
+	    CPPUNIT_ASSERT( b.owns(in_b) );
+	    arena::scoped_free(in_a);
+	}
+
+	CPPUNIT_ASSERT( &a == arena::current() );
+	arena::scoped_free(in_b);
+	arena::scoped_free(outside);
+	outside = arena::scoped_malloc(32);
+	CPPUNIT_ASSERT( a.owns(outside) );
+    }
+
+    CPPUNIT_ASSERT( nullptr == arena::current() );
+    arena::scoped_free(outside);
+    arena::scoped_free(nullptr);
+}
+
+/**
+ * Tests that repeated requests through one problem reach a steady state with
+ * no further system allocations from its arena
+ */
+void ArenaTestFixture::testRequestArena()
+{
+    tickerproblem::route_json_allocations();
+    tickerproblem p("TEST",SLTBNormalRequest);
+
+    p.solve();
+    const uint64_t warm = p.request_arena().system_allocations();
+    CPPUNIT_ASSERT( p.request_arena().allocations() > 0 );
+
+    for ( int i=0; i<10; i++ )
+	CPPUNIT_ASSERT( "99.99" == p.solve()["response"] );
+
+    CPPUNIT_ASSERT( warm == p.request_arena().system_allocations() );
+}
@@ -0,0 +1,42 @@
+#ifndef TEST_ARENA_H
+#define TEST_ARENA_H
+
+#include <cppunit/TestFixture.h>
+#include <cppunit/TestAssert.h>
+#include <cppunit/TestCaller.h>
+#include <cppunit/TestSuite.h>
+#include <cppunit/TestCase.h>
+
+#include <cppunit/extensions/TestFactoryRegistry.h>
+#include <cppunit/extensions/HelperMacros.h>
+
+class ArenaTestFixture : public CppUnit::TestFixture
+{
+public:
+    ArenaTestFixture();
+    virtual ~ArenaTestFixture();
+
+    void setUp();
+    void tearDown();
+
+    /** @name Test Cases */
+    // @{
+    void testAllocate();
+    void testRelease();
+    void testLargeAllocation();
+    void testScope();
+    void testRequestArena();
+    // @}
+
+    /** \cond internal */
+    CPPUNIT_TEST_SUITE( ArenaTestFixture );
+    CPPUNIT_TEST( testAllocate );
+    CPPUNIT_TEST( testRelease );
+    CPPUNIT_TEST( testLargeAllocation );
+    CPPUNIT_TEST( testScope );
+    CPPUNIT_TEST( testRequestArena );
+    CPPUNIT_TEST_SUITE_END();
+    /** \endcond */
+};
+
+#endif
@@ -1,6 +1,7 @@
 #include <string.h>
 #include "test-buffer.h"
 #include <stocklib/buffer.h>
+#include <stocklib/arena.h>
 
 BufferTestFixture::BufferTestFixture()
 {
@@ -92,3 +93,39 @@ void BufferTestFixture::testOverflow()
     CPPUNIT_ASSERT( !c.append(ib,1025) );
     CPPUNIT_ASSERT( c.remaining_bytes() == 1024 );
 }
+
+/**
+ * Tests a buffer whose storage is drawn from an arena
+ */
+void BufferTestFixture::testArenaStorage()
+{
+    arena a;
+    {
+	buffer b(64,a);
+	CPPUNIT_ASSERT( a.owns(b.contents()) );
+	CPPUNIT_ASSERT( b.append("hello",6) );
+	CPPUNIT_ASSERT( 0==strcmp("hello",b.contents()) );
+	CPPUNIT_ASSERT( 58 == b.remaining_bytes() );
+    }
+    CPPUNIT_ASSERT( 64 == a.used() );
+    a.release();
+    CPPUNIT_ASSERT( 0 == a.used() );
+}
+
+/**
+ * Tests that a growable arena-backed buffer accepts more than its initial
+ * size, keeping what it already held
+ */
+void BufferTestFixture::testGrowable()
+{
+    arena a;
+    buffer b(16,a,true);
+    char ib[1000];
+    for ( int i=0; i<1000; i++ )
+	ib[i] = 'a' + (i%26);
+
+    CPPUNIT_ASSERT( b.append(ib,10) );
+    CPPUNIT_ASSERT( b.append(ib+10,990) );
+    CPPUNIT_ASSERT( 0==memcmp(ib,b.contents(),1000) );
+    CPPUNIT_ASSERT( a.owns(b.contents()) );
+}
@@ -26,6 +26,8 @@ public:
     void testReset();
     void testMove();
     void testOverflow();
+    void testArenaStorage();
+    void testGrowable();
     // @}
 
     /** \cond internal */
@@ -35,6 +37,8 @@ public:
     CPPUNIT_TEST( testReset );
     CPPUNIT_TEST( testMove );
     CPPUNIT_TEST( testOverflow );
+    CPPUNIT_TEST( testArenaStorage );
+    CPPUNIT_TEST( testGrowable );
     CPPUNIT_TEST_SUITE_END();
     /** \endcond */
 };
@@ -0,0 +1,207 @@
+#include <string>
+#include <thread>
+#include <vector>
+#include <atomic>
+
+#include "test-directory.h"
+#include <stocklib/directory.h>
+
+typedef directory<std::string> stringdir;
+
+DirectoryTestFixture::DirectoryTestFixture()
+{
+}
+
+DirectoryTestFixture::~DirectoryTestFixture()
+{
+
+}
+
+void DirectoryTestFixture::setUp()
+{
+    _dir = new stringdir();
+}
+
+void DirectoryTestFixture::tearDown()
+{
+    delete _dir;
+    _dir = nullptr;
+}
+
+/**
+ * Tests storing and reading back values
+ */
+void DirectoryTestFixture::testStoreAndRead()
+{
+    std::string value;
+
+    CPPUNIT_ASSERT( !_dir->get(0,value) );
+    CPPUNIT_ASSERT( !_dir->contains(100000) );
+
+    _dir->store(0,"Apple Inc.");
+    _dir->store(100000,"Far Away Corp.");
+
+    CPPUNIT_ASSERT( _dir->get(0,value) );
+    CPPUNIT_ASSERT( "Apple Inc." == value );
+    CPPUNIT_ASSERT( _dir->get(100000,value) );
+    CPPUNIT_ASSERT( "Far Away Corp." == value );
+    CPPUNIT_ASSERT( !_dir->contains(1) );
+    CPPUNIT_ASSERT( 2 == _dir->size() );
+}
+
+/**
+ * Tests that replacing a value does not change the entry count
+ */
+void DirectoryTestFixture::testReplace()
+{
+    std::string value;
+
+    _dir->store(7,"Old Name");
+    _dir->store(7,"New Name");
+
+    CPPUNIT_ASSERT( _dir->get(7,value) );
+    CPPUNIT_ASSERT( "New Name" == value );
+    CPPUNIT_ASSERT( 1 == _dir->size() );
+}
+
+/**
+ * Tests removing values
+ */
+void DirectoryTestFixture::testErase()
+{
+    _dir->store(3,"Three");
+
+    CPPUNIT_ASSERT( !_dir->erase(4) );
+    CPPUNIT_ASSERT( _dir->erase(3) );
+    CPPUNIT_ASSERT( !_dir->contains(3) );
+    CPPUNIT_ASSERT( !_dir->erase(3) );
+    CPPUNIT_ASSERT( 0 == _dir->size() );
+}
+
+/**
+ * Tests that FIFO eviction drops the oldest entry of a full shard, whether
+ * or not it has been read
+ */
+void DirectoryTestFixture::testFifoEviction()
+{
+    const stringdir::id_t s = stringdir::shards;
+
+    _dir->configure(2,stringdir::evict_fifo);
+
+    _dir->store(0,"A");
+    _dir->store(s,"B");
+    CPPUNIT_ASSERT( _dir->contains(0) );
+    _dir->store(2*s,"C");
+
+    CPPUNIT_ASSERT( !_dir->contains(0) );
+    CPPUNIT_ASSERT( _dir->contains(s) );
+    CPPUNIT_ASSERT( _dir->contains(2*s) );
+    CPPUNIT_ASSERT( 2 == _dir->size() );
+    CPPUNIT_ASSERT( 1 == _dir->evictions() );
+
+    /* A shard holding nothing else to evict takes from another */
+    _dir->store(1,"D");
+    CPPUNIT_ASSERT( _dir->contains(1) );
+    CPPUNIT_ASSERT( 2 == _dir->size() );
+    CPPUNIT_ASSERT( 2 == _dir->evictions() );
+}
+
+/**
+ * Tests that CLOCK eviction spares entries read since they were stored
+ */
+void DirectoryTestFixture::testClockEviction()
+{
+    const stringdir::id_t s = stringdir::shards;
+
+    _dir->configure(2,stringdir::evict_clock);
+
+    _dir->store(0,"A");
+    _dir->store(s,"B");
+    CPPUNIT_ASSERT( _dir->contains(0) );
+    _dir->store(2*s,"C");
+
+    CPPUNIT_ASSERT( _dir->contains(0) );
+    CPPUNIT_ASSERT( !_dir->contains(s) );
+    CPPUNIT_ASSERT( _dir->contains(2*s) );
+
+    /* With every entry read, the one just stored is still kept */
+    _dir->store(3*s,"D");
+    CPPUNIT_ASSERT( _dir->contains(3*s) );
+    CPPUNIT_ASSERT( 2 == _dir->size() );
+    CPPUNIT_ASSERT( 2 == _dir->evictions() );
+}
+
+/**
+ * Tests that the capacity bounds the whole directory, however the entries
+ * are spread over the shards
+ */
+void DirectoryTestFixture::testCapacity()
+{
+    _dir->configure(1,stringdir::evict_fifo);
+    for ( stringdir::id_t id=0; id<4*stringdir::shards; id++ )
+    {
+	_dir->store(id,std::to_string(id));
+	CPPUNIT_ASSERT( 1 == _dir->size() );
+	CPPUNIT_ASSERT( _dir->contains(id) );
+    }
+
+    _dir->configure(40,stringdir::evict_clock);
+    for ( stringdir::id_t id=0; id<4*stringdir::shards; id++ )
+	_dir->store(id,std::to_string(id));
+    CPPUNIT_ASSERT( 40 == _dir->size() );
+
+    /* Shrinking takes effect at the next store */
+    _dir->configure(3,stringdir::evict_clock);
+    _dir->store(1000,"X");
+    CPPUNIT_ASSERT( 3 == _dir->size() );
+    CPPUNIT_ASSERT( _dir->contains(1000) );
+}
+
+/**
+ * Tests that readers always see a complete value while writers replace and
+ * evict entries
+ */
+void DirectoryTestFixture::testConcurrentReaders()
+{
+    const stringdir::id_t count = 256;
+    std::atomic<bool> stop{false};
+    std::atomic<int> torn{0};
+    std::vector<std::thread> threads;
+
+    _dir->configure(count/2,stringdir::evict_clock);
+
+    for ( int t=0; t<4; t++ )
+    {
+	threads.push_back( std::thread( [this,&stop,&torn]()
+	{
+	    while (!stop.load())
+		for ( stringdir::id_t id=0; id<count; id++ )
+		    this->_dir->read(id,[id,&torn](const std::string& v)
+		    {
+			if ( v.compare(0,v.find(':'),std::to_string(id)) )
+			    torn++;
+		    } );
+	} ) );
+    }
+
+    for ( int t=0; t<2; t++ )
+    {
+	threads.push_back( std::thread( [this,t]()
+	{
+	    for ( int n=0; n<20000; n++ )
+	    {
+		const stringdir::id_t id = (n*7+t) % count;
+		this->_dir->store(id,std::to_string(id)+":"+std::to_string(n));
+	    }
+	} ) );
+    }
+
+    for ( std::size_t i=4; i<threads.size(); i++ )
+	threads[i].join();
+    stop.store(true);
+    for ( std::size_t i=0; i<4; i++ )
+	threads[i].join();
+
+    CPPUNIT_ASSERT( 0 == torn.load() );
+    CPPUNIT_ASSERT( _dir->size() <= count/2 );
+}
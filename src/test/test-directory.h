@@ -0,0 +1,53 @@
+#ifndef TEST_DIRECTORY_H
+#define TEST_DIRECTORY_H
+
+#include <string>
+
+#include <cppunit/TestFixture.h>
+#include <cppunit/TestAssert.h>
+#include <cppunit/TestCaller.h>
+#include <cppunit/TestSuite.h>
+#include <cppunit/TestCase.h>
+
+#include <cppunit/extensions/TestFactoryRegistry.h>
+#include <cppunit/extensions/HelperMacros.h>
+
+template<class T> class directory;
+
+class DirectoryTestFixture : public CppUnit::TestFixture
+{
+public:
+    DirectoryTestFixture();
+    virtual ~DirectoryTestFixture();
+
+    void setUp();
+    void tearDown();
+
+    /** @name Test Cases */
+    // @{
+    void testStoreAndRead();
+    void testReplace();
+    void testErase();
+    void testFifoEviction();
+    void testClockEviction();
+    void testCapacity();
+    void testConcurrentReaders();
+    // @}
+
+    /** \cond internal */
+    CPPUNIT_TEST_SUITE( DirectoryTestFixture );
+    CPPUNIT_TEST( testStoreAndRead );
+    CPPUNIT_TEST( testReplace );
+    CPPUNIT_TEST( testErase );
+    CPPUNIT_TEST( testFifoEviction );
+    CPPUNIT_TEST( testClockEviction );
+    CPPUNIT_TEST( testCapacity );
+    CPPUNIT_TEST( testConcurrentReaders );
+    CPPUNIT_TEST_SUITE_END();
+    /** \endcond */
+
+private:
+    directory<std::string>* _dir{nullptr};
+};
+
+#endif
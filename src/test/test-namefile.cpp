@@ -0,0 +1,166 @@
+#include <string.h>
+#include <stdio.h>
+#include <unistd.h>
+#include <string>
+
+#include "test-namefile.h"
+#include <stocklib/namefile.h>
+
+NameFileTestFixture::NameFileTestFixture()
+{
+}
+
+NameFileTestFixture::~NameFileTestFixture()
+{
+
+}
+
+void NameFileTestFixture::setUp()
+{
+    char path[] = "/tmp/stocklib-namefile-XXXXXX";
+    close(mkstemp(path));
+    unlink(path);
+    _path = path;
+}
+
+void NameFileTestFixture::tearDown()
+{
+    unlink(_path.c_str());
+}
+
+/**
+ * Tests basic storage and retrieval
+ */
+void NameFileTestFixture::testInsertLookup()
+{
+    namefile f;
+    char name[256];
+
+    CPPUNIT_ASSERT( f.open(_path) );
+    CPPUNIT_ASSERT( 0 == f.count() );
+    CPPUNIT_ASSERT( !f.lookup("AAPL",name,sizeof(name)) );
+
+    CPPUNIT_ASSERT( f.insert("AAPL","Apple Inc.") );
+    CPPUNIT_ASSERT( f.lookup("AAPL",name,sizeof(name)) );
+    CPPUNIT_ASSERT( 0==strcmp("Apple Inc.",name) );
+    CPPUNIT_ASSERT( 1 == f.count() );
+}
+
+/**
+ * Tests that names survive closing and re-opening the file
+ */
+void NameFileTestFixture::testReopen()
+{
+    char name[256];
+
+    {
+	namefile f;
+	CPPUNIT_ASSERT( f.open(_path) );
+	CPPUNIT_ASSERT( f.insert("MSFT","Microsoft Corporation") );
+    }
+
+    namefile g;
+    CPPUNIT_ASSERT( g.open(_path) );
+    CPPUNIT_ASSERT( g.lookup("MSFT",name,sizeof(name)) );
+    CPPUNIT_ASSERT( 0==strcmp("Microsoft Corporation",name) );
+}
+
+/**
+ * Tests updating an existing name
+ */
+void NameFileTestFixture::testUpdate()
+{
+    namefile f;
+    char name[256];
+
+    CPPUNIT_ASSERT( f.open(_path) );
+    f.insert("FB","Facebook, Inc.");
+    f.insert("FB","Meta Platforms, Inc.");
+
+    CPPUNIT_ASSERT( f.lookup("FB",name,sizeof(name)) );
+    CPPUNIT_ASSERT( 0==strcmp("Meta Platforms, Inc.",name) );
+    CPPUNIT_ASSERT( 1 == f.count() );
+}
+
+/**
+ * Tests that the file grows as required, keeping its contents
+ */
+void NameFileTestFixture::testGrowth()
+{
+    namefile f;
+    char name[256];
+
+    CPPUNIT_ASSERT( f.open(_path) );
+
+    for ( int i=0; i<2000; i++ )
+	CPPUNIT_ASSERT( f.insert( ("T"+std::to_string(i)).c_str(),
+				  ("Name "+std::to_string(i)).c_str() ) );
+
+    CPPUNIT_ASSERT( 2000 == f.count() );
+
+    for ( int i=0; i<2000; i+=7 )
+    {
+	CPPUNIT_ASSERT( f.lookup( ("T"+std::to_string(i)).c_str(), name, sizeof(name) ) );
+	CPPUNIT_ASSERT( ("Name "+std::to_string(i)) == name );
+    }
+}
+
+/**
+ * Tests that a file with an unknown format is discarded
+ */
+void NameFileTestFixture::testVersionMismatch()
+{
+    char name[256];
+
+    FILE* fp = fopen(_path.c_str(),"w");
+    fputs("This is not a name cache, but it is long enough to hold a header."
+	  "This is not a name cache, but it is long enough to hold a header.",fp);
+    fclose(fp);
+
+    namefile f;
+    CPPUNIT_ASSERT( f.open(_path) );
+    CPPUNIT_ASSERT( 0 == f.count() );
+    CPPUNIT_ASSERT( f.insert("IBM","International Business Machines") );
+    CPPUNIT_ASSERT( f.lookup("IBM",name,sizeof(name)) );
+}
+
+/**
+ * Tests that over-long entries are rejected
+ */
+void NameFileTestFixture::testTooLong()
+{
+    namefile f;
+    CPPUNIT_ASSERT( f.open(_path) );
+
+    std::string ticker(namefile::max_ticker+1,'X');
+    std::string longname(namefile::max_name+1,'Y');
+
+    CPPUNIT_ASSERT( !f.insert(ticker.c_str(),"Name") );
+    CPPUNIT_ASSERT( !f.insert("X",longname.c_str()) );
+    CPPUNIT_ASSERT( 0 == f.count() );
+}
+
+/**
+ * Tests that two users of one file see each other's entries, including
+ * after the file has been replaced by a larger one.
+ */
+void NameFileTestFixture::testSharedFile()
+{
+    namefile a, b;
+    char name[256];
+
+    CPPUNIT_ASSERT( a.open(_path) );
+    CPPUNIT_ASSERT( b.open(_path) );
+
+    a.insert("AAPL","Apple Inc.");
+    CPPUNIT_ASSERT( b.lookup("AAPL",name,sizeof(name)) );
+
+    // Force a to replace the file
+    for ( int i=0; i<1000; i++ )
+	a.insert( ("T"+std::to_string(i)).c_str(), "Name" );
+
+    CPPUNIT_ASSERT( b.lookup("T999",name,sizeof(name)) );
+    CPPUNIT_ASSERT( b.insert("GOOG","Alphabet Inc.") );
+    CPPUNIT_ASSERT( a.lookup("GOOG",name,sizeof(name)) );
+    CPPUNIT_ASSERT( 1002 == a.count() );
+}
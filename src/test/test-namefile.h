@@ -0,0 +1,51 @@
+#ifndef TEST_NAMEFILE_H
+#define TEST_NAMEFILE_H
+
+#include <cppunit/TestFixture.h>
+#include <cppunit/TestAssert.h>
+#include <cppunit/TestCaller.h>
+#include <cppunit/TestSuite.h>
+#include <cppunit/TestCase.h>
+
+#include <cppunit/extensions/TestFactoryRegistry.h>
+#include <cppunit/extensions/HelperMacros.h>
+
+#include <string>
+
+class NameFileTestFixture : public CppUnit::TestFixture
+{
+public:
+    NameFileTestFixture();
+    virtual ~NameFileTestFixture();
+
+    void setUp();
+    void tearDown();
+
+    /** @name Test Cases */
+    // @{
+    void testInsertLookup();
+    void testReopen();
+    void testUpdate();
+    void testGrowth();
+    void testVersionMismatch();
+    void testTooLong();
+    void testSharedFile();
+    // @}
+
+    /** \cond internal */
+    CPPUNIT_TEST_SUITE( NameFileTestFixture );
+    CPPUNIT_TEST( testInsertLookup );
+    CPPUNIT_TEST( testReopen );
+    CPPUNIT_TEST( testUpdate );
+    CPPUNIT_TEST( testGrowth );
+    CPPUNIT_TEST( testVersionMismatch );
+    CPPUNIT_TEST( testTooLong );
+    CPPUNIT_TEST( testSharedFile );
+    CPPUNIT_TEST_SUITE_END();
+    /** \endcond */
+
+private:
+    std::string _path;
+};
+
+#endif
@@ -0,0 +1,108 @@
+#include "test-pool.h"
+#include <stocklib/pool.h>
+
+namespace
+{
+    int g_live{0};
+    int g_recycled{0};
+
+    class widget
+    {
+    public:
+	widget() { g_live++; }
+	~widget() { g_live--; }
+	int value{0};
+    };
+
+    void recycle_widget(widget& w)
+    {
+	w.value = 0;
+	g_recycled++;
+    }
+}
+
+PoolTestFixture::PoolTestFixture()
+{
+}
+
+PoolTestFixture::~PoolTestFixture()
+{
+
+}
+
+void PoolTestFixture::setUp()
+{
+    g_live = 0;
+    g_recycled = 0;
+}
+
+void PoolTestFixture::tearDown()
+{
+}
+
+/**
+ * Tests that an empty pool hands out nothing
+ */
+void PoolTestFixture::testEmptyAcquire()
+{
+    pool<widget> p(&recycle_widget);
+    CPPUNIT_ASSERT( p.acquire()==nullptr );
+    CPPUNIT_ASSERT( p.idle()==0 );
+}
+
+/**
+ * Tests that released objects are recycled and handed back out
+ */
+void PoolTestFixture::testRecycle()
+{
+    pool<widget> p(&recycle_widget);
+
+    widget* w = new widget();
+    w->value = 42;
+    p.release(w);
+
+    CPPUNIT_ASSERT( p.idle()==1 );
+    
+    widget* r = p.acquire();
+    CPPUNIT_ASSERT( r==w );
+    CPPUNIT_ASSERT( r->value==0 );
+    CPPUNIT_ASSERT( p.idle()==0 );
+
+    delete r;
+    CPPUNIT_ASSERT( g_live==0 );
+}
+
+/**
+ * Tests that objects released to a full pool are recycled, then deleted
+ */
+void PoolTestFixture::testMaxIdle()
+{
+    pool<widget> p(&recycle_widget,2);
+
+    p.release(new widget());
+    p.release(new widget());
+    p.release(new widget());
+
+    CPPUNIT_ASSERT( p.idle()==2 );
+    CPPUNIT_ASSERT( g_live==2 );
+    CPPUNIT_ASSERT( g_recycled==3 );
+}
+
+/**
+ * Tests that draining the pool, or destroying it, deletes idle objects
+ */
+void PoolTestFixture::testDrain()
+{
+    {
+	pool<widget> p(&recycle_widget);
+	p.release(new widget());
+	p.release(new widget());
+	p.drain();
+	CPPUNIT_ASSERT( p.idle()==0 );
+	CPPUNIT_ASSERT( g_live==0 );
+
+	p.release(new widget());
+    }
+
+    CPPUNIT_ASSERT( g_live==0 );
+}
@@ -0,0 +1,40 @@
+#ifndef TEST_POOL_H
+#define TEST_POOL_H
+
+#include <cppunit/TestFixture.h>
+#include <cppunit/TestAssert.h>
+#include <cppunit/TestCaller.h>
+#include <cppunit/TestSuite.h>
+#include <cppunit/TestCase.h>
+
+#include <cppunit/extensions/TestFactoryRegistry.h>
+#include <cppunit/extensions/HelperMacros.h>
+
+class PoolTestFixture : public CppUnit::TestFixture
+{
+public:
+    PoolTestFixture();
+    virtual ~PoolTestFixture();
+
+    void setUp();
+    void tearDown();
+
+    /** @name Test Cases */
+    // @{
+    void testEmptyAcquire();
+    void testRecycle();
+    void testMaxIdle();
+    void testDrain();
+    // @}
+
+    /** \cond internal */
+    CPPUNIT_TEST_SUITE( PoolTestFixture );
+    CPPUNIT_TEST( testEmptyAcquire );
+    CPPUNIT_TEST( testRecycle );
+    CPPUNIT_TEST( testMaxIdle );
+    CPPUNIT_TEST( testDrain );
+    CPPUNIT_TEST_SUITE_END();
+    /** \endcond */
+};
+
+#endif
@@ -0,0 +1,265 @@
+#include <stdio.h>
+#include <unistd.h>
+#include <string>
+#include <vector>
+#include <map>
+#include <thread>
+#include <atomic>
+#include <fstream>
+
+#include "test-portfoliobook.h"
+#include <stocklib/portfoliobook.h>
+
+namespace
+{
+    /** Gives tickers symbols in the order they are first seen */
+    struct interner
+    {
+	std::map<std::string,uint32_t> ids;
+	uint32_t operator()(const char* ticker)
+	{
+	    return ids.insert(std::make_pair(std::string(ticker),ids.size()+1)).first->second;
+	}
+    };
+
+    portfoliobook::totals totals_of(const portfoliobook& b, const std::string& name)
+    {
+	portfoliobook::id_t id;
+	CPPUNIT_ASSERT( b.find(name,id) );
+	portfoliobook::totals t;
+	CPPUNIT_ASSERT( b.value(id,t) );
+	return t;
+    }
+}
+
+PortfolioBookTestFixture::PortfolioBookTestFixture()
+{
+}
+
+PortfolioBookTestFixture::~PortfolioBookTestFixture()
+{
+
+}
+
+void PortfolioBookTestFixture::setUp()
+{
+    char path[] = "/tmp/stocklib-portfolio-XXXXXX";
+    close(mkstemp(path));
+    _path = path;
+}
+
+void PortfolioBookTestFixture::tearDown()
+{
+    unlink(_path.c_str());
+}
+
+/**
+ * Tests that quotes revalue a portfolio, and that only priced positions count
+ */
+void PortfolioBookTestFixture::testUpdate()
+{
+    portfoliobook b;
+    b.hold({ {"growth",1,100,1000000}, {"growth",2,-50,0} });
+
+    portfoliobook::totals t = totals_of(b,"growth");
+    CPPUNIT_ASSERT( 2 == t.positions );
+    CPPUNIT_ASSERT( 0 == t.priced );
+    CPPUNIT_ASSERT( 0 == t.value );
+    CPPUNIT_ASSERT( 0 == t.cost );
+
+    CPPUNIT_ASSERT( b.update(1,12000) );
+    t = totals_of(b,"growth");
+    CPPUNIT_ASSERT( 1 == t.priced );
+    CPPUNIT_ASSERT( 1200000 == t.value );
+    CPPUNIT_ASSERT( 1000000 == t.cost );
+    CPPUNIT_ASSERT( 200000 == t.pnl );
+
+    CPPUNIT_ASSERT( b.update(2,4000) );
+    CPPUNIT_ASSERT( b.update(1,11000) );
+    t = totals_of(b,"growth");
+    CPPUNIT_ASSERT( 2 == t.priced );
+    CPPUNIT_ASSERT( 1100000-200000 == t.value );
+
+    /* Symbols nobody holds */
+    CPPUNIT_ASSERT( !b.update(3,100) );
+    CPPUNIT_ASSERT( !b.update(1000,100) );
+    CPPUNIT_ASSERT( 3 == b.updates() );
+
+    /* Adding to a position */
+    b.hold({ {"growth",1,100,1200000} });
+    t = totals_of(b,"growth");
+    CPPUNIT_ASSERT( 2 == t.positions );
+    CPPUNIT_ASSERT( 2200000-200000 == t.value );
+    CPPUNIT_ASSERT( 2200000 == t.cost );
+
+    std::vector<portfoliobook::holding> h;
+    portfoliobook::id_t id;
+    CPPUNIT_ASSERT( b.find("growth",id) );
+    CPPUNIT_ASSERT( b.holdings(id,h,&t) );
+    CPPUNIT_ASSERT( 2 == h.size() );
+    CPPUNIT_ASSERT( 1 == h[0].symbol );
+    CPPUNIT_ASSERT( 200 == h[0].quantity );
+    CPPUNIT_ASSERT( 2200000 == h[0].value );
+    CPPUNIT_ASSERT( -200000 == h[1].value );
+    CPPUNIT_ASSERT( h[0].weight == 2200000.0/2000000 );
+    CPPUNIT_ASSERT( h[1].weight == -0.1 );
+
+    CPPUNIT_ASSERT( !b.find("income",id) );
+    CPPUNIT_ASSERT( !b.value(7,t) );
+    CPPUNIT_ASSERT( !b.holdings(7,h) );
+
+    b.clear();
+    CPPUNIT_ASSERT( 0 == b.portfolios() );
+    CPPUNIT_ASSERT( !b.update(1,100) );
+}
+
+/**
+ * Tests that one quote revalues every portfolio holding the symbol
+ */
+void PortfolioBookTestFixture::testSharedSymbols()
+{
+    portfoliobook b;
+    std::vector<portfoliobook::entry> entries;
+    for ( unsigned p=0; p<100; p++ )
+	for ( uint32_t s=1; s<=10; s++ )
+	    entries.push_back( {"p"+std::to_string(p),s,p+1,0} );
+    b.hold(entries);
+    CPPUNIT_ASSERT( 100 == b.portfolios() );
+    CPPUNIT_ASSERT( 10 == b.symbols().size() );
+
+    CPPUNIT_ASSERT( b.update(5,10000) );
+    for ( unsigned p=0; p<100; p++ )
+    {
+	const portfoliobook::totals t = totals_of(b,"p"+std::to_string(p));
+	CPPUNIT_ASSERT( 10 == t.positions );
+	CPPUNIT_ASSERT( 1 == t.priced );
+	CPPUNIT_ASSERT( (p+1)*10000 == t.value );
+    }
+}
+
+/**
+ * Tests that positions added in symbols already quoted are valued at once
+ */
+void PortfolioBookTestFixture::testHoldQuoted()
+{
+    portfoliobook b;
+    b.hold({ {"a",1,10,0} });
+    b.update(1,5000);
+
+    b.hold({ {"b",1,3,6000}, {"b",2,1,0} });
+    portfoliobook::totals t = totals_of(b,"b");
+    CPPUNIT_ASSERT( 1 == t.priced );
+    CPPUNIT_ASSERT( 15000 == t.value );
+    CPPUNIT_ASSERT( 6000 == t.cost );
+    CPPUNIT_ASSERT( 9000 == t.pnl );
+
+    /* Ids survive new layouts */
+    portfoliobook::id_t id;
+    CPPUNIT_ASSERT( b.find("a",id) );
+    CPPUNIT_ASSERT( 0 == id );
+    CPPUNIT_ASSERT( 50000 == totals_of(b,"a").value );
+}
+
+/**
+ * Tests loading holdings from a file
+ */
+void PortfolioBookTestFixture::testLoad()
+{
+    {
+	std::ofstream out(_path);
+	out << "# portfolio ticker quantity cost\n"
+	    << "growth AAPL 100 125.50\n"
+	    << "\n"
+	    << "  income\tT  -200   # short\n"
+	    << "growth MSFT 50 40\n"
+	    << "growth AAPL 10 130\n";
+    }
+
+    interner intern;
+    portfoliobook b;
+    unsigned line = 99;
+    CPPUNIT_ASSERT( b.load(_path,std::ref(intern),&line) );
+    CPPUNIT_ASSERT( 0 == line );
+    CPPUNIT_ASSERT( 2 == b.portfolios() );
+    CPPUNIT_ASSERT( 3 == b.symbols().size() );
+
+    b.update(intern("AAPL"),1300000);
+    b.update(intern("T"),330000);
+    portfoliobook::totals t = totals_of(b,"growth");
+    CPPUNIT_ASSERT( 2 == t.positions );
+    CPPUNIT_ASSERT( 110*1300000 == t.value );
+    CPPUNIT_ASSERT( 100*1255000+10*1300000 == t.cost );
+    t = totals_of(b,"income");
+    CPPUNIT_ASSERT( -200*330000 == t.value );
+    CPPUNIT_ASSERT( 0 == t.cost );
+
+    /* Nothing is added from a file with a bad line */
+    {
+	std::ofstream out(_path);
+	out << "value IBM 10\n"
+	    << "value GE ten\n";
+    }
+    CPPUNIT_ASSERT( !b.load(_path,std::ref(intern),&line) );
+    CPPUNIT_ASSERT( 2 == line );
+    CPPUNIT_ASSERT( 2 == b.portfolios() );
+
+    for ( const char* bad : { "value GE\n", "value GE 1 2 3\n", "value GE 1 x\n" } )
+    {
+	std::ofstream(_path) << bad;
+	CPPUNIT_ASSERT( !b.load(_path,std::ref(intern),&line) );
+	CPPUNIT_ASSERT( 1 == line );
+    }
+
+    CPPUNIT_ASSERT( !b.load(_path+"-missing",std::ref(intern),&line) );
+    CPPUNIT_ASSERT( 0 == line );
+}
+
+/**
+ * Tests that queries see each portfolio as it stood after some update, while
+ * quotes arrive and holdings are added
+ */
+void PortfolioBookTestFixture::testConcurrent()
+{
+    portfoliobook b;
+    std::vector<portfoliobook::entry> entries;
+    for ( uint32_t s=1; s<=50; s++ )
+	entries.push_back( {"shared",s,s,0} );
+    b.hold(entries);
+
+    std::atomic<bool> stop{false};
+    std::thread quotes( [&]()
+			{
+			    for ( int64_t price=1; !stop; price++ )
+				for ( uint32_t s=1; s<=50; s++ )
+				    b.update(s,price*s);
+			} );
+    std::thread adds( [&]()
+		      {
+			  for ( unsigned p=0; p<200; p++ )
+			      b.hold({ {"p"+std::to_string(p),p%50+1,1,0} });
+		      } );
+
+    portfoliobook::id_t id;
+    CPPUNIT_ASSERT( b.find("shared",id) );
+    unsigned reads = 0;
+    for ( ; (reads<20000) || (b.portfolios()<201); reads++ )
+    {
+	std::vector<portfoliobook::holding> h;
+	portfoliobook::totals t;
+	CPPUNIT_ASSERT( b.holdings(id,h,&t) );
+	int64_t sum = 0;
+	unsigned priced = 0;
+	for ( const portfoliobook::holding& p : h )
+	{
+	    sum += p.value;
+	    priced += p.priced;
+	}
+	CPPUNIT_ASSERT( sum == t.value );
+	CPPUNIT_ASSERT( priced == t.priced );
+    }
+
+    adds.join();
+    stop = true;
+    quotes.join();
+    CPPUNIT_ASSERT( 201 == b.portfolios() );
+}
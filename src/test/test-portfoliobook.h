@@ -0,0 +1,47 @@
+#ifndef TEST_PORTFOLIOBOOK_H
+#define TEST_PORTFOLIOBOOK_H
+
+#include <string>
+
+#include <cppunit/TestFixture.h>
+#include <cppunit/TestAssert.h>
+#include <cppunit/TestCaller.h>
+#include <cppunit/TestSuite.h>
+#include <cppunit/TestCase.h>
+
+#include <cppunit/extensions/TestFactoryRegistry.h>
+#include <cppunit/extensions/HelperMacros.h>
+
+class PortfolioBookTestFixture : public CppUnit::TestFixture
+{
+public:
+    PortfolioBookTestFixture();
+    virtual ~PortfolioBookTestFixture();
+
+    void setUp();
+    void tearDown();
+
+    /** @name Test Cases */
+    // @{
+    void testUpdate();
+    void testSharedSymbols();
+    void testHoldQuoted();
+    void testLoad();
+    void testConcurrent();
+    // @}
+
+    /** \cond internal */
+    CPPUNIT_TEST_SUITE( PortfolioBookTestFixture );
+    CPPUNIT_TEST( testUpdate );
+    CPPUNIT_TEST( testSharedSymbols );
+    CPPUNIT_TEST( testHoldQuoted );
+    CPPUNIT_TEST( testLoad );
+    CPPUNIT_TEST( testConcurrent );
+    CPPUNIT_TEST_SUITE_END();
+    /** \endcond */
+
+private:
+    std::string _path;
+};
+
+#endif
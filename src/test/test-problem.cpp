@@ -1,3 +1,5 @@
+#include <vector>
+
 #include "test-problem.h"
 #include <stocklib/problem.h>
 #include <stocklib/urltask.h>
@@ -71,4 +73,91 @@ void ProblemTestFixture::testContainedProblem()
     CPPUNIT_ASSERT( r == WorkResult::Success );
 }
 
+/**
+ * Tests that a map_problem returns every output, in input order, whatever
+ * the thread count and chunk size
+ */
+void ProblemTestFixture::testMapProblem()
+{
+    std::vector<int> inputs;
+    for ( int i=0; i<10000; i++ )
+	inputs.push_back(i);
+
+    auto square = [](const int& x) { return x*x; };
+
+    for ( unsigned threads : {0u,1u,3u,16u} )
+	for ( std::size_t chunk : {0u,1u,7u,20000u} )
+	{
+	    map_problem<int,int> m(square,inputs,threads,chunk);
+	    std::vector<element_result<int>> out = m.solve();
 
+	    CPPUNIT_ASSERT( inputs.size() == out.size() );
+	    for ( int i=0; i<10000; i++ )
+		CPPUNIT_ASSERT( out[i].ok && (out[i].value == i*i) );
+	}
+
+    map_problem<int,int> empty(square,std::vector<int>());
+    CPPUNIT_ASSERT( empty.solve().empty() );
+}
+
+/**
+ * Tests that errors are reported against the failing elements only
+ */
+void ProblemTestFixture::testMapProblemErrors()
+{
+    std::vector<int> inputs = {4,0,2,0,1};
+
+    map_problem<int,int> m( [](const int& x)
+			    {
+				if (!x)
+				    throw std::domain_error("division by zero");
+				return 8/x;
+			    }, inputs );
+
+    std::vector<element_result<int>> out = m.solve();
+
+    CPPUNIT_ASSERT( out[0].ok && (2==out[0].value) );
+    CPPUNIT_ASSERT( !out[1].ok && ("division by zero"==out[1].error) );
+    CPPUNIT_ASSERT( out[2].ok && (4==out[2].value) );
+    CPPUNIT_ASSERT( !out[3].ok );
+    CPPUNIT_ASSERT( out[4].ok && (8==out[4].value) );
+}
+
+/**
+ * Tests running a map_problem through the task machinery
+ */
+void ProblemTestFixture::testMapProblemTask()
+{
+    typedef task<std::vector<int>,std::vector<element_result<int>>> maptask;
+
+    std::vector<int> inputs(1000,3);
+    maptask t( new map_problem<int,int>( [](const int& x) { return x+1; }, inputs ) );
+
+    t.perform_async();
+    t.wait();
+
+    CPPUNIT_ASSERT( t.result() == WorkResult::Success );
+    const std::vector<element_result<int>>& out = t.output_ref();
+    CPPUNIT_ASSERT( 1000 == out.size() );
+    CPPUNIT_ASSERT( out[999].ok && (4==out[999].value) );
+}
+
+/**
+ * Tests that an endpoint replaces the origin of each URL, keeping its path
+ * and query
+ */
+void ProblemTestFixture::testEndpoint()
+{
+    const std::string url("https://query.example.com/v1/yql?q=a%2Fb");
+    CPPUNIT_ASSERT( urlproblem::apply_endpoint(url) == url );
+
+    urlproblem::set_endpoint("http://127.0.0.1:8080/");
+    CPPUNIT_ASSERT( urlproblem::apply_endpoint(url) == "http://127.0.0.1:8080/v1/yql?q=a%2Fb" );
+    CPPUNIT_ASSERT( urlproblem::apply_endpoint("http://host") == "http://127.0.0.1:8080" );
+
+    urlproblem::set_endpoint("http://localhost/stub");
+    CPPUNIT_ASSERT( urlproblem::apply_endpoint(url) == "http://localhost/stub/v1/yql?q=a%2Fb" );
+
+    urlproblem::set_endpoint("");
+    CPPUNIT_ASSERT( urlproblem::apply_endpoint(url) == url );
+}
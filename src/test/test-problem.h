@@ -24,6 +24,10 @@ public:
     void testSimpleProblem();
     void testFunctor();
     void testContainedProblem();
+    void testMapProblem();
+    void testMapProblemErrors();
+    void testMapProblemTask();
+    void testEndpoint();
     // @}
 
     /** \cond internal */
@@ -31,6 +35,10 @@ public:
     CPPUNIT_TEST( testSimpleProblem );
     CPPUNIT_TEST( testFunctor );
     CPPUNIT_TEST( testContainedProblem );
+    CPPUNIT_TEST( testMapProblem );
+    CPPUNIT_TEST( testMapProblemErrors );
+    CPPUNIT_TEST( testMapProblemTask );
+    CPPUNIT_TEST( testEndpoint );
     CPPUNIT_TEST_SUITE_END();
     /** \endcond */
 };
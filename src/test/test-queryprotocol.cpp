@@ -0,0 +1,164 @@
+#include <string>
+#include <stdexcept>
+#include <unistd.h>
+#include <sys/socket.h>
+
+#include "test-queryprotocol.h"
+#include <stocklib/queryprotocol.h>
+
+namespace
+{
+    /** @return The body of an encoded frame */
+    std::string body_of(const std::string& frame)
+    {
+	CPPUNIT_ASSERT( frame.size()>=4 );
+	return frame.substr(4);
+    }
+}
+
+QueryProtocolTestFixture::QueryProtocolTestFixture()
+{
+}
+
+QueryProtocolTestFixture::~QueryProtocolTestFixture()
+{
+
+}
+
+void QueryProtocolTestFixture::setUp()
+{
+}
+
+void QueryProtocolTestFixture::tearDown()
+{
+}
+
+/**
+ * Tests that requests survive encoding
+ */
+void QueryProtocolTestFixture::testRequest()
+{
+    queryprotocol::request r;
+    r.op = queryprotocol::quote;
+    r.argument = 5000;
+    r.tickers = { "AAPL", "BRK.B", "" };
+
+    std::string frame;
+    queryprotocol::encode(r,frame);
+
+    queryprotocol::request d;
+    CPPUNIT_ASSERT( queryprotocol::decode(body_of(frame),d) );
+    CPPUNIT_ASSERT( d.op == queryprotocol::quote );
+    CPPUNIT_ASSERT( d.argument == 5000 );
+    CPPUNIT_ASSERT( d.tickers == r.tickers );
+
+    // The longest ticker survives; a longer one is refused, not dropped
+    r.tickers.push_back( std::string(queryprotocol::max_ticker,'X') );
+    queryprotocol::encode(r,frame);
+    CPPUNIT_ASSERT( queryprotocol::decode(body_of(frame),d) );
+    CPPUNIT_ASSERT( d.tickers == r.tickers );
+
+    r.tickers.push_back( std::string(queryprotocol::max_ticker+1,'X') );
+    CPPUNIT_ASSERT_THROW( queryprotocol::encode(r,frame), std::logic_error );
+}
+
+/**
+ * Tests that responses survive encoding, including extreme values
+ */
+void QueryProtocolTestFixture::testResponse()
+{
+    queryprotocol::response r;
+    queryprotocol::quote_record q;
+    q.ticker = "AAPL";
+    q.name = "Apple Inc.";
+    q.price = 1234500;
+    q.timestamp = 1433116800000000LL;
+    q.flags = 3;
+    r.quotes.push_back(q);
+    q.ticker = "NEG";
+    q.name.clear();
+    q.price = INT64_MIN;
+    q.timestamp = INT64_MAX;
+    q.flags = 0;
+    r.quotes.push_back(q);
+
+    std::string frame;
+    queryprotocol::encode(r,frame);
+
+    queryprotocol::response d;
+    CPPUNIT_ASSERT( queryprotocol::decode(body_of(frame),d) );
+    CPPUNIT_ASSERT( d.code == queryprotocol::ok );
+    CPPUNIT_ASSERT( d.quotes.size() == 2 );
+    CPPUNIT_ASSERT( d.quotes[0].ticker == "AAPL" );
+    CPPUNIT_ASSERT( d.quotes[0].name == "Apple Inc." );
+    CPPUNIT_ASSERT( d.quotes[0].price == 1234500 );
+    CPPUNIT_ASSERT( d.quotes[0].timestamp == 1433116800000000LL );
+    CPPUNIT_ASSERT( d.quotes[0].flags == 3 );
+    CPPUNIT_ASSERT( d.quotes[1].name.empty() );
+    CPPUNIT_ASSERT( d.quotes[1].price == INT64_MIN );
+    CPPUNIT_ASSERT( d.quotes[1].timestamp == INT64_MAX );
+}
+
+/**
+ * Tests that truncated, over-long and nonsensical bodies are rejected
+ */
+void QueryProtocolTestFixture::testMalformed()
+{
+    queryprotocol::request r;
+    r.op = queryprotocol::quote;
+    r.tickers = { "AAPL", "MSFT" };
+    std::string frame;
+    queryprotocol::encode(r,frame);
+    const std::string body = body_of(frame);
+
+    queryprotocol::request d;
+    for ( std::size_t n=0; n<body.size(); n++ )
+	CPPUNIT_ASSERT( !queryprotocol::decode(body.substr(0,n),d) );
+    CPPUNIT_ASSERT( !queryprotocol::decode(body+'x',d) );
+
+    std::string bad(body);
+    bad[0] = 99;
+    CPPUNIT_ASSERT( !queryprotocol::decode(bad,d) );
+
+    queryprotocol::response resp;
+    resp.quotes.resize(1);
+    queryprotocol::encode(resp,frame);
+    const std::string rbody = body_of(frame);
+    queryprotocol::response rd;
+    for ( std::size_t n=0; n<rbody.size(); n++ )
+	CPPUNIT_ASSERT( !queryprotocol::decode(rbody.substr(0,n),rd) );
+}
+
+/**
+ * Tests passing frames over a socket, and refusing one too large to accept
+ */
+void QueryProtocolTestFixture::testFrames()
+{
+    int fds[2];
+    CPPUNIT_ASSERT( 0 == socketpair(AF_UNIX,SOCK_STREAM,0,fds) );
+
+    queryprotocol::request r;
+    r.op = queryprotocol::ping;
+    std::string frame;
+    queryprotocol::encode(r,frame);
+    CPPUNIT_ASSERT( queryprotocol::write_frame(fds[0],frame) );
+    CPPUNIT_ASSERT( queryprotocol::write_frame(fds[0],frame) );
+
+    std::string body;
+    queryprotocol::request d;
+    for ( int i=0; i<2; i++ )
+    {
+	CPPUNIT_ASSERT( queryprotocol::read_frame(fds[1],body) );
+	CPPUNIT_ASSERT( queryprotocol::decode(body,d) );
+	CPPUNIT_ASSERT( d.op == queryprotocol::ping );
+    }
+
+    const char huge[4] = { 0, 0, 0, 0x7f };
+    CPPUNIT_ASSERT( 4 == write(fds[0],huge,4) );
+    CPPUNIT_ASSERT( !queryprotocol::read_frame(fds[1],body) );
+
+    close(fds[0]);
+    CPPUNIT_ASSERT( !queryprotocol::read_frame(fds[1],body) );
+    CPPUNIT_ASSERT( !queryprotocol::write_frame(fds[1],frame) );
+    close(fds[1]);
+}
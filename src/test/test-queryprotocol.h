@@ -0,0 +1,40 @@
+#ifndef TEST_QUERYPROTOCOL_H
+#define TEST_QUERYPROTOCOL_H
+
+#include <cppunit/TestFixture.h>
+#include <cppunit/TestAssert.h>
+#include <cppunit/TestCaller.h>
+#include <cppunit/TestSuite.h>
+#include <cppunit/TestCase.h>
+
+#include <cppunit/extensions/TestFactoryRegistry.h>
+#include <cppunit/extensions/HelperMacros.h>
+
+class QueryProtocolTestFixture : public CppUnit::TestFixture
+{
+public:
+    QueryProtocolTestFixture();
+    virtual ~QueryProtocolTestFixture();
+
+    void setUp();
+    void tearDown();
+
+    /** @name Test Cases */
+    // @{
+    void testRequest();
+    void testResponse();
+    void testMalformed();
+    void testFrames();
+    // @}
+
+    /** \cond internal */
+    CPPUNIT_TEST_SUITE( QueryProtocolTestFixture );
+    CPPUNIT_TEST( testRequest );
+    CPPUNIT_TEST( testResponse );
+    CPPUNIT_TEST( testMalformed );
+    CPPUNIT_TEST( testFrames );
+    CPPUNIT_TEST_SUITE_END();
+    /** \endcond */
+};
+
+#endif
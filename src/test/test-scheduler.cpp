@@ -0,0 +1,197 @@
+#include <vector>
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <chrono>
+#include <future>
+#include <memory>
+
+#include "test-scheduler.h"
+#include <stocklib/scheduler.h>
+
+typedef scheduler::priority prio;
+
+SchedulerTestFixture::SchedulerTestFixture()
+{
+}
+
+SchedulerTestFixture::~SchedulerTestFixture()
+{
+
+}
+
+void SchedulerTestFixture::setUp()
+{
+}
+
+void SchedulerTestFixture::tearDown()
+{
+}
+
+/**
+ * Blocks a single-worker scheduler until the returned promise is set, so that
+ * subsequent jobs queue up behind it.
+ */
+static std::shared_ptr<std::promise<void>> block(scheduler& s)
+{
+    auto gate = std::make_shared<std::promise<void>>();
+    auto started = std::make_shared<std::atomic<bool>>(false);
+    std::shared_future<void> f = gate->get_future().share();
+
+    s.submit( [f,started]() { started->store(true); f.wait(); }, prio::normal );
+    while (!started->load())
+	std::this_thread::sleep_for( std::chrono::milliseconds(1) );
+
+    return gate;
+}
+
+/**
+ * Tests that every job runs, across several workers
+ */
+void SchedulerTestFixture::testRunsJobs()
+{
+    std::atomic<int> count{0};
+    {
+	scheduler s(4);
+	for ( int i=0; i<1000; i++ )
+	    s.submit( [&count]() { count++; }, prio::normal );
+
+	while ( count.load() < 1000 )
+	    std::this_thread::sleep_for( std::chrono::milliseconds(1) );
+	CPPUNIT_ASSERT( 0 == s.pending() );
+    }
+    CPPUNIT_ASSERT( 1000 == count.load() );
+}
+
+/**
+ * Tests that an interactive job overtakes a large backlog of bulk jobs
+ */
+void SchedulerTestFixture::testInteractiveOvertakesBulk()
+{
+    std::mutex m;
+    std::vector<int> order;
+    std::atomic<int> done{0};
+
+    scheduler s(1);
+    auto gate = block(s);
+
+    for ( int i=0; i<10000; i++ )
+	s.submit( [&,i]() { std::lock_guard<std::mutex> l(m); order.push_back(i); done++; },
+		  prio::bulk );
+    s.submit( [&]() { std::lock_guard<std::mutex> l(m); order.push_back(-1); done++; },
+	      prio::interactive );
+
+    gate->set_value();
+    while ( done.load() < 10001 )
+	std::this_thread::sleep_for( std::chrono::milliseconds(1) );
+
+    CPPUNIT_ASSERT( -1 == order[0] );
+    for ( int i=0; i<10000; i++ )
+	CPPUNIT_ASSERT( i == order[i+1] );
+}
+
+/**
+ * Tests that explicit deadlines are honoured, whatever the class
+ */
+void SchedulerTestFixture::testExplicitDeadlines()
+{
+    std::mutex m;
+    std::vector<int> order;
+    std::atomic<int> done{0};
+    const auto now = scheduler::clock::now();
+
+    scheduler s(1);
+    auto gate = block(s);
+
+    auto job = [&](int id) { return [&,id]() { std::lock_guard<std::mutex> l(m); order.push_back(id); done++; }; };
+    s.submit( job(3), prio::interactive, now+std::chrono::seconds(3) );
+    s.submit( job(1), prio::bulk, now+std::chrono::seconds(1) );
+    s.submit( job(2), prio::normal, now+std::chrono::seconds(2) );
+
+    gate->set_value();
+    while ( done.load() < 3 )
+	std::this_thread::sleep_for( std::chrono::milliseconds(1) );
+
+    CPPUNIT_ASSERT( (std::vector<int>{1,2,3}) == order );
+}
+
+/**
+ * Tests the per-class queueing statistics
+ */
+void SchedulerTestFixture::testStats()
+{
+    std::atomic<int> done{0};
+
+    scheduler s(1);
+    auto gate = block(s);
+
+    for ( int i=0; i<5; i++ )
+	s.submit( [&done]() { done++; }, prio::bulk );
+
+    CPPUNIT_ASSERT( 5 == s.stats(prio::bulk).queued );
+    CPPUNIT_ASSERT( 0 == s.stats(prio::bulk).dispatched );
+
+    std::this_thread::sleep_for( std::chrono::milliseconds(20) );
+    gate->set_value();
+    while ( done.load() < 5 )
+	std::this_thread::sleep_for( std::chrono::milliseconds(1) );
+
+    const scheduler::stats_t st = s.stats(prio::bulk);
+    CPPUNIT_ASSERT( 0 == st.queued );
+    CPPUNIT_ASSERT( 5 == st.dispatched );
+    CPPUNIT_ASSERT( st.max_delay_us >= 20000 );
+    CPPUNIT_ASSERT( st.total_delay_us >= 5*20000 );
+    CPPUNIT_ASSERT( 0 == s.stats(prio::interactive).dispatched );
+
+    s.reset_stats();
+    CPPUNIT_ASSERT( 0 == s.stats(prio::bulk).dispatched );
+}
+
+/**
+ * Tests that adding workers to a running scheduler lets blocked work proceed
+ */
+void SchedulerTestFixture::testReserve()
+{
+    scheduler s(1);
+    auto gate = block(s);
+
+    std::atomic<bool> ran{false};
+    s.submit( [&ran]() { ran = true; }, prio::normal );
+    std::this_thread::sleep_for( std::chrono::milliseconds(10) );
+    CPPUNIT_ASSERT( !ran.load() );
+
+    s.reserve(2);
+    CPPUNIT_ASSERT( 2 == s.workers() );
+    while ( !ran.load() )
+	std::this_thread::sleep_for( std::chrono::milliseconds(1) );
+
+    s.reserve(1);
+    CPPUNIT_ASSERT( 2 == s.workers() );
+    gate->set_value();
+}
+
+/**
+ * Tests that jobs still queued when the scheduler is destroyed are run, not
+ * dropped
+ */
+void SchedulerTestFixture::testDestructorRunsQueued()
+{
+    std::atomic<int> count{0};
+    std::thread release;
+    {
+	scheduler s(1);
+	auto gate = block(s);
+	for ( int i=0; i<10; i++ )
+	    s.submit( [&count]() { count++; }, prio::bulk );
+
+	// Open the gate only once the destructor has begun
+	release = std::thread( [gate]()
+	{
+	    std::this_thread::sleep_for( std::chrono::milliseconds(20) );
+	    gate->set_value();
+	} );
+    }
+    release.join();
+
+    CPPUNIT_ASSERT( 10 == count.load() );
+}
@@ -0,0 +1,44 @@
+#ifndef TEST_SCHEDULER_H
+#define TEST_SCHEDULER_H
+
+#include <cppunit/TestFixture.h>
+#include <cppunit/TestAssert.h>
+#include <cppunit/TestCaller.h>
+#include <cppunit/TestSuite.h>
+#include <cppunit/TestCase.h>
+
+#include <cppunit/extensions/TestFactoryRegistry.h>
+#include <cppunit/extensions/HelperMacros.h>
+
+class SchedulerTestFixture : public CppUnit::TestFixture
+{
+public:
+    SchedulerTestFixture();
+    virtual ~SchedulerTestFixture();
+
+    void setUp();
+    void tearDown();
+
+    /** @name Test Cases */
+    // @{
+    void testRunsJobs();
+    void testInteractiveOvertakesBulk();
+    void testExplicitDeadlines();
+    void testStats();
+    void testReserve();
+    void testDestructorRunsQueued();
+    // @}
+
+    /** \cond internal */
+    CPPUNIT_TEST_SUITE( SchedulerTestFixture );
+    CPPUNIT_TEST( testRunsJobs );
+    CPPUNIT_TEST( testInteractiveOvertakesBulk );
+    CPPUNIT_TEST( testExplicitDeadlines );
+    CPPUNIT_TEST( testStats );
+    CPPUNIT_TEST( testReserve );
+    CPPUNIT_TEST( testDestructorRunsQueued );
+    CPPUNIT_TEST_SUITE_END();
+    /** \endcond */
+};
+
+#endif
@@ -258,3 +258,90 @@ void StateTestFixture::testHoldExplicitLock()
 
     CPPUNIT_ASSERT( pLoadedMachine->get_state()==TestState::Died );
 }
+
+/**
+ * Tests waiting on a set of states
+ */
+void StateTestFixture::testWaitForAnyState()
+{
+    pLoadedMachine->initialize(TestState::Idle);
+
+    // Already in one of the states - returns immediately
+    CPPUNIT_ASSERT( TestState::Idle ==
+		    pLoadedMachine->wait_for_any_state( { TestState::Idle, TestState::Died } ) );
+
+    TestState entered = TestState::Idle;
+    std::thread t( [this,&entered]()
+		   {
+		       entered = this->pLoadedMachine->wait_for_any_state( { TestState::Running,
+									     TestState::Died } );
+		   } );
+
+    std::this_thread::sleep_for( std::chrono::milliseconds(50) );
+    pLoadedMachine->action(TestAction::Start);
+    t.join();
+
+    CPPUNIT_ASSERT( entered==TestState::Running );
+}
+
+/**
+ * Tests that a deadline is honoured when the state is never entered
+ */
+void StateTestFixture::testWaitForAnyStateTimeout()
+{
+    typedef state_machine<TestState,TestAction>::clock clock;
+
+    pLoadedMachine->initialize(TestState::Idle);
+
+    auto start = clock::now();
+    bool entered = pLoadedMachine->wait_for_any_state( { TestState::Died },
+						       start + std::chrono::milliseconds(50) );
+
+    CPPUNIT_ASSERT( !entered );
+    CPPUNIT_ASSERT( clock::now()-start >= std::chrono::milliseconds(50) );
+}
+
+/**
+ * Tests that a transition only wakes threads waiting on the state entered
+ */
+void StateTestFixture::testTargetedWakeup()
+{
+    typedef state_machine<TestState,TestAction>::clock clock;
+
+    pLoadedMachine->initialize(TestState::Idle);
+
+    bool runningSeen{false};
+    bool diedSeenEarly{true};
+    clock::duration diedWaited{0};
+
+    std::thread waitRunning( [this,&runningSeen]()
+			     {
+				 runningSeen = this->pLoadedMachine->wait_for_any_state(
+				     { TestState::Running },
+				     clock::now() + std::chrono::seconds(5) );
+			     } );
+
+    std::thread waitDied( [this,&diedSeenEarly,&diedWaited]()
+			  {
+			      // Must time out: entry into Running must not satisfy this wait
+			      const auto start = clock::now();
+			      diedSeenEarly = this->pLoadedMachine->wait_for_any_state(
+				  { TestState::Died },
+				  start + std::chrono::milliseconds(200) );
+			      diedWaited = clock::now() - start;
+			  } );
+
+    pLoadedMachine->action(TestAction::Start);
+
+    waitRunning.join();
+    waitDied.join();
+
+    // The Running waiter returns; the Died waiter sleeps through the
+    // transition until its own deadline
+    CPPUNIT_ASSERT( runningSeen );
+    CPPUNIT_ASSERT( !diedSeenEarly );
+    CPPUNIT_ASSERT( diedWaited >= std::chrono::milliseconds(200) );
+
+    pLoadedMachine->action(TestAction::Stop);
+    pLoadedMachine->wait_for_state_entry(TestState::Died);
+}
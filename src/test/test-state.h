@@ -40,6 +40,9 @@ public:
     void testExitFunction();
     void testInitialize();
     void testHoldExplicitLock();
+    void testWaitForAnyState();
+    void testWaitForAnyStateTimeout();
+    void testTargetedWakeup();
     // @}
 
     /** \cond internal */
@@ -58,6 +61,9 @@ public:
     CPPUNIT_TEST( testExitFunction );
     CPPUNIT_TEST( testInitialize );
     CPPUNIT_TEST( testHoldExplicitLock );
+    CPPUNIT_TEST( testWaitForAnyState );
+    CPPUNIT_TEST( testWaitForAnyStateTimeout );
+    CPPUNIT_TEST( testTargetedWakeup );
     CPPUNIT_TEST_SUITE_END();
     /** \endcond */
 
@@ -1,8 +1,18 @@
 #include <string.h>
+#include <stdlib.h>
+#include <unistd.h>
 #include <thread>
+#include <mutex>
+#include <map>
+#include <vector>
+#include <string>
+#include <chrono>
+#include <atomic>
+#include <stdexcept>
 
 #include "test-stocklib.h"
 #include <stocklib/stocklib_p.h>
+#include <stocklib/tickarchive.h>
 
 StockLibTestFixture::StockLibTestFixture()
 {
@@ -16,6 +26,8 @@ StockLibTestFixture::~StockLibTestFixture()
 
 void StockLibTestFixture::setUp()
 {
+    // Keep the tests away from the user's persistent name cache
+    setenv("STOCKLIB_NAMECACHE","",1);
     stocklib_init();
 }
 
@@ -205,3 +217,689 @@ void StockLibTestFixture::testNameCacheIndirectCache()
 
     CPPUNIT_ASSERT( 0==strcmp("Test Inc.",stocklib_ticker_to_name("ANYTHING") ) );
 }
+
+void StockLibTestFixture::testHandleRecycling()
+{
+    char buffer[32];
+    stocklib_p_test_mode(true);
+    stocklib_p_test_behavior( SLTBNormalRequest );
+
+    CPPUNIT_ASSERT( 0 == stocklib_p_pooled_handles() );
+
+    SLHANDLE h1 = stocklib_fetch_asynch("ANYTHING",buffer);
+    CPPUNIT_ASSERT( SL_OK == stocklib_asynch_wait(h1) );
+    stocklib_asynch_dispose(h1);
+    CPPUNIT_ASSERT( 1 == stocklib_p_pooled_handles() );
+
+    /* The disposed handle is re-used, and retargeted at the new ticker */
+    stocklib_p_test_behavior( SLTBGibberishRequest );
+    SLHANDLE h2 = stocklib_fetch_asynch("NOTHING",buffer);
+    CPPUNIT_ASSERT( h2 == h1 );
+    CPPUNIT_ASSERT( 0 == stocklib_p_pooled_handles() );
+    CPPUNIT_ASSERT( SL_FAIL == stocklib_asynch_wait(h2) );
+    stocklib_asynch_dispose(h2);
+
+    /* Synchronous requests draw from the same pool */
+    stocklib_p_test_behavior( SLTBNormalRequest );
+    CPPUNIT_ASSERT( SL_OK == stocklib_fetch_synch("ANYTHING",buffer) );
+    CPPUNIT_ASSERT( 1 == stocklib_p_pooled_handles() );
+    CPPUNIT_ASSERT( strcmp(buffer,"99.99")==0 );
+}
+
+void StockLibTestFixture::testQuoteSynch()
+{
+    sl_quote_t q;
+    stocklib_p_test_mode(true);
+    stocklib_p_test_behavior( SLTBNormalRequest );
+
+    CPPUNIT_ASSERT( SL_OK == stocklib_fetch_quote_synch("ANYTHING",&q) );
+    CPPUNIT_ASSERT( q.price == 999900 );
+    CPPUNIT_ASSERT( q.symbol == stocklib_symbol_id("ANYTHING") );
+    CPPUNIT_ASSERT( q.flags == (SLQFPrice|SLQFName) );
+    CPPUNIT_ASSERT( q.timestamp > 0 );
+    CPPUNIT_ASSERT( 0==strcmp("Test Inc.",stocklib_p_namecache_resolve("ANYTHING")) );
+}
+
+void StockLibTestFixture::testQuoteAsynch()
+{
+    sl_quote_t q;
+    stocklib_p_test_mode(true);
+    stocklib_p_test_behavior( SLTBNormalRequest );
+
+    SLHANDLE h = stocklib_fetch_quote_asynch("ANYTHING",&q);
+    CPPUNIT_ASSERT( q.symbol == stocklib_symbol_id("ANYTHING") );
+
+    CPPUNIT_ASSERT( SL_OK == stocklib_asynch_wait(h) );
+    stocklib_asynch_dispose(h);
+
+    CPPUNIT_ASSERT( q.price == 999900 );
+    CPPUNIT_ASSERT( q.flags & SLQFPrice );
+}
+
+void StockLibTestFixture::testQuoteFailure()
+{
+    sl_quote_t q;
+    stocklib_p_test_mode(true);
+    stocklib_p_test_behavior( SLTBGibberishRequest );
+
+    CPPUNIT_ASSERT( SL_FAIL == stocklib_fetch_quote_synch("ANYTHING",&q) );
+    CPPUNIT_ASSERT( q.symbol == stocklib_symbol_id("ANYTHING") );
+    CPPUNIT_ASSERT( q.flags == SLQFNone );
+}
+
+void StockLibTestFixture::testSymbolIds()
+{
+    sl_symbol_t a = stocklib_symbol_id("AAPL");
+    sl_symbol_t b = stocklib_symbol_id("MSFT");
+
+    CPPUNIT_ASSERT( a != b );
+    CPPUNIT_ASSERT( a == stocklib_symbol_id("AAPL") );
+    CPPUNIT_ASSERT( 0==strcmp("MSFT",stocklib_symbol_name(b)) );
+    CPPUNIT_ASSERT( NULL==stocklib_symbol_name(b+1000) );
+}
+
+void StockLibTestFixture::testFormatPrice()
+{
+    char buffer[SL_MAX_BUFFER];
+
+    stocklib_format_price(999900,buffer);
+    CPPUNIT_ASSERT( 0==strcmp("99.99",buffer) );
+
+    stocklib_format_price(1234567,buffer);
+    CPPUNIT_ASSERT( 0==strcmp("123.4567",buffer) );
+
+    stocklib_format_price(50000,buffer);
+    CPPUNIT_ASSERT( 0==strcmp("5.00",buffer) );
+
+    stocklib_format_price(-1500,buffer);
+    CPPUNIT_ASSERT( 0==strcmp("-0.15",buffer) );
+}
+
+void StockLibTestFixture::testNameCachePersistence()
+{
+    char path[] = "/tmp/stocklib-names-XXXXXX";
+    close(mkstemp(path));
+    unlink(path);
+
+    setenv("STOCKLIB_NAMECACHE",path,1);
+    stocklib_p_reset();
+    stocklib_init();
+
+    stocklib_p_namecache_insert("TEST","Test Company Inc.");
+
+    /* A fresh start sees the name, without a lookup */
+    stocklib_p_reset();
+    stocklib_init();
+    CPPUNIT_ASSERT( 0 == stocklib_p_namecache_count() );
+
+    stocklib_p_test_mode(true);
+    stocklib_p_test_behavior( SLTBGibberishRequest );
+    const char* pName = stocklib_ticker_to_name("TEST");
+    CPPUNIT_ASSERT( pName != NULL );
+    CPPUNIT_ASSERT( 0==strcmp("Test Company Inc.",pName) );
+
+    /* Names fetched in test mode are not persisted */
+    stocklib_p_test_behavior( SLTBNormalRequest );
+    CPPUNIT_ASSERT( 0==strcmp("Test Inc.",stocklib_ticker_to_name("ANYTHING")) );
+    stocklib_p_reset();
+    stocklib_init();
+    CPPUNIT_ASSERT( !stocklib_p_namecache_has_ticker("ANYTHING") );
+
+    unlink(path);
+}
+
+/**
+ * Tests that a limited name cache holds no more than its capacity
+ */
+void StockLibTestFixture::testNameCacheLimit()
+{
+    stocklib_namecache_configure(16,SLEVFifo);
+
+    for ( int i=0; i<100; i++ )
+	stocklib_p_namecache_insert( ("T"+std::to_string(i)).c_str(), "Test Inc." );
+
+    CPPUNIT_ASSERT( stocklib_p_namecache_count() <= 16 );
+    CPPUNIT_ASSERT( stocklib_p_namecache_has_ticker("T99") );
+    CPPUNIT_ASSERT( !stocklib_p_namecache_has_ticker("T0") );
+
+    stocklib_namecache_configure(0,SLEVClock);
+}
+
+/**
+ * Tests asynchronous fetches with priority classes, and the queueing
+ * statistics they leave behind
+ */
+void StockLibTestFixture::testPriorityFetch()
+{
+    char buffer[SL_MAX_BUFFER];
+    sl_quote_t q;
+    sl_queue_stats_t stats;
+
+    stocklib_p_test_mode(true);
+    stocklib_p_test_behavior( SLTBNormalRequest );
+
+    SLHANDLE h1 = stocklib_fetch_asynch("ANYTHING",buffer,SLPRInteractive);
+    SLHANDLE h2 = stocklib_fetch_quote_asynch("ANYTHING",&q,SLPRBulk);
+    CPPUNIT_ASSERT( SL_OK == stocklib_asynch_wait(h1) );
+    CPPUNIT_ASSERT( SL_OK == stocklib_asynch_wait(h2) );
+    stocklib_asynch_dispose(h1);
+    stocklib_asynch_dispose(h2);
+
+    CPPUNIT_ASSERT( 0==strcmp("99.99",buffer) );
+    CPPUNIT_ASSERT( q.flags & SLQFPrice );
+
+    stocklib_queue_stats(SLPRInteractive,&stats);
+    CPPUNIT_ASSERT( 1 == stats.dispatched );
+    CPPUNIT_ASSERT( 0 == stats.queued );
+    stocklib_queue_stats(SLPRBulk,&stats);
+    CPPUNIT_ASSERT( 1 == stats.dispatched );
+    stocklib_queue_stats(SLPRNormal,&stats);
+    CPPUNIT_ASSERT( 0 == stats.dispatched );
+}
+
+/**
+ * Tests that once a request is seen to be complete by polling, its output
+ * has been written, and that polling a disposed handle is rejected
+ */
+void StockLibTestFixture::testPollingCompletion()
+{
+    char buffer[SL_MAX_BUFFER] = "";
+    stocklib_p_test_mode(true);
+    stocklib_p_test_behavior( SLTBNormalRequest );
+
+    SLHANDLE h = stocklib_fetch_asynch("ANYTHING",buffer,SLPRInteractive);
+    while (!stocklib_is_complete(h))
+	std::this_thread::yield();
+
+    CPPUNIT_ASSERT( 0==strcmp("99.99",buffer) );
+    CPPUNIT_ASSERT( SL_OK == stocklib_asynch_result(h) );
+    stocklib_asynch_wait(h);
+    stocklib_asynch_dispose(h);
+
+    // The disposed task is pooled, not freed, so it can still be checked
+    CPPUNIT_ASSERT_THROW( stocklib_is_complete(h), std::logic_error );
+}
+
+namespace
+{
+    struct subscription_counts
+    {
+	std::mutex m;
+	std::map<sl_symbol_t,int> quotes;
+	int bad{0};
+    };
+
+    void count_quote(const sl_quote_t* quote, void* data)
+    {
+	subscription_counts* c = static_cast<subscription_counts*>(data);
+	std::lock_guard<std::mutex> l(c->m);
+	c->quotes[quote->symbol]++;
+	if ( !(quote->flags & SLQFPrice) || (quote->price!=999900) )
+	    c->bad++;
+    }
+}
+
+/**
+ * Tests that subscribed symbols are refreshed in batched requests, and that
+ * the callback stops once unsubscribed
+ */
+void StockLibTestFixture::testSubscribe()
+{
+    const char* tickers[] = { "AAA", "BBB", "CCC" };
+    subscription_counts c;
+    uint64_t requests, symbols;
+
+    stocklib_p_test_mode(true);
+    stocklib_p_test_behavior( SLTBNormalRequest );
+
+    CPPUNIT_ASSERT( 0 == stocklib_subscribe(tickers,0,10,&count_quote,&c) );
+
+    const sl_subscription_t s = stocklib_subscribe(tickers,3,10,&count_quote,&c);
+    CPPUNIT_ASSERT( 0 != s );
+
+    for ( int i=0; i<1000; i++ )
+    {
+	{
+	    std::lock_guard<std::mutex> l(c.m);
+	    int fresh = 0;
+	    for ( const auto& q : c.quotes )
+		fresh += (q.second>=3) ? 1 : 0;
+	    if (fresh==3)
+		break;
+	}
+	std::this_thread::sleep_for( std::chrono::milliseconds(1) );
+    }
+
+    CPPUNIT_ASSERT( SL_OK == stocklib_unsubscribe(s) );
+    CPPUNIT_ASSERT( SL_FAIL == stocklib_unsubscribe(s) );
+
+    std::lock_guard<std::mutex> l(c.m);
+    CPPUNIT_ASSERT( 3 == c.quotes.size() );
+    CPPUNIT_ASSERT( 1 == c.quotes.count(stocklib_symbol_id("BBB")) );
+    CPPUNIT_ASSERT( 0 == c.bad );
+    CPPUNIT_ASSERT( stocklib_p_namecache_has_ticker("CCC") );
+
+    stocklib_p_subscription_stats(&requests,&symbols);
+    CPPUNIT_ASSERT( requests > 0 );
+    CPPUNIT_ASSERT( requests < symbols );
+}
+
+/**
+ * Tests that a full batch of symbols, whose response is several kilobytes,
+ * is received and decoded whole
+ */
+void StockLibTestFixture::testSubscribeFullBatch()
+{
+    std::vector<std::string> names;
+    std::vector<const char*> tickers;
+    for ( int i=0; i<50; i++ )
+	names.push_back( "BATCH" + std::to_string(i) );
+    for ( const std::string& n : names )
+	tickers.push_back( n.c_str() );
+    subscription_counts c;
+
+    stocklib_p_test_mode(true);
+    stocklib_p_test_behavior( SLTBNormalRequest );
+
+    // Aligned, so that all fifty are fetched in one request
+    const sl_subscription_t s = stocklib_subscribe(tickers.data(),50,1000,&count_quote,&c,
+						   SLSFAligned);
+    for ( int i=0; i<1000; i++ )
+    {
+	{
+	    std::lock_guard<std::mutex> l(c.m);
+	    if (c.quotes.size()==50)
+		break;
+	}
+	std::this_thread::sleep_for( std::chrono::milliseconds(1) );
+    }
+    CPPUNIT_ASSERT( SL_OK == stocklib_unsubscribe(s) );
+
+    std::lock_guard<std::mutex> l(c.m);
+    CPPUNIT_ASSERT( 50 == c.quotes.size() );
+    CPPUNIT_ASSERT( 0 == c.bad );
+}
+
+/**
+ * Tests that a subscription for changes only receives each unchanging
+ * symbol once
+ */
+void StockLibTestFixture::testSubscribeChangesOnly()
+{
+    const char* tickers[] = { "AAA", "BBB" };
+    subscription_counts c;
+    uint64_t requests, symbols, suppressed = 0;
+
+    stocklib_p_test_mode(true);
+    stocklib_p_test_behavior( SLTBNormalRequest );
+
+    const sl_subscription_t s = stocklib_subscribe(tickers,2,5,&count_quote,&c,
+						   SLSFChangesOnly);
+    for ( int i=0; (i<1000) && (suppressed<6); i++ )
+    {
+	std::this_thread::sleep_for( std::chrono::milliseconds(1) );
+	stocklib_p_subscription_stats(&requests,&symbols,&suppressed);
+    }
+    CPPUNIT_ASSERT( SL_OK == stocklib_unsubscribe(s) );
+
+    std::lock_guard<std::mutex> l(c.m);
+    CPPUNIT_ASSERT( suppressed >= 6 );
+    CPPUNIT_ASSERT( 2 == c.quotes.size() );
+    CPPUNIT_ASSERT( 1 == c.quotes[stocklib_symbol_id("AAA")] );
+    CPPUNIT_ASSERT( 1 == c.quotes[stocklib_symbol_id("BBB")] );
+    CPPUNIT_ASSERT( 0 == c.bad );
+}
+
+/**
+ * Tests that decoded prices are recorded in the tick history
+ */
+void StockLibTestFixture::testHistory()
+{
+    char buffer[SL_MAX_BUFFER];
+    sl_quote_t q;
+    int64_t ts[8], prices[8];
+
+    stocklib_p_test_mode(true);
+    stocklib_p_test_behavior( SLTBNormalRequest );
+
+    const sl_symbol_t symbol = stocklib_symbol_id("HIST");
+    CPPUNIT_ASSERT( 0 == stocklib_history(symbol,0,INT64_MAX,ts,prices,8) );
+
+    CPPUNIT_ASSERT( SL_OK == stocklib_fetch_quote_synch("HIST",&q) );
+    CPPUNIT_ASSERT( SL_OK == stocklib_fetch_synch("HIST",buffer) );
+    CPPUNIT_ASSERT( SL_OK == stocklib_fetch_quote_synch("HIST",&q) );
+
+    CPPUNIT_ASSERT( 3 == stocklib_history(symbol,0,INT64_MAX,ts,prices,8) );
+    CPPUNIT_ASSERT( ts[0] <= ts[1] && ts[1] <= ts[2] );
+    CPPUNIT_ASSERT( q.timestamp == ts[2] );
+    CPPUNIT_ASSERT( 999900 == prices[0] && 999900 == prices[2] );
+
+    CPPUNIT_ASSERT( 1 == stocklib_history(symbol,q.timestamp,q.timestamp,ts,prices,8) );
+    CPPUNIT_ASSERT( 0 == stocklib_history(symbol,q.timestamp+1,INT64_MAX,ts,prices,8) );
+
+    // Failed requests leave no ticks
+    stocklib_p_test_behavior( SLTBGibberishRequest );
+    CPPUNIT_ASSERT( SL_FAIL == stocklib_fetch_quote_synch("HIST",&q) );
+    CPPUNIT_ASSERT( 3 == stocklib_history(symbol,0,INT64_MAX,ts,prices,8) );
+}
+
+void StockLibTestFixture::testArchive()
+{
+    sl_quote_t q;
+    char dir[] = "/tmp/stocklib-archive-XXXXXX";
+    CPPUNIT_ASSERT( mkdtemp(dir) );
+
+    stocklib_p_test_mode(true);
+    stocklib_p_test_behavior( SLTBNormalRequest );
+
+    CPPUNIT_ASSERT( SL_OK == stocklib_archive_open(dir) );
+    CPPUNIT_ASSERT( SL_OK == stocklib_fetch_quote_synch("ARCH",&q) );
+    CPPUNIT_ASSERT( SL_OK == stocklib_fetch_quote_synch("ARCH",&q) );
+    stocklib_archive_close();
+
+    // Not archived once closed
+    CPPUNIT_ASSERT( SL_OK == stocklib_fetch_quote_synch("ARCH",&q) );
+
+    archiveday d;
+    const int64_t day = tickarchive::day(q.timestamp);
+    CPPUNIT_ASSERT( d.open(dir,day) );
+    CPPUNIT_ASSERT( 2 == d.rows() );
+    CPPUNIT_ASSERT( 999900 == d.prices()[1] );
+    CPPUNIT_ASSERT( 2 == d.scan(0,0,INT64_MAX,[](int64_t, int64_t) {}) );
+    d.close();
+
+    const char* extensions[] = { "sym", "ts", "px", "idx" };
+    for ( const char* e : extensions )
+	unlink(tickarchive::path(dir,day,e).c_str());
+    unlink((std::string(dir)+"/symbols").c_str());
+    unlink((std::string(dir)+"/lock").c_str());
+    CPPUNIT_ASSERT( 0 == rmdir(dir) );
+}
+
+/**
+ * Tests that quotes revalue the portfolios loaded from a holdings file
+ */
+void StockLibTestFixture::testPortfolio()
+{
+    sl_quote_t q;
+    char path[] = "/tmp/stocklib-portfolio-XXXXXX";
+    const int fd = mkstemp(path);
+    const char holdings[] = "growth PFA 10 90\n"
+			    "growth PFB 5\n"
+			    "income PFA -2\n";
+    CPPUNIT_ASSERT( sizeof(holdings)-1 == write(fd,holdings,sizeof(holdings)-1) );
+    close(fd);
+
+    stocklib_p_test_mode(true);
+    stocklib_p_test_behavior( SLTBNormalRequest );
+
+    unsigned line;
+    CPPUNIT_ASSERT( SL_OK == stocklib_portfolio_load(path,&line) );
+    unlink(path);
+    CPPUNIT_ASSERT( SL_FAIL == stocklib_portfolio_load(path,&line) );
+
+    sl_valuation_t v;
+    CPPUNIT_ASSERT( SL_OK == stocklib_portfolio_value("growth",&v) );
+    CPPUNIT_ASSERT( 2 == v.positions );
+    CPPUNIT_ASSERT( 0 == v.priced );
+    CPPUNIT_ASSERT( SL_FAIL == stocklib_portfolio_value("value",&v) );
+
+    CPPUNIT_ASSERT( SL_OK == stocklib_fetch_quote_synch("PFA",&q) );
+    CPPUNIT_ASSERT( SL_OK == stocklib_portfolio_value("growth",&v) );
+    CPPUNIT_ASSERT( 1 == v.priced );
+    CPPUNIT_ASSERT( 10*999900 == v.value );
+    CPPUNIT_ASSERT( 10*900000 == v.cost );
+    CPPUNIT_ASSERT( 10*99900 == v.pnl );
+    CPPUNIT_ASSERT( SL_OK == stocklib_portfolio_value("income",&v) );
+    CPPUNIT_ASSERT( -2*999900 == v.value );
+
+    // Quoted by the subscription
+    const sl_subscription_t s = stocklib_portfolio_subscribe(20);
+    CPPUNIT_ASSERT( 0 != s );
+    for ( int i=0; (i<500) && (v.priced<2); i++ )
+    {
+	std::this_thread::sleep_for(std::chrono::milliseconds(10));
+	CPPUNIT_ASSERT( SL_OK == stocklib_portfolio_value("growth",&v) );
+    }
+    CPPUNIT_ASSERT( SL_OK == stocklib_unsubscribe(s) );
+
+    sl_holding_t h[1];
+    CPPUNIT_ASSERT( 2 == stocklib_portfolio_holdings("growth",h,1,&v) );
+    CPPUNIT_ASSERT( 2 == v.priced );
+    CPPUNIT_ASSERT( 15*999900 == v.value );
+    CPPUNIT_ASSERT( stocklib_symbol_id("PFA") == h[0].symbol );
+    CPPUNIT_ASSERT( SLQFPrice == h[0].flags );
+    CPPUNIT_ASSERT( 10*999900 == h[0].value );
+    CPPUNIT_ASSERT( h[0].weight == 10.0/15 );
+    CPPUNIT_ASSERT( 0 == stocklib_portfolio_holdings("value",h,1,nullptr) );
+
+    stocklib_portfolio_clear();
+    CPPUNIT_ASSERT( SL_FAIL == stocklib_portfolio_value("growth",&v) );
+    CPPUNIT_ASSERT( 0 == stocklib_portfolio_subscribe(20) );
+}
+
+namespace
+{
+    void collect_alerts(const sl_alert_t* alerts, unsigned count, void* data)
+    {
+	std::vector<sl_alert_t>* v = static_cast<std::vector<sl_alert_t>*>(data);
+	v->insert(v->end(),alerts,alerts+count);
+    }
+}
+
+/**
+ * Tests that decoded quotes fire price alerts through the callback
+ */
+void StockLibTestFixture::testAlerts()
+{
+    sl_quote_t q;
+    std::vector<sl_alert_t> fired;
+
+    stocklib_p_test_mode(true);
+    stocklib_p_test_behavior( SLTBNormalRequest );
+    stocklib_alert_callback(&collect_alerts,&fired);
+
+    const sl_alert_id_t above = stocklib_alert_add("ALRT",SLADAbove,999000);
+    const sl_alert_id_t below = stocklib_alert_add("ALRT",SLADBelow,500000,SLALRepeat);
+    const sl_alert_id_t gone = stocklib_alert_add("ALRT",SLADBelow,1);
+    CPPUNIT_ASSERT( SL_OK == stocklib_alert_remove(gone) );
+    CPPUNIT_ASSERT( SL_FAIL == stocklib_alert_remove(gone) );
+
+    stocklib_p_record_tick("ALRT",900000);
+    CPPUNIT_ASSERT( fired.empty() );
+
+    // Quoted at 99.99
+    CPPUNIT_ASSERT( SL_OK == stocklib_fetch_quote_synch("ALRT",&q) );
+    CPPUNIT_ASSERT( 1 == fired.size() );
+    CPPUNIT_ASSERT( above == fired[0].alert );
+    CPPUNIT_ASSERT( q.symbol == fired[0].symbol );
+    CPPUNIT_ASSERT( 999900 == fired[0].price );
+    CPPUNIT_ASSERT( q.timestamp == fired[0].timestamp );
+    CPPUNIT_ASSERT( SL_FAIL == stocklib_alert_remove(above) );
+
+    stocklib_p_record_tick("ALRT",400000);
+    CPPUNIT_ASSERT( 2 == fired.size() );
+    CPPUNIT_ASSERT( below == fired[1].alert );
+    CPPUNIT_ASSERT( SLADBelow == fired[1].direction );
+    CPPUNIT_ASSERT( 400000 == fired[1].price );
+
+    // Delivered before an asynchronous request is complete
+    const sl_alert_id_t recovery = stocklib_alert_add("ALRT",SLADAbove,600000);
+    SLHANDLE h = stocklib_fetch_quote_asynch("ALRT",&q);
+    CPPUNIT_ASSERT( SL_OK == stocklib_asynch_wait(h) );
+    stocklib_asynch_dispose(h);
+    CPPUNIT_ASSERT( 3 == fired.size() );
+    CPPUNIT_ASSERT( recovery == fired[2].alert );
+
+    stocklib_alert_callback(NULL,NULL);
+    stocklib_p_record_tick("ALRT",999900);
+    stocklib_p_record_tick("ALRT",400000);
+    CPPUNIT_ASSERT( 3 == fired.size() );
+    CPPUNIT_ASSERT( SL_OK == stocklib_alert_remove(below) );
+}
+
+/**
+ * Tests the breakdown of an asynchronous request's time
+ */
+void StockLibTestFixture::testTiming()
+{
+    sl_quote_t q;
+    sl_timing_t t;
+    stocklib_p_test_mode(true);
+    stocklib_p_test_behavior( SLTBNormalRequest );
+
+    SLHANDLE h = stocklib_fetch_quote_asynch("TIME",&q);
+    CPPUNIT_ASSERT( SL_OK == stocklib_asynch_wait(h) );
+    CPPUNIT_ASSERT( SL_OK == stocklib_asynch_timing(h,&t) );
+    stocklib_asynch_dispose(h);
+
+    // Test mode makes no transfer, so every network phase is zero
+    CPPUNIT_ASSERT( 0 == t.dns_us + t.connect_us + t.tls_us + t.ttfb_us + t.transfer_us );
+    CPPUNIT_ASSERT( t.total_us >= t.queue_us + t.decode_us + t.callback_us );
+    CPPUNIT_ASSERT( t.total_us < 10000000 );
+
+    stocklib_p_test_behavior( SLTBGibberishRequest );
+    h = stocklib_fetch_quote_asynch("TIME",&q);
+    stocklib_asynch_wait(h);
+    CPPUNIT_ASSERT( SL_FAIL == stocklib_asynch_timing(h,&t) );
+    stocklib_asynch_dispose(h);
+}
+
+/**
+ * Tests that disposing of a handle from another thread, as soon as its result
+ * is available, waits for a callback still running on the worker thread
+ */
+void StockLibTestFixture::testDisposeWaitsForCallback()
+{
+    struct probe
+    {
+	std::atomic<bool> finished{false};
+	std::thread::id main;
+    };
+
+    stocklib_p_test_mode(true);
+    stocklib_p_test_behavior( SLTBNormalRequest );
+
+    for ( int i=0; i<20; i++ )
+    {
+	// A callback registered late runs at once on this thread instead, so
+	// repeat until some run on the worker
+	sl_quote_t q;
+	probe p;
+	p.main = std::this_thread::get_id();
+
+	SLHANDLE h = stocklib_fetch_quote_asynch("CALLBACK",&q);
+	stocklib_asynch_register_callback( h,
+					   [](SLHANDLE, void* pData)
+					   {
+					       probe* pp = static_cast<probe*>(pData);
+					       if (std::this_thread::get_id()!=pp->main)
+						   std::this_thread::sleep_for( std::chrono::milliseconds(20) );
+					       pp->finished = true;
+					   },
+					   &p );
+
+	while (!stocklib_is_complete(h))
+	    std::this_thread::yield();
+	stocklib_asynch_dispose(h);
+
+	CPPUNIT_ASSERT( p.finished );
+    }
+}
+
+void StockLibTestFixture::testCallbackOnce()
+{
+    stocklib_p_test_mode(true);
+    stocklib_p_test_behavior( SLTBNormalRequest );
+
+    for ( int i=0; i<200; i++ )
+    {
+	// Registration races the worker finishing the request; whichever way
+	// it goes, the callback must run exactly once
+	sl_quote_t q;
+	std::atomic<int> calls{0};
+
+	SLHANDLE h = stocklib_fetch_quote_asynch("ONCE",&q);
+	stocklib_asynch_register_callback( h,
+					   [](SLHANDLE, void* pData)
+					   {
+					       ++*static_cast<std::atomic<int>*>(pData);
+					   },
+					   &calls );
+
+	while (!stocklib_is_complete(h))
+	    std::this_thread::yield();
+	stocklib_asynch_dispose(h);
+
+	CPPUNIT_ASSERT_EQUAL( 1, calls.load() );
+    }
+}
+
+void StockLibTestFixture::testDisposeBeyondPool()
+{
+    stocklib_p_test_mode(true);
+    stocklib_p_test_behavior( SLTBNormalRequest );
+
+    // More handles than the pool keeps idle, so that some are deleted on
+    // disposal, each while its worker is still in the callback
+    const int count = 100;
+    std::vector<sl_quote_t> quotes(count);
+    std::vector<SLHANDLE> handles(count);
+    for ( int i=0; i<count; i++ )
+    {
+	handles[i] = stocklib_fetch_quote_asynch("POOL",&quotes[i]);
+	stocklib_asynch_register_callback( handles[i],
+					   [](SLHANDLE, void*)
+					   {
+					       std::this_thread::sleep_for( std::chrono::milliseconds(2) );
+					   },
+					   nullptr );
+    }
+
+    for ( auto h : handles )
+    {
+	while (!stocklib_is_complete(h))
+	    std::this_thread::yield();
+	stocklib_asynch_dispose(h);
+    }
+
+    CPPUNIT_ASSERT_EQUAL( SL_OK, stocklib_cleanup() );
+}
+
+void StockLibTestFixture::testDisposeDuringReentrantCallback()
+{
+    struct probe
+    {
+	std::atomic<sl_result_t> result{SL_PENDING};
+	std::thread::id main;
+    };
+
+    stocklib_p_test_mode(true);
+    stocklib_p_test_behavior( SLTBNormalRequest );
+
+    for ( int i=0; i<10; i++ )
+    {
+	// The callback calls back into the library while the handle is being
+	// disposed of, which must not wait for it with the library locked
+	sl_quote_t q;
+	probe p;
+	p.main = std::this_thread::get_id();
+
+	SLHANDLE h = stocklib_fetch_quote_asynch("REENTER",&q);
+	stocklib_asynch_register_callback( h,
+					   [](SLHANDLE h, void* pData)
+					   {
+					       probe* pp = static_cast<probe*>(pData);
+					       if (std::this_thread::get_id()!=pp->main)
+						   std::this_thread::sleep_for( std::chrono::milliseconds(20) );
+					       pp->result = stocklib_asynch_result(h);
+					   },
+					   &p );
+
+	while (!stocklib_is_complete(h))
+	    std::this_thread::yield();
+	stocklib_asynch_dispose(h);
+
+	CPPUNIT_ASSERT_EQUAL( SL_OK, p.result.load() );
+    }
+}
@@ -34,6 +34,28 @@ public:
     void testNameCacheFailedNameLookup();
     void testNameCacheClearOnReset();
     void testNameCacheIndirectCache();
+    void testHandleRecycling();
+    void testQuoteSynch();
+    void testQuoteAsynch();
+    void testQuoteFailure();
+    void testSymbolIds();
+    void testFormatPrice();
+    void testNameCachePersistence();
+    void testNameCacheLimit();
+    void testPriorityFetch();
+    void testPollingCompletion();
+    void testSubscribe();
+    void testSubscribeChangesOnly();
+    void testHistory();
+    void testArchive();
+    void testPortfolio();
+    void testAlerts();
+    void testTiming();
+    void testSubscribeFullBatch();
+    void testDisposeWaitsForCallback();
+    void testCallbackOnce();
+    void testDisposeBeyondPool();
+    void testDisposeDuringReentrantCallback();
     // @}
 
     /** \cond internal */
@@ -53,6 +75,30 @@ public:
     CPPUNIT_TEST( testNameCacheClearOnReset );
     CPPUNIT_TEST( testNameCacheIndirectCache );
 
+    CPPUNIT_TEST( testHandleRecycling );
+
+    CPPUNIT_TEST( testQuoteSynch );
+    CPPUNIT_TEST( testQuoteAsynch );
+    CPPUNIT_TEST( testQuoteFailure );
+    CPPUNIT_TEST( testSymbolIds );
+    CPPUNIT_TEST( testFormatPrice );
+    CPPUNIT_TEST( testNameCachePersistence );
+    CPPUNIT_TEST( testNameCacheLimit );
+    CPPUNIT_TEST( testPriorityFetch );
+    CPPUNIT_TEST( testPollingCompletion );
+    CPPUNIT_TEST( testSubscribe );
+    CPPUNIT_TEST( testSubscribeChangesOnly );
+    CPPUNIT_TEST( testHistory );
+    CPPUNIT_TEST( testArchive );
+    CPPUNIT_TEST( testPortfolio );
+    CPPUNIT_TEST( testAlerts );
+    CPPUNIT_TEST( testTiming );
+    CPPUNIT_TEST( testSubscribeFullBatch );
+    CPPUNIT_TEST( testDisposeWaitsForCallback );
+    CPPUNIT_TEST( testCallbackOnce );
+    CPPUNIT_TEST( testDisposeBeyondPool );
+    CPPUNIT_TEST( testDisposeDuringReentrantCallback );
+
     CPPUNIT_TEST_SUITE_END();
     /** \endcond */
 };
@@ -0,0 +1,347 @@
+#include <vector>
+#include <map>
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <chrono>
+#include <stdexcept>
+
+#include "test-subscriber.h"
+#include <stocklib/subscriber.h>
+
+using std::chrono::milliseconds;
+
+namespace
+{
+    /** Quotes every symbol at a price equal to its identifier */
+    void fake_fetch(const std::vector<sl_symbol_t>& symbols, std::vector<sl_quote_t>& quotes)
+    {
+	for ( const sl_symbol_t s : symbols )
+	    quotes.push_back( sl_quote_t{ s, 0, s, SLQFPrice } );
+    }
+
+    /** Runs each request on a thread of its own */
+    void thread_executor(std::function<void()> job)
+    {
+	std::thread(job).detach();
+    }
+
+    /** Waits up to a second for a condition to become true */
+    template<class F>
+    bool eventually(F condition)
+    {
+	for ( int i=0; i<1000; i++ )
+	{
+	    if (condition())
+		return true;
+	    std::this_thread::sleep_for( milliseconds(1) );
+	}
+	return condition();
+    }
+
+    /** Counts the quotes delivered for each symbol */
+    struct counter
+    {
+	std::mutex m;
+	std::map<sl_symbol_t,int> counts;
+	bool bad_price{false};
+
+	subscriber::deliver_fn fn()
+	{
+	    return [this](const sl_quote_t& q)
+	    {
+		std::lock_guard<std::mutex> l(m);
+		counts[q.symbol]++;
+		if ( (q.price!=(int64_t)q.symbol) || !(q.flags & SLQFPrice) )
+		    bad_price = true;
+	    };
+	}
+
+	int min_count(const std::vector<sl_symbol_t>& symbols)
+	{
+	    std::lock_guard<std::mutex> l(m);
+	    int result = -1;
+	    for ( const sl_symbol_t s : symbols )
+		if ( (result<0) || (counts[s]<result) )
+		    result = counts[s];
+	    return result;
+	}
+
+	int total()
+	{
+	    std::lock_guard<std::mutex> l(m);
+	    int result = 0;
+	    for ( const auto& c : counts )
+		result += c.second;
+	    return result;
+	}
+    };
+}
+
+SubscriberTestFixture::SubscriberTestFixture()
+{
+}
+
+SubscriberTestFixture::~SubscriberTestFixture()
+{
+
+}
+
+void SubscriberTestFixture::setUp()
+{
+}
+
+void SubscriberTestFixture::tearDown()
+{
+}
+
+/**
+ * Tests that every subscribed symbol is fetched repeatedly, and its quote
+ * delivered
+ */
+void SubscriberTestFixture::testRefreshes()
+{
+    counter c;
+    subscriber s(&fake_fetch,&thread_executor);
+    const std::vector<sl_symbol_t> symbols{1,2,3};
+
+    const subscriber::id_t id = s.subscribe(symbols,milliseconds(10),c.fn());
+    CPPUNIT_ASSERT( 0 != id );
+    CPPUNIT_ASSERT( 1 == s.subscriptions() );
+
+    CPPUNIT_ASSERT( eventually( [&]() { return c.min_count(symbols)>=3; } ) );
+    CPPUNIT_ASSERT( s.unsubscribe(id) );
+    CPPUNIT_ASSERT( !c.bad_price );
+    CPPUNIT_ASSERT( 0 == s.subscriptions() );
+}
+
+/**
+ * Tests that symbols falling due together, across subscriptions, are
+ * combined into a few large requests
+ */
+void SubscriberTestFixture::testBatching()
+{
+    counter c;
+    std::atomic<unsigned> largest{0};
+    subscriber s( [&largest](const std::vector<sl_symbol_t>& symbols,
+			     std::vector<sl_quote_t>& quotes)
+		  {
+		      if (symbols.size()>largest)
+			  largest = symbols.size();
+		      fake_fetch(symbols,quotes);
+		  },
+		  &thread_executor, 50, 8, milliseconds(200) );
+
+    std::vector<sl_symbol_t> a, b;
+    for ( sl_symbol_t i=1; i<=100; i++ )
+    {
+	a.push_back(i);
+	b.push_back(i+100);
+    }
+
+    s.subscribe(a,milliseconds(100),c.fn());
+    s.subscribe(b,milliseconds(100),c.fn());
+    CPPUNIT_ASSERT( eventually( [&]() { return c.total()>=200; } ) );
+    s.clear();
+
+    const subscriber::stats_t st = s.stats();
+    CPPUNIT_ASSERT( largest <= 50 );
+    CPPUNIT_ASSERT( st.symbols >= 200 );
+    CPPUNIT_ASSERT( st.requests*10 <= st.symbols );
+    CPPUNIT_ASSERT( st.deliveries == st.symbols );
+}
+
+/**
+ * Tests that no more than the permitted number of requests are outstanding
+ */
+void SubscriberTestFixture::testInflightLimit()
+{
+    counter c;
+    std::atomic<int> running{0};
+    std::atomic<int> most{0};
+
+    subscriber s( [&](const std::vector<sl_symbol_t>& symbols,
+		      std::vector<sl_quote_t>& quotes)
+		  {
+		      const int r = ++running;
+		      if (r>most)
+			  most = r;
+		      std::this_thread::sleep_for( milliseconds(5) );
+		      fake_fetch(symbols,quotes);
+		      running--;
+		  },
+		  &thread_executor, 1, 2, milliseconds(0) );
+
+    std::vector<sl_symbol_t> symbols;
+    for ( sl_symbol_t i=1; i<=20; i++ )
+	symbols.push_back(i);
+
+    s.subscribe(symbols,milliseconds(5),c.fn());
+    CPPUNIT_ASSERT( eventually( [&]() { return c.min_count(symbols)>=1; } ) );
+    s.clear();
+
+    CPPUNIT_ASSERT( most <= 2 );
+    CPPUNIT_ASSERT( !c.bad_price );
+}
+
+/**
+ * Tests that no callback runs after unsubscribing, and that other
+ * subscriptions are unaffected
+ */
+void SubscriberTestFixture::testUnsubscribe()
+{
+    counter c1, c2;
+    subscriber s(&fake_fetch,&thread_executor);
+    const std::vector<sl_symbol_t> symbols{1,2};
+
+    const subscriber::id_t id1 = s.subscribe(symbols,milliseconds(5),c1.fn());
+    s.subscribe(symbols,milliseconds(5),c2.fn());
+    CPPUNIT_ASSERT( eventually( [&]() { return c1.min_count(symbols)>=1; } ) );
+
+    CPPUNIT_ASSERT( s.unsubscribe(id1) );
+    CPPUNIT_ASSERT( !s.unsubscribe(id1) );
+    const int after = c1.total();
+
+    const int before = c2.total();
+    CPPUNIT_ASSERT( eventually( [&]() { return c2.total()>=before+4; } ) );
+    CPPUNIT_ASSERT( after == c1.total() );
+}
+
+/**
+ * Tests that a callback may end its own subscription
+ */
+void SubscriberTestFixture::testUnsubscribeFromCallback()
+{
+    std::atomic<int> calls{0};
+    std::atomic<subscriber::id_t> id{0};
+    subscriber s(&fake_fetch,&thread_executor);
+
+    id = s.subscribe( {1,2,3}, milliseconds(5),
+		      [&](const sl_quote_t&)
+		      {
+			  while (!id)
+			      std::this_thread::yield();
+			  calls++;
+			  s.unsubscribe(id);
+		      } );
+
+    CPPUNIT_ASSERT( eventually( [&]() { return 0==s.subscriptions(); } ) );
+    std::this_thread::sleep_for( milliseconds(30) );
+    CPPUNIT_ASSERT( 1 == calls );
+}
+
+/**
+ * Tests that a failed fetch delivers quotes without prices
+ */
+void SubscriberTestFixture::testFailedFetch()
+{
+    std::atomic<int> failed{0};
+    subscriber s( [](const std::vector<sl_symbol_t>&, std::vector<sl_quote_t>&)
+		  {
+		      throw std::logic_error("No connection");
+		  },
+		  &thread_executor );
+
+    s.subscribe( {7}, milliseconds(5),
+		 [&failed](const sl_quote_t& q)
+		 {
+		     if ( (q.symbol==7) && !(q.flags & SLQFPrice) )
+			 failed++;
+		 } );
+
+    CPPUNIT_ASSERT( eventually( [&]() { return failed>=2; } ) );
+}
+
+/**
+ * Tests that a subscription for changes only receives a quote when the price
+ * moves by at least the minimum tick, or the price is lost
+ */
+void SubscriberTestFixture::testChangesOnly()
+{
+    std::atomic<int64_t> price{1000};
+    std::atomic<bool> fail{false};
+    std::atomic<int> delivered{0};
+    std::atomic<int64_t> last{0};
+
+    subscriber s( [&](const std::vector<sl_symbol_t>& symbols,
+		      std::vector<sl_quote_t>& quotes)
+		  {
+		      for ( const sl_symbol_t sym : symbols )
+			  quotes.push_back( sl_quote_t{ price, 0, sym,
+				      fail ? (uint32_t)SLQFNone : (uint32_t)SLQFPrice } );
+		  },
+		  &thread_executor );
+
+    s.subscribe( {1}, milliseconds(2),
+		 [&](const sl_quote_t& q)
+		 {
+		     last = (q.flags & SLQFPrice) ? q.price : -1;
+		     delivered++;
+		 },
+		 true, 5 );
+
+    // Waits until the symbol has been fetched a few more times
+    auto settle = [&s]()
+    {
+	const uint64_t target = s.stats().symbols + 3;
+	return eventually( [&]() { return s.stats().symbols >= target; } );
+    };
+
+    CPPUNIT_ASSERT( eventually( [&]() { return delivered==1; } ) );
+    CPPUNIT_ASSERT( settle() );
+    CPPUNIT_ASSERT( 1 == delivered );
+    CPPUNIT_ASSERT( s.stats().suppressed >= 3 );
+
+    // A move smaller than the tick is not delivered
+    price = 1004;
+    CPPUNIT_ASSERT( settle() );
+    CPPUNIT_ASSERT( 1 == delivered );
+
+    // Moves accumulate against the last price delivered
+    price = 1005;
+    CPPUNIT_ASSERT( eventually( [&]() { return delivered==2; } ) );
+    CPPUNIT_ASSERT( 1005 == last );
+
+    // Losing the price is delivered once
+    fail = true;
+    CPPUNIT_ASSERT( eventually( [&]() { return delivered==3; } ) );
+    CPPUNIT_ASSERT( settle() );
+    CPPUNIT_ASSERT( 3 == delivered );
+    CPPUNIT_ASSERT( -1 == last );
+
+    s.clear();
+}
+
+/**
+ * Tests that an aligned subscription fetches all its symbols in one request
+ * each interval, even with no coalescing window to gather them
+ */
+void SubscriberTestFixture::testAligned()
+{
+    counter c;
+    std::mutex m;
+    std::vector<std::size_t> sizes;
+    subscriber s( [&](const std::vector<sl_symbol_t>& symbols,
+		      std::vector<sl_quote_t>& quotes)
+		  {
+		      {
+			  std::lock_guard<std::mutex> l(m);
+			  sizes.push_back(symbols.size());
+		      }
+		      fake_fetch(symbols,quotes);
+		  },
+		  &thread_executor, 50, 4, milliseconds(0) );
+
+    std::vector<sl_symbol_t> symbols;
+    for ( sl_symbol_t i=1; i<=30; i++ )
+	symbols.push_back(i);
+
+    s.subscribe(symbols,milliseconds(20),c.fn(),false,0,true);
+    CPPUNIT_ASSERT( eventually( [&]() { return c.min_count(symbols)>=5; } ) );
+    s.clear();
+
+    std::lock_guard<std::mutex> l(m);
+    CPPUNIT_ASSERT( sizes.size() >= 5 );
+    for ( std::size_t n : sizes )
+	CPPUNIT_ASSERT( 30 == n );
+}
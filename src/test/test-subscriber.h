@@ -0,0 +1,48 @@
+#ifndef TEST_SUBSCRIBER_H
+#define TEST_SUBSCRIBER_H
+
+#include <cppunit/TestFixture.h>
+#include <cppunit/TestAssert.h>
+#include <cppunit/TestCaller.h>
+#include <cppunit/TestSuite.h>
+#include <cppunit/TestCase.h>
+
+#include <cppunit/extensions/TestFactoryRegistry.h>
+#include <cppunit/extensions/HelperMacros.h>
+
+class SubscriberTestFixture : public CppUnit::TestFixture
+{
+public:
+    SubscriberTestFixture();
+    virtual ~SubscriberTestFixture();
+
+    void setUp();
+    void tearDown();
+
+    /** @name Test Cases */
+    // @{
+    void testRefreshes();
+    void testBatching();
+    void testInflightLimit();
+    void testUnsubscribe();
+    void testUnsubscribeFromCallback();
+    void testFailedFetch();
+    void testChangesOnly();
+    void testAligned();
+    // @}
+
+    /** \cond internal */
+    CPPUNIT_TEST_SUITE( SubscriberTestFixture );
+    CPPUNIT_TEST( testRefreshes );
+    CPPUNIT_TEST( testBatching );
+    CPPUNIT_TEST( testInflightLimit );
+    CPPUNIT_TEST( testUnsubscribe );
+    CPPUNIT_TEST( testUnsubscribeFromCallback );
+    CPPUNIT_TEST( testFailedFetch );
+    CPPUNIT_TEST( testChangesOnly );
+    CPPUNIT_TEST( testAligned );
+    CPPUNIT_TEST_SUITE_END();
+    /** \endcond */
+};
+
+#endif
@@ -0,0 +1,125 @@
+#include <string.h>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "test-symboltable.h"
+#include <stocklib/symboltable.h>
+
+SymbolTableTestFixture::SymbolTableTestFixture()
+{
+}
+
+SymbolTableTestFixture::~SymbolTableTestFixture()
+{
+
+}
+
+void SymbolTableTestFixture::setUp()
+{
+    _table = new symboltable();
+}
+
+void SymbolTableTestFixture::tearDown()
+{
+    delete _table;
+    _table = nullptr;
+}
+
+/**
+ * Tests that identifiers are dense and stable
+ */
+void SymbolTableTestFixture::testIntern()
+{
+    CPPUNIT_ASSERT( 0 == _table->intern("AAPL") );
+    CPPUNIT_ASSERT( 1 == _table->intern("MSFT") );
+    CPPUNIT_ASSERT( 0 == _table->intern("AAPL") );
+    CPPUNIT_ASSERT( 2 == _table->size() );
+}
+
+/**
+ * Tests lookup without interning
+ */
+void SymbolTableTestFixture::testFind()
+{
+    symboltable::id_t id;
+
+    CPPUNIT_ASSERT( !_table->find("AAPL",id) );
+    _table->intern("AAPL");
+    CPPUNIT_ASSERT( _table->find("AAPL",id) );
+    CPPUNIT_ASSERT( 0 == id );
+    CPPUNIT_ASSERT( !_table->find("AAP",id) );
+    CPPUNIT_ASSERT( 1 == _table->size() );
+}
+
+/**
+ * Tests mapping identifiers back to symbols
+ */
+void SymbolTableTestFixture::testName()
+{
+    symboltable::id_t id = _table->intern("GOOG");
+    CPPUNIT_ASSERT( 0 == strcmp("GOOG",_table->name(id)) );
+    CPPUNIT_ASSERT( nullptr == _table->name(id+1) );
+}
+
+/**
+ * Tests that identifiers and names survive growth of the index
+ */
+void SymbolTableTestFixture::testGrowth()
+{
+    const char* first = _table->name( _table->intern("S0") );
+
+    for ( int i=1; i<50000; i++ )
+	CPPUNIT_ASSERT( (symboltable::id_t)i == _table->intern( ("S"+std::to_string(i)).c_str() ) );
+
+    for ( int i=0; i<50000; i+=997 )
+    {
+	symboltable::id_t id;
+	CPPUNIT_ASSERT( _table->find( ("S"+std::to_string(i)).c_str(), id ) );
+	CPPUNIT_ASSERT( (symboltable::id_t)i == id );
+    }
+
+    CPPUNIT_ASSERT( first == _table->name(0) );
+}
+
+/**
+ * Tests that concurrent interning of the same symbols agrees on identifiers
+ */
+void SymbolTableTestFixture::testConcurrentIntern()
+{
+    const int count = 5000;
+    std::vector<std::vector<symboltable::id_t>> ids(4);
+    std::vector<std::thread> threads;
+
+    for ( int t=0; t<4; t++ )
+    {
+	threads.push_back( std::thread( [this,t,&ids]()
+					{
+					    for ( int i=0; i<count; i++ )
+						ids[t].push_back( this->_table->intern(
+								      ("T"+std::to_string(i)).c_str() ) );
+					} ) );
+    }
+
+    for ( auto& t : threads )
+	t.join();
+
+    CPPUNIT_ASSERT( count == _table->size() );
+    for ( int t=1; t<4; t++ )
+	CPPUNIT_ASSERT( ids[t]==ids[0] );
+}
+
+/**
+ * Tests clearing the table
+ */
+void SymbolTableTestFixture::testClear()
+{
+    symboltable::id_t id;
+
+    _table->intern("AAPL");
+    _table->clear();
+
+    CPPUNIT_ASSERT( 0 == _table->size() );
+    CPPUNIT_ASSERT( !_table->find("AAPL",id) );
+    CPPUNIT_ASSERT( 0 == _table->intern("MSFT") );
+}
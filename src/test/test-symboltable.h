@@ -0,0 +1,49 @@
+#ifndef TEST_SYMBOLTABLE_H
+#define TEST_SYMBOLTABLE_H
+
+#include <cppunit/TestFixture.h>
+#include <cppunit/TestAssert.h>
+#include <cppunit/TestCaller.h>
+#include <cppunit/TestSuite.h>
+#include <cppunit/TestCase.h>
+
+#include <cppunit/extensions/TestFactoryRegistry.h>
+#include <cppunit/extensions/HelperMacros.h>
+
+class symboltable;
+
+class SymbolTableTestFixture : public CppUnit::TestFixture
+{
+public:
+    SymbolTableTestFixture();
+    virtual ~SymbolTableTestFixture();
+
+    void setUp();
+    void tearDown();
+
+    /** @name Test Cases */
+    // @{
+    void testIntern();
+    void testFind();
+    void testName();
+    void testGrowth();
+    void testConcurrentIntern();
+    void testClear();
+    // @}
+
+    /** \cond internal */
+    CPPUNIT_TEST_SUITE( SymbolTableTestFixture );
+    CPPUNIT_TEST( testIntern );
+    CPPUNIT_TEST( testFind );
+    CPPUNIT_TEST( testName );
+    CPPUNIT_TEST( testGrowth );
+    CPPUNIT_TEST( testConcurrentIntern );
+    CPPUNIT_TEST( testClear );
+    CPPUNIT_TEST_SUITE_END();
+    /** \endcond */
+
+private:
+    symboltable* _table{nullptr};
+};
+
+#endif
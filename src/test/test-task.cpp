@@ -170,3 +170,46 @@ void TaskTestFixture::testPerformAsyncFailure()
     CPPUNIT_ASSERT( r == WorkResult::Failure );
     
 }
+
+/**
+ * Tests in-place access to the output
+ */
+void TaskTestFixture::testOutputRef()
+{
+    CPPUNIT_ASSERT_THROW( _task->output_ref(), std::logic_error );
+
+    _task->perform_sync();
+
+    const long& r1 = _task->output_ref();
+    const long& r2 = _task->output_ref();
+    CPPUNIT_ASSERT( SIX_FACTORIAL == r1 );
+    CPPUNIT_ASSERT( &r1 == &r2 );
+
+    _task->reset();
+    CPPUNIT_ASSERT_THROW( _task->output_ref(), std::logic_error );
+
+    _buggy_task->perform_sync();
+    CPPUNIT_ASSERT_THROW( _buggy_task->output_ref(), std::logic_error );
+}
+
+/**
+ * Tests that a task only reports ready once its completion function has
+ * finished, so a poller needs no lock to see the completion's effects
+ */
+void TaskTestFixture::testReadyPublishesCompletion()
+{
+    long copied = 0;
+
+    _task->perform_async( [this,&copied]()
+			  {
+			      std::this_thread::sleep_for( std::chrono::milliseconds(5) );
+			      copied = this->_task->output_ref();
+			  } );
+
+    while (!_task->ready())
+	std::this_thread::yield();
+
+    CPPUNIT_ASSERT( SIX_FACTORIAL == copied );
+    CPPUNIT_ASSERT( WorkResult::Success == _task->result() );
+    _task->wait();
+}
@@ -32,6 +32,8 @@ public:
     void testReset();
     void testPerformSyncFailure();
     void testPerformAsyncFailure();
+    void testOutputRef();
+    void testReadyPublishesCompletion();
     // @}
 
     /** \cond internal */
@@ -43,6 +45,8 @@ public:
     CPPUNIT_TEST( testReset );
     CPPUNIT_TEST( testPerformSyncFailure );
     CPPUNIT_TEST( testPerformAsyncFailure );
+    CPPUNIT_TEST( testOutputRef );
+    CPPUNIT_TEST( testReadyPublishesCompletion );
     CPPUNIT_TEST_SUITE_END();
     /** \endcond */
 
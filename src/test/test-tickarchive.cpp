@@ -0,0 +1,475 @@
+#include <string.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <string>
+#include <vector>
+#include <limits>
+
+#include "test-tickarchive.h"
+#include <stocklib/tickarchive.h>
+
+namespace
+{
+    /** 2015-06-01, in days since the Unix epoch */
+    const int64_t day0 = 16587;
+
+    /** @return A timestamp on day0 (or a later day) */
+    int64_t at(int64_t micros, int64_t days=0)
+    {
+	return (day0+days)*tickarchive::day_length + micros;
+    }
+
+    /** Reads a symbol's ticks from a day into vectors */
+    std::size_t collect(const archiveday& d, tickarchive::id_t symbol, int64_t from, int64_t to,
+			std::vector<int64_t>& ts, std::vector<int64_t>& prices)
+    {
+	return d.scan(symbol,from,to,[&](int64_t t, int64_t p)
+		      {
+			  ts.push_back(t);
+			  prices.push_back(p);
+		      });
+    }
+}
+
+TickArchiveTestFixture::TickArchiveTestFixture()
+{
+}
+
+TickArchiveTestFixture::~TickArchiveTestFixture()
+{
+
+}
+
+void TickArchiveTestFixture::setUp()
+{
+    char path[] = "/tmp/stocklib-archive-XXXXXX";
+    _dir = mkdtemp(path);
+}
+
+void TickArchiveTestFixture::tearDown()
+{
+    if (DIR* d = opendir(_dir.c_str()))
+    {
+	while (struct dirent* e = readdir(d))
+	    if (e->d_name[0]!='.')
+		unlink((_dir+"/"+e->d_name).c_str());
+	closedir(d);
+    }
+    rmdir(_dir.c_str());
+}
+
+/**
+ * Tests that appended ticks can be read back, column by column
+ */
+void TickArchiveTestFixture::testAppendRead()
+{
+    tickarchive a;
+    CPPUNIT_ASSERT( a.open(_dir) );
+    CPPUNIT_ASSERT( a.is_open() );
+    a.append("AAPL",at(1000),1250000);
+    a.append("MSFT",at(2000),470000);
+    a.append("AAPL",at(3000),1251000);
+    CPPUNIT_ASSERT( 3 == a.appended() );
+    a.close();
+    CPPUNIT_ASSERT( !a.is_open() );
+
+    std::vector<std::string> tickers;
+    CPPUNIT_ASSERT( tickarchive::read_symbols(_dir,tickers) );
+    CPPUNIT_ASSERT( 2 == tickers.size() );
+    CPPUNIT_ASSERT( "AAPL" == tickers[0] );
+    CPPUNIT_ASSERT( "MSFT" == tickers[1] );
+
+    const std::vector<int64_t> days = tickarchive::days(_dir);
+    CPPUNIT_ASSERT( 1 == days.size() );
+    CPPUNIT_ASSERT( day0 == days[0] );
+    CPPUNIT_ASSERT( _dir+"/20150601.ts" == tickarchive::path(_dir,day0,"ts") );
+
+    archiveday d;
+    CPPUNIT_ASSERT( d.open(_dir,day0) );
+    CPPUNIT_ASSERT( d.indexed() );
+    CPPUNIT_ASSERT( 3 == d.rows() );
+    CPPUNIT_ASSERT( 0 == d.symbols()[0] );
+    CPPUNIT_ASSERT( 1 == d.symbols()[1] );
+    CPPUNIT_ASSERT( at(2000) == d.timestamps()[1] );
+    CPPUNIT_ASSERT( 1251000 == d.prices()[2] );
+
+    archiveday missing;
+    CPPUNIT_ASSERT( !missing.open(_dir,day0+1) );
+    CPPUNIT_ASSERT( !missing.is_open() );
+}
+
+/**
+ * Tests finding the rows of a time window, and that timestamps are kept in
+ * order
+ */
+void TickArchiveTestFixture::testTimeRange()
+{
+    tickarchive a(4);
+    CPPUNIT_ASSERT( a.open(_dir) );
+    for ( int64_t i=0; i<100; i++ )
+	a.append("IBM",at(i*10),1000+i);
+
+    /* Out of order, stored at the latest time so far */
+    a.append("IBM",at(5),2000);
+    a.close();
+
+    archiveday d;
+    CPPUNIT_ASSERT( d.open(_dir,day0) );
+    CPPUNIT_ASSERT( 101 == d.rows() );
+    CPPUNIT_ASSERT( at(990) == d.timestamps()[100] );
+
+    archiveday::range r = d.between(at(100),at(195));
+    CPPUNIT_ASSERT( 10 == r.first );
+    CPPUNIT_ASSERT( 20 == r.last );
+
+    r = d.between(at(990),at(990));
+    CPPUNIT_ASSERT( 99 == r.first );
+    CPPUNIT_ASSERT( 101 == r.last );
+
+    r = d.between(at(200),at(100));
+    CPPUNIT_ASSERT( r.first == r.last );
+
+    r = d.between(at(-1,1),at(0,2));
+    CPPUNIT_ASSERT( r.first == r.last );
+}
+
+/**
+ * Tests scanning for one symbol's ticks, with and without an index
+ */
+void TickArchiveTestFixture::testSymbolScan()
+{
+    const char* tickers[] = { "AAPL", "MSFT", "GOOG" };
+
+    tickarchive a(8);
+    CPPUNIT_ASSERT( a.open(_dir) );
+    for ( int64_t i=0; i<300; i++ )
+	a.append(tickers[i%3],at(i),i);
+    a.flush();
+
+    /* The day is being written, so has no index yet */
+    std::vector<int64_t> ts, prices;
+    {
+	archiveday d;
+	CPPUNIT_ASSERT( d.open(_dir,day0) );
+	CPPUNIT_ASSERT( !d.indexed() );
+	CPPUNIT_ASSERT( 300 == d.rows() );
+	CPPUNIT_ASSERT( 10 == collect(d,1,at(0),at(29),ts,prices) );
+	CPPUNIT_ASSERT( 1 == prices[0] );
+	CPPUNIT_ASSERT( 28 == prices[9] );
+    }
+
+    a.close();
+
+    archiveday d;
+    CPPUNIT_ASSERT( d.open(_dir,day0) );
+    CPPUNIT_ASSERT( d.indexed() );
+
+    std::size_t count;
+    const uint32_t* rows = d.postings(2,count);
+    CPPUNIT_ASSERT( 100 == count );
+    CPPUNIT_ASSERT( 2 == rows[0] );
+    CPPUNIT_ASSERT( 299 == rows[99] );
+
+    d.postings(7,count);
+    CPPUNIT_ASSERT( 0 == count );
+
+    std::vector<int64_t> ts2, prices2;
+    CPPUNIT_ASSERT( 10 == collect(d,1,at(0),at(29),ts2,prices2) );
+    CPPUNIT_ASSERT( ts == ts2 );
+    CPPUNIT_ASSERT( prices == prices2 );
+
+    CPPUNIT_ASSERT( 100 == d.scan(0,at(0),at(1000),[](int64_t, int64_t) {}) );
+    CPPUNIT_ASSERT( 0 == d.scan(7,at(0),at(1000),[](int64_t, int64_t) {}) );
+}
+
+/**
+ * Tests that each day has its own files, and that a day is indexed when the
+ * next begins
+ */
+void TickArchiveTestFixture::testDayRollover()
+{
+    tickarchive a;
+    CPPUNIT_ASSERT( a.open(_dir) );
+    a.append("AAPL",at(tickarchive::day_length-1),100);
+    a.append("AAPL",at(0,1),101);
+    a.append("MSFT",at(1,1),102);
+    a.flush();
+
+    archiveday first;
+    CPPUNIT_ASSERT( first.open(_dir,day0) );
+    CPPUNIT_ASSERT( first.indexed() );
+    CPPUNIT_ASSERT( 1 == first.rows() );
+
+    archiveday second;
+    CPPUNIT_ASSERT( second.open(_dir,day0+1) );
+    CPPUNIT_ASSERT( !second.indexed() );
+    CPPUNIT_ASSERT( 2 == second.rows() );
+
+    a.close();
+    const std::vector<int64_t> days = tickarchive::days(_dir);
+    CPPUNIT_ASSERT( 2 == days.size() );
+    CPPUNIT_ASSERT( day0+1 == days[1] );
+
+    CPPUNIT_ASSERT( -1 == tickarchive::day(-1) );
+    CPPUNIT_ASSERT( 0 == tickarchive::day(0) );
+}
+
+/**
+ * Tests that a day can be added to by a later writer, keeping symbol
+ * identifiers, and is indexed again when it closes
+ */
+void TickArchiveTestFixture::testReopen()
+{
+    {
+	tickarchive a;
+	CPPUNIT_ASSERT( a.open(_dir) );
+	a.append("AAPL",at(10),1);
+	a.append("MSFT",at(20),2);
+    }
+
+    tickarchive b;
+    CPPUNIT_ASSERT( b.open(_dir) );
+    b.append("MSFT",at(30),3);
+    b.append("IBM",at(15),4);
+    b.close();
+
+    std::vector<std::string> tickers;
+    CPPUNIT_ASSERT( tickarchive::read_symbols(_dir,tickers) );
+    CPPUNIT_ASSERT( 3 == tickers.size() );
+    CPPUNIT_ASSERT( "IBM" == tickers[2] );
+
+    archiveday d;
+    CPPUNIT_ASSERT( d.open(_dir,day0) );
+    CPPUNIT_ASSERT( d.indexed() );
+    CPPUNIT_ASSERT( 4 == d.rows() );
+    CPPUNIT_ASSERT( 1 == d.symbols()[2] );
+    CPPUNIT_ASSERT( at(30) == d.timestamps()[3] );
+
+    std::size_t count;
+    d.postings(1,count);
+    CPPUNIT_ASSERT( 2 == count );
+}
+
+/**
+ * Tests that only one writer may have an archive open
+ */
+void TickArchiveTestFixture::testExclusive()
+{
+    tickarchive a, b;
+    CPPUNIT_ASSERT( a.open(_dir) );
+    CPPUNIT_ASSERT( !b.open(_dir) );
+    CPPUNIT_ASSERT( !b.is_open() );
+
+    /* Appending to an archive that is not open does nothing */
+    b.append("AAPL",at(0),1);
+    CPPUNIT_ASSERT( 0 == b.appended() );
+
+    a.close();
+    CPPUNIT_ASSERT( b.open(_dir) );
+}
+
+/**
+ * Tests that columns left unequal, as by a crash part way through a write,
+ * are cut back to the shortest when the day is next written
+ */
+void TickArchiveTestFixture::testTornColumns()
+{
+    {
+	tickarchive a;
+	CPPUNIT_ASSERT( a.open(_dir) );
+	for ( int64_t i=0; i<10; i++ )
+	    a.append("AAPL",at(i),i);
+    }
+
+    /* Lose the last three symbols and half of one price */
+    const std::string sym = tickarchive::path(_dir,day0,"sym");
+    const std::string px = tickarchive::path(_dir,day0,"px");
+    CPPUNIT_ASSERT( 0 == truncate(sym.c_str(),64+7*sizeof(uint32_t)) );
+    CPPUNIT_ASSERT( 0 == truncate(px.c_str(),64+9*sizeof(int64_t)-4) );
+
+    {
+	archiveday d;
+	CPPUNIT_ASSERT( d.open(_dir,day0) );
+	CPPUNIT_ASSERT( 7 == d.rows() );
+	CPPUNIT_ASSERT( !d.indexed() );
+    }
+
+    tickarchive b;
+    CPPUNIT_ASSERT( b.open(_dir) );
+    b.append("AAPL",at(100),100);
+    b.close();
+
+    archiveday d;
+    CPPUNIT_ASSERT( d.open(_dir,day0) );
+    CPPUNIT_ASSERT( d.indexed() );
+    CPPUNIT_ASSERT( 8 == d.rows() );
+    CPPUNIT_ASSERT( 6 == d.prices()[6] );
+    CPPUNIT_ASSERT( 100 == d.prices()[7] );
+    CPPUNIT_ASSERT( at(100) == d.timestamps()[7] );
+}
+
+/**
+ * Tests that a day whose index is damaged is read without it, through the
+ * symbol column
+ */
+void TickArchiveTestFixture::testDamagedIndex()
+{
+    const char* tickers[] = { "AAPL", "MSFT", "GOOG" };
+    {
+	tickarchive a;
+	CPPUNIT_ASSERT( a.open(_dir) );
+	for ( int64_t i=0; i<300; i++ )
+	    a.append(tickers[i%3],at(i),i);
+    }
+    {
+	archiveday d;
+	CPPUNIT_ASSERT( d.open(_dir,day0) );
+	CPPUNIT_ASSERT( d.indexed() );
+    }
+
+    /* The header is 64 bytes, followed by three 16-byte entries, then the
+       postings */
+    const std::string idx = tickarchive::path(_dir,day0,"idx");
+    const int fd = open(idx.c_str(),O_RDWR);
+    CPPUNIT_ASSERT( fd>=0 );
+
+    uint64_t offset, bad_offset = 1000;
+    CPPUNIT_ASSERT( sizeof(offset) == pread(fd,&offset,sizeof(offset),64+16+8) );
+    CPPUNIT_ASSERT( sizeof(bad_offset) == pwrite(fd,&bad_offset,sizeof(bad_offset),64+16+8) );
+    {
+	archiveday d;
+	CPPUNIT_ASSERT( d.open(_dir,day0) );
+	CPPUNIT_ASSERT( !d.indexed() );
+	CPPUNIT_ASSERT( 100 == d.scan(1,at(0),at(1000),[](int64_t, int64_t) {}) );
+    }
+
+    uint32_t bad_row = 300;
+    CPPUNIT_ASSERT( sizeof(offset) == pwrite(fd,&offset,sizeof(offset),64+16+8) );
+    CPPUNIT_ASSERT( sizeof(bad_row) == pwrite(fd,&bad_row,sizeof(bad_row),64+3*16+4) );
+    {
+	archiveday d;
+	CPPUNIT_ASSERT( d.open(_dir,day0) );
+	CPPUNIT_ASSERT( !d.indexed() );
+	CPPUNIT_ASSERT( 100 == d.scan(0,at(0),at(1000),[](int64_t, int64_t) {}) );
+    }
+    close(fd);
+}
+
+/**
+ * Tests that a compressing archive packs the day when it is sealed, and that
+ * the packed day reads back as written
+ */
+void TickArchiveTestFixture::testPacked()
+{
+    const char* tickers[] = { "AAPL", "MSFT", "GOOG" };
+
+    tickarchive a(64);
+    CPPUNIT_ASSERT( a.open(_dir,true) );
+    for ( int64_t i=0; i<3000; i++ )
+	a.append(tickers[i%3],at(i*1000),1000000+(i%7)*100);
+    a.close();
+
+    archiveday raw;
+    CPPUNIT_ASSERT( !raw.open(_dir,day0) );
+    CPPUNIT_ASSERT( 0 != access(tickarchive::path(_dir,day0,"idx").c_str(),F_OK) );
+    CPPUNIT_ASSERT( 1 == tickarchive::days(_dir).size() );
+
+    packedday d;
+    CPPUNIT_ASSERT( d.open(_dir,day0) );
+    CPPUNIT_ASSERT( 3000 == d.rows() );
+    CPPUNIT_ASSERT( at(2999*1000) == d.last_timestamp() );
+    CPPUNIT_ASSERT( 3 == d.symbols().size() );
+
+    /* A window in the middle of the day, spanning a block boundary */
+    std::vector<int64_t> ts, prices;
+    CPPUNIT_ASSERT( 200 == d.scan(1,at(900000),at(1499000),[&](int64_t t, int64_t p)
+				  {
+				      ts.push_back(t);
+				      prices.push_back(p);
+				  }) );
+    CPPUNIT_ASSERT( at(901000) == ts.front() );
+    CPPUNIT_ASSERT( at(1498000) == ts.back() );
+    CPPUNIT_ASSERT( 1000000+(901%7)*100 == prices.front() );
+
+    int64_t cts[1000], cprices[1000];
+    CPPUNIT_ASSERT( 1000 == d.copy(2,std::numeric_limits<int64_t>::min(),
+				   std::numeric_limits<int64_t>::max(),cts,cprices,1000) );
+    CPPUNIT_ASSERT( at(2000) == cts[0] );
+    CPPUNIT_ASSERT( at(2999000) == cts[999] );
+    CPPUNIT_ASSERT( 10 == d.copy(2,at(0),at(2999000),cts,cprices,10) );
+    CPPUNIT_ASSERT( at(29000) == cts[9] );
+    CPPUNIT_ASSERT( 0 == d.copy(9,at(0),at(2999000),cts,cprices,10) );
+    CPPUNIT_ASSERT( 0 == d.copy(2,at(10),at(0),cts,cprices,10) );
+
+    /* Much smaller than the columns it replaced */
+    struct stat st;
+    CPPUNIT_ASSERT( 0 == stat(tickarchive::path(_dir,day0,"tkz").c_str(),&st) );
+    CPPUNIT_ASSERT( st.st_size*5 < 3000*20 );
+}
+
+/**
+ * Tests adding to a day that has already been packed
+ */
+void TickArchiveTestFixture::testPackedReopen()
+{
+    {
+	tickarchive a;
+	CPPUNIT_ASSERT( a.open(_dir,true) );
+	a.append("AAPL",at(10),1);
+	a.append("MSFT",at(20),2);
+    }
+
+    tickarchive b;
+    CPPUNIT_ASSERT( b.open(_dir,true) );
+    b.append("AAPL",at(5),3);
+    b.append("IBM",at(40),4);
+    b.close();
+
+    packedday d;
+    CPPUNIT_ASSERT( d.open(_dir,day0) );
+    CPPUNIT_ASSERT( 4 == d.rows() );
+
+    int64_t ts[4], prices[4];
+    CPPUNIT_ASSERT( 2 == d.copy(0,0,std::numeric_limits<int64_t>::max(),ts,prices,4) );
+    CPPUNIT_ASSERT( at(10) == ts[0] );
+    CPPUNIT_ASSERT( at(20) == ts[1] );
+    CPPUNIT_ASSERT( 3 == prices[1] );
+    CPPUNIT_ASSERT( 1 == d.copy(2,0,std::numeric_limits<int64_t>::max(),ts,prices,4) );
+}
+
+/**
+ * Tests packing a day written without compression
+ */
+void TickArchiveTestFixture::testPack()
+{
+    tickarchive a;
+    CPPUNIT_ASSERT( a.open(_dir) );
+    for ( int64_t i=0; i<500; i++ )
+	a.append( (i%2) ? "AAPL" : "MSFT", at(i), i );
+    a.close();
+
+    packedday d;
+    CPPUNIT_ASSERT( !d.open(_dir,day0) );
+    CPPUNIT_ASSERT( !tickarchive::pack(_dir,day0+1) );
+    CPPUNIT_ASSERT( tickarchive::pack(_dir,day0) );
+    CPPUNIT_ASSERT( tickarchive::pack(_dir,day0) );
+
+    CPPUNIT_ASSERT( d.open(_dir,day0) );
+    CPPUNIT_ASSERT( 500 == d.rows() );
+    std::size_t odd = 0;
+    CPPUNIT_ASSERT( 250 == d.scan(0,at(0),at(499),[&odd](int64_t t, int64_t p)
+				  {
+				      if ( (p%2) && (t==at(p)) )
+					  odd++;
+				  }) );
+    CPPUNIT_ASSERT( 0 == odd );
+    CPPUNIT_ASSERT( 250 == d.scan(1,at(0),at(499),[&odd](int64_t t, int64_t p)
+				  {
+				      if ( (p%2) && (t==at(p)) )
+					  odd++;
+				  }) );
+    CPPUNIT_ASSERT( 250 == odd );
+}
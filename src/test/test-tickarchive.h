@@ -0,0 +1,59 @@
+#ifndef TEST_TICKARCHIVE_H
+#define TEST_TICKARCHIVE_H
+
+#include <cppunit/TestFixture.h>
+#include <cppunit/TestAssert.h>
+#include <cppunit/TestCaller.h>
+#include <cppunit/TestSuite.h>
+#include <cppunit/TestCase.h>
+
+#include <cppunit/extensions/TestFactoryRegistry.h>
+#include <cppunit/extensions/HelperMacros.h>
+
+#include <string>
+
+class TickArchiveTestFixture : public CppUnit::TestFixture
+{
+public:
+    TickArchiveTestFixture();
+    virtual ~TickArchiveTestFixture();
+
+    void setUp();
+    void tearDown();
+
+    /** @name Test Cases */
+    // @{
+    void testAppendRead();
+    void testTimeRange();
+    void testSymbolScan();
+    void testDayRollover();
+    void testReopen();
+    void testExclusive();
+    void testTornColumns();
+    void testDamagedIndex();
+    void testPacked();
+    void testPackedReopen();
+    void testPack();
+    // @}
+
+    /** \cond internal */
+    CPPUNIT_TEST_SUITE( TickArchiveTestFixture );
+    CPPUNIT_TEST( testAppendRead );
+    CPPUNIT_TEST( testTimeRange );
+    CPPUNIT_TEST( testSymbolScan );
+    CPPUNIT_TEST( testDayRollover );
+    CPPUNIT_TEST( testReopen );
+    CPPUNIT_TEST( testExclusive );
+    CPPUNIT_TEST( testTornColumns );
+    CPPUNIT_TEST( testDamagedIndex );
+    CPPUNIT_TEST( testPacked );
+    CPPUNIT_TEST( testPackedReopen );
+    CPPUNIT_TEST( testPack );
+    CPPUNIT_TEST_SUITE_END();
+    /** \endcond */
+
+private:
+    std::string _dir;
+};
+
+#endif
@@ -0,0 +1,176 @@
+#include <vector>
+#include <random>
+#include <limits>
+#include <cstdint>
+
+#include "test-tickcodec.h"
+#include <stocklib/tickcodec.h>
+
+namespace
+{
+    /**
+     * Encodes ticks in blocks, then decodes every block and checks that the
+     * ticks come back unchanged
+     *
+     * @return The bytes taken by the encoded ticks, including block headers
+     */
+    std::size_t round_trip(const std::vector<int64_t>& ts, const std::vector<int64_t>& prices)
+    {
+	std::vector<tickcodec::block> blocks;
+	std::vector<uint8_t> data;
+	for ( std::size_t i=0; i<ts.size(); i+=tickcodec::block_size )
+	{
+	    tickcodec::block b;
+	    tickcodec::encode(&ts[i],&prices[i],
+			      std::min(tickcodec::block_size,ts.size()-i),b,data);
+	    CPPUNIT_ASSERT( tickcodec::encoded_size(b) == data.size()-b.offset );
+	    blocks.push_back(b);
+	}
+	const std::size_t size = data.size() + blocks.size()*sizeof(tickcodec::block);
+	data.resize(data.size()+tickcodec::padding);
+
+	std::size_t row = 0;
+	int64_t out_ts[tickcodec::block_size];
+	int64_t out_prices[tickcodec::block_size];
+	for ( const tickcodec::block& b : blocks )
+	{
+	    tickcodec::decode(b,data.data(),out_ts,out_prices);
+	    CPPUNIT_ASSERT( ts[row] == b.first_timestamp );
+	    CPPUNIT_ASSERT( ts[row+b.count-1] == b.last_timestamp );
+	    for ( std::size_t i=0; i<b.count; i++, row++ )
+	    {
+		CPPUNIT_ASSERT( ts[row] == out_ts[i] );
+		CPPUNIT_ASSERT( prices[row] == out_prices[i] );
+	    }
+	}
+	CPPUNIT_ASSERT( ts.size() == row );
+
+	return size;
+    }
+}
+
+TickCodecTestFixture::TickCodecTestFixture()
+{
+}
+
+TickCodecTestFixture::~TickCodecTestFixture()
+{
+
+}
+
+void TickCodecTestFixture::setUp()
+{
+}
+
+void TickCodecTestFixture::tearDown()
+{
+}
+
+/**
+ * Tests that random walks of many step sizes survive encoding
+ */
+void TickCodecTestFixture::testRoundTrip()
+{
+    std::mt19937_64 random(42);
+
+    for ( int64_t step : { 0, 1, 100, 10000, 1000000000 } )
+    {
+	std::uniform_int_distribution<int64_t> move(-step,step);
+	std::vector<int64_t> ts, prices;
+	int64_t t = 1433116800000000LL;
+	int64_t p = 1250000;
+	for ( int i=0; i<1000; i++ )
+	{
+	    t += 1000000 + move(random);
+	    p += move(random);
+	    ts.push_back(t);
+	    prices.push_back(p);
+	}
+	round_trip(ts,prices);
+    }
+}
+
+/**
+ * Tests values which need the full 64 bits
+ */
+void TickCodecTestFixture::testExtremes()
+{
+    const int64_t lo = std::numeric_limits<int64_t>::min();
+    const int64_t hi = std::numeric_limits<int64_t>::max();
+
+    std::vector<int64_t> ts, prices;
+    for ( int i=0; i<300; i++ )
+    {
+	ts.push_back( (i%2) ? hi : lo+i );
+	prices.push_back( (i%3) ? hi-i : lo+i );
+    }
+    round_trip(ts,prices);
+
+    // Every width, so values straddle words at every offset
+    std::mt19937_64 random(7);
+    for ( unsigned bits=1; bits<64; bits++ )
+    {
+	std::vector<int64_t> t, p;
+	for ( int i=0; i<100; i++ )
+	{
+	    t.push_back(i);
+	    p.push_back( static_cast<int64_t>(random() >> (64-bits)) );
+	}
+	round_trip(t,p);
+    }
+}
+
+/**
+ * Tests blocks of one, two and three ticks, which have no delta-of-deltas or
+ * no XORs
+ */
+void TickCodecTestFixture::testShortBlocks()
+{
+    for ( std::size_t n=1; n<=3; n++ )
+    {
+	std::vector<int64_t> ts, prices;
+	for ( std::size_t i=0; i<n; i++ )
+	{
+	    ts.push_back(1000+i*7);
+	    prices.push_back(500-i*3);
+	}
+	round_trip(ts,prices);
+    }
+
+    std::vector<int64_t> ts(1,5), prices(1,5);
+    tickcodec::block b;
+    std::vector<uint8_t> data;
+    tickcodec::encode(ts.data(),prices.data(),1,b,data);
+    CPPUNIT_ASSERT( data.empty() );
+}
+
+/**
+ * Tests the size of a typical polled stream: one quote a second with a
+ * little jitter, moving a few cents at a time
+ */
+void TickCodecTestFixture::testCompression()
+{
+    std::mt19937_64 random(1);
+    std::uniform_int_distribution<int64_t> jitter(-500,500);
+    std::uniform_int_distribution<int64_t> cents(-3,3);
+
+    std::vector<int64_t> ts, prices;
+    int64_t t = 1433116800000000LL;
+    int64_t p = 1250000;
+    for ( int i=0; i<10000; i++ )
+    {
+	t += 1000000 + jitter(random);
+	p += 100*cents(random);
+	ts.push_back(t);
+	prices.push_back(p);
+    }
+
+    const std::size_t raw = ts.size()*(sizeof(int64_t)*2 + sizeof(uint32_t));
+    const std::size_t packed = round_trip(ts,prices);
+    CPPUNIT_ASSERT( packed*6 < raw );
+
+    // Strictly periodic polling compresses timestamps to nothing
+    for ( std::size_t i=0; i<ts.size(); i++ )
+	ts[i] = 1433116800000000LL + i*1000000LL;
+    CPPUNIT_ASSERT( round_trip(ts,prices)*10 < raw );
+}
@@ -0,0 +1,40 @@
+#ifndef TEST_TICKCODEC_H
+#define TEST_TICKCODEC_H
+
+#include <cppunit/TestFixture.h>
+#include <cppunit/TestAssert.h>
+#include <cppunit/TestCaller.h>
+#include <cppunit/TestSuite.h>
+#include <cppunit/TestCase.h>
+
+#include <cppunit/extensions/TestFactoryRegistry.h>
+#include <cppunit/extensions/HelperMacros.h>
+
+class TickCodecTestFixture : public CppUnit::TestFixture
+{
+public:
+    TickCodecTestFixture();
+    virtual ~TickCodecTestFixture();
+
+    void setUp();
+    void tearDown();
+
+    /** @name Test Cases */
+    // @{
+    void testRoundTrip();
+    void testExtremes();
+    void testShortBlocks();
+    void testCompression();
+    // @}
+
+    /** \cond internal */
+    CPPUNIT_TEST_SUITE( TickCodecTestFixture );
+    CPPUNIT_TEST( testRoundTrip );
+    CPPUNIT_TEST( testExtremes );
+    CPPUNIT_TEST( testShortBlocks );
+    CPPUNIT_TEST( testCompression );
+    CPPUNIT_TEST_SUITE_END();
+    /** \endcond */
+};
+
+#endif
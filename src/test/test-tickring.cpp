@@ -0,0 +1,218 @@
+#include <vector>
+#include <atomic>
+#include <thread>
+#include <limits>
+#include <cstdint>
+
+#include "test-tickring.h"
+#include <stocklib/tickring.h>
+
+namespace
+{
+    const int64_t all_time = std::numeric_limits<int64_t>::max();
+
+    /** Reads a view into vectors, oldest first */
+    void flatten(const tickring::view& v, std::vector<int64_t>& ts, std::vector<int64_t>& prices)
+    {
+	for ( const tickring::span& s : v.parts )
+	    for ( std::size_t i=0; i<s.count; i++ )
+	    {
+		ts.push_back(s.timestamps[i]);
+		prices.push_back(s.prices[i]);
+	    }
+    }
+}
+
+TickRingTestFixture::TickRingTestFixture()
+{
+}
+
+TickRingTestFixture::~TickRingTestFixture()
+{
+
+}
+
+void TickRingTestFixture::setUp()
+{
+}
+
+void TickRingTestFixture::tearDown()
+{
+}
+
+/**
+ * Tests selecting ticks by time window
+ */
+void TickRingTestFixture::testWindow()
+{
+    tickring r(8);
+    CPPUNIT_ASSERT( r.capacity() >= 8 );
+    CPPUNIT_ASSERT( 0 == r.window(0,all_time).count() );
+
+    for ( int64_t t=1; t<=5; t++ )
+	CPPUNIT_ASSERT( r.push(t*10,t*100) );
+
+    const tickring::view v = r.window(20,40);
+    CPPUNIT_ASSERT( 3 == v.count() );
+    CPPUNIT_ASSERT( 0 == v.parts[1].count );
+    CPPUNIT_ASSERT( 20 == v.parts[0].timestamps[0] );
+    CPPUNIT_ASSERT( 400 == v.parts[0].prices[2] );
+    CPPUNIT_ASSERT( r.valid(v) );
+
+    CPPUNIT_ASSERT( 2 == r.window(35,1000).count() );
+    CPPUNIT_ASSERT( 0 == r.window(51,1000).count() );
+    CPPUNIT_ASSERT( 0 == r.window(21,29).count() );
+    CPPUNIT_ASSERT( 5 == r.pushed() );
+
+    int64_t ts, price;
+    CPPUNIT_ASSERT( r.latest(ts,price) );
+    CPPUNIT_ASSERT( 50 == ts );
+    CPPUNIT_ASSERT( 500 == price );
+}
+
+/**
+ * Tests that a full ring keeps the most recent ticks, and that a window
+ * across the end of the arrays comes back as two spans
+ */
+void TickRingTestFixture::testWrap()
+{
+    tickring r(8);
+    const int64_t n = r.capacity()*3 + 5;
+
+    for ( int64_t t=1; t<=n; t++ )
+	r.push(t,-t);
+
+    const tickring::view v = r.window(0,all_time);
+    CPPUNIT_ASSERT( r.capacity() == v.count() );
+    CPPUNIT_ASSERT( v.parts[1].count > 0 );
+
+    std::vector<int64_t> ts, prices;
+    flatten(v,ts,prices);
+    CPPUNIT_ASSERT( r.valid(v) );
+
+    for ( std::size_t i=0; i<ts.size(); i++ )
+    {
+	CPPUNIT_ASSERT( n - (int64_t)r.capacity() + 1 + (int64_t)i == ts[i] );
+	CPPUNIT_ASSERT( -ts[i] == prices[i] );
+    }
+
+    // The ticks of an old view have since been overwritten
+    for ( int64_t t=n+1; t<=n+(int64_t)r.capacity(); t++ )
+	r.push(t,-t);
+    CPPUNIT_ASSERT( !r.valid(v) );
+}
+
+/**
+ * Tests copying a window into contiguous arrays
+ */
+void TickRingTestFixture::testCopy()
+{
+    tickring r(64);
+    for ( int64_t t=1; t<=100; t++ )
+	r.push(t,t*2);
+
+    int64_t ts[8], prices[8];
+    CPPUNIT_ASSERT( 3 == r.copy(90,92,ts,prices,8) );
+    CPPUNIT_ASSERT( 90 == ts[0] && 92 == ts[2] );
+    CPPUNIT_ASSERT( 184 == prices[2] );
+
+    // Only the most recent ticks are copied when there are too many
+    CPPUNIT_ASSERT( 8 == r.copy(0,all_time,ts,prices,8) );
+    CPPUNIT_ASSERT( 93 == ts[0] );
+    CPPUNIT_ASSERT( 100 == ts[7] );
+}
+
+/**
+ * Tests that ticks older than the latest are ignored, and equal timestamps
+ * accepted
+ */
+void TickRingTestFixture::testOrdering()
+{
+    tickring r(8);
+    CPPUNIT_ASSERT( r.push(10,1) );
+    CPPUNIT_ASSERT( r.push(10,2) );
+    CPPUNIT_ASSERT( !r.push(9,3) );
+    CPPUNIT_ASSERT( 2 == r.window(0,all_time).count() );
+}
+
+/**
+ * Tests that the arrays and rings are cache-line aligned
+ */
+void TickRingTestFixture::testLayout()
+{
+    tickhistory h(16);
+    h.record(1,1,1);
+    h.record(2,1,1);
+
+    const tickring* r1 = h.find(1);
+    const tickring* r2 = h.find(2);
+    CPPUNIT_ASSERT( 0 == reinterpret_cast<uintptr_t>(r1) % 64 );
+    CPPUNIT_ASSERT( 0 == reinterpret_cast<uintptr_t>(r2) % 64 );
+    CPPUNIT_ASSERT( 0 == sizeof(tickring) % 64 );
+
+    const tickring::view v = r1->window(0,all_time);
+    CPPUNIT_ASSERT( 0 == reinterpret_cast<uintptr_t>(v.parts[0].timestamps) % 64 );
+    CPPUNIT_ASSERT( 0 == reinterpret_cast<uintptr_t>(v.parts[0].prices) % 64 );
+}
+
+/**
+ * Tests that readers always see consistent ticks while the writer wraps the
+ * ring many times
+ */
+void TickRingTestFixture::testConcurrentReaders()
+{
+    tickring r(32);
+    std::atomic<bool> done{false};
+    std::atomic<int> bad{0};
+
+    std::vector<std::thread> readers;
+    for ( int i=0; i<3; i++ )
+	readers.push_back( std::thread( [&]()
+	{
+	    int64_t ts[64], prices[64];
+	    while (!done)
+	    {
+		const std::size_t n = r.copy(0,all_time,ts,prices,64);
+		for ( std::size_t j=0; j<n; j++ )
+		{
+		    if ( (prices[j]!=ts[j]*3) || ( (j>0) && (ts[j]!=ts[j-1]+1) ) )
+			bad++;
+		}
+	    }
+	} ) );
+
+    for ( int64_t t=1; t<=200000; t++ )
+	r.push(t,t*3);
+    done = true;
+
+    for ( auto& t : readers )
+	t.join();
+
+    CPPUNIT_ASSERT( 0 == bad );
+}
+
+/**
+ * Tests the per-symbol collection of rings
+ */
+void TickRingTestFixture::testHistory()
+{
+    tickhistory h(16);
+    CPPUNIT_ASSERT( nullptr == h.find(1) );
+
+    h.record(1,100,5);
+    h.record(1,200,6);
+    h.record(5000,100,7);
+    CPPUNIT_ASSERT( 2 == h.symbols() );
+    CPPUNIT_ASSERT( nullptr == h.find(2) );
+    CPPUNIT_ASSERT( 2 == h.find(1)->window(0,all_time).count() );
+    CPPUNIT_ASSERT( 1 == h.find(5000)->window(0,all_time).count() );
+
+    h.configure(100);
+    h.record(2,1,1);
+    CPPUNIT_ASSERT( h.find(2)->capacity() >= 100 );
+    CPPUNIT_ASSERT( h.find(1)->capacity() < 100 );
+
+    h.clear();
+    CPPUNIT_ASSERT( 0 == h.symbols() );
+    CPPUNIT_ASSERT( nullptr == h.find(1) );
+}
@@ -0,0 +1,46 @@
+#ifndef TEST_TICKRING_H
+#define TEST_TICKRING_H
+
+#include <cppunit/TestFixture.h>
+#include <cppunit/TestAssert.h>
+#include <cppunit/TestCaller.h>
+#include <cppunit/TestSuite.h>
+#include <cppunit/TestCase.h>
+
+#include <cppunit/extensions/TestFactoryRegistry.h>
+#include <cppunit/extensions/HelperMacros.h>
+
+class TickRingTestFixture : public CppUnit::TestFixture
+{
+public:
+    TickRingTestFixture();
+    virtual ~TickRingTestFixture();
+
+    void setUp();
+    void tearDown();
+
+    /** @name Test Cases */
+    // @{
+    void testWindow();
+    void testWrap();
+    void testCopy();
+    void testOrdering();
+    void testLayout();
+    void testConcurrentReaders();
+    void testHistory();
+    // @}
+
+    /** \cond internal */
+    CPPUNIT_TEST_SUITE( TickRingTestFixture );
+    CPPUNIT_TEST( testWindow );
+    CPPUNIT_TEST( testWrap );
+    CPPUNIT_TEST( testCopy );
+    CPPUNIT_TEST( testOrdering );
+    CPPUNIT_TEST( testLayout );
+    CPPUNIT_TEST( testConcurrentReaders );
+    CPPUNIT_TEST( testHistory );
+    CPPUNIT_TEST_SUITE_END();
+    /** \endcond */
+};
+
+#endif